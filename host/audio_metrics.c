@@ -0,0 +1,158 @@
+#include "audio_metrics.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FFT_N        AUDIO_METRICS_FFT_SIZE
+#define FFT_HOP      (FFT_N / 2)
+#define POWER_FLOOR  1e-10      // -100 dBFS, keeps silent bins finite
+
+int audio_metrics_best_lag(const int16_t *ref, size_t ref_n,
+                           const int16_t *test, size_t test_n, int max_lag)
+{
+    int best_lag = 0;
+    double best = -INFINITY;
+
+    for (int lag = -max_lag; lag <= max_lag; lag++) {
+        // test[i + lag] lines up with ref[i]
+        size_t start = lag < 0 ? (size_t)-lag : 0;
+        double sum = 0.0;
+        for (size_t i = start; i < ref_n && i + lag < test_n; i++) {
+            sum += (double)ref[i] * test[i + lag];
+        }
+        // Ties (periodic signals) go to the smallest |lag|
+        if (sum > best || (sum == best && abs(lag) < abs(best_lag))) {
+            best = sum;
+            best_lag = lag;
+        }
+    }
+    return best_lag;
+}
+
+double audio_metrics_snr_db(const int16_t *ref, const int16_t *test, size_t n)
+{
+    double signal = 0.0, noise = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        double d = (double)test[i] - ref[i];
+        signal += (double)ref[i] * ref[i];
+        noise += d * d;
+    }
+    if (noise == 0.0) {
+        return AUDIO_METRICS_SNR_MAX_DB;
+    }
+    if (signal == 0.0) {
+        return -AUDIO_METRICS_SNR_MAX_DB;
+    }
+    double snr = 10.0 * log10(signal / noise);
+    return snr > AUDIO_METRICS_SNR_MAX_DB ? AUDIO_METRICS_SNR_MAX_DB : snr;
+}
+
+// In-place iterative radix-2 FFT, n a power of two
+static void fft(double *re, double *im, size_t n)
+{
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j |= bit;
+        if (i < j) {
+            double t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    for (size_t len = 2; len <= n; len <<= 1) {
+        double angle = -2.0 * M_PI / len;
+        for (size_t i = 0; i < n; i += len) {
+            for (size_t k = 0; k < len / 2; k++) {
+                double wr = cos(angle * k), wi = sin(angle * k);
+                size_t a = i + k, b = a + len / 2;
+                double xr = re[b] * wr - im[b] * wi;
+                double xi = re[b] * wi + im[b] * wr;
+                re[b] = re[a] - xr; im[b] = im[a] - xi;
+                re[a] += xr;        im[a] += xi;
+            }
+        }
+    }
+}
+
+// Power spectrum in dB of one windowed frame (zero-padded past n)
+static void frame_spectrum_db(const int16_t *x, size_t n, const double *window, double *out_db)
+{
+    double re[FFT_N], im[FFT_N];
+    for (size_t i = 0; i < FFT_N; i++) {
+        re[i] = i < n ? x[i] / 32768.0 * window[i] : 0.0;
+        im[i] = 0.0;
+    }
+    fft(re, im, FFT_N);
+    for (size_t k = 0; k <= FFT_N / 2; k++) {
+        double power = (re[k] * re[k] + im[k] * im[k]) / FFT_N;
+        out_db[k] = 10.0 * log10(power + POWER_FLOOR);
+    }
+}
+
+double audio_metrics_lsd_db(const int16_t *ref, const int16_t *test, size_t n)
+{
+    double window[FFT_N];
+    double ref_db[FFT_N / 2 + 1], test_db[FFT_N / 2 + 1];
+    for (size_t i = 0; i < FFT_N; i++) {
+        window[i] = 0.5 - 0.5 * cos(2.0 * M_PI * i / FFT_N);
+    }
+
+    double total = 0.0;
+    size_t frames = 0;
+    size_t pos = 0;
+    do {
+        size_t len = n - pos < FFT_N ? n - pos : FFT_N;
+        frame_spectrum_db(ref + pos, len, window, ref_db);
+        frame_spectrum_db(test + pos, len, window, test_db);
+
+        double sum = 0.0;
+        for (size_t k = 0; k <= FFT_N / 2; k++) {
+            double d = ref_db[k] - test_db[k];
+            sum += d * d;
+        }
+        total += sqrt(sum / (FFT_N / 2 + 1));
+        frames++;
+        pos += FFT_HOP;
+    } while (pos + FFT_HOP < n);
+
+    return total / frames;
+}
+
+size_t audio_metrics_clipped(const int16_t *samples, size_t n)
+{
+    size_t clipped = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (samples[i] >= AUDIO_METRICS_CLIP_LEVEL || samples[i] <= -AUDIO_METRICS_CLIP_LEVEL) {
+            clipped++;
+        }
+    }
+    return clipped;
+}
+
+void audio_metrics_compare(const int16_t *ref, size_t ref_n,
+                           const int16_t *test, size_t test_n,
+                           uint32_t sample_rate, int max_lag, audio_metrics_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->clipped = audio_metrics_clipped(test, test_n);
+    out->length_diff_ms = ((double)test_n - (double)ref_n) * 1000.0 / sample_rate;
+    out->lag_samples = audio_metrics_best_lag(ref, ref_n, test, test_n, max_lag);
+
+    // Overlap of ref[i] and test[i + lag]
+    size_t ref_start = out->lag_samples < 0 ? (size_t)-out->lag_samples : 0;
+    size_t test_start = out->lag_samples > 0 ? (size_t)out->lag_samples : 0;
+    if (ref_start >= ref_n || test_start >= test_n) {
+        out->snr_db = -AUDIO_METRICS_SNR_MAX_DB;
+        return;
+    }
+    size_t n = ref_n - ref_start;
+    if (test_n - test_start < n) {
+        n = test_n - test_start;
+    }
+
+    out->snr_db = audio_metrics_snr_db(ref + ref_start, test + test_start, n);
+    out->lsd_db = audio_metrics_lsd_db(ref + ref_start, test + test_start, n);
+}
@@ -0,0 +1,38 @@
+#ifndef AUDIO_METRICS_H
+#define AUDIO_METRICS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Objective audio comparison for the host harness and tools: a test signal
+// against a reference (golden) signal of the same sample rate.
+
+#define AUDIO_METRICS_SNR_MAX_DB   120.0    // reported when the signals are identical
+#define AUDIO_METRICS_FFT_SIZE     512
+#define AUDIO_METRICS_CLIP_LEVEL   32767    // |sample| at or above this counts as clipped
+
+typedef struct {
+    double snr_db;              // reference energy over difference energy, after alignment
+    double lsd_db;              // log-spectral distance, mean over frames
+    size_t clipped;             // clipped samples in the test signal
+    int lag_samples;            // test delayed (+) or early (-) relative to the reference
+    double length_diff_ms;      // test length minus reference length
+} audio_metrics_t;
+
+// Lag in [-max_lag, max_lag] that maximises the cross-correlation
+int audio_metrics_best_lag(const int16_t *ref, size_t ref_n,
+                           const int16_t *test, size_t test_n, int max_lag);
+
+double audio_metrics_snr_db(const int16_t *ref, const int16_t *test, size_t n);
+
+// Hann-windowed frames of AUDIO_METRICS_FFT_SIZE with 50% overlap
+double audio_metrics_lsd_db(const int16_t *ref, const int16_t *test, size_t n);
+
+size_t audio_metrics_clipped(const int16_t *samples, size_t n);
+
+// All of the above: align test to ref, then measure the overlapping part
+void audio_metrics_compare(const int16_t *ref, size_t ref_n,
+                           const int16_t *test, size_t test_n,
+                           uint32_t sample_rate, int max_lag, audio_metrics_t *out);
+
+#endif // AUDIO_METRICS_H
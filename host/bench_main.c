@@ -0,0 +1,24 @@
+// Host runner for the kernel microbenchmarks in main/audio_bench.c.
+// Cycles are TSC ticks on x86 and nanoseconds elsewhere (see shim/esp_cpu.h).
+//
+//   build-host/audio_bench > bench.jsonl
+//   node nodejs_bridge/tools/bench_compare.js baseline.jsonl bench.jsonl
+#include "esp_log.h"
+#include "audio_bench.h"
+#include "dlog.h"
+
+host_config_t host_config = {
+    .server_ip = "127.0.0.1",
+    .server_port = 8080,
+    .local_port = 3333,
+    .speed = 1.0,
+    .log_level = ESP_LOG_WARN,
+};
+
+int main(void)
+{
+    // Same recorder setup as on the device, so dlog_record is measured with its formatter task
+    dlog_init();
+    audio_bench_run();
+    return 0;
+}
@@ -0,0 +1,579 @@
+// Golden-audio regression suite for the capture and playback chains.
+// Each case pushes a WAV through the real firmware processing on the host
+// build and compares the result with a committed golden WAV:
+//
+//   capture:  48 kHz mic WAV -> i2s_channel_read -> audio_capture_chunk_to_buffer
+//             -> AUDIO_SAMPLE_RATE_UPLINK (24 kHz, or 16 kHz: goldens named <case>_16k)
+//   playback: 24 kHz WAV -> audio_playback_queue_push (1440-byte chunks) -> queue_playback_task
+//             -> i2s_channel_write -> 24 kHz speaker WAV
+//
+// Metrics per case: SNR and log-spectral distance against the golden output,
+// clipped samples, timing error (cross-correlation lag and length change) and
+// throughput as audio seconds per CPU second. Any case outside the thresholds
+// fails the run (exit 1). Results are printed as JSON lines, like audio_bench.
+//
+//   build-host/audio_golden                       # compare against host/golden
+//   build-host/audio_golden --update              # regenerate the golden files
+//   build-host/audio_golden --corpus ~/wavs       # add 48 kHz (capture) / 24 kHz (playback) WAVs
+//
+// The built-in corpus is synthesized deterministically, so only the outputs
+// are committed. Each case runs in its own process: the I2S shim owns one mic
+// and one speaker WAV per process.
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "audio_handler.h"
+#include "audio_metrics.h"
+#include "telemetry.h"
+#include "wav.h"
+#include <dirent.h>
+#include <getopt.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifndef GOLDEN_DIR
+#define GOLDEN_DIR "golden"
+#endif
+
+#define PLAYBACK_CHUNK_BYTES 1440       // downlink chunk size from the bridge
+#define MAX_CASES            64
+#define MAX_LAG_MS           20
+
+host_config_t host_config = {
+    .server_ip = "127.0.0.1",
+    .server_port = 8080,
+    .local_port = 3333,
+    .speed = 200.0,
+    .log_level = ESP_LOG_WARN,
+};
+
+typedef enum {
+    CHAIN_CAPTURE,
+    CHAIN_PLAYBACK,
+} chain_t;
+
+static const char *chain_names[] = { "capture", "playback" };
+
+typedef struct {
+    const char *name;
+    chain_t chain;
+    uint32_t duration_ms;
+    void (*generate)(int16_t *out, size_t n, uint32_t rate);
+} builtin_case_t;
+
+typedef struct {
+    char name[96];              // <chain>_<case>
+    chain_t chain;
+    char input[PATH_MAX];
+} golden_case_t;
+
+typedef struct {
+    double min_snr_db;
+    double max_lsd_db;
+    double max_timing_ms;
+    double min_rtf;
+} thresholds_t;
+
+// ---- Built-in corpus ----
+
+static uint32_t lcg_state;
+
+static int16_t lcg_noise(void)
+{
+    lcg_state = lcg_state * 1664525 + 1013904223;
+    return (int16_t)(lcg_state >> 16);
+}
+
+static int16_t saturate(double v)
+{
+    return v > 32767.0 ? 32767 : v < -32768.0 ? -32768 : (int16_t)lrint(v);
+}
+
+static void gen_tone_1k(int16_t *out, size_t n, uint32_t rate)
+{
+    for (size_t i = 0; i < n; i++) {
+        out[i] = saturate(8000.0 * sin(2.0 * M_PI * 1000.0 * i / rate));
+    }
+}
+
+// Log sweep 50 Hz .. 20 kHz: shows aliasing in the 2x decimator
+static void gen_sweep(int16_t *out, size_t n, uint32_t rate)
+{
+    const double f0 = 50.0, f1 = 20000.0;
+    double duration = (double)n / rate;
+    double k = log(f1 / f0);
+    for (size_t i = 0; i < n; i++) {
+        double t = (double)i / rate;
+        double phase = 2.0 * M_PI * f0 * duration / k * (exp(t / duration * k) - 1.0);
+        out[i] = saturate(12000.0 * sin(phase));
+    }
+}
+
+// Voiced-speech stand-in: 140 Hz harmonics shaped by two formants, 4 Hz syllable envelope, breath noise
+static void gen_speech_like(int16_t *out, size_t n, uint32_t rate)
+{
+    lcg_state = 2024;
+    for (size_t i = 0; i < n; i++) {
+        double t = (double)i / rate;
+        double v = 0.0;
+        for (int h = 1; h * 140.0 < rate / 2.0 && h <= 40; h++) {
+            double f = h * 140.0;
+            double formants = exp(-pow((f - 700.0) / 250.0, 2)) + 0.5 * exp(-pow((f - 1200.0) / 300.0, 2));
+            v += (0.05 + formants) / h * sin(2.0 * M_PI * f * t);
+        }
+        double envelope = 0.5 - 0.5 * cos(2.0 * M_PI * 4.0 * t);
+        out[i] = saturate(9000.0 * envelope * v + lcg_noise() / 200.0);
+    }
+}
+
+// Overdriven 300 Hz sine, flat-topped at full scale
+static void gen_near_clip(int16_t *out, size_t n, uint32_t rate)
+{
+    for (size_t i = 0; i < n; i++) {
+        out[i] = saturate(40000.0 * sin(2.0 * M_PI * 300.0 * i / rate));
+    }
+}
+
+// audio_test_tx_with_known_sample(): 800 Hz at moderate volume
+static void gen_known_sample(int16_t *out, size_t n, uint32_t rate)
+{
+    for (size_t i = 0; i < n; i++) {
+        out[i] = (int16_t)(sin(2.0 * M_PI * 800.0 * i / rate) * 8000);
+    }
+}
+
+// audio_test_abrupt_ending(): 1 kHz, no fade, ends mid-chunk
+static void gen_abrupt_ending(int16_t *out, size_t n, uint32_t rate)
+{
+    for (size_t i = 0; i < n; i++) {
+        out[i] = (int16_t)(sin(2.0 * M_PI * 1000.0 * i / rate) * 16000);
+    }
+}
+
+static const builtin_case_t builtin_cases[] = {
+    { "tone_1k", CHAIN_CAPTURE, 500, gen_tone_1k },
+    { "sweep", CHAIN_CAPTURE, 500, gen_sweep },
+    { "speech_like", CHAIN_CAPTURE, 500, gen_speech_like },
+    { "near_clip", CHAIN_CAPTURE, 500, gen_near_clip },
+    { "known_sample", CHAIN_PLAYBACK, 500, gen_known_sample },
+    { "abrupt_ending", CHAIN_PLAYBACK, 500, gen_abrupt_ending },
+    { "speech_like", CHAIN_PLAYBACK, 500, gen_speech_like },
+};
+
+static uint32_t chain_input_rate(chain_t chain)
+{
+    return chain == CHAIN_CAPTURE ? AUDIO_SAMPLE_RATE_CAPTURE : AUDIO_SAMPLE_RATE_OUTPUT;
+}
+
+static uint32_t chain_output_rate(chain_t chain)
+{
+    return chain == CHAIN_CAPTURE ? AUDIO_SAMPLE_RATE_UPLINK : AUDIO_SAMPLE_RATE_OUTPUT;
+}
+
+// Golden file of a case: the 24 kHz outputs keep the plain name, other rates
+// get their own set (a 16 kHz uplink build runs the 3x FIR decimator)
+static void golden_path(char *out, size_t size, const char *dir, const golden_case_t *c)
+{
+    uint32_t rate = chain_output_rate(c->chain);
+    if (rate == AUDIO_SAMPLE_RATE_OUTPUT) {
+        snprintf(out, size, "%s/%s.wav", dir, c->name);
+    } else {
+        snprintf(out, size, "%s/%s_%luk.wav", dir, c->name, (unsigned long)(rate / 1000));
+    }
+}
+
+static bool write_wav(const char *path, const int16_t *samples, size_t n, uint32_t rate)
+{
+    wav_file_t wav;
+    if (!wav_open_write(&wav, path, rate, 1, 16)) {
+        return false;
+    }
+    wav_write(&wav, samples, n * sizeof(int16_t));
+    wav_close(&wav);
+    return true;
+}
+
+// Whole mono PCM16 file; returns NULL (and logs) on anything else
+static int16_t *read_wav(const char *path, size_t *n, uint32_t *rate)
+{
+    wav_file_t wav;
+    if (!wav_open_read(&wav, path)) {
+        return NULL;
+    }
+    if (wav.channels != 1 || wav.bits_per_sample != 16) {
+        fprintf(stderr, "%s: need 16-bit mono PCM\n", path);
+        wav_close(&wav);
+        return NULL;
+    }
+    int16_t *samples = malloc(wav.data_bytes + sizeof(int16_t));
+    if (!samples) {
+        wav_close(&wav);
+        return NULL;
+    }
+    *n = wav_read(&wav, samples, wav.data_bytes) / sizeof(int16_t);
+    if (rate) {
+        *rate = wav.sample_rate;
+    }
+    wav_close(&wav);
+    return samples;
+}
+
+// ---- Processing chains (run in a child process) ----
+
+static int run_capture_chain(const char *output)
+{
+    if (audio_init() != ESP_OK || audio_start_streaming() != ESP_OK) {
+        return 1;
+    }
+
+    wav_file_t out;
+    if (!wav_open_write(&out, output, AUDIO_SAMPLE_RATE_UPLINK, 1, 16)) {
+        return 1;
+    }
+
+    // The chunk that hits the end of the mic WAV is zero-padded by the I2S shim and still kept
+    uint8_t chunk[AUDIO_CHUNK_SIZE_UPLINK];
+    host_i2s_stats_t i2s = { 0 };
+    while (!i2s.mic_done) {
+        size_t bytes = 0;
+        if (audio_capture_chunk_to_buffer(chunk, &bytes) != ESP_OK) {
+            wav_close(&out);
+            return 1;
+        }
+        wav_write(&out, chunk, bytes);
+        host_i2s_get_stats(&i2s);
+    }
+
+    audio_stop_streaming(NULL);
+    wav_close(&out);
+    return 0;
+}
+
+static int run_playback_chain(const char *input)
+{
+    size_t n = 0;
+    int16_t *samples = read_wav(input, &n, NULL);
+    if (!samples) {
+        return 1;
+    }
+    if (audio_init() != ESP_OK || audio_playback_queue_init() != ESP_OK) {
+        free(samples);
+        return 1;
+    }
+
+    // Pushed back to back right after start, like a burst from the bridge; the
+    // task's pre-buffer wait keeps the order deterministic
+    audio_stats_t stats;
+    audio_get_stats(&stats);
+    uint32_t sessions = stats.playback_sessions;
+    audio_playback_queue_start();
+    const uint8_t *pcm = (const uint8_t *)samples;
+    size_t total = n * sizeof(int16_t);
+    uint32_t seq = 0;
+    for (size_t off = 0; off < total; off += PLAYBACK_CHUNK_BYTES, seq++) {
+        size_t len = total - off < PLAYBACK_CHUNK_BYTES ? total - off : PLAYBACK_CHUNK_BYTES;
+        if (audio_playback_queue_push(pcm + off, len, seq, off + len == total) != ESP_OK) {
+            free(samples);
+            return 1;
+        }
+    }
+
+    // The task registers itself when it starts (before counting the session)
+    // and unregisters after the drain and DMA silence flush
+    do {
+        vTaskDelay(pdMS_TO_TICKS(10));
+        audio_get_stats(&stats);
+    } while (stats.playback_sessions == sessions || telemetry_get_task(TELEMETRY_TASK_PLAYBACK) != NULL);
+
+    free(samples);
+    return 0;
+}
+
+// Runs one chain in a child process; returns CPU seconds used, or < 0 on failure
+static double run_case(const golden_case_t *c, const char *output)
+{
+    struct rusage before, after;
+    getrusage(RUSAGE_CHILDREN, &before);
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return -1.0;
+    }
+    if (pid == 0) {
+        int rc;
+        if (c->chain == CHAIN_CAPTURE) {
+            host_config.mic_wav = c->input;
+            rc = run_capture_chain(output);
+        } else {
+            host_config.speaker_wav = output;
+            rc = run_playback_chain(c->input);
+        }
+        host_i2s_close();
+        fflush(stdout);
+        // Firmware tasks may still be parked; leave without tearing them down
+        _exit(rc);
+    }
+
+    int status = 0;
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "%s: %s chain failed\n", c->name, chain_names[c->chain]);
+        return -1.0;
+    }
+
+    getrusage(RUSAGE_CHILDREN, &after);
+    double cpu_before = before.ru_utime.tv_sec + before.ru_stime.tv_sec +
+                        (before.ru_utime.tv_usec + before.ru_stime.tv_usec) / 1e6;
+    double cpu_after = after.ru_utime.tv_sec + after.ru_stime.tv_sec +
+                       (after.ru_utime.tv_usec + after.ru_stime.tv_usec) / 1e6;
+    return cpu_after - cpu_before;
+}
+
+// ---- Suite ----
+
+static size_t add_builtin_cases(golden_case_t *cases, const char *work_dir)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < sizeof(builtin_cases) / sizeof(builtin_cases[0]); i++) {
+        const builtin_case_t *b = &builtin_cases[i];
+        golden_case_t *c = &cases[count];
+        uint32_t rate = chain_input_rate(b->chain);
+        size_t n = (size_t)rate * b->duration_ms / 1000;
+
+        int16_t *samples = malloc(n * sizeof(int16_t));
+        if (!samples) {
+            continue;
+        }
+        b->generate(samples, n, rate);
+
+        snprintf(c->name, sizeof(c->name), "%s_%s", chain_names[b->chain], b->name);
+        snprintf(c->input, sizeof(c->input), "%s/%s_in.wav", work_dir, c->name);
+        c->chain = b->chain;
+        if (write_wav(c->input, samples, n, rate)) {
+            count++;
+        }
+        free(samples);
+    }
+    return count;
+}
+
+// 48 kHz files feed the capture chain, 24 kHz files the playback chain
+static size_t add_corpus_dir(golden_case_t *cases, size_t count, const char *dir_path)
+{
+    DIR *dir = opendir(dir_path);
+    if (!dir) {
+        perror(dir_path);
+        return count;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL && count < MAX_CASES) {
+        const char *dot = strrchr(entry->d_name, '.');
+        if (!dot || strcmp(dot, ".wav") != 0) {
+            continue;
+        }
+
+        golden_case_t *c = &cases[count];
+        snprintf(c->input, sizeof(c->input), "%s/%s", dir_path, entry->d_name);
+
+        wav_file_t wav;
+        if (!wav_open_read(&wav, c->input)) {
+            continue;
+        }
+        uint32_t rate = wav.sample_rate;
+        wav_close(&wav);
+
+        if (rate == AUDIO_SAMPLE_RATE_CAPTURE) {
+            c->chain = CHAIN_CAPTURE;
+        } else if (rate == AUDIO_SAMPLE_RATE_OUTPUT) {
+            c->chain = CHAIN_PLAYBACK;
+        } else {
+            fprintf(stderr, "%s: %lu Hz, skipped (need 48000 or 24000)\n", c->input, (unsigned long)rate);
+            continue;
+        }
+        snprintf(c->name, sizeof(c->name), "%s_%.*s", chain_names[c->chain],
+                 (int)(dot - entry->d_name), entry->d_name);
+        count++;
+    }
+    closedir(dir);
+    return count;
+}
+
+static bool copy_file(const char *from, const char *to)
+{
+    FILE *in = fopen(from, "rb");
+    FILE *out = in ? fopen(to, "wb") : NULL;
+    bool ok = in && out;
+    char buf[8192];
+    size_t n;
+    while (ok && (n = fread(buf, 1, sizeof(buf), in)) > 0) {
+        ok = fwrite(buf, 1, n, out) == n;
+    }
+    if (in) fclose(in);
+    if (out) fclose(out);
+    return ok;
+}
+
+static bool check_case(const golden_case_t *c, const char *output, const char *golden,
+                       double cpu_s, const thresholds_t *limits)
+{
+    size_t out_n = 0, golden_n = 0;
+    uint32_t rate = chain_output_rate(c->chain), golden_rate = 0;
+    int16_t *out = read_wav(output, &out_n, NULL);
+    int16_t *ref = read_wav(golden, &golden_n, &golden_rate);
+    if (!out || !ref) {
+        fprintf(stderr, "%s: missing output or golden file %s (run with --update)\n", c->name, golden);
+        free(out);
+        free(ref);
+        return false;
+    }
+    if (golden_rate != rate) {
+        fprintf(stderr, "%s: golden file %s is %lu Hz, the chain outputs %lu Hz\n",
+                c->name, golden, (unsigned long)golden_rate, (unsigned long)rate);
+        free(out);
+        free(ref);
+        return false;
+    }
+
+    audio_metrics_t m;
+    audio_metrics_compare(ref, golden_n, out, out_n, rate, rate * MAX_LAG_MS / 1000, &m);
+    size_t golden_clipped = audio_metrics_clipped(ref, golden_n);
+    double timing_ms = fabs(m.lag_samples * 1000.0 / rate) + fabs(m.length_diff_ms);
+    double rtf = cpu_s > 0 ? (double)out_n / rate / cpu_s : INFINITY;
+
+    bool pass = m.snr_db >= limits->min_snr_db &&
+                m.lsd_db <= limits->max_lsd_db &&
+                m.clipped <= golden_clipped &&
+                timing_ms <= limits->max_timing_ms &&
+                rtf >= limits->min_rtf;
+
+    printf("{\"bench\":\"golden\",\"chain\":\"%s\",\"case\":\"%s\",\"samples\":%zu,"
+           "\"snr_db\":%.2f,\"lsd_db\":%.3f,\"clipped\":%zu,\"golden_clipped\":%zu,"
+           "\"lag_samples\":%d,\"length_diff_ms\":%.2f,\"cpu_ms\":%.2f,\"rtf\":%.1f,\"pass\":%s}\n",
+           chain_names[c->chain], c->name, out_n, m.snr_db, m.lsd_db, m.clipped, golden_clipped,
+           m.lag_samples, m.length_diff_ms, cpu_s * 1000.0, isinf(rtf) ? 0.0 : rtf,
+           pass ? "true" : "false");
+
+    free(out);
+    free(ref);
+    return pass;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --golden DIR        golden outputs (default %s)\n"
+            "  --corpus DIR        extra input WAVs: 48 kHz -> capture, 24 kHz -> playback\n"
+            "  --update            write the outputs as the new golden files\n"
+            "  --min-snr DB        fail below this SNR against the golden (default 60)\n"
+            "  --max-lsd DB        fail above this log-spectral distance (default 0.5)\n"
+            "  --max-timing-ms MS  fail above this |lag| + |length change| (default 1)\n"
+            "  --min-rtf X         fail below X seconds of audio per CPU second (default 20)\n"
+            "  --speed X           virtual clock speed for the chains (default 200)\n",
+            prog, GOLDEN_DIR);
+}
+
+int main(int argc, char **argv)
+{
+    const char *golden_dir = GOLDEN_DIR;
+    const char *corpus_dir = NULL;
+    bool update = false;
+    thresholds_t limits = {
+        .min_snr_db = 60.0,
+        .max_lsd_db = 0.5,
+        .max_timing_ms = 1.0,
+        .min_rtf = 20.0,
+    };
+
+    static const struct option options[] = {
+        { "golden", required_argument, NULL, 'g' },
+        { "corpus", required_argument, NULL, 'c' },
+        { "update", no_argument, NULL, 'u' },
+        { "min-snr", required_argument, NULL, 's' },
+        { "max-lsd", required_argument, NULL, 'l' },
+        { "max-timing-ms", required_argument, NULL, 't' },
+        { "min-rtf", required_argument, NULL, 'r' },
+        { "speed", required_argument, NULL, 'x' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 },
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", options, NULL)) != -1) {
+        switch (opt) {
+            case 'g': golden_dir = optarg; break;
+            case 'c': corpus_dir = optarg; break;
+            case 'u': update = true; break;
+            case 's': limits.min_snr_db = atof(optarg); break;
+            case 'l': limits.max_lsd_db = atof(optarg); break;
+            case 't': limits.max_timing_ms = atof(optarg); break;
+            case 'r': limits.min_rtf = atof(optarg); break;
+            case 'x': host_config.speed = atof(optarg); break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (host_config.speed <= 0) {
+        fprintf(stderr, "--speed must be positive\n");
+        return 1;
+    }
+
+    char work_dir[] = "/tmp/audio_golden.XXXXXX";
+    if (!mkdtemp(work_dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    if (update) {
+        mkdir(golden_dir, 0755);
+    }
+
+    static golden_case_t cases[MAX_CASES];
+    size_t count = add_builtin_cases(cases, work_dir);
+    if (corpus_dir) {
+        count = add_corpus_dir(cases, count, corpus_dir);
+    }
+
+    int failed = 0;
+    for (size_t i = 0; i < count; i++) {
+        const golden_case_t *c = &cases[i];
+        char output[PATH_MAX], golden[PATH_MAX];
+        snprintf(output, sizeof(output), "%s/%s_out.wav", work_dir, c->name);
+        golden_path(golden, sizeof(golden), golden_dir, c);
+
+        double cpu_s = run_case(c, output);
+        if (cpu_s < 0) {
+            failed++;
+            continue;
+        }
+
+        if (update) {
+            if (!copy_file(output, golden)) {
+                fprintf(stderr, "%s: cannot write %s\n", c->name, golden);
+                failed++;
+                continue;
+            }
+            fprintf(stderr, "updated %s\n", golden);
+        }
+        if (!check_case(c, output, golden, cpu_s, &limits)) {
+            failed++;
+        }
+        unlink(output);
+        if (strncmp(c->input, work_dir, strlen(work_dir)) == 0) {
+            unlink(c->input);
+        }
+    }
+    rmdir(work_dir);
+
+    fprintf(stderr, "%zu cases, %d failed\n", count, failed);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,189 @@
+// Host-native build of the firmware.
+// Runs the real app_main(), capture, playback, state machine and UDP protocol
+// code on Linux: I2S reads come from a WAV file, playback goes to a WAV file
+// and the UDP client talks to a bridge over local sockets. --speed runs the
+// virtual clock (esp_timer, ticks, I2S pacing) faster than wall time.
+//
+//   cmake -S host -B build-host && cmake --build build-host
+//   build-host/voice_host --mic speech_48k.wav --speaker out_24k.wav --server 127.0.0.1
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "telemetry.h"
+#include "audio_handler.h"
+#include "audio_loopback.h"
+#include <getopt.h>
+#include <stdbool.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+host_config_t host_config = {
+    .server_ip = "127.0.0.1",
+    .server_port = 8080,
+    .local_port = 3333,
+    .speed = 1.0,
+    .log_level = ESP_LOG_INFO,
+    .loopback_delay_us = 5000,
+};
+
+void app_main(void);
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    stop_requested = 1;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --mic FILE          capture input, 16-bit mono 48 kHz WAV (default: silence)\n"
+            "  --speaker FILE      write playback to a 16-bit mono 24 kHz WAV\n"
+            "  --server IP         bridge address (default 127.0.0.1)\n"
+            "  --port N            bridge UDP port (default 8080)\n"
+            "  --local-port N      device UDP port (default 3333)\n"
+            "  --speed X           run the virtual clock X times faster than real time (default 1)\n"
+            "  --duration-ms N     stop after N ms of virtual time\n"
+            "  --tail-ms N         keep running N ms after the mic WAV ends (default 3000)\n"
+            "  --log-level N       0=none .. 5=verbose (default 3)\n"
+            "  --loopback-gain G   the mic also hears the speaker at gain G (acoustic echo path)\n"
+            "  --loopback-delay-ms N  delay of that path (default 5)\n"
+            "  --loopback-test     run the loopback self-test (audio_loopback_run) and exit\n",
+            prog);
+}
+
+static void app_main_task(void *pvParameters)
+{
+    app_main();
+    vTaskDelete(NULL);
+}
+
+static volatile bool loopback_done = false;
+static volatile bool loopback_ok = false;
+
+static void loopback_test_task(void *pvParameters)
+{
+    audio_loopback_result_t result;
+    loopback_ok = audio_init() == ESP_OK && audio_loopback_run(&result) == ESP_OK;
+    loopback_done = true;
+    vTaskDelete(NULL);
+}
+
+static void print_summary(void)
+{
+    telemetry_snapshot_t s;
+    host_i2s_stats_t i2s;
+    telemetry_build_snapshot(&s);
+    host_i2s_get_stats(&i2s);
+
+    printf("\n==== host run summary (%.1f s virtual) ====\n", host_time_us() / 1e6);
+    printf("capture:  %lu chunks, %llu bytes, %lu errors, %lu DMA overflows\n",
+           (unsigned long)s.chunks_captured, (unsigned long long)i2s.bytes_captured,
+           (unsigned long)s.capture_errors, (unsigned long)i2s.rx_overflows);
+    printf("network:  sent %lu, received %lu, lost %lu, send errors %lu\n",
+           (unsigned long)s.packets_sent, (unsigned long)s.packets_received,
+           (unsigned long)s.packets_lost, (unsigned long)s.send_errors);
+    printf("playback: %lu chunks, %llu bytes, %lu sessions, %lu queue underruns, %lu DMA underruns\n",
+           (unsigned long)s.chunks_played, (unsigned long long)i2s.bytes_played,
+           (unsigned long)s.playback_sessions, (unsigned long)s.underruns,
+           (unsigned long)i2s.tx_underruns);
+    printf("state:    %lu changes, %lu interrupts, final state %u\n",
+           (unsigned long)s.state_changes, (unsigned long)s.interrupts, s.voice_state);
+}
+
+int main(int argc, char **argv)
+{
+    int64_t duration_ms = 0;
+    int64_t tail_ms = 3000;
+    bool loopback_test = false;
+
+    static const struct option options[] = {
+        { "mic", required_argument, NULL, 'm' },
+        { "speaker", required_argument, NULL, 's' },
+        { "server", required_argument, NULL, 'a' },
+        { "port", required_argument, NULL, 'p' },
+        { "local-port", required_argument, NULL, 'l' },
+        { "speed", required_argument, NULL, 'x' },
+        { "duration-ms", required_argument, NULL, 'd' },
+        { "tail-ms", required_argument, NULL, 't' },
+        { "log-level", required_argument, NULL, 'v' },
+        { "loopback-gain", required_argument, NULL, 'g' },
+        { "loopback-delay-ms", required_argument, NULL, 'D' },
+        { "loopback-test", no_argument, NULL, 'L' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 },
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", options, NULL)) != -1) {
+        switch (opt) {
+            case 'm': host_config.mic_wav = optarg; break;
+            case 's': host_config.speaker_wav = optarg; break;
+            case 'a': host_config.server_ip = optarg; break;
+            case 'p': host_config.server_port = atoi(optarg); break;
+            case 'l': host_config.local_port = atoi(optarg); break;
+            case 'x': host_config.speed = atof(optarg); break;
+            case 'd': duration_ms = atoll(optarg); break;
+            case 't': tail_ms = atoll(optarg); break;
+            case 'v': host_config.log_level = atoi(optarg); break;
+            case 'g': host_config.loopback_gain = atof(optarg); break;
+            case 'D': host_config.loopback_delay_us = (int64_t)(atof(optarg) * 1000); break;
+            case 'L': loopback_test = true; break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (host_config.speed <= 0) {
+        fprintf(stderr, "--speed must be positive\n");
+        return 1;
+    }
+
+    if (loopback_test) {
+        // Just the I2S side of the firmware: no WiFi, no bridge
+        xTaskCreate(loopback_test_task, "loopback", 8192, NULL, 5, NULL);
+        while (!loopback_done) {
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
+        host_i2s_close();
+        fflush(stdout);
+        _exit(loopback_ok ? 0 : 1);
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    // app_main() returns once the firmware tasks are running, like on the device
+    xTaskCreate(app_main_task, "main", 8192, NULL, 1, NULL);
+
+    int64_t mic_done_us = 0;
+    while (!stop_requested) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+
+        int64_t now_us = host_time_us();
+        if (duration_ms > 0 && now_us >= duration_ms * 1000) {
+            break;
+        }
+
+        host_i2s_stats_t i2s;
+        host_i2s_get_stats(&i2s);
+        if (i2s.mic_done && mic_done_us == 0) {
+            mic_done_us = now_us;
+        }
+        if (mic_done_us && now_us - mic_done_us >= tail_ms * 1000) {
+            break;
+        }
+    }
+
+    host_i2s_close();
+    print_summary();
+    fflush(stdout);
+
+    // The firmware tasks never return; leave without tearing them down
+    _exit(0);
+}
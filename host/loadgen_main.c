@@ -0,0 +1,724 @@
+// Synthetic device load for sizing the bridge: many simulated devices in
+// one process, speaking the firmware's UDP protocol (udp_client.h).
+//
+//   cmake -S host -B build-host && cmake --build build-host
+//   build-host/voice_loadgen --devices 200 --wav speech_24k.wav --duration-s 60
+//
+// Each device has its own socket and does what the firmware does on the
+// wire: HELLO (and again on HELLO_REQUEST), a clock sync burst, then 40 ms
+// uplink chunks at real-time pacing run through the capture state machine
+// of main.c (speech starts a stream, SILENCE_DURATION_MS of quiet ends it,
+// loud audio while the AI speaks interrupts). Chunks come from the WAV,
+// looped, each device starting at a different point of it. Downlink
+// PLAY_AUDIO goes into a simulated playout (pre-buffer, then drained at
+// 24 kHz), which reports PLAYBACK_STARTED and, after the last chunk has
+// played, PLAYBACK_COMPLETE. State messages drive the state machine.
+//
+// Reported per device (--per-device) and over all devices: downlink loss
+// (sequence gaps), interarrival jitter (RFC 3550, against the chunks'
+// playback times), playout underruns and turn latency, from the end of
+// speech (first quiet chunk) to the first PLAY_AUDIO and to the start of
+// playout. --json prints {"loadgen":...} lines instead of tables.
+#include "esp_log.h"
+#include "udp_client.h"
+#include "clock_sync.h"
+#include "audio_handler.h"
+#include "wav.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <getopt.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+host_config_t host_config = {
+    .server_ip = "127.0.0.1",
+    .server_port = 8080,
+    .local_port = 0,
+    .speed = 1.0,
+    .log_level = ESP_LOG_WARN,
+};
+
+// Capture thresholds, as in main.c
+#define RMS_THRESHOLD_NORMAL    100
+#define RMS_THRESHOLD_INTERRUPT 400
+
+#define CHUNK_US                (AUDIO_CHUNK_DURATION_MS * 1000)
+#define PCM_BYTES_PER_MS        (AUDIO_SAMPLE_RATE_OUTPUT * 2 / 1000)
+#define PREBUFFER_CHUNKS        10      // audio_handler.c default
+#define MAX_TURNS               4096    // latency samples kept per run and metric
+#define PLAYBACK_STARTED_SIZE   21
+#define PROGRESS_INTERVAL_US    5000000
+
+typedef struct {
+    int fd;
+    int id;
+    uint8_t hello[UDP_HELLO_SIZE];
+
+    // Clock sync (clock_sync.c, without the periodic refresh)
+    int sync_sent;
+    int64_t sync_next_us;
+    int64_t offset_us;
+    int64_t best_delay_us;
+    bool synced;
+
+    // Capture
+    size_t wav_pos;
+    int64_t next_chunk_us;
+    voice_state_t state;
+    uint32_t sequence;
+    int64_t silence_start_us;
+    int64_t speech_end_us;          // waiting for the response to this turn
+
+    // Downlink and playout
+    uint32_t expected_seq;
+    bool in_response;
+    int prebuffered;
+    int64_t prebuffer_us;
+    int64_t first_rx_us;
+    bool playing;
+    int64_t playout_end_us;
+    bool last_received;
+    int64_t media_us;               // playback position of the next chunk in the response
+    int64_t prev_transit_us;
+    double jitter_us;
+
+    // Counters
+    uint32_t chunks_sent;
+    uint32_t chunks_received;
+    uint32_t lost;
+    uint32_t underruns;
+    uint32_t responses;
+    uint32_t completes;
+    uint32_t interrupts;
+    uint32_t send_errors;
+    uint32_t turns;
+    double turn_rx_ms_sum;
+} sim_device_t;
+
+typedef struct {
+    double *samples;
+    size_t count;
+} sample_set_t;
+
+static sim_device_t *devices;
+static int device_count = 10;
+static int16_t *wav_samples;
+static size_t wav_len;               // samples, a whole number of chunks
+static struct sockaddr_in server;
+static sample_set_t turn_rx_ms;     // speech end -> first PLAY_AUDIO
+static sample_set_t turn_output_ms; // speech end -> playout start
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    stop_requested = 1;
+}
+
+static int64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void add_sample(sample_set_t *set, double value)
+{
+    if (set->count < MAX_TURNS) {
+        set->samples[set->count++] = value;
+    }
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double percentile(double *values, size_t count, double p)
+{
+    if (count == 0) {
+        return 0;
+    }
+    qsort(values, count, sizeof(double), compare_double);
+    size_t i = (size_t)(p / 100.0 * count);
+    return values[i < count ? i : count - 1];
+}
+
+// ==================== Audio source ====================
+
+// 24 kHz mono PCM16, or 48 kHz decimated like the capture path (pair average)
+static bool load_wav(const char *path)
+{
+    wav_file_t wav;
+    if (!wav_open_read(&wav, path)) {
+        return false;
+    }
+    if (wav.channels != 1 || wav.bits_per_sample != 16 ||
+        (wav.sample_rate != AUDIO_SAMPLE_RATE_OUTPUT && wav.sample_rate != AUDIO_SAMPLE_RATE_CAPTURE)) {
+        fprintf(stderr, "%s: need 16-bit mono at 24 or 48 kHz\n", path);
+        wav_close(&wav);
+        return false;
+    }
+    int16_t *raw = malloc(wav.data_bytes);
+    size_t n = wav_read(&wav, raw, wav.data_bytes) / 2;
+    wav_close(&wav);
+
+    int step = wav.sample_rate == AUDIO_SAMPLE_RATE_CAPTURE ? 2 : 1;
+    size_t chunk = AUDIO_CHUNK_SIZE_OUTPUT / 2;
+    wav_len = n / step / chunk * chunk;
+    if (wav_len == 0) {
+        fprintf(stderr, "%s: shorter than one chunk\n", path);
+        free(raw);
+        return false;
+    }
+    wav_samples = malloc(wav_len * sizeof(int16_t));
+    for (size_t i = 0; i < wav_len; i++) {
+        wav_samples[i] = step == 2 ? (int16_t)((raw[2 * i] + raw[2 * i + 1]) / 2) : raw[i];
+    }
+    free(raw);
+    return true;
+}
+
+// Without a WAV: 2 s of modulated 300 Hz "speech", 6 s of silence
+static void synth_wav(void)
+{
+    wav_len = 8 * AUDIO_SAMPLE_RATE_OUTPUT;
+    wav_samples = calloc(wav_len, sizeof(int16_t));
+    for (size_t i = 0; i < 2 * AUDIO_SAMPLE_RATE_OUTPUT; i++) {
+        double t = (double)i / AUDIO_SAMPLE_RATE_OUTPUT;
+        wav_samples[i] = (int16_t)(6000 * sin(2 * M_PI * 300 * t) * (0.6 + 0.4 * sin(2 * M_PI * 4 * t)));
+    }
+}
+
+// ==================== Sending ====================
+
+static void dev_send(sim_device_t *d, const void *packet, size_t len)
+{
+    if (send(d->fd, packet, len, 0) < 0) {
+        d->send_errors++;
+    }
+}
+
+static int64_t to_bridge_us(const sim_device_t *d, int64_t local_us)
+{
+    return d->synced ? local_us + d->offset_us : 0;
+}
+
+static void send_time_request(sim_device_t *d, int64_t now)
+{
+    uint8_t msg[CLOCK_SYNC_REQUEST_SIZE];
+    msg[0] = UDP_MSG_TIME_REQUEST;
+    memcpy(msg + 1, &now, sizeof(now));
+    dev_send(d, msg, sizeof(msg));
+}
+
+static void send_audio(sim_device_t *d, const uint8_t *audio, int64_t capture_us)
+{
+    uint8_t packet[UDP_AUDIO_TS_HEADER_SIZE + AUDIO_CHUNK_SIZE_OUTPUT];
+    size_t size;
+    int64_t capture_bridge_us = to_bridge_us(d, capture_us);
+    if (capture_bridge_us > 0) {
+        packet[0] = UDP_MSG_AUDIO_DATA_TS;
+        memcpy(packet + 1, &d->sequence, sizeof(d->sequence));
+        memcpy(packet + UDP_AUDIO_HEADER_SIZE, &capture_bridge_us, sizeof(capture_bridge_us));
+        memcpy(packet + UDP_AUDIO_TS_HEADER_SIZE, audio, AUDIO_CHUNK_SIZE_OUTPUT);
+        size = UDP_AUDIO_TS_HEADER_SIZE + AUDIO_CHUNK_SIZE_OUTPUT;
+    } else {
+        size = udp_packet_build_audio(packet, sizeof(packet), UDP_MSG_AUDIO_DATA,
+                                      audio, AUDIO_CHUNK_SIZE_OUTPUT, d->sequence);
+    }
+    d->sequence++;
+    d->chunks_sent++;
+    dev_send(d, packet, size);
+}
+
+static void send_byte(sim_device_t *d, uint8_t type)
+{
+    dev_send(d, &type, 1);
+}
+
+// ==================== Device behaviour ====================
+
+static void stop_playout(sim_device_t *d)
+{
+    d->in_response = false;
+    d->playing = false;
+    d->prebuffered = 0;
+    d->prebuffer_us = 0;
+    d->last_received = false;
+}
+
+// One 40 ms chunk through main.c's capture state machine
+static void capture_chunk(sim_device_t *d, int64_t now)
+{
+    int16_t *chunk = wav_samples + d->wav_pos;
+    size_t samples = AUDIO_CHUNK_SIZE_OUTPUT / 2;
+    d->wav_pos = (d->wav_pos + samples) % wav_len;
+    uint32_t rms = audio_calculate_rms(chunk, samples);
+    int64_t capture_us = now - CHUNK_US;
+
+    switch (d->state) {
+        case STATE_IDLE:
+            if (rms > RMS_THRESHOLD_NORMAL) {
+                d->state = STATE_USER_SPEAKING;
+                d->silence_start_us = 0;
+                d->sequence = 0;
+                send_audio(d, (const uint8_t *)chunk, capture_us);
+            }
+            break;
+
+        case STATE_USER_SPEAKING:
+            if (rms < AUDIO_RMS_STOP_THRESHOLD) {
+                if (d->silence_start_us == 0) {
+                    d->silence_start_us = now;
+                    d->speech_end_us = capture_us;      // turn latency counts from here
+                } else if (now - d->silence_start_us > SILENCE_DURATION_MS * 1000LL) {
+                    d->state = STATE_IDLE;
+                    d->silence_start_us = 0;
+                    break;
+                }
+            } else {
+                d->silence_start_us = 0;
+                d->speech_end_us = 0;
+            }
+            send_audio(d, (const uint8_t *)chunk, capture_us);
+            break;
+
+        case STATE_AI_SPEAKING:
+            if (rms > RMS_THRESHOLD_INTERRUPT) {
+                d->state = STATE_USER_SPEAKING;
+                d->silence_start_us = 0;
+                d->speech_end_us = 0;
+                d->interrupts++;
+                stop_playout(d);
+                send_byte(d, UDP_MSG_INTERRUPT);
+                d->sequence = 0;
+                send_audio(d, (const uint8_t *)chunk, capture_us);
+            }
+            break;
+    }
+}
+
+static void start_playout(sim_device_t *d, int64_t now)
+{
+    d->playing = true;
+    d->playout_end_us = now + d->prebuffer_us;
+
+    if (d->speech_end_us > 0) {
+        add_sample(&turn_output_ms, (now - d->speech_end_us) / 1000.0);
+        d->speech_end_us = 0;
+    }
+
+    uint8_t msg[PLAYBACK_STARTED_SIZE];
+    uint32_t seq = 0;
+    int64_t first_rx = to_bridge_us(d, d->first_rx_us);
+    int64_t first_output = to_bridge_us(d, now);
+    msg[0] = UDP_MSG_PLAYBACK_STARTED;
+    memcpy(&msg[1], &seq, sizeof(seq));
+    memcpy(&msg[5], &first_rx, sizeof(first_rx));
+    memcpy(&msg[13], &first_output, sizeof(first_output));
+    dev_send(d, msg, sizeof(msg));
+}
+
+static void on_play_audio(sim_device_t *d, const uint8_t *packet, size_t len, int64_t now)
+{
+    uint32_t seq;
+    const uint8_t *audio;
+    size_t audio_len;
+    if (!udp_packet_parse_audio(packet, len, &seq, &audio, &audio_len)) {
+        return;
+    }
+    int64_t duration_us = (int64_t)audio_len * 1000 / PCM_BYTES_PER_MS;
+    d->chunks_received++;
+
+    if (seq == 0) {
+        // New response
+        stop_playout(d);
+        d->in_response = true;
+        d->responses++;
+        d->expected_seq = 0;
+        d->media_us = 0;
+        d->first_rx_us = now;
+        d->jitter_us = d->responses > 1 ? d->jitter_us : 0;
+        d->prev_transit_us = now;
+        if (d->speech_end_us > 0) {
+            double ms = (now - d->speech_end_us) / 1000.0;
+            add_sample(&turn_rx_ms, ms);
+            d->turns++;
+            d->turn_rx_ms_sum += ms;
+        }
+    } else if (!d->in_response) {
+        return;     // rest of an interrupted response
+    }
+
+    if (seq > d->expected_seq) {
+        d->lost += seq - d->expected_seq;
+        d->media_us += (int64_t)(seq - d->expected_seq) * duration_us;
+    }
+    d->expected_seq = seq + 1;
+
+    // RFC 3550 interarrival jitter against the playback clock of the response
+    int64_t transit = now - d->media_us;
+    int64_t delta = transit - d->prev_transit_us;
+    d->prev_transit_us = transit;
+    d->jitter_us += (fabs((double)delta) - d->jitter_us) / 16.0;
+    d->media_us += duration_us;
+
+    if (!d->playing) {
+        d->prebuffered++;
+        d->prebuffer_us += duration_us;
+        if (d->prebuffered >= PREBUFFER_CHUNKS || packet[0] == UDP_MSG_PLAY_AUDIO_LAST) {
+            start_playout(d, now);
+        }
+    } else if (now > d->playout_end_us) {
+        d->underruns++;
+        d->playout_end_us = now + duration_us;
+    } else {
+        d->playout_end_us += duration_us;
+    }
+    if (packet[0] == UDP_MSG_PLAY_AUDIO_LAST) {
+        d->last_received = true;
+    }
+}
+
+static void on_time_response(sim_device_t *d, const uint8_t *packet, size_t len, int64_t now)
+{
+    if (len < CLOCK_SYNC_RESPONSE_SIZE) {
+        return;
+    }
+    int64_t t1, t2, t3;
+    memcpy(&t1, packet + 1, sizeof(t1));
+    memcpy(&t2, packet + 9, sizeof(t2));
+    memcpy(&t3, packet + 17, sizeof(t3));
+    int64_t delay = (now - t1) - (t3 - t2);
+    if (delay < 0 || delay > CLOCK_SYNC_MAX_DELAY_US) {
+        return;
+    }
+    if (!d->synced || delay < d->best_delay_us) {
+        d->offset_us = ((t2 - t1) + (t3 - now)) / 2;
+        d->best_delay_us = delay;
+        d->synced = true;
+    }
+}
+
+static void on_datagram(sim_device_t *d, const uint8_t *packet, size_t len, int64_t now)
+{
+    if (len == 0) {
+        return;
+    }
+    switch (packet[0]) {
+        case UDP_MSG_PLAY_AUDIO:
+        case UDP_MSG_PLAY_AUDIO_LAST:
+            on_play_audio(d, packet, len, now);
+            break;
+
+        case UDP_MSG_STATE_IDLE:
+            d->state = STATE_IDLE;
+            break;
+
+        case UDP_MSG_STATE_USER_SPEAKING:
+            d->state = STATE_USER_SPEAKING;
+            break;
+
+        case UDP_MSG_STATE_AI_SPEAKING:
+            d->state = STATE_AI_SPEAKING;
+            break;
+
+        case UDP_MSG_TIME_RESPONSE:
+            on_time_response(d, packet, len, now);
+            break;
+
+        case UDP_MSG_HELLO_REQUEST:
+            dev_send(d, d->hello, sizeof(d->hello));
+            break;
+
+        default:
+            break;
+    }
+}
+
+// Timers of one device; returns its next deadline
+static int64_t run_timers(sim_device_t *d, int64_t now)
+{
+    if (d->sync_sent < CLOCK_SYNC_SAMPLES && now >= d->sync_next_us) {
+        send_time_request(d, now);
+        d->sync_sent++;
+        d->sync_next_us = now + CLOCK_SYNC_BURST_MS * 1000;
+    }
+    // Catch up if the loop fell behind, like DMA-paced capture would
+    while (now >= d->next_chunk_us) {
+        capture_chunk(d, d->next_chunk_us);
+        d->next_chunk_us += CHUNK_US;
+    }
+    if (d->playing && d->last_received && now >= d->playout_end_us) {
+        stop_playout(d);
+        d->completes++;
+        send_byte(d, UDP_MSG_PLAYBACK_COMPLETE);
+    }
+
+    int64_t next = d->next_chunk_us;
+    if (d->sync_sent < CLOCK_SYNC_SAMPLES && d->sync_next_us < next) {
+        next = d->sync_next_us;
+    }
+    if (d->playing && d->last_received && d->playout_end_us < next) {
+        next = d->playout_end_us;
+    }
+    return next;
+}
+
+static bool device_open(sim_device_t *d, int id, int epfd, int64_t start_us)
+{
+    memset(d, 0, sizeof(*d));
+    d->id = id;
+    d->fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (d->fd < 0 || connect(d->fd, (struct sockaddr *)&server, sizeof(server)) < 0) {
+        fprintf(stderr, "device %d: socket: %s\n", id, strerror(errno));
+        return false;
+    }
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = d };
+    epoll_ctl(epfd, EPOLL_CTL_ADD, d->fd, &ev);
+
+    // Locally administered MAC, unique per device: 02:'l':'g':id
+    uint16_t uplink_hz = AUDIO_SAMPLE_RATE_OUTPUT, downlink_hz = AUDIO_SAMPLE_RATE_OUTPUT;
+    d->hello[0] = UDP_MSG_HELLO;
+    d->hello[1] = UDP_HELLO_VERSION;
+    d->hello[2] = 0x02;
+    d->hello[3] = 'l';
+    d->hello[4] = 'g';
+    d->hello[5] = (uint8_t)(id >> 16);
+    d->hello[6] = (uint8_t)(id >> 8);
+    d->hello[7] = (uint8_t)id;
+    memcpy(&d->hello[8], &uplink_hz, sizeof(uplink_hz));
+    memcpy(&d->hello[10], &downlink_hz, sizeof(downlink_hz));
+    dev_send(d, d->hello, sizeof(d->hello));
+
+    // Spread devices over the WAV (and the chunk grid) so they do not speak in unison
+    size_t chunk = AUDIO_CHUNK_SIZE_OUTPUT / 2;
+    d->wav_pos = ((size_t)id * 7919 % (wav_len / chunk)) * chunk;
+    d->sync_next_us = start_us;
+    d->next_chunk_us = start_us + CHUNK_US + (int64_t)id * 997 % CHUNK_US;
+    d->state = STATE_IDLE;
+    return true;
+}
+
+// ==================== Report ====================
+
+static void report(int64_t elapsed_us, bool json, bool per_device)
+{
+    uint64_t sent = 0, received = 0, lost = 0, underruns = 0, responses = 0, completes = 0, interrupts = 0, errors = 0;
+    int synced = 0;
+    double *jitter = malloc(device_count * sizeof(double));
+
+    for (int i = 0; i < device_count; i++) {
+        sim_device_t *d = &devices[i];
+        sent += d->chunks_sent;
+        received += d->chunks_received;
+        lost += d->lost;
+        underruns += d->underruns;
+        responses += d->responses;
+        completes += d->completes;
+        interrupts += d->interrupts;
+        errors += d->send_errors;
+        synced += d->synced;
+        jitter[i] = d->jitter_us / 1000.0;
+
+        if (!per_device) {
+            continue;
+        }
+        double loss_pct = d->chunks_received + d->lost ? 100.0 * d->lost / (d->chunks_received + d->lost) : 0;
+        double turn_ms = d->turns ? d->turn_rx_ms_sum / d->turns : 0;
+        if (json) {
+            printf("{\"loadgen\":\"device\",\"id\":%d,\"sent\":%u,\"received\":%u,\"lost\":%u,\"lossPct\":%.2f,"
+                   "\"jitterMs\":%.2f,\"underruns\":%u,\"responses\":%u,\"completes\":%u,\"interrupts\":%u,"
+                   "\"turns\":%u,\"turnMeanMs\":%.1f,\"synced\":%s}\n",
+                   d->id, d->chunks_sent, d->chunks_received, d->lost, loss_pct, d->jitter_us / 1000.0,
+                   d->underruns, d->responses, d->completes, d->interrupts, d->turns, turn_ms,
+                   d->synced ? "true" : "false");
+        } else {
+            if (i == 0) {
+                printf("%6s %8s %8s %6s %7s %9s %9s %9s %9s %10s\n", "device", "sent", "received", "lost",
+                       "loss %", "jitter ms", "underruns", "responses", "completes", "turn ms");
+            }
+            printf("%6d %8u %8u %6u %7.2f %9.2f %9u %9u %9u %10.1f\n", d->id, d->chunks_sent, d->chunks_received,
+                   d->lost, loss_pct, d->jitter_us / 1000.0, d->underruns, d->responses, d->completes, turn_ms);
+        }
+    }
+
+    double loss_pct = received + lost ? 100.0 * lost / (received + lost) : 0;
+    double jitter_p50 = percentile(jitter, device_count, 50);
+    double jitter_p99 = percentile(jitter, device_count, 99);
+    double jitter_max = jitter[device_count - 1];
+    double rx_p50 = percentile(turn_rx_ms.samples, turn_rx_ms.count, 50);
+    double rx_p90 = percentile(turn_rx_ms.samples, turn_rx_ms.count, 90);
+    double rx_p99 = percentile(turn_rx_ms.samples, turn_rx_ms.count, 99);
+    double out_p50 = percentile(turn_output_ms.samples, turn_output_ms.count, 50);
+    double out_p99 = percentile(turn_output_ms.samples, turn_output_ms.count, 99);
+    free(jitter);
+
+    if (json) {
+        printf("{\"loadgen\":\"summary\",\"devices\":%d,\"seconds\":%.1f,\"synced\":%d,\"sent\":%llu,"
+               "\"received\":%llu,\"lost\":%llu,\"lossPct\":%.3f,\"jitterP50Ms\":%.2f,\"jitterP99Ms\":%.2f,"
+               "\"jitterMaxMs\":%.2f,\"underruns\":%llu,\"responses\":%llu,\"completes\":%llu,\"interrupts\":%llu,"
+               "\"sendErrors\":%llu,\"turns\":%zu,\"turnFirstChunkP50Ms\":%.1f,\"turnFirstChunkP90Ms\":%.1f,"
+               "\"turnFirstChunkP99Ms\":%.1f,\"turnOutputP50Ms\":%.1f,\"turnOutputP99Ms\":%.1f}\n",
+               device_count, elapsed_us / 1e6, synced, (unsigned long long)sent, (unsigned long long)received,
+               (unsigned long long)lost, loss_pct, jitter_p50, jitter_p99, jitter_max,
+               (unsigned long long)underruns, (unsigned long long)responses, (unsigned long long)completes,
+               (unsigned long long)interrupts, (unsigned long long)errors, turn_rx_ms.count,
+               rx_p50, rx_p90, rx_p99, out_p50, out_p99);
+        return;
+    }
+    printf("\n==== loadgen: %d devices, %.1f s ====\n", device_count, elapsed_us / 1e6);
+    printf("uplink:   %llu chunks sent, %llu send errors, %d/%d devices clock synced\n",
+           (unsigned long long)sent, (unsigned long long)errors, synced, device_count);
+    printf("downlink: %llu chunks, %llu lost (%.3f%%), jitter p50 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+           (unsigned long long)received, (unsigned long long)lost, loss_pct, jitter_p50, jitter_p99, jitter_max);
+    printf("playout:  %llu responses, %llu completed, %llu underruns, %llu interrupts\n",
+           (unsigned long long)responses, (unsigned long long)completes, (unsigned long long)underruns,
+           (unsigned long long)interrupts);
+    printf("turns:    %zu, speech end -> first chunk p50 %.1f / p90 %.1f / p99 %.1f ms, "
+           "-> playout p50 %.1f / p99 %.1f ms\n",
+           turn_rx_ms.count, rx_p50, rx_p90, rx_p99, out_p50, out_p99);
+}
+
+// ==================== Main ====================
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --devices N       simulated devices (default 10)\n"
+            "  --wav FILE        uplink audio, 16-bit mono 24 or 48 kHz, looped (default: 2 s tone bursts every 8 s)\n"
+            "  --server IP       bridge address (default 127.0.0.1)\n"
+            "  --port N          bridge UDP port (default 8080)\n"
+            "  --duration-s N    run time (default 30; Ctrl-C stops early)\n"
+            "  --ramp-ms N       start the devices over this long (default 1000)\n"
+            "  --per-device      also report every device\n"
+            "  --json            {\"loadgen\":...} lines instead of tables\n",
+            prog);
+}
+
+int main(int argc, char **argv)
+{
+    const char *wav_path = NULL;
+    double duration_s = 30;
+    int64_t ramp_us = 1000000;
+    bool json = false;
+    bool per_device = false;
+
+    static const struct option options[] = {
+        { "devices", required_argument, NULL, 'n' },
+        { "wav", required_argument, NULL, 'w' },
+        { "server", required_argument, NULL, 'a' },
+        { "port", required_argument, NULL, 'p' },
+        { "duration-s", required_argument, NULL, 'd' },
+        { "ramp-ms", required_argument, NULL, 'r' },
+        { "per-device", no_argument, NULL, 'P' },
+        { "json", no_argument, NULL, 'j' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 },
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", options, NULL)) != -1) {
+        switch (opt) {
+            case 'n': device_count = atoi(optarg); break;
+            case 'w': wav_path = optarg; break;
+            case 'a': host_config.server_ip = optarg; break;
+            case 'p': host_config.server_port = atoi(optarg); break;
+            case 'd': duration_s = atof(optarg); break;
+            case 'r': ramp_us = (int64_t)(atof(optarg) * 1000); break;
+            case 'P': per_device = true; break;
+            case 'j': json = true; break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (device_count <= 0 || duration_s <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (wav_path ? !load_wav(wav_path) : (synth_wav(), false)) {
+        return 1;
+    }
+
+    server.sin_family = AF_INET;
+    server.sin_port = htons(host_config.server_port);
+    if (inet_pton(AF_INET, host_config.server_ip, &server.sin_addr) != 1) {
+        fprintf(stderr, "bad server address %s\n", host_config.server_ip);
+        return 1;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    int epfd = epoll_create1(0);
+    devices = calloc(device_count, sizeof(sim_device_t));
+    turn_rx_ms.samples = malloc(MAX_TURNS * sizeof(double));
+    turn_output_ms.samples = malloc(MAX_TURNS * sizeof(double));
+
+    int64_t start_us = now_us();
+    for (int i = 0; i < device_count; i++) {
+        if (!device_open(&devices[i], i + 1, epfd, start_us + ramp_us * i / device_count)) {
+            return 1;
+        }
+    }
+    if (!json) {
+        printf("voice_loadgen: %d devices -> %s:%d for %.0f s\n", device_count,
+               host_config.server_ip, host_config.server_port, duration_s);
+    }
+
+    int64_t end_us = start_us + (int64_t)(duration_s * 1e6);
+    int64_t next_progress_us = start_us + PROGRESS_INTERVAL_US;
+    struct epoll_event events[64];
+    uint8_t packet[UDP_MAX_PAYLOAD];
+
+    while (!stop_requested) {
+        int64_t now = now_us();
+        if (now >= end_us) {
+            break;
+        }
+        int64_t next = end_us;
+        for (int i = 0; i < device_count; i++) {
+            int64_t t = run_timers(&devices[i], now);
+            if (t < next) {
+                next = t;
+            }
+        }
+        if (!json && now >= next_progress_us) {
+            uint64_t sent = 0, received = 0;
+            for (int i = 0; i < device_count; i++) {
+                sent += devices[i].chunks_sent;
+                received += devices[i].chunks_received;
+            }
+            printf("%5.0f s: %llu chunks up, %llu down, %zu turns\n", (now - start_us) / 1e6,
+                   (unsigned long long)sent, (unsigned long long)received, turn_rx_ms.count);
+            fflush(stdout);
+            next_progress_us += PROGRESS_INTERVAL_US;
+        }
+
+        now = now_us();
+        int timeout_ms = next > now ? (int)((next - now + 999) / 1000) : 0;
+        int n = epoll_wait(epfd, events, 64, timeout_ms);
+        for (int i = 0; i < n; i++) {
+            sim_device_t *d = events[i].data.ptr;
+            ssize_t len;
+            while ((len = recv(d->fd, packet, sizeof(packet), MSG_DONTWAIT)) >= 0) {
+                on_datagram(d, packet, (size_t)len, now_us());
+            }
+        }
+    }
+
+    report(now_us() - start_us, json, per_device);
+    return 0;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include "esp_err.h"
+#include <stdint.h>
+
+typedef int gpio_num_t;
+#define GPIO_NUM_NC (-1)
+
+typedef enum {
+    GPIO_MODE_DISABLE,
+    GPIO_MODE_INPUT,
+    GPIO_MODE_OUTPUT,
+} gpio_mode_t;
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode);
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level);
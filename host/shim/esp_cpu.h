@@ -0,0 +1,17 @@
+#pragma once
+#include <stdint.h>
+#include <time.h>
+
+// Cycle counter: TSC on x86, nanoseconds elsewhere
+static inline uint32_t esp_cpu_get_cycle_count(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return (uint32_t)__builtin_ia32_rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000000ull + ts.tv_nsec);
+#endif
+}
+
+int esp_cpu_get_core_id(void);
@@ -0,0 +1,33 @@
+#pragma once
+#include <stdint.h>
+#include <stdarg.h>
+#include "sdkconfig.h"
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
+void esp_log_writev(esp_log_level_t level, const char *tag, const char *format, va_list args);
+uint32_t esp_log_timestamp(void);
+void esp_log_level_set(const char *tag, esp_log_level_t level);
+
+// Same line format as the firmware: "I (1234) TAG: message"
+#define ESP_LOG_LINE_(level, letter, tag, fmt, ...) do {                             \
+        if (CONFIG_LOG_MAXIMUM_LEVEL >= (level)) {                                   \
+            esp_log_write((level), (tag), #letter " (%lu) %s: " fmt "\n",            \
+                          (unsigned long)esp_log_timestamp(), (tag), ##__VA_ARGS__); \
+        }                                                                            \
+    } while (0)
+
+#define ESP_LOGE(tag, fmt, ...) ESP_LOG_LINE_(ESP_LOG_ERROR, E, tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) ESP_LOG_LINE_(ESP_LOG_WARN, W, tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) ESP_LOG_LINE_(ESP_LOG_INFO, I, tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) ESP_LOG_LINE_(ESP_LOG_DEBUG, D, tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGV(tag, fmt, ...) ESP_LOG_LINE_(ESP_LOG_VERBOSE, V, tag, fmt, ##__VA_ARGS__)
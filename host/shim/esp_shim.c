@@ -0,0 +1,311 @@
+// ESP-IDF system services the firmware touches: logging, error names, heap
+// capabilities, NVS, event loop, GPIO, random numbers, MAC address and restart.
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_event.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_mac.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+#include "driver/gpio.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// ==================== Logging ====================
+
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void esp_log_writev(esp_log_level_t level, const char *tag, const char *format, va_list args)
+{
+    (void)tag;
+    if ((int)level > host_config.log_level) {
+        return;
+    }
+    pthread_mutex_lock(&log_lock);
+    vprintf(format, args);
+    fflush(stdout);
+    pthread_mutex_unlock(&log_lock);
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    esp_log_writev(level, tag, format, args);
+    va_end(args);
+}
+
+uint32_t esp_log_timestamp(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    // Only the global level is modelled
+    if (tag && tag[0] == '*' && tag[1] == '\0') {
+        host_config.log_level = level;
+    }
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+        case ESP_ERR_NVS_INVALID_LENGTH: return "ESP_ERR_NVS_INVALID_LENGTH";
+        default: return "ERROR";
+    }
+}
+
+// ==================== Heap ====================
+
+// The host does not model the ESP32-S3 heaps; sizes are nominal so the
+// telemetry and memory monitor code paths run without raising alerts
+#define HOST_INTERNAL_HEAP  (320 * 1024)
+#define HOST_PSRAM_HEAP     (8 * 1024 * 1024)
+
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    (void)caps;
+    return malloc(size);
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+    (void)caps;
+    return calloc(n, size);
+}
+
+void heap_caps_free(void *ptr)
+{
+    free(ptr);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    return (caps & MALLOC_CAP_SPIRAM) ? HOST_PSRAM_HEAP : HOST_INTERNAL_HEAP;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps)
+{
+    return heap_caps_get_free_size(caps);
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+    return heap_caps_get_free_size(caps);
+}
+
+void heap_caps_get_info(multi_heap_info_t *info, uint32_t caps)
+{
+    size_t size = heap_caps_get_free_size(caps);
+    *info = (multi_heap_info_t) {
+        .total_free_bytes = size,
+        .largest_free_block = size,
+        .minimum_free_bytes = size,
+        .free_blocks = 1,
+        .total_blocks = 1,
+    };
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    return HOST_INTERNAL_HEAP + HOST_PSRAM_HEAP;
+}
+
+uint32_t esp_get_minimum_free_heap_size(void)
+{
+    return esp_get_free_heap_size();
+}
+
+// ==================== System ====================
+
+void esp_restart(void)
+{
+    fprintf(stderr, "esp_restart() called - exiting\n");
+    exit(2);
+}
+
+uint32_t esp_random(void)
+{
+    static pthread_mutex_t random_lock = PTHREAD_MUTEX_INITIALIZER;
+    static bool seeded = false;
+    pthread_mutex_lock(&random_lock);
+    if (!seeded) {
+        srandom((unsigned)time(NULL) ^ (unsigned)getpid());
+        seeded = true;
+    }
+    uint32_t r = ((uint32_t)random() << 16) ^ (uint32_t)random();
+    pthread_mutex_unlock(&random_lock);
+    return r;
+}
+
+// Locally administered, unique per device UDP port, so several host devices
+// on one machine get distinct ids
+esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type)
+{
+    mac[0] = 0x02;
+    mac[1] = 'h';
+    mac[2] = 'o';
+    mac[3] = (uint8_t)type;
+    mac[4] = (uint8_t)(host_config.local_port >> 8);
+    mac[5] = (uint8_t)host_config.local_port;
+    return ESP_OK;
+}
+
+esp_err_t esp_event_loop_create_default(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    return ESP_OK;
+}
+
+// In-memory NVS: lives as long as the process, like a freshly erased flash at start
+#define NVS_MAX_NAMESPACES 8
+#define NVS_MAX_ENTRIES    32
+#define NVS_NAME_MAX       16      // NVS_KEY_NAME_MAX_SIZE, terminator included
+
+typedef struct {
+    nvs_handle_t ns;
+    char key[NVS_NAME_MAX];
+    void *data;
+    size_t length;
+} nvs_entry_t;
+
+static pthread_mutex_t nvs_lock = PTHREAD_MUTEX_INITIALIZER;
+static char nvs_namespaces[NVS_MAX_NAMESPACES][NVS_NAME_MAX];
+static nvs_entry_t nvs_entries[NVS_MAX_ENTRIES];
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    if (strlen(namespace_name) >= NVS_NAME_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t ret = ESP_ERR_NVS_NOT_FOUND;
+    pthread_mutex_lock(&nvs_lock);
+    for (int i = 0; i < NVS_MAX_NAMESPACES; i++) {
+        if (strcmp(nvs_namespaces[i], namespace_name) == 0) {
+            *out_handle = i + 1;
+            ret = ESP_OK;
+            break;
+        }
+        if (nvs_namespaces[i][0] == '\0') {
+            // Like the real NVS, read-only opens do not create a namespace
+            if (open_mode == NVS_READWRITE) {
+                strcpy(nvs_namespaces[i], namespace_name);
+                *out_handle = i + 1;
+                ret = ESP_OK;
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return ret;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    (void)handle;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    (void)handle;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    if (strlen(key) >= NVS_NAME_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    void *copy = malloc(length ? length : 1);
+    if (!copy) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(copy, value, length);
+
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    pthread_mutex_lock(&nvs_lock);
+    nvs_entry_t *slot = NULL;
+    for (int i = 0; i < NVS_MAX_ENTRIES; i++) {
+        nvs_entry_t *e = &nvs_entries[i];
+        if (e->ns == handle && strcmp(e->key, key) == 0) {
+            slot = e;
+            break;
+        }
+        if (!slot && e->ns == 0) {
+            slot = e;
+        }
+    }
+    if (slot) {
+        free(slot->data);
+        slot->ns = handle;
+        strcpy(slot->key, key);
+        slot->data = copy;
+        slot->length = length;
+        ret = ESP_OK;
+    } else {
+        free(copy);
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return ret;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    esp_err_t ret = ESP_ERR_NVS_NOT_FOUND;
+    pthread_mutex_lock(&nvs_lock);
+    for (int i = 0; i < NVS_MAX_ENTRIES; i++) {
+        nvs_entry_t *e = &nvs_entries[i];
+        if (e->ns == handle && strcmp(e->key, key) == 0) {
+            // NULL out_value queries the size, as on the device
+            if (out_value && *length < e->length) {
+                ret = ESP_ERR_NVS_INVALID_LENGTH;
+            } else {
+                if (out_value) {
+                    memcpy(out_value, e->data, e->length);
+                }
+                ret = ESP_OK;
+            }
+            *length = e->length;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return ret;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    return ESP_OK;
+}
@@ -0,0 +1,6 @@
+#pragma once
+#include "esp_err.h"
+#include <stdint.h>
+uint32_t esp_get_free_heap_size(void);
+uint32_t esp_get_minimum_free_heap_size(void);
+void esp_restart(void);
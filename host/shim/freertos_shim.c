@@ -0,0 +1,444 @@
+// FreeRTOS tasks, queues, semaphores and ticks on top of pthreads.
+// All timeouts and delays run on the virtual clock, so --speed scales them.
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+// ==================== Virtual clock ====================
+
+static int64_t real_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int64_t clock_start_us = 0;
+static pthread_once_t clock_once = PTHREAD_ONCE_INIT;
+
+static void clock_init(void)
+{
+    clock_start_us = real_now_us();
+}
+
+static double clock_speed(void)
+{
+    return host_config.speed > 0 ? host_config.speed : 1.0;
+}
+
+int64_t host_time_us(void)
+{
+    pthread_once(&clock_once, clock_init);
+    return (int64_t)((real_now_us() - clock_start_us) * clock_speed());
+}
+
+void host_sleep_us(int64_t us)
+{
+    if (us <= 0) {
+        sched_yield();
+        return;
+    }
+
+    int64_t real_us = (int64_t)(us / clock_speed());
+    struct timespec ts = { .tv_sec = real_us / 1000000, .tv_nsec = (real_us % 1000000) * 1000 };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+void host_sleep_until_us(int64_t deadline_us)
+{
+    host_sleep_us(deadline_us - host_time_us());
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return host_time_us();
+}
+
+static int64_t ticks_to_us(TickType_t ticks)
+{
+    return (int64_t)ticks * 1000000 / configTICK_RATE_HZ;
+}
+
+// Absolute CLOCK_MONOTONIC deadline for a timeout given in virtual ticks
+static void ticks_to_abstime(TickType_t ticks, struct timespec *ts)
+{
+    int64_t deadline = real_now_us() + (int64_t)(ticks_to_us(ticks) / clock_speed());
+    ts->tv_sec = deadline / 1000000;
+    ts->tv_nsec = (deadline % 1000000) * 1000;
+}
+
+static void cond_init_monotonic(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+// Wait on cond until pred() holds or the timeout expires; returns the final pred()
+#define WAIT_UNTIL(cond, lock, ticks, pred) ({                                  \
+        bool ok_ = (pred);                                                      \
+        if (!ok_ && (ticks) != 0) {                                             \
+            struct timespec abs_;                                               \
+            if ((ticks) != portMAX_DELAY) ticks_to_abstime((ticks), &abs_);     \
+            while (!(ok_ = (pred))) {                                           \
+                if ((ticks) == portMAX_DELAY) {                                 \
+                    pthread_cond_wait((cond), (lock));                          \
+                } else if (pthread_cond_timedwait((cond), (lock), &abs_) == ETIMEDOUT) { \
+                    ok_ = (pred);                                               \
+                    break;                                                      \
+                }                                                               \
+            }                                                                   \
+        }                                                                       \
+        ok_;                                                                    \
+    })
+
+// ==================== Critical sections ====================
+
+static pthread_mutex_t critical_lock;
+static pthread_once_t critical_once = PTHREAD_ONCE_INIT;
+
+static void critical_init(void)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&critical_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+void vPortEnterCritical(portMUX_TYPE *mux)
+{
+    (void)mux;
+    pthread_once(&critical_once, critical_init);
+    pthread_mutex_lock(&critical_lock);
+}
+
+void vPortExitCritical(portMUX_TYPE *mux)
+{
+    (void)mux;
+    pthread_mutex_unlock(&critical_lock);
+}
+
+// ==================== Tasks ====================
+
+#define HOST_TASK_MIN_STACK (256 * 1024)   // host libc needs far more than the firmware sizes
+
+struct host_task {
+    pthread_t thread;
+    TaskFunction_t fn;
+    void *param;
+    char name[16];
+    uint32_t stack_depth;
+    int core;
+};
+
+static __thread struct host_task *current_task = NULL;
+static struct host_task main_task = { .name = "main", .stack_depth = 8192 };
+static atomic_uint task_count = 1;
+
+static void *task_entry(void *arg)
+{
+    struct host_task *task = arg;
+    current_task = task;
+    task->fn(task->param);
+
+    // FreeRTOS tasks must not return; treat it like vTaskDelete(NULL)
+    vTaskDelete(NULL);
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+                                   void *param, UBaseType_t priority, TaskHandle_t *handle,
+                                   BaseType_t core_id)
+{
+    (void)priority;
+
+    // Handles stay valid after the task exits (telemetry keeps them), so they are never freed
+    struct host_task *task = calloc(1, sizeof(*task));
+    if (!task) {
+        return pdFAIL;
+    }
+    task->fn = fn;
+    task->param = param;
+    task->stack_depth = stack_depth;
+    task->core = core_id == 1 ? 1 : 0;
+    strncpy(task->name, name ? name : "task", sizeof(task->name) - 1);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&attr, stack_depth > HOST_TASK_MIN_STACK ? stack_depth : HOST_TASK_MIN_STACK);
+
+    if (handle) {
+        *handle = task;
+    }
+    atomic_fetch_add(&task_count, 1);
+    int rc = pthread_create(&task->thread, &attr, task_entry, task);
+    pthread_attr_destroy(&attr);
+
+    if (rc != 0) {
+        atomic_fetch_sub(&task_count, 1);
+        if (handle) {
+            *handle = NULL;
+        }
+        free(task);
+        return pdFAIL;
+    }
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task != NULL && task != current_task) {
+        // Deleting another task is not used by the firmware and has no safe pthread equivalent
+        abort();
+    }
+    atomic_fetch_sub(&task_count, 1);
+    pthread_exit(NULL);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    host_sleep_us(ticks_to_us(ticks));
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(host_time_us() * configTICK_RATE_HZ / 1000000);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return current_task ? current_task : &main_task;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    // Stack usage is not measured on the host; report the configured size
+    task = task ? task : xTaskGetCurrentTaskHandle();
+    return task->stack_depth;
+}
+
+const char *pcTaskGetName(TaskHandle_t task)
+{
+    task = task ? task : xTaskGetCurrentTaskHandle();
+    return task->name;
+}
+
+UBaseType_t uxTaskGetNumberOfTasks(void)
+{
+    return atomic_load(&task_count);
+}
+
+int esp_cpu_get_core_id(void)
+{
+    return current_task ? current_task->core : 0;
+}
+
+// ==================== Queues ====================
+
+struct host_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    uint8_t *storage;
+    bool owns_storage;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+};
+
+static QueueHandle_t queue_create(UBaseType_t length, UBaseType_t item_size, uint8_t *storage)
+{
+    struct host_queue *queue = calloc(1, sizeof(*queue));
+    if (!queue) {
+        return NULL;
+    }
+
+    queue->owns_storage = storage == NULL;
+    queue->storage = storage ? storage : malloc((size_t)length * item_size);
+    if (!queue->storage) {
+        free(queue);
+        return NULL;
+    }
+    queue->length = length;
+    queue->item_size = item_size;
+    pthread_mutex_init(&queue->lock, NULL);
+    cond_init_monotonic(&queue->not_empty);
+    cond_init_monotonic(&queue->not_full);
+    return queue;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    return queue_create(length, item_size, NULL);
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size,
+                                 uint8_t *storage, StaticQueue_t *queue_buffer)
+{
+    QueueHandle_t queue = queue_create(length, item_size, storage);
+    if (queue_buffer) {
+        queue_buffer->impl = queue;
+    }
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    if (!queue) {
+        return;
+    }
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_cond_destroy(&queue->not_full);
+    if (queue->owns_storage) {
+        free(queue->storage);
+    }
+    free(queue);
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+    pthread_mutex_lock(&queue->lock);
+    bool ok = WAIT_UNTIL(&queue->not_full, &queue->lock, ticks, queue->count < queue->length);
+    if (ok) {
+        UBaseType_t tail = (queue->head + queue->count) % queue->length;
+        memcpy(queue->storage + (size_t)tail * queue->item_size, item, queue->item_size);
+        queue->count++;
+        pthread_cond_signal(&queue->not_empty);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return ok ? pdPASS : pdFAIL;
+}
+
+static BaseType_t queue_take(QueueHandle_t queue, void *item, TickType_t ticks, bool remove)
+{
+    pthread_mutex_lock(&queue->lock);
+    bool ok = WAIT_UNTIL(&queue->not_empty, &queue->lock, ticks, queue->count > 0);
+    if (ok) {
+        memcpy(item, queue->storage + (size_t)queue->head * queue->item_size, queue->item_size);
+        if (remove) {
+            queue->head = (queue->head + 1) % queue->length;
+            queue->count--;
+            pthread_cond_signal(&queue->not_full);
+        }
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return ok ? pdPASS : pdFAIL;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+    return queue_take(queue, item, ticks, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+    return queue_take(queue, item, ticks, false);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    UBaseType_t count = queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    UBaseType_t space = queue->length - queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return space;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    queue->head = 0;
+    queue->count = 0;
+    pthread_cond_broadcast(&queue->not_full);
+    pthread_mutex_unlock(&queue->lock);
+    return pdPASS;
+}
+
+// ==================== Semaphores ====================
+
+struct host_semaphore {
+    pthread_mutex_t lock;
+    pthread_cond_t available;
+    UBaseType_t count;
+    UBaseType_t max_count;
+};
+
+static SemaphoreHandle_t semaphore_create(UBaseType_t initial, UBaseType_t max_count)
+{
+    struct host_semaphore *sem = calloc(1, sizeof(*sem));
+    if (!sem) {
+        return NULL;
+    }
+    sem->count = initial;
+    sem->max_count = max_count;
+    pthread_mutex_init(&sem->lock, NULL);
+    cond_init_monotonic(&sem->available);
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return semaphore_create(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return semaphore_create(0, 1);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    pthread_mutex_lock(&sem->lock);
+    bool ok = WAIT_UNTIL(&sem->available, &sem->lock, ticks, sem->count > 0);
+    if (ok) {
+        sem->count--;
+    }
+    pthread_mutex_unlock(&sem->lock);
+    return ok ? pdPASS : pdFAIL;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    pthread_mutex_lock(&sem->lock);
+    bool ok = sem->count < sem->max_count;
+    if (ok) {
+        sem->count++;
+        pthread_cond_signal(&sem->available);
+    }
+    pthread_mutex_unlock(&sem->lock);
+    return ok ? pdPASS : pdFAIL;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    if (!sem) {
+        return;
+    }
+    pthread_mutex_destroy(&sem->lock);
+    pthread_cond_destroy(&sem->available);
+    free(sem);
+}
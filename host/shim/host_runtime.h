@@ -0,0 +1,43 @@
+#pragma once
+// Host build runtime: configuration, virtual clock and I2S/WAV harness hooks.
+// Force-included into every source of the host build (see host/CMakeLists.txt).
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct {
+    const char *mic_wav;        // capture input, PCM16; NULL feeds silence
+    const char *speaker_wav;    // playback output; NULL discards it
+    const char *server_ip;
+    int server_port;
+    int local_port;
+    double speed;               // virtual time runs this many times faster than wall time
+    int log_level;              // esp_log_level_t
+    double loopback_gain;       // > 0: the mic also hears the speaker at this gain
+    int64_t loopback_delay_us;  // speaker-to-mic delay of that path
+} host_config_t;
+
+extern host_config_t host_config;
+
+// Firmware network settings come from the command line on the host
+#define UDP_SERVER_IP   host_config.server_ip
+#define UDP_SERVER_PORT host_config.server_port
+#define UDP_LOCAL_PORT  host_config.local_port
+
+// Virtual clock behind esp_timer, FreeRTOS ticks and I2S pacing (microseconds since start)
+int64_t host_time_us(void);
+void host_sleep_us(int64_t us);
+void host_sleep_until_us(int64_t deadline_us);
+
+typedef struct {
+    uint64_t bytes_captured;    // bytes returned by i2s_channel_read
+    uint64_t bytes_played;      // bytes accepted by i2s_channel_write
+    uint32_t rx_overflows;      // reader fell more than one DMA ring behind
+    uint32_t tx_underruns;      // DMA ran dry between writes
+    bool mic_done;              // end of the input WAV reached
+} host_i2s_stats_t;
+
+void host_i2s_get_stats(host_i2s_stats_t *stats);
+
+// Finish the output WAV (patches the header sizes)
+void host_i2s_close(void);
@@ -0,0 +1,310 @@
+// I2S standard-mode channels backed by WAV files.
+// RX reads the --mic WAV paced at the channel sample rate on the virtual clock,
+// TX appends to the --speaker WAV and blocks like a DMA ring of the configured
+// size draining in real time. DMA events are delivered to the registered
+// callbacks from the calling thread. With host_config.loopback_gain set, RX
+// also hears TX through a simulated acoustic path (delay + gain), which is
+// what the loopback self-test and echo/interrupt handling see on the device.
+#include "driver/i2s_std.h"
+#include "esp_log.h"
+#include "wav.h"
+#include <pthread.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "HOST_I2S";
+
+struct host_i2s_channel {
+    bool is_tx;
+    bool enabled;
+    uint32_t sample_rate;
+    uint32_t frame_bytes;
+    uint32_t dma_bytes;         // dma_desc_num * dma_frame_num frames
+    int64_t clock_us;           // RX: capture time of the next frame, TX: end of queued audio
+    int64_t frame_pos;          // same position in frames since the epoch of the virtual clock
+    bool primed;                // TX: written to since the last enable
+    uint8_t *preload;           // TX: i2s_channel_preload_data() before enable
+    size_t preload_len;
+    i2s_event_callbacks_t callbacks;
+    void *callback_ctx;
+};
+
+static pthread_mutex_t wav_lock = PTHREAD_MUTEX_INITIALIZER;
+static wav_file_t mic_wav;
+static wav_file_t speaker_wav;
+static host_i2s_stats_t stats;
+
+// Loopback: everything TX played, indexed by absolute TX frame
+#define SPEAKER_RING_FRAMES 65536   // 2.7 s at 24 kHz
+static int16_t speaker_ring[SPEAKER_RING_FRAMES];
+static int64_t speaker_tag[SPEAKER_RING_FRAMES];     // frame index + 1 held in the slot, 0 = never played
+static uint32_t speaker_rate;
+
+static int64_t bytes_to_us(const struct host_i2s_channel *chan, size_t bytes)
+{
+    return (int64_t)(bytes / chan->frame_bytes) * 1000000 / chan->sample_rate;
+}
+
+static void fire(i2s_isr_callback_t cb, i2s_chan_handle_t chan, void *data, size_t size)
+{
+    if (cb) {
+        i2s_event_data_t event = { .data = data, .size = size };
+        cb(chan, &event, chan->callback_ctx);
+    }
+}
+
+esp_err_t i2s_new_channel(const i2s_chan_config_t *chan_cfg, i2s_chan_handle_t *ret_tx, i2s_chan_handle_t *ret_rx)
+{
+    i2s_chan_handle_t *slots[] = { ret_tx, ret_rx };
+
+    for (int i = 0; i < 2; i++) {
+        if (!slots[i]) {
+            continue;
+        }
+        struct host_i2s_channel *chan = calloc(1, sizeof(*chan));
+        if (!chan) {
+            return ESP_ERR_NO_MEM;
+        }
+        chan->is_tx = (i == 0);
+        chan->dma_bytes = chan_cfg->dma_desc_num * chan_cfg->dma_frame_num;  // frames until init
+        *slots[i] = chan;
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2s_del_channel(i2s_chan_handle_t handle)
+{
+    free(handle->preload);
+    free(handle);
+    return ESP_OK;
+}
+
+esp_err_t i2s_channel_init_std_mode(i2s_chan_handle_t handle, const i2s_std_config_t *std_cfg)
+{
+    uint32_t bits = std_cfg->slot_cfg.data_bit_width;
+    uint32_t channels = std_cfg->slot_cfg.slot_mode == I2S_SLOT_MODE_STEREO ? 2 : 1;
+
+    handle->sample_rate = std_cfg->clk_cfg.sample_rate_hz;
+    handle->frame_bytes = bits / 8 * channels;
+    handle->dma_bytes *= handle->frame_bytes;
+    if (handle->is_tx) {
+        speaker_rate = handle->sample_rate;
+    }
+
+    pthread_mutex_lock(&wav_lock);
+    if (handle->is_tx && host_config.speaker_wav && !speaker_wav.fp) {
+        if (!wav_open_write(&speaker_wav, host_config.speaker_wav, handle->sample_rate, channels, bits)) {
+            pthread_mutex_unlock(&wav_lock);
+            return ESP_FAIL;
+        }
+    } else if (!handle->is_tx && host_config.mic_wav && !mic_wav.fp) {
+        if (!wav_open_read(&mic_wav, host_config.mic_wav)) {
+            pthread_mutex_unlock(&wav_lock);
+            return ESP_ERR_NOT_FOUND;
+        }
+        if (mic_wav.bits_per_sample != bits || mic_wav.channels != channels) {
+            ESP_LOGE(TAG, "%s must be %lu-bit, %lu channel(s)", host_config.mic_wav,
+                     (unsigned long)bits, (unsigned long)channels);
+            wav_close(&mic_wav);
+            pthread_mutex_unlock(&wav_lock);
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        if (mic_wav.sample_rate != handle->sample_rate) {
+            ESP_LOGW(TAG, "%s is %lu Hz, capture runs at %lu Hz (no resampling)", host_config.mic_wav,
+                     (unsigned long)mic_wav.sample_rate, (unsigned long)handle->sample_rate);
+        }
+    }
+    pthread_mutex_unlock(&wav_lock);
+
+    return ESP_OK;
+}
+
+esp_err_t i2s_channel_register_event_callback(i2s_chan_handle_t handle, const i2s_event_callbacks_t *callbacks, void *user_data)
+{
+    if (handle->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    handle->callbacks = *callbacks;
+    handle->callback_ctx = user_data;
+    return ESP_OK;
+}
+
+// TX: hand audio to the "DMA" - speaker WAV, loopback ring and play-out clock
+static void tx_queue(i2s_chan_handle_t handle, const void *src, size_t size)
+{
+    pthread_mutex_lock(&wav_lock);
+    wav_write(&speaker_wav, src, size);
+    stats.bytes_played += size;
+    if (handle->frame_bytes == sizeof(int16_t)) {
+        const int16_t *samples = src;
+        for (size_t i = 0; i < size / sizeof(int16_t); i++) {
+            int64_t frame = handle->frame_pos + i;
+            speaker_ring[frame % SPEAKER_RING_FRAMES] = samples[i];
+            speaker_tag[frame % SPEAKER_RING_FRAMES] = frame + 1;
+        }
+    }
+    pthread_mutex_unlock(&wav_lock);
+
+    handle->clock_us += bytes_to_us(handle, size);
+    handle->frame_pos += size / handle->frame_bytes;
+}
+
+// RX: add what the microphone hears from the speaker, frames starting at frame_pos
+static void mix_loopback(i2s_chan_handle_t handle, int16_t *samples, size_t frames, int64_t frame_pos)
+{
+    if (host_config.loopback_gain <= 0 || !speaker_rate || handle->frame_bytes != sizeof(int16_t)) {
+        return;
+    }
+    for (size_t i = 0; i < frames; i++) {
+        double t_us = (double)(frame_pos + i) * 1e6 / handle->sample_rate - host_config.loopback_delay_us;
+        int64_t frame = (int64_t)floor(t_us * speaker_rate / 1e6);
+        if (frame < 0 || speaker_tag[frame % SPEAKER_RING_FRAMES] != frame + 1) {
+            continue;
+        }
+        double v = samples[i] + speaker_ring[frame % SPEAKER_RING_FRAMES] * host_config.loopback_gain;
+        samples[i] = v > 32767.0 ? 32767 : v < -32768.0 ? -32768 : (int16_t)lrint(v);
+    }
+}
+
+esp_err_t i2s_channel_enable(i2s_chan_handle_t handle)
+{
+    if (handle->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    handle->enabled = true;
+    handle->primed = false;
+    handle->clock_us = host_time_us();
+    handle->frame_pos = handle->clock_us * handle->sample_rate / 1000000;
+
+    // Preloaded audio starts playing the moment the channel is enabled
+    if (handle->preload_len) {
+        tx_queue(handle, handle->preload, handle->preload_len);
+        handle->preload_len = 0;
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2s_channel_preload_data(i2s_chan_handle_t handle, const void *src, size_t size, size_t *bytes_loaded)
+{
+    if (!handle->is_tx || handle->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!handle->preload) {
+        handle->preload = malloc(handle->dma_bytes);
+        if (!handle->preload) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    size_t room = handle->dma_bytes - handle->preload_len;
+    size_t n = size < room ? size : room;
+    memcpy(handle->preload + handle->preload_len, src, n);
+    handle->preload_len += n;
+    *bytes_loaded = n;
+    return ESP_OK;
+}
+
+esp_err_t i2s_channel_disable(i2s_chan_handle_t handle)
+{
+    if (!handle->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    handle->enabled = false;
+    return ESP_OK;
+}
+
+esp_err_t i2s_channel_read(i2s_chan_handle_t handle, void *dest, size_t size, size_t *bytes_read, uint32_t timeout_ms)
+{
+    if (!handle->enabled || handle->is_tx) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // The microphone keeps running while nobody reads: once the reader is more
+    // than a DMA ring behind, the oldest audio is lost
+    int64_t behind_us = host_time_us() - handle->clock_us - bytes_to_us(handle, handle->dma_bytes);
+    if (behind_us > 0) {
+        size_t lost = (size_t)(behind_us * handle->sample_rate / 1000000) * handle->frame_bytes;
+        uint8_t scratch[1024];
+
+        pthread_mutex_lock(&wav_lock);
+        for (size_t left = lost; left > 0;) {
+            size_t n = left < sizeof(scratch) ? left : sizeof(scratch);
+            if (wav_read(&mic_wav, scratch, n) == 0) {
+                break;
+            }
+            left -= n;
+        }
+        stats.rx_overflows++;
+        pthread_mutex_unlock(&wav_lock);
+
+        handle->clock_us += bytes_to_us(handle, lost);
+        handle->frame_pos += lost / handle->frame_bytes;
+        fire(handle->callbacks.on_recv_q_ovf, handle, NULL, lost);
+    }
+
+    // Block until the requested audio has been "captured"
+    handle->clock_us += bytes_to_us(handle, size);
+    host_sleep_until_us(handle->clock_us);
+
+    pthread_mutex_lock(&wav_lock);
+    size_t got = wav_read(&mic_wav, dest, size);
+    if (got < size) {
+        memset((uint8_t *)dest + got, 0, size - got);
+        stats.mic_done = true;
+    }
+    stats.bytes_captured += size;
+    mix_loopback(handle, dest, size / handle->frame_bytes, handle->frame_pos);
+    pthread_mutex_unlock(&wav_lock);
+
+    handle->frame_pos += size / handle->frame_bytes;
+    fire(handle->callbacks.on_recv, handle, dest, size);
+    *bytes_read = size;
+    return ESP_OK;
+}
+
+esp_err_t i2s_channel_write(i2s_chan_handle_t handle, const void *src, size_t size, size_t *bytes_written, uint32_t timeout_ms)
+{
+    if (!handle->enabled || !handle->is_tx) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int64_t now = host_time_us();
+    if (handle->clock_us < now) {
+        // DMA ran dry since the last write; hardware replays stale buffers here
+        if (handle->primed) {
+            pthread_mutex_lock(&wav_lock);
+            stats.tx_underruns++;
+            pthread_mutex_unlock(&wav_lock);
+            fire(handle->callbacks.on_send_q_ovf, handle, NULL, 0);
+        }
+        handle->clock_us = now;
+        handle->frame_pos = now * handle->sample_rate / 1000000;
+    }
+
+    // Wait for room in the DMA ring
+    host_sleep_until_us(handle->clock_us + bytes_to_us(handle, size) - bytes_to_us(handle, handle->dma_bytes));
+
+    tx_queue(handle, src, size);
+    handle->primed = true;
+    fire(handle->callbacks.on_sent, handle, (void *)src, size);
+    *bytes_written = size;
+    return ESP_OK;
+}
+
+void host_i2s_get_stats(host_i2s_stats_t *out)
+{
+    pthread_mutex_lock(&wav_lock);
+    *out = stats;
+    if (!host_config.mic_wav) {
+        out->mic_done = false;
+    }
+    pthread_mutex_unlock(&wav_lock);
+}
+
+void host_i2s_close(void)
+{
+    pthread_mutex_lock(&wav_lock);
+    wav_close(&speaker_wav);
+    wav_close(&mic_wav);
+    pthread_mutex_unlock(&wav_lock);
+}
@@ -0,0 +1,9 @@
+#pragma once
+// lwIP's BSD socket API maps directly onto the host's
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <errno.h>
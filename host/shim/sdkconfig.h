@@ -0,0 +1,10 @@
+#pragma once
+// Subset of the firmware configuration used by the shared sources
+#define CONFIG_IDF_TARGET "linux"
+#define CONFIG_IDF_TARGET_LINUX 1
+#ifndef CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ
+#define CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ 1000
+#endif
+#define CONFIG_FREERTOS_HZ 1000
+#define CONFIG_LOG_MAXIMUM_LEVEL 5
+#define CONFIG_LOG_DEFAULT_LEVEL 3
@@ -0,0 +1,13 @@
+// The host is always "connected": sockets go straight to the host network stack
+#include "wifi_handler.h"
+#include <stdbool.h>
+
+esp_err_t wifi_connect_init(void)
+{
+    return ESP_OK;
+}
+
+bool wifi_is_connected(void)
+{
+    return true;
+}
@@ -0,0 +1,163 @@
+#include "wav.h"
+#include <string.h>
+
+#define WAV_HEADER_SIZE 44
+
+static uint32_t read_u32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t read_u16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+bool wav_open_read(wav_file_t *wav, const char *path)
+{
+    memset(wav, 0, sizeof(*wav));
+    wav->fp = fopen(path, "rb");
+    if (!wav->fp) {
+        fprintf(stderr, "wav: cannot open %s\n", path);
+        return false;
+    }
+
+    uint8_t riff[12];
+    if (fread(riff, 1, sizeof(riff), wav->fp) != sizeof(riff) ||
+        memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+        fprintf(stderr, "wav: %s is not a RIFF/WAVE file\n", path);
+        goto fail;
+    }
+
+    // Walk the chunks until "data", picking up "fmt " on the way
+    bool have_fmt = false;
+    for (;;) {
+        uint8_t hdr[8];
+        if (fread(hdr, 1, sizeof(hdr), wav->fp) != sizeof(hdr)) {
+            fprintf(stderr, "wav: %s has no data chunk\n", path);
+            goto fail;
+        }
+        uint32_t size = read_u32(hdr + 4);
+
+        if (memcmp(hdr, "fmt ", 4) == 0) {
+            uint8_t fmt[16];
+            if (size < sizeof(fmt) || fread(fmt, 1, sizeof(fmt), wav->fp) != sizeof(fmt)) {
+                goto fail;
+            }
+            if (read_u16(fmt) != 1) {
+                fprintf(stderr, "wav: %s is not integer PCM\n", path);
+                goto fail;
+            }
+            wav->channels = read_u16(fmt + 2);
+            wav->sample_rate = read_u32(fmt + 4);
+            wav->bits_per_sample = read_u16(fmt + 14);
+            have_fmt = true;
+            fseek(wav->fp, (long)(size - sizeof(fmt) + (size & 1)), SEEK_CUR);
+        } else if (memcmp(hdr, "data", 4) == 0) {
+            if (!have_fmt) {
+                fprintf(stderr, "wav: %s has data before fmt\n", path);
+                goto fail;
+            }
+            wav->data_bytes = size;
+            return true;
+        } else {
+            fseek(wav->fp, (long)(size + (size & 1)), SEEK_CUR);
+        }
+    }
+
+fail:
+    fclose(wav->fp);
+    wav->fp = NULL;
+    return false;
+}
+
+size_t wav_read(wav_file_t *wav, void *buf, size_t bytes)
+{
+    if (!wav->fp || wav->writing) {
+        return 0;
+    }
+
+    size_t left = wav->data_bytes - wav->data_read;
+    if (bytes > left) {
+        bytes = left;
+    }
+    size_t got = fread(buf, 1, bytes, wav->fp);
+    wav->data_read += got;
+    return got;
+}
+
+static void write_header(wav_file_t *wav)
+{
+    uint8_t hdr[WAV_HEADER_SIZE];
+    uint16_t block_align = wav->channels * wav->bits_per_sample / 8;
+
+    memcpy(hdr, "RIFF", 4);
+    put_u32(hdr + 4, 36 + wav->data_bytes);
+    memcpy(hdr + 8, "WAVEfmt ", 8);
+    put_u32(hdr + 16, 16);
+    put_u16(hdr + 20, 1);
+    put_u16(hdr + 22, wav->channels);
+    put_u32(hdr + 24, wav->sample_rate);
+    put_u32(hdr + 28, wav->sample_rate * block_align);
+    put_u16(hdr + 32, block_align);
+    put_u16(hdr + 34, wav->bits_per_sample);
+    memcpy(hdr + 36, "data", 4);
+    put_u32(hdr + 40, wav->data_bytes);
+
+    fseek(wav->fp, 0, SEEK_SET);
+    fwrite(hdr, 1, sizeof(hdr), wav->fp);
+    fseek(wav->fp, 0, SEEK_END);
+}
+
+bool wav_open_write(wav_file_t *wav, const char *path, uint32_t sample_rate,
+                    uint16_t channels, uint16_t bits_per_sample)
+{
+    memset(wav, 0, sizeof(*wav));
+    wav->fp = fopen(path, "wb");
+    if (!wav->fp) {
+        fprintf(stderr, "wav: cannot create %s\n", path);
+        return false;
+    }
+    wav->writing = true;
+    wav->sample_rate = sample_rate;
+    wav->channels = channels;
+    wav->bits_per_sample = bits_per_sample;
+    write_header(wav);
+    return true;
+}
+
+size_t wav_write(wav_file_t *wav, const void *buf, size_t bytes)
+{
+    if (!wav->fp || !wav->writing) {
+        return 0;
+    }
+    size_t put = fwrite(buf, 1, bytes, wav->fp);
+    wav->data_bytes += put;
+    return put;
+}
+
+void wav_close(wav_file_t *wav)
+{
+    if (!wav->fp) {
+        return;
+    }
+    if (wav->writing) {
+        write_header(wav);
+    }
+    fclose(wav->fp);
+    wav->fp = NULL;
+}
@@ -0,0 +1,35 @@
+#ifndef WAV_H
+#define WAV_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Minimal PCM WAV reader / writer for the host harness and tools
+
+typedef struct {
+    FILE *fp;
+    bool writing;
+    uint32_t sample_rate;
+    uint16_t channels;
+    uint16_t bits_per_sample;
+    uint32_t data_bytes;        // reading: size of the data chunk, writing: bytes so far
+    uint32_t data_read;         // reading: bytes consumed
+} wav_file_t;
+
+// Open a PCM WAV file; returns false (and logs to stderr) if it is not one
+bool wav_open_read(wav_file_t *wav, const char *path);
+
+// Read up to bytes of sample data; returns bytes read (0 at end of data)
+size_t wav_read(wav_file_t *wav, void *buf, size_t bytes);
+
+bool wav_open_write(wav_file_t *wav, const char *path, uint32_t sample_rate,
+                    uint16_t channels, uint16_t bits_per_sample);
+
+size_t wav_write(wav_file_t *wav, const void *buf, size_t bytes);
+
+// Close; a written file gets its RIFF and data sizes patched
+void wav_close(wav_file_t *wav);
+
+#endif // WAV_H
@@ -0,0 +1,225 @@
+#include "audio_bench.h"
+#include "audio_dsp.h"
+#include "audio_handler.h"
+#include "udp_client.h"
+#include "trace.h"
+#include "dlog.h"
+#include "telemetry.h"
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "sdkconfig.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "AUDIO_BENCH";
+
+#if CONFIG_COMPILER_OPTIMIZATION_PERF
+#define BENCH_PROFILE "perf"
+#elif CONFIG_COMPILER_OPTIMIZATION_SIZE
+#define BENCH_PROFILE "size"
+#elif CONFIG_COMPILER_OPTIMIZATION_NONE
+#define BENCH_PROFILE "none"
+#elif CONFIG_IDF_TARGET_LINUX
+#define BENCH_PROFILE "host"
+#else
+#define BENCH_PROFILE "debug"
+#endif
+
+// What the cycle counter counts. The host counter has no fixed relation to
+// the shim's CPU frequency, so cpu_mhz is null there.
+#define BENCH_STR_(x) #x
+#define BENCH_STR(x)  BENCH_STR_(x)
+#if CONFIG_IDF_TARGET_LINUX
+#if defined(__x86_64__) || defined(__i386__)
+#define BENCH_CLOCK "tsc"
+#else
+#define BENCH_CLOCK "ns"
+#endif
+#define BENCH_CPU_MHZ "null"
+#else
+#define BENCH_CLOCK "ccount"
+#define BENCH_CPU_MHZ BENCH_STR(CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ)
+#endif
+
+#define CAPTURE_SAMPLES  (AUDIO_CHUNK_SIZE_CAPTURE / 2)    // 48 kHz, one 40 ms chunk
+#define OUTPUT_SAMPLES   (AUDIO_CHUNK_SIZE_OUTPUT / 2)     // 24 kHz, one 40 ms chunk
+#define PLAYBACK_BYTES   1440                              // downlink chunk from the bridge
+#define PLAYBACK_SAMPLES (PLAYBACK_BYTES / 2)
+
+typedef struct {
+    const char *name;
+    size_t samples;         // samples (or events) processed per call
+    void (*run)(void);
+} bench_kernel_t;
+
+// Internal RAM, like the real chunk buffers the kernels see on the hot path
+static int16_t capture_buf[CAPTURE_SAMPLES];
+static int16_t output_buf[OUTPUT_SAMPLES];
+static int16_t playback_buf[PLAYBACK_SAMPLES];
+static uint8_t packet_buf[UDP_AUDIO_HEADER_SIZE + AUDIO_CHUNK_SIZE_OUTPUT];
+static audio_chunk_t chunk_buf;
+static uint32_t cycles[AUDIO_BENCH_ITERATIONS];
+static volatile uint32_t sink;
+
+static void fill_test_signal(void)
+{
+    // Deterministic pseudo-random full-scale noise
+    uint32_t lcg = 12345;
+    for (size_t i = 0; i < CAPTURE_SAMPLES; i++) {
+        lcg = lcg * 1664525 + 1013904223;
+        capture_buf[i] = (int16_t)(lcg >> 16);
+    }
+    memcpy(output_buf, capture_buf, sizeof(output_buf));
+    memcpy(playback_buf, capture_buf, sizeof(playback_buf));
+    udp_packet_build_audio(packet_buf, sizeof(packet_buf), UDP_MSG_PLAY_AUDIO,
+                           (const uint8_t *)playback_buf, PLAYBACK_BYTES, 42);
+}
+
+// ---- DSP kernels ----
+
+static void run_decimate_2x(void)
+{
+    audio_dsp_decimate_2x(capture_buf, CAPTURE_SAMPLES, output_buf);
+}
+
+static void run_decimate_3x(void)
+{
+    static int16_t history[AUDIO_DSP_DECIMATE_3X_HISTORY];
+    audio_dsp_decimate_3x(capture_buf, CAPTURE_SAMPLES, output_buf, history);
+}
+
+static void run_rms(void)
+{
+    sink += audio_dsp_rms(output_buf, OUTPUT_SAMPLES);
+}
+
+static void run_scale_q15(void)
+{
+    audio_dsp_scale_q15(playback_buf, PLAYBACK_SAMPLES, AUDIO_DSP_Q15(0.05f));
+}
+
+// The float volume loop the playback task used before audio_dsp_scale_q15
+static void run_scale_float_ref(void)
+{
+    for (size_t i = 0; i < PLAYBACK_SAMPLES; i++) {
+        playback_buf[i] = (int16_t)(playback_buf[i] * 0.05f);
+    }
+}
+
+// ---- Packet kernels ----
+
+static void run_packet_build(void)
+{
+    sink += udp_packet_build_audio(packet_buf, sizeof(packet_buf), UDP_MSG_AUDIO_DATA,
+                                   (const uint8_t *)output_buf, AUDIO_CHUNK_SIZE_OUTPUT, 7);
+}
+
+// What udp_send_audio_packet() does around sendto(): allocate, frame, free
+static void run_packet_build_malloc(void)
+{
+    size_t size = UDP_AUDIO_HEADER_SIZE + AUDIO_CHUNK_SIZE_OUTPUT;
+    uint8_t *packet = malloc(size);
+    if (packet) {
+        sink += udp_packet_build_audio(packet, size, UDP_MSG_AUDIO_DATA,
+                                       (const uint8_t *)output_buf, AUDIO_CHUNK_SIZE_OUTPUT, 7);
+        free(packet);
+    }
+}
+
+static void run_packet_parse(void)
+{
+    uint32_t seq;
+    const uint8_t *audio;
+    size_t audio_len;
+    if (udp_packet_parse_audio(packet_buf, UDP_AUDIO_HEADER_SIZE + PLAYBACK_BYTES, &seq, &audio, &audio_len)) {
+        sink += seq + audio_len;
+    }
+}
+
+// The copy audio_playback_queue_push() makes into the queue item
+static void run_chunk_copy(void)
+{
+    memcpy(chunk_buf.data, packet_buf + UDP_AUDIO_HEADER_SIZE, PLAYBACK_BYTES);
+    chunk_buf.length = PLAYBACK_BYTES;
+    chunk_buf.sequence = 42;
+    chunk_buf.is_last_chunk = false;
+}
+
+// ---- Instrumentation recorders ----
+
+static void run_trace_record(void)
+{
+    trace_record(TRACE_EV_QUEUE_PUSH, 1, 42);
+}
+
+static void run_dlog_record(void)
+{
+    // Verbose: stored and formatted like any entry, but never printed
+    static const uint32_t args[2] = { 42, 1440 };
+    dlog_record(ESP_LOG_VERBOSE, TAG, "bench chunk=#%lu bytes=%lu", 2, args);
+}
+
+static void run_telemetry_latency(void)
+{
+    telemetry_record_latency(TELEMETRY_HIST_UDP_SEND, 250);
+}
+
+static const bench_kernel_t kernels[] = {
+    { "decimate_2x", CAPTURE_SAMPLES, run_decimate_2x },
+    { "decimate_3x", CAPTURE_SAMPLES, run_decimate_3x },
+    { "rms", OUTPUT_SAMPLES, run_rms },
+    { "scale_q15", PLAYBACK_SAMPLES, run_scale_q15 },
+    { "scale_float_ref", PLAYBACK_SAMPLES, run_scale_float_ref },
+    { "packet_build", OUTPUT_SAMPLES, run_packet_build },
+    { "packet_build_malloc", OUTPUT_SAMPLES, run_packet_build_malloc },
+    { "packet_parse", PLAYBACK_SAMPLES, run_packet_parse },
+    { "chunk_copy", PLAYBACK_SAMPLES, run_chunk_copy },
+    { "trace_record", 1, run_trace_record },
+    { "dlog_record", 1, run_dlog_record },
+    { "telemetry_latency", 1, run_telemetry_latency },
+};
+
+static int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void bench_kernel(const bench_kernel_t *k)
+{
+    uint64_t total = 0;
+
+    k->run();   // warm caches and branch predictors
+
+    for (int i = 0; i < AUDIO_BENCH_ITERATIONS; i++) {
+        fill_test_signal();
+        uint32_t start = esp_cpu_get_cycle_count();
+        k->run();
+        cycles[i] = esp_cpu_get_cycle_count() - start;
+        total += cycles[i];
+    }
+
+    qsort(cycles, AUDIO_BENCH_ITERATIONS, sizeof(cycles[0]), compare_u32);
+    uint32_t mean = (uint32_t)(total / AUDIO_BENCH_ITERATIONS);
+
+    printf("{\"bench\":\"kernel\",\"target\":\"%s\",\"profile\":\"%s\",\"clock\":\"%s\",\"cpu_mhz\":%s,"
+           "\"kernel\":\"%s\",\"samples\":%u,\"iterations\":%d,"
+           "\"min\":%lu,\"median\":%lu,\"mean\":%lu,\"max\":%lu,\"cycles_per_sample\":%.3f}\n",
+           CONFIG_IDF_TARGET, BENCH_PROFILE, BENCH_CLOCK, BENCH_CPU_MHZ,
+           k->name, (unsigned)k->samples, AUDIO_BENCH_ITERATIONS,
+           (unsigned long)cycles[0], (unsigned long)cycles[AUDIO_BENCH_ITERATIONS / 2],
+           (unsigned long)mean, (unsigned long)cycles[AUDIO_BENCH_ITERATIONS - 1],
+           (double)cycles[AUDIO_BENCH_ITERATIONS / 2] / k->samples);
+}
+
+void audio_bench_run(void)
+{
+    ESP_LOGI(TAG, "📊 Kernel benchmark: %d kernels x %d iterations (profile=%s)",
+             (int)(sizeof(kernels) / sizeof(kernels[0])), AUDIO_BENCH_ITERATIONS, BENCH_PROFILE);
+
+    for (size_t i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i++) {
+        bench_kernel(&kernels[i]);
+    }
+    fflush(stdout);
+}
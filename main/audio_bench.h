@@ -0,0 +1,27 @@
+#ifndef AUDIO_BENCH_H
+#define AUDIO_BENCH_H
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Cycle benchmark of the hot-path kernels: audio_dsp, packet framing and the
+// trace / dlog / telemetry recorders. Each kernel runs over fixed inputs and
+// prints one JSON line to stdout:
+//
+//   {"bench":"kernel","target":"esp32s3","profile":"perf","clock":"ccount",
+//    "cpu_mhz":160,"kernel":"rms","samples":960,"iterations":200,"min":..,"median":..,"mean":..,"max":..,
+//    "cycles_per_sample":..}
+//
+// min..max are cycles per frame (one call on one 40 ms chunk). Cycles come
+// from esp_cpu_get_cycle_count(): CCOUNT on the device, TSC / clock_gettime
+// on the host build ("clock" says which; cpu_mhz is null on the host). Compare two runs with nodejs_bridge/tools/bench_compare.js.
+
+#ifndef AUDIO_BENCH_ITERATIONS
+#define AUDIO_BENCH_ITERATIONS 200
+#endif
+
+void audio_bench_run(void);
+
+#endif // AUDIO_BENCH_H
@@ -0,0 +1,94 @@
+#include "audio_dsp.h"
+#include "esp_attr.h"
+
+size_t IRAM_ATTR audio_dsp_decimate_2x(const int16_t *in, size_t in_samples, int16_t *out)
+{
+    size_t out_samples = in_samples / 2;
+
+    for (size_t i = 0; i < out_samples; i++) {
+        out[i] = in[i * 2];
+    }
+
+    return out_samples;
+}
+
+// Kaiser-windowed sinc (beta 6), cutoff 6.8 kHz at 48 kHz, unity DC gain.
+// Symmetric, so the taps can be applied oldest sample first.
+static const DRAM_ATTR int16_t decimate_3x_fir[AUDIO_DSP_DECIMATE_3X_TAPS] = {
+        6,    12,     6,   -20,   -52,   -50,    13,   115,
+      166,    76,  -151,  -360,  -328,    44,   568,   813,
+      400,  -619, -1602, -1593,    73,  3209,  6687,  8970,
+     8970,  6687,  3209,    73, -1593, -1602,  -619,   400,
+      813,   568,    44,  -328,  -360,  -151,    76,   166,
+      115,    13,   -50,   -52,   -20,     6,    12,     6,
+};
+
+size_t IRAM_ATTR audio_dsp_decimate_3x(const int16_t *in, size_t in_samples, int16_t *out, int16_t *history)
+{
+    const int taps = AUDIO_DSP_DECIMATE_3X_TAPS;
+    const int hist = AUDIO_DSP_DECIMATE_3X_HISTORY;
+    size_t out_samples = in_samples / 3;
+
+    for (size_t k = 0; k < out_samples; k++) {
+        int oldest = (int)(k * 3) + 2 - hist;   // first input under the filter for this output
+        int32_t acc = 0;                        // |acc| < 32768 * sum|h| < 2^31
+
+        if (oldest >= 0) {
+            const int16_t *x = &in[oldest];
+            for (int j = 0; j < taps; j++) {
+                acc += x[j] * decimate_3x_fir[j];
+            }
+        } else {
+            // Window still reaches back into the previous chunk
+            for (int j = 0; j < taps; j++) {
+                int i = oldest + j;
+                int32_t sample = i < 0 ? history[hist + i] : in[i];
+                acc += sample * decimate_3x_fir[j];
+            }
+        }
+
+        acc = (acc + (1 << 14)) >> 15;
+        out[k] = (int16_t)(acc > 32767 ? 32767 : acc < -32768 ? -32768 : acc);
+    }
+
+    for (int i = 0; i < hist; i++) {
+        history[i] = in[in_samples - hist + i];
+    }
+
+    return out_samples;
+}
+
+uint32_t IRAM_ATTR audio_dsp_rms(const int16_t *samples, size_t sample_count)
+{
+    if (!samples || sample_count == 0) {
+        return 0;
+    }
+
+    uint64_t sum = 0;
+    for (size_t i = 0; i < sample_count; i++) {
+        int32_t sample = samples[i];
+        sum += (uint32_t)(sample * sample);
+    }
+
+    uint32_t mean = (uint32_t)(sum / sample_count);
+
+    // Fast integer square root (Babylonian method)
+    if (mean == 0) return 0;
+
+    uint32_t x = mean;
+    uint32_t y = (x + 1) / 2;
+    while (y < x) {
+        x = y;
+        y = (x + mean / x) / 2;
+    }
+
+    return x;
+}
+
+void IRAM_ATTR audio_dsp_scale_q15(int16_t *samples, size_t sample_count, int16_t gain_q15)
+{
+    // Integer multiply + shift instead of an int->float->int round trip per sample
+    for (size_t i = 0; i < sample_count; i++) {
+        samples[i] = (int16_t)(((int32_t)samples[i] * gain_q15) >> 15);
+    }
+}
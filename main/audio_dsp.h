@@ -0,0 +1,36 @@
+#ifndef AUDIO_DSP_H
+#define AUDIO_DSP_H
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Per-sample audio kernels used on the capture and playback paths.
+// They are placed in IRAM so a chunk never waits on an instruction cache
+// refill while WiFi or PSRAM traffic is thrashing the cache. Kernels must not
+// call into flash-resident code (no logging, no libm).
+
+// Q15 fixed point gain: 32768 = 1.0
+#define AUDIO_DSP_Q15(x) ((int16_t)((x) * 32768.0f + 0.5f))
+
+// 2:1 decimation (keeps every 2nd sample, no filtering). Returns output samples.
+size_t audio_dsp_decimate_2x(const int16_t *in, size_t in_samples, int16_t *out);
+
+// 3:1 decimation (48 -> 16 kHz uplink) through a 48-tap Q15 lowpass FIR:
+// flat to 5 kHz, -24 dB at the new Nyquist (8 kHz), -60 dB from 9 kHz.
+// history carries the last AUDIO_DSP_DECIMATE_3X_HISTORY input samples from
+// one call to the next (zero it at the start of a stream). in_samples must
+// be a multiple of 3 and at least the history; out must not overlap in.
+// Returns output samples.
+#define AUDIO_DSP_DECIMATE_3X_TAPS      48
+#define AUDIO_DSP_DECIMATE_3X_HISTORY   (AUDIO_DSP_DECIMATE_3X_TAPS - 1)
+size_t audio_dsp_decimate_3x(const int16_t *in, size_t in_samples, int16_t *out, int16_t *history);
+
+// Integer RMS of a block
+uint32_t audio_dsp_rms(const int16_t *samples, size_t sample_count);
+
+// In-place volume: samples[i] = samples[i] * gain_q15 / 32768
+void audio_dsp_scale_q15(int16_t *samples, size_t sample_count, int16_t gain_q15);
+
+#endif // AUDIO_DSP_H
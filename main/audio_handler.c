@@ -10,6 +10,12 @@
 #include "esp_heap_caps.h"
 #include "udp_client.h"  // For UDP streaming
 #include "audio_handler.h"
+#include "audio_dsp.h"
+#include "trace.h"
+#include "dlog.h"
+#include "telemetry.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
 
 static const char *TAG = "AUDIO_HANDLER";
 
@@ -31,12 +37,42 @@ static const char *TAG = "AUDIO_HANDLER";
 static i2s_chan_handle_t tx_handle = NULL;  // For speaker output
 static i2s_chan_handle_t rx_handle = NULL;  // For microphone input
 
+// Cumulative counters reported through telemetry (see audio_get_stats)
+static audio_stats_t audio_stats;
+
 // Forward declarations
 esp_err_t audio_stop_streaming(uint32_t *chunks_sent);
 
-// Timing helper function
+// Timing helper function (esp_timer, not the 10 ms FreeRTOS tick)
 static inline int64_t get_time_ms(void) {
-    return (int64_t)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+    return esp_timer_get_time() / 1000;
+}
+
+// I2S DMA event callbacks, run in ISR context (IRAM, with CONFIG_I2S_ISR_IRAM_SAFE in sdkconfig.perf)
+static bool IRAM_ATTR i2s_rx_dma_done(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx)
+{
+    TRACE_EVENT(TRACE_EV_I2S_RX_DMA, 0, event->size);
+    return false;
+}
+
+static bool IRAM_ATTR i2s_rx_dma_overflow(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx)
+{
+    // Capture fell behind: the oldest DMA buffer was overwritten
+    TRACE_EVENT(TRACE_EV_I2S_RX_OVERFLOW, 0, event->size);
+    return false;
+}
+
+static bool IRAM_ATTR i2s_tx_dma_done(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx)
+{
+    TRACE_EVENT(TRACE_EV_I2S_TX_DMA, 0, event->size);
+    return false;
+}
+
+static bool IRAM_ATTR i2s_tx_dma_overflow(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx)
+{
+    // Playback fell behind: DMA is replaying a stale buffer
+    TRACE_EVENT(TRACE_EV_I2S_TX_OVERFLOW, 0, event->size);
+    return false;
 }
 
 
@@ -160,6 +196,23 @@ esp_err_t audio_init(void)
         return ret;
     }
     ESP_LOGI(TAG, "✅ I2S TX channel initialized successfully");
+
+    // DMA event callbacks (must be registered before the channels are enabled)
+    i2s_event_callbacks_t rx_cbs = {
+        .on_recv = i2s_rx_dma_done,
+        .on_recv_q_ovf = i2s_rx_dma_overflow,
+    };
+    i2s_event_callbacks_t tx_cbs = {
+        .on_sent = i2s_tx_dma_done,
+        .on_send_q_ovf = i2s_tx_dma_overflow,
+    };
+    ret = i2s_channel_register_event_callback(rx_handle, &rx_cbs, NULL);
+    if (ret == ESP_OK) {
+        ret = i2s_channel_register_event_callback(tx_handle, &tx_cbs, NULL);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to register I2S DMA callbacks: %s", esp_err_to_name(ret));
+    }
     
     ESP_LOGI(TAG, "I2S initialized successfully with PROVEN INMP441 settings");
     ESP_LOGI(TAG, "Microphone: SCK=%d, WS=%d, SD=%d", I2S_MIC_SCK_GPIO, I2S_MIC_WS_GPIO, I2S_MIC_SD_GPIO);
@@ -488,29 +541,7 @@ esp_err_t audio_test_microphone_quick(void)
 // Used for silence detection in continuous recording mode
 uint32_t audio_calculate_rms(int16_t *samples, size_t sample_count)
 {
-    if (!samples || sample_count == 0) {
-        return 0;
-    }
-
-    uint64_t sum = 0;
-    for (size_t i = 0; i < sample_count; i++) {
-        int32_t sample = samples[i];
-        sum += (sample * sample);
-    }
-
-    uint32_t mean = sum / sample_count;
-
-    // Fast integer square root (Babylonian method)
-    if (mean == 0) return 0;
-
-    uint32_t x = mean;
-    uint32_t y = (x + 1) / 2;
-    while (y < x) {
-        x = y;
-        y = (x + mean / x) / 2;
-    }
-
-    return x;
+    return audio_dsp_rms(samples, sample_count);
 }
 
 // Stop I2S TX channel (for interrupting playback)
@@ -529,6 +560,20 @@ static uint8_t *streaming_capture_buffer = NULL;
 static uint8_t *streaming_output_buffer = NULL;
 static uint32_t streaming_sequence = 0;
 static bool streaming_active = false;
+static int64_t last_capture_us = 0;
+#if AUDIO_SAMPLE_RATE_UPLINK == 16000
+static int16_t decimate_history[AUDIO_DSP_DECIMATE_3X_HISTORY];
+#endif
+
+// 48 kHz capture -> AUDIO_SAMPLE_RATE_UPLINK; returns output samples
+static size_t capture_to_uplink(const int16_t *in, size_t in_samples, int16_t *out)
+{
+#if AUDIO_SAMPLE_RATE_UPLINK == 16000
+    return audio_dsp_decimate_3x(in, in_samples, out, decimate_history);
+#else
+    return audio_dsp_decimate_2x(in, in_samples, out);
+#endif
+}
 
 // just configure and kinda initlize everything before the actual streaming
 esp_err_t audio_start_streaming(void)
@@ -542,7 +587,7 @@ esp_err_t audio_start_streaming(void)
 
     // Allocate buffers for streaming
     const size_t capture_chunk_size = AUDIO_CHUNK_SIZE_CAPTURE;  // 3,840 bytes
-    const size_t output_chunk_size = AUDIO_CHUNK_SIZE_OUTPUT;    // 1,920 bytes
+    const size_t output_chunk_size = AUDIO_CHUNK_SIZE_UPLINK;    // 1,920 bytes (1,280 at 16 kHz)
 
     streaming_capture_buffer = malloc(capture_chunk_size);
     streaming_output_buffer = malloc(output_chunk_size);
@@ -580,8 +625,11 @@ esp_err_t audio_start_streaming(void)
         vTaskDelay(pdMS_TO_TICKS(10));
     }
 
-    // Reset sequence counter
+    // Reset sequence counter and the decimator's filter state
     streaming_sequence = 0;
+#if AUDIO_SAMPLE_RATE_UPLINK == 16000
+    memset(decimate_history, 0, sizeof(decimate_history));
+#endif
     streaming_active = true;
 
     ESP_LOGI(TAG, "✅ Streaming started - ready to capture chunks");
@@ -596,7 +644,7 @@ esp_err_t audio_stream_one_chunk(void)
     }
 
     const size_t capture_chunk_size = AUDIO_CHUNK_SIZE_CAPTURE;  // 3,840 bytes
-    const size_t output_chunk_size = AUDIO_CHUNK_SIZE_OUTPUT;    // 1,920 bytes
+    const size_t output_chunk_size = AUDIO_CHUNK_SIZE_UPLINK;    // 1,920 bytes (1,280 at 16 kHz)
 
     // Capture one chunk from I2S
     size_t bytes_read = 0;
@@ -609,17 +657,17 @@ esp_err_t audio_stream_one_chunk(void)
         return ret;
     }
 
-    // Downsample 48kHz → 24kHz (take every 2nd sample)
+    // Downsample 48kHz → uplink rate
     size_t input_samples = capture_chunk_size / 2;
     int16_t *input_16 = (int16_t *)streaming_capture_buffer;
     int16_t *output_16 = (int16_t *)streaming_output_buffer;
 
-    for (size_t i = 0; i < input_samples / 2; i++) {
-        output_16[i] = input_16[i * 2];
-    }
+    capture_to_uplink(input_16, input_samples, output_16);
 
-    // Send via UDP with sequence number
-    esp_err_t send_ret = udp_send_audio_packet(streaming_output_buffer, output_chunk_size, streaming_sequence);
+    // Send via UDP with sequence number; the chunk started one chunk duration before the read returned
+    int64_t capture_us = esp_timer_get_time() - AUDIO_CHUNK_DURATION_MS * 1000;
+    esp_err_t send_ret = udp_send_audio_packet(streaming_output_buffer, output_chunk_size, streaming_sequence,
+                                               capture_us);
 
     if (send_ret == ESP_OK) {
         streaming_sequence++;
@@ -681,43 +729,57 @@ esp_err_t audio_stop_streaming(uint32_t *chunks_sent)
 esp_err_t audio_capture_chunk_to_buffer(uint8_t *output_buffer, size_t *bytes_captured)
 {
     if (!streaming_active) {
-        ESP_LOGE(TAG, "Streaming not active - call audio_start_streaming() first");
+        DLOGE(TAG, "Streaming not active - call audio_start_streaming() first");
         return ESP_ERR_INVALID_STATE;
     }
 
     if (!output_buffer || !bytes_captured) {
-        ESP_LOGE(TAG, "Invalid parameters");
+        DLOGE(TAG, "Invalid parameters");
         return ESP_ERR_INVALID_ARG;
     }
 
     const size_t capture_chunk_size = AUDIO_CHUNK_SIZE_CAPTURE;  // 3,840 bytes
-    const size_t output_chunk_size = AUDIO_CHUNK_SIZE_OUTPUT;    // 1,920 bytes
+    const size_t output_chunk_size = AUDIO_CHUNK_SIZE_UPLINK;    // 1,920 bytes (1,280 at 16 kHz)
 
     // Capture from I2S
     size_t bytes_read = 0;
+    int64_t read_start_us = esp_timer_get_time();
+    TRACE_EVENT(TRACE_EV_I2S_READ_BEGIN, 0, capture_chunk_size);
     esp_err_t ret = i2s_channel_read(rx_handle, streaming_capture_buffer,
                                      capture_chunk_size, &bytes_read,
                                      pdMS_TO_TICKS(1000));
+    TRACE_EVENT(TRACE_EV_I2S_READ_END, ret, bytes_read);
+    int64_t read_end_us = esp_timer_get_time();
+    telemetry_record_latency(TELEMETRY_HIST_I2S_READ, (uint32_t)(read_end_us - read_start_us));
 
     if (ret != ESP_OK || bytes_read != capture_chunk_size) {
-        ESP_LOGW(TAG, "I2S read issue: ret=%s, bytes=%zu/%zu",
-                 esp_err_to_name(ret), bytes_read, capture_chunk_size);
+        audio_stats.capture_errors++;
+        DLOGW(TAG, "I2S read issue: ret=0x%x, bytes=%lu/%lu",
+              ret, bytes_read, capture_chunk_size);
         return ret;
     }
 
-    // Downsample 48kHz → 24kHz (take every 2nd sample)
+    // Downsample 48kHz → uplink rate
     int16_t *input_16 = (int16_t *)streaming_capture_buffer;
     int16_t *output_16 = (int16_t *)output_buffer;
 
     size_t input_samples = capture_chunk_size / 2;
-    for (size_t i = 0; i < input_samples / 2; i++) {
-        output_16[i] = input_16[i * 2];
-    }
+    capture_to_uplink(input_16, input_samples, output_16);
+
+    // The read returns once the chunk's last sample is in, so the first one
+    // was captured a chunk duration earlier
+    last_capture_us = read_end_us - AUDIO_CHUNK_DURATION_MS * 1000;
 
     *bytes_captured = output_chunk_size;
+    audio_stats.chunks_captured++;
     return ESP_OK;
 }
 
+int64_t audio_get_capture_time_us(void)
+{
+    return last_capture_us;
+}
+
 // ==================== QUEUE-BASED PLAYBACK SYSTEM ====================
 // New queue-based playback for precise 40ms chunk handling
 
@@ -725,11 +787,15 @@ static QueueHandle_t audio_playback_queue = NULL;
 static TaskHandle_t queue_playback_task_handle = NULL;
 static volatile bool queue_playback_active = false;
 
+// Chunks queued before playback starts; the link probe (link_probe.c) tunes it
+static volatile int playback_prebuffer_chunks = 10;
+
 // Timing metrics for diagnostics
 static int64_t last_chunk_time_ms = 0;
 static int64_t first_chunk_time_ms = 0;
 static uint32_t total_chunks_played = 0;
 static uint32_t queue_underrun_count = 0;
+static int64_t last_chunk_time_us = 0;
 
 // PSRAM-backed queue storage for larger buffer sizes
 static StaticQueue_t queue_struct;
@@ -737,7 +803,7 @@ static uint8_t *queue_storage_buffer = NULL;
 
 // Volume control: 0.0 (mute) to 1.0 (full volume)
 // Set to 0.2 (20%) to prevent AI audio from triggering interrupt
-#define PLAYBACK_VOLUME_SCALE 0.05f
+#define PLAYBACK_VOLUME_Q15 AUDIO_DSP_Q15(0.05f)
 
 esp_err_t audio_playback_queue_init(void)
 {
@@ -773,6 +839,17 @@ esp_err_t audio_playback_queue_init(void)
     return ESP_OK;
 }
 
+void audio_playback_set_prebuffer(int chunks)
+{
+    if (chunks < 1) {
+        chunks = 1;
+    } else if (chunks > AUDIO_QUEUE_LENGTH) {
+        chunks = AUDIO_QUEUE_LENGTH;
+    }
+    playback_prebuffer_chunks = chunks;
+    ESP_LOGI(TAG, "Playback pre-buffer: %d chunks", chunks);
+}
+
 esp_err_t audio_playback_queue_push(const uint8_t *data, size_t len, uint32_t seq, bool is_last)
 {
     if (!audio_playback_queue) {
@@ -780,7 +857,7 @@ esp_err_t audio_playback_queue_push(const uint8_t *data, size_t len, uint32_t se
     }
 
     if (len > 1440) {
-        ESP_LOGW(TAG, "Chunk too large: %zu bytes (max 1440)", len);
+        DLOGW(TAG, "Chunk too large: %lu bytes (max 1440)", len);
         len = 1440;
     }
 
@@ -792,14 +869,22 @@ esp_err_t audio_playback_queue_push(const uint8_t *data, size_t len, uint32_t se
 
     // Try to push to queue (non-blocking)
     if (xQueueSend(audio_playback_queue, &chunk, 0) != pdTRUE) {
-        ESP_LOGW(TAG, "⚠️ Queue full, dropping chunk #%lu", seq);
+        audio_stats.queue_drops++;
+        DLOGW(TAG, "⚠️ Queue full, dropping chunk #%lu", seq);
         return ESP_ERR_NO_MEM;
     }
 
+    UBaseType_t depth = uxQueueMessagesWaiting(audio_playback_queue);
+    TRACE_EVENT(TRACE_EV_QUEUE_PUSH, depth, seq);
+    audio_stats.chunks_queued++;
+    if (depth > audio_stats.queue_high_water) {
+        audio_stats.queue_high_water = depth;
+    }
+
     // Log every 25 chunks (1 second)
     if (seq % 25 == 0) {
-        ESP_LOGI(TAG, "📥 Queued chunk #%lu (%zu bytes, %d in queue)",
-                 seq, len, uxQueueMessagesWaiting(audio_playback_queue));
+        DLOGI(TAG, "📥 Queued chunk #%lu (%lu bytes, %d in queue)",
+              seq, len, uxQueueMessagesWaiting(audio_playback_queue));
     }
 
     return ESP_OK;
@@ -807,6 +892,9 @@ esp_err_t audio_playback_queue_push(const uint8_t *data, size_t len, uint32_t se
 
 static void queue_playback_task(void *pvParameters)
 {
+    // Registered from here rather than by the creator: this task can run,
+    // fail and delete itself before xTaskCreatePinnedToCore() returns
+    telemetry_register_task(TELEMETRY_TASK_PLAYBACK, xTaskGetCurrentTaskHandle());
     ESP_LOGI(TAG, "🔊 Playback task started");
 
     // CRITICAL FIX: Reset metrics at the START of each playback session
@@ -815,6 +903,8 @@ static void queue_playback_task(void *pvParameters)
     last_chunk_time_ms = 0;
     first_chunk_time_ms = 0;
     queue_underrun_count = 0;
+    last_chunk_time_us = 0;
+    audio_stats.playback_sessions++;
 
     audio_chunk_t chunk;
     size_t bytes_written;
@@ -824,6 +914,8 @@ static void queue_playback_task(void *pvParameters)
     if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
         ESP_LOGE(TAG, "Failed to enable I2S TX: %s", esp_err_to_name(ret));
         queue_playback_active = false;
+        telemetry_register_task(TELEMETRY_TASK_PLAYBACK, NULL);
+        queue_playback_task_handle = NULL;
         vTaskDelete(NULL);
         return;
     }
@@ -832,10 +924,10 @@ static void queue_playback_task(void *pvParameters)
 
     // CRITICAL FIX: Wait for pre-buffering before starting playback
     // This prevents immediate playback from starving if packets are delayed
-    const int MIN_PREBUFFER_CHUNKS = 10;
-    ESP_LOGI(TAG, "⏳ Waiting for %d chunks to pre-buffer...", MIN_PREBUFFER_CHUNKS);
+    const int min_prebuffer_chunks = playback_prebuffer_chunks;
+    ESP_LOGI(TAG, "⏳ Waiting for %d chunks to pre-buffer...", min_prebuffer_chunks);
 
-    while (queue_playback_active && uxQueueMessagesWaiting(audio_playback_queue) < MIN_PREBUFFER_CHUNKS) {
+    while (queue_playback_active && uxQueueMessagesWaiting(audio_playback_queue) < min_prebuffer_chunks) {
         vTaskDelay(pdMS_TO_TICKS(50));
     }
 
@@ -847,8 +939,16 @@ static void queue_playback_task(void *pvParameters)
     while (queue_playback_active) {
         // Block waiting for chunk (500ms timeout - allows for network jitter)
         if (xQueueReceive(audio_playback_queue, &chunk, pdMS_TO_TICKS(500)) == pdTRUE) {
+            TRACE_EVENT(TRACE_EV_QUEUE_POP, uxQueueMessagesWaiting(audio_playback_queue), chunk.sequence);
 
             // Timing metrics
+            int64_t now_us = esp_timer_get_time();
+            if (last_chunk_time_us > 0) {
+                telemetry_record_latency(TELEMETRY_HIST_CHUNK_INTERVAL, (uint32_t)(now_us - last_chunk_time_us));
+            }
+            last_chunk_time_us = now_us;
+            audio_stats.chunks_played++;
+
             int64_t now_ms = get_time_ms();
             if (total_chunks_played == 0) {
                 first_chunk_time_ms = now_ms;
@@ -861,35 +961,41 @@ static void queue_playback_task(void *pvParameters)
             // Volume scaling in UDP task was blocking packet reception, causing massive packet loss
             int16_t *samples = (int16_t *)chunk.data;
             size_t sample_count = chunk.length / 2;
-            for (size_t i = 0; i < sample_count; i++) {
-                samples[i] = (int16_t)(samples[i] * PLAYBACK_VOLUME_SCALE);
-            }
+            audio_dsp_scale_q15(samples, sample_count, PLAYBACK_VOLUME_Q15);
 
             // Write to I2S - use generous timeout to avoid spurious failures
             // The DMA will pace the actual transmission, write just queues to DMA buffer
             int64_t write_start_ms = get_time_ms();
+            int64_t write_start_us = esp_timer_get_time();
+            TRACE_EVENT(TRACE_EV_I2S_WRITE_BEGIN, chunk.sequence, chunk.length);
             ret = i2s_channel_write(tx_handle, chunk.data, chunk.length,
                                    &bytes_written, portMAX_DELAY);
+            TRACE_EVENT(TRACE_EV_I2S_WRITE_END, ret, bytes_written);
             int64_t write_duration_ms = get_time_ms() - write_start_ms;
+            if (total_chunks_played == 1) {
+                // First chunk of the response is in the TX DMA: the device end of the latency waterfall
+                udp_send_playback_started(chunk.sequence, write_start_us);
+            }
+            telemetry_record_latency(TELEMETRY_HIST_I2S_WRITE, (uint32_t)(esp_timer_get_time() - write_start_us));
 
             if (ret != ESP_OK || bytes_written != chunk.length) {
-                ESP_LOGE(TAG, "I2S write failed: ret=%s, wrote %zu/%zu bytes",
-                         esp_err_to_name(ret), bytes_written, chunk.length);
+                audio_stats.i2s_write_errors++;
+                DLOGE(TAG, "I2S write failed: ret=0x%x, wrote %lu/%lu bytes",
+                      ret, bytes_written, chunk.length);
             }
 
             // Enhanced timing diagnostics every 25 chunks
             if (chunk.sequence % 25 == 0) {
                 int queue_depth = uxQueueMessagesWaiting(audio_playback_queue);
-                ESP_LOGI(TAG, "⏱️ TIMING: chunk=#%lu interval=%lldms i2s_write=%lldms queue_depth=%d (%.1f%% full)",
-                         chunk.sequence, chunk_interval_ms, write_duration_ms, queue_depth,
-                         (queue_depth * 100.0f) / AUDIO_QUEUE_LENGTH);
-                ESP_LOGI(TAG, "🔊 Played chunk #%lu (%d queued) [Volume: %.0f%%]",
-                         chunk.sequence, queue_depth,
-                         PLAYBACK_VOLUME_SCALE * 100);
+                DLOGI(TAG, "⏱️ TIMING: chunk=#%lu interval=%lums i2s_write=%lums queue_depth=%d",
+                      chunk.sequence, (uint32_t)chunk_interval_ms, (uint32_t)write_duration_ms, queue_depth);
+                DLOGI(TAG, "🔊 Played chunk #%lu (%d queued, %d%% full) [Volume: %d%%]",
+                      chunk.sequence, queue_depth, (queue_depth * 100) / AUDIO_QUEUE_LENGTH,
+                      (PLAYBACK_VOLUME_Q15 * 100 + 16384) >> 15);
             }
 
             if (chunk.is_last_chunk) {
-                ESP_LOGI(TAG, "🔊 Last chunk written to I2S - draining TX buffer...");
+                DLOGI(TAG, "🔊 Last chunk written to I2S - draining TX buffer...");
 
                 // CRITICAL FIX: Wait for I2S DMA to finish transmitting all buffered samples
                 // The I2S driver buffers multiple DMA descriptors, so we need to ensure
@@ -902,16 +1008,17 @@ static void queue_playback_task(void *pvParameters)
                 vTaskDelay(pdMS_TO_TICKS(220));
 
                 // Log final timing summary
-                int64_t total_duration_ms = get_time_ms() - first_chunk_time_ms;
-                float expected_duration_ms = total_chunks_played * 40.0f;  // 40ms per chunk
-                float timing_error_pct = ((total_duration_ms - expected_duration_ms) / expected_duration_ms) * 100.0f;
-
-                ESP_LOGI(TAG, "📊 PLAYBACK SUMMARY:");
-                ESP_LOGI(TAG, "   Chunks played: %lu", total_chunks_played);
-                ESP_LOGI(TAG, "   Total time: %lld ms", total_duration_ms);
-                ESP_LOGI(TAG, "   Expected time: %.1f ms", expected_duration_ms);
-                ESP_LOGI(TAG, "   Timing error: %.1f%%", timing_error_pct);
-                ESP_LOGI(TAG, "   Underruns: %lu", queue_underrun_count);
+                int32_t total_duration_ms = (int32_t)(get_time_ms() - first_chunk_time_ms);
+                int32_t expected_duration_ms = total_chunks_played * AUDIO_CHUNK_DURATION_MS;
+                int32_t timing_error_pct = expected_duration_ms > 0 ?
+                    ((total_duration_ms - expected_duration_ms) * 100) / expected_duration_ms : 0;
+
+                DLOGI(TAG, "📊 PLAYBACK SUMMARY:");
+                DLOGI(TAG, "   Chunks played: %lu", total_chunks_played);
+                DLOGI(TAG, "   Total time: %ld ms", total_duration_ms);
+                DLOGI(TAG, "   Expected time: %ld ms", expected_duration_ms);
+                DLOGI(TAG, "   Timing error: %ld%%", timing_error_pct);
+                DLOGI(TAG, "   Underruns: %lu", queue_underrun_count);
 
                 // Reset metrics
                 total_chunks_played = 0;
@@ -919,20 +1026,21 @@ static void queue_playback_task(void *pvParameters)
                 first_chunk_time_ms = 0;
                 queue_underrun_count = 0;
 
-                ESP_LOGI(TAG, "🔊 TX buffer drained - sending playback complete");
+                DLOGI(TAG, "🔊 TX buffer drained - sending playback complete");
                 udp_send_playback_complete();
 
                 // CRITICAL FIX: Stop playback immediately to prevent underrun repeats
                 // The task will exit naturally, and STATE_IDLE from bridge will reset state machine
                 queue_playback_active = false;
-                ESP_LOGI(TAG, "🔊 Playback complete - task exiting");
+                DLOGI(TAG, "🔊 Playback complete - task exiting");
                 break;  // Exit the while loop immediately
             }
         } else {
             // Timeout waiting for chunk - potential underrun
             if (queue_playback_active && total_chunks_played > 0) {
                 queue_underrun_count++;
-                ESP_LOGW(TAG, "⚠️ Queue underrun #%lu - no chunk available for 500ms", queue_underrun_count);
+                audio_stats.underruns++;
+                DLOGW(TAG, "⚠️ Queue underrun #%lu - no chunk available for 500ms", queue_underrun_count);
 
                 // CRITICAL FIX: Write silence to prevent DMA from looping last chunk
                 // This stops the "repeating audio" issue at the end
@@ -967,6 +1075,7 @@ static void queue_playback_task(void *pvParameters)
 
     i2s_channel_disable(tx_handle);
 
+    telemetry_register_task(TELEMETRY_TASK_PLAYBACK, NULL);
     queue_playback_task_handle = NULL;
     vTaskDelete(NULL);
 }
@@ -1032,3 +1141,74 @@ size_t audio_playback_queue_space(void)
     }
     return uxQueueSpacesAvailable(audio_playback_queue);
 }
+
+void audio_get_stats(audio_stats_t *stats)
+{
+    *stats = audio_stats;
+    stats->queue_depth = audio_playback_queue ? uxQueueMessagesWaiting(audio_playback_queue) : 0;
+}
+// ==================== PLAY AND RECORD ====================
+// Used by the loopback self-test (audio_loopback.c): both channels run at once
+// with a known start time, outside the streaming and playback-queue paths.
+
+esp_err_t audio_play_and_record(const int16_t *tx, size_t tx_samples, int16_t *rx, size_t rx_samples,
+                                int64_t *tx_start_us, int64_t *rx_start_us)
+{
+    if (!rx_handle || !tx_handle) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (streaming_active || queue_playback_active) {
+        ESP_LOGW(TAG, "Play/record needs idle capture and playback");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Fill the TX DMA ring before enabling, so tx[0] goes out exactly at enable time
+    const size_t tx_bytes = tx_samples * sizeof(int16_t);
+    const size_t rx_bytes = rx_samples * sizeof(int16_t);
+    size_t tx_done = 0, rx_done = 0;
+    esp_err_t ret = i2s_channel_preload_data(tx_handle, tx, tx_bytes, &tx_done);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "TX preload failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = i2s_channel_enable(rx_handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    *rx_start_us = esp_timer_get_time();
+    ret = i2s_channel_enable(tx_handle);
+    *tx_start_us = esp_timer_get_time();
+    if (ret != ESP_OK) {
+        i2s_channel_disable(rx_handle);
+        return ret;
+    }
+
+    // 40 ms of TX (the rest of the stimulus, then silence so the DMA never
+    // replays it), then 40 ms of RX; the TX write paces the loop
+    static const uint8_t silence[AUDIO_CHUNK_SIZE_OUTPUT] = {0};
+    while (rx_done < rx_bytes) {
+        size_t n = 0;
+        if (tx_done < tx_bytes) {
+            size_t len = tx_bytes - tx_done < AUDIO_CHUNK_SIZE_OUTPUT ? tx_bytes - tx_done : AUDIO_CHUNK_SIZE_OUTPUT;
+            ret = i2s_channel_write(tx_handle, (const uint8_t *)tx + tx_done, len, &n, pdMS_TO_TICKS(1000));
+            tx_done += n;
+        } else {
+            ret = i2s_channel_write(tx_handle, silence, sizeof(silence), &n, pdMS_TO_TICKS(1000));
+        }
+        if (ret != ESP_OK) {
+            break;
+        }
+
+        size_t len = rx_bytes - rx_done < AUDIO_CHUNK_SIZE_CAPTURE ? rx_bytes - rx_done : AUDIO_CHUNK_SIZE_CAPTURE;
+        ret = i2s_channel_read(rx_handle, (uint8_t *)rx + rx_done, len, &n, pdMS_TO_TICKS(1000));
+        if (ret != ESP_OK) {
+            break;
+        }
+        rx_done += n;
+    }
+
+    i2s_channel_disable(tx_handle);
+    i2s_channel_disable(rx_handle);
+    return ret;
+}
@@ -2,7 +2,7 @@
 #define AUDIO_HANDLER_H
 
 #include "esp_err.h"
-#include <stdint.h>git 
+#include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
 
@@ -13,9 +13,22 @@
 #define AUDIO_CHANNELS          1
 #define AUDIO_CHUNK_DURATION_MS 40  // 40ms chunks for real-time (matching bridge server)
 
+// Uplink (mic) rate sent to the bridge, announced in the HELLO: 24000 keeps
+// every 2nd capture sample; 16000 filters and keeps every 3rd
+// (audio_dsp_decimate_3x), a third less uplink traffic, and the bridge
+// resamples to 24 kHz. idf.py -D AUDIO_SAMPLE_RATE_UPLINK=16000 build
+#ifndef AUDIO_SAMPLE_RATE_UPLINK
+#define AUDIO_SAMPLE_RATE_UPLINK   AUDIO_SAMPLE_RATE_OUTPUT
+#endif
+
 // Calculate chunk sizes
 #define AUDIO_CHUNK_SIZE_CAPTURE ((AUDIO_SAMPLE_RATE_CAPTURE * AUDIO_BITS_PER_SAMPLE * AUDIO_CHANNELS * AUDIO_CHUNK_DURATION_MS) / (8 * 1000))
 #define AUDIO_CHUNK_SIZE_OUTPUT  ((AUDIO_SAMPLE_RATE_OUTPUT * AUDIO_BITS_PER_SAMPLE * AUDIO_CHANNELS * AUDIO_CHUNK_DURATION_MS) / (8 * 1000))
+#define AUDIO_CHUNK_SIZE_UPLINK  ((AUDIO_SAMPLE_RATE_UPLINK * AUDIO_BITS_PER_SAMPLE * AUDIO_CHANNELS * AUDIO_CHUNK_DURATION_MS) / (8 * 1000))
+
+#if AUDIO_SAMPLE_RATE_UPLINK != 24000 && AUDIO_SAMPLE_RATE_UPLINK != 16000
+#error "AUDIO_SAMPLE_RATE_UPLINK must be 24000 or 16000"
+#endif
 
 // RMS thresholds for voice detection
 #define AUDIO_RMS_STOP_THRESHOLD    500
@@ -34,6 +47,20 @@ typedef struct {
     bool is_last_chunk;
 } audio_chunk_t;
 
+// Cumulative audio counters for telemetry (never reset)
+typedef struct {
+    uint32_t chunks_captured;
+    uint32_t capture_errors;
+    uint32_t chunks_played;
+    uint32_t playback_sessions;
+    uint32_t underruns;
+    uint32_t i2s_write_errors;
+    uint32_t queue_depth;
+    uint32_t queue_high_water;
+    uint32_t chunks_queued;
+    uint32_t queue_drops;
+} audio_stats_t;
+
 // Basic audio functions
 esp_err_t audio_init(void);
 esp_err_t audio_play_test_tone(void);
@@ -43,7 +70,11 @@ esp_err_t audio_test_abrupt_ending(void);  // Test for "y y y y" bug
 
 // Streaming functions
 esp_err_t audio_start_streaming(void);
+esp_err_t audio_stop_streaming(uint32_t *chunks_sent);
+// One 40 ms chunk at AUDIO_SAMPLE_RATE_UPLINK (AUDIO_CHUNK_SIZE_UPLINK bytes)
 esp_err_t audio_capture_chunk_to_buffer(uint8_t *output_buffer, size_t *bytes_captured);
+// esp_timer time of the first sample of the last captured chunk
+int64_t audio_get_capture_time_us(void);
 uint32_t audio_calculate_rms(int16_t *samples, size_t sample_count);
 
 // Queue-based playback functions
@@ -52,5 +83,15 @@ esp_err_t audio_playback_queue_push(const uint8_t *data, size_t len, uint32_t se
 void audio_playback_queue_start(void);
 void audio_playback_queue_stop(void);
 size_t audio_playback_queue_space(void);
+// Chunks to queue before playback starts (takes effect on the next session)
+void audio_playback_set_prebuffer(int chunks);
+
+// Play tx (24 kHz) and record rx (48 kHz) simultaneously; the start times are
+// when tx[0] left the TX DMA and rx[0] entered the RX DMA (esp_timer clock)
+esp_err_t audio_play_and_record(const int16_t *tx, size_t tx_samples, int16_t *rx, size_t rx_samples,
+                                int64_t *tx_start_us, int64_t *rx_start_us);
+
+// Telemetry
+void audio_get_stats(audio_stats_t *stats);
 
 #endif // AUDIO_HANDLER_H
\ No newline at end of file
@@ -0,0 +1,247 @@
+#include "audio_loopback.h"
+#include "audio_handler.h"
+#include "audio_dsp.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "LOOPBACK";
+
+#define NVS_NAMESPACE "audio_cal"
+#define NVS_KEY       "loopback"
+
+#define RATE          AUDIO_SAMPLE_RATE_OUTPUT     // analysis runs on the 24 kHz uplink signal
+#define LEAD_SAMPLES  (RATE * AUDIO_LOOPBACK_LEAD_MS / 1000)
+#define MAX_LAG       (RATE * AUDIO_LOOPBACK_MAX_LATENCY_MS / 1000)
+#define IR_PRE        32                           // impulse response samples kept before the peak
+#define TX_RING_US    (8 * 512 * 1000000LL / AUDIO_SAMPLE_RATE_OUTPUT)  // TX dma_desc_num * dma_frame_num
+
+const uint16_t audio_loopback_band_hz[AUDIO_LOOPBACK_BANDS] = { 125, 250, 500, 1000, 2000, 4000, 8000 };
+
+// MLS from a 12-bit Fibonacci LFSR, taps 12, 6, 4, 1 (maximal length)
+static void generate_mls(int8_t *mls)
+{
+    uint16_t lfsr = 0x001;
+    for (int i = 0; i < AUDIO_LOOPBACK_MLS_LENGTH; i++) {
+        mls[i] = (lfsr & 1) ? 1 : -1;
+        uint16_t bit = ((lfsr >> 0) ^ (lfsr >> 6) ^ (lfsr >> 8) ^ (lfsr >> 11)) & 1;
+        lfsr = (lfsr >> 1) | (bit << 11);
+    }
+}
+
+// sum(mls[n] * y[n]); the MLS is +-1, so this is adds and subtracts only
+static int32_t correlate(const int8_t *mls, const int16_t *y)
+{
+    int32_t sum = 0;
+    for (int n = 0; n < AUDIO_LOOPBACK_MLS_LENGTH; n++) {
+        sum += mls[n] > 0 ? y[n] : -y[n];
+    }
+    return sum;
+}
+
+static int16_t to_db_x10(double linear)
+{
+    double db = linear > 1e-9 ? 20.0 * log10(linear) : -180.0;
+    return (int16_t)lround(db * 10.0);
+}
+
+// Path gain at each band centre from the impulse response (single-bin DFT)
+static void band_response(const float *ir, size_t ir_len, int16_t *response_db_x10)
+{
+    for (int b = 0; b < AUDIO_LOOPBACK_BANDS; b++) {
+        double w = 2.0 * M_PI * audio_loopback_band_hz[b] / RATE;
+        double re = 0.0, im = 0.0;
+        for (size_t k = 0; k < ir_len; k++) {
+            re += ir[k] * cos(w * k);
+            im -= ir[k] * sin(w * k);
+        }
+        response_db_x10[b] = to_db_x10(sqrt(re * re + im * im));
+    }
+}
+
+static esp_err_t analyse(const int8_t *mls, const int16_t *y, size_t y_len,
+                         int64_t tx_start_us, int64_t rx_start_us, audio_loopback_result_t *result)
+{
+    // Where the stimulus would sit in the capture with zero latency
+    int64_t base = LEAD_SAMPLES + (tx_start_us - rx_start_us) * RATE / 1000000;
+    if (base < 0) {
+        base = 0;
+    }
+    if ((size_t)base + MAX_LAG + AUDIO_LOOPBACK_MLS_LENGTH + AUDIO_LOOPBACK_IR_LENGTH > y_len) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Lag search; 400 ms x 4095 taps, so let the idle task run now and then
+    int32_t best = 0, best_abs = -1;
+    int32_t prev = 0, next = 0;
+    int best_lag = 0;
+    int32_t last = 0;
+    for (int lag = 0; lag < MAX_LAG; lag++) {
+        int32_t c = correlate(mls, y + base + lag);
+        int32_t a = c < 0 ? -c : c;
+        if (a > best_abs) {
+            best_abs = a;
+            best = c;
+            best_lag = lag;
+            prev = last;
+        }
+        if (lag == best_lag + 1) {
+            next = c;
+        }
+        last = c;
+        if ((lag & 1023) == 1023) {
+            vTaskDelay(1);
+        }
+    }
+
+    // Parabolic interpolation of the peak for sub-sample latency
+    double frac = 0.0;
+    if (best_lag > 0 && best_lag + 1 < MAX_LAG) {
+        double ym = fabs((double)prev), y0 = fabs((double)best), yp = fabs((double)next);
+        double denom = ym - 2.0 * y0 + yp;
+        if (denom != 0.0) {
+            frac = 0.5 * (ym - yp) / denom;
+        }
+    }
+
+    // Capture sample (base + lag) was recorded at rx_start + index / RATE;
+    // stimulus sample 0 left the TX DMA at tx_start + LEAD / RATE
+    double arrival_us = rx_start_us + (base + best_lag + frac) * 1e6 / RATE;
+    double departure_us = tx_start_us + LEAD_SAMPLES * 1e6 / RATE;
+    result->latency_us = (int32_t)lround(arrival_us - departure_us);
+    result->pipeline_latency_us = result->latency_us + (int32_t)TX_RING_US;
+    result->polarity = best < 0 ? -1 : 1;
+
+    // Normalised peak: 1.0 for a clean, delayed, scaled copy of the stimulus
+    const int16_t *aligned = y + base + best_lag;
+    double energy = 0.0;
+    for (int n = 0; n < AUDIO_LOOPBACK_MLS_LENGTH; n++) {
+        energy += (double)aligned[n] * aligned[n];
+    }
+    double confidence = energy > 0 ? best_abs / sqrt((double)AUDIO_LOOPBACK_MLS_LENGTH * energy) : 0.0;
+    result->confidence_pct = (uint16_t)lround(confidence * 100.0);
+
+    // Impulse response around the peak, scaled so a unity path is 1.0
+    float *ir = malloc(AUDIO_LOOPBACK_IR_LENGTH * sizeof(float));
+    if (!ir) {
+        return ESP_ERR_NO_MEM;
+    }
+    int start = best_lag - IR_PRE;
+    double ir_energy = 0.0;
+    for (int k = 0; k < AUDIO_LOOPBACK_IR_LENGTH; k++) {
+        int64_t pos = base + start + k;
+        int32_t c = pos >= 0 ? correlate(mls, y + pos) : 0;
+        ir[k] = (float)c / ((float)AUDIO_LOOPBACK_MLS_LENGTH * AUDIO_LOOPBACK_LEVEL);
+        ir_energy += (double)ir[k] * ir[k];
+    }
+    result->coupling_gain_db_x10 = to_db_x10(sqrt(ir_energy));
+    band_response(ir, AUDIO_LOOPBACK_IR_LENGTH, result->response_db_x10);
+    free(ir);
+
+    result->valid = result->confidence_pct >= AUDIO_LOOPBACK_MIN_CONFIDENCE_PCT;
+    return result->valid ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+static esp_err_t save(const audio_loopback_result_t *result)
+{
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = nvs_set_blob(nvs, NVS_KEY, result, sizeof(*result));
+    if (ret == ESP_OK) {
+        ret = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    return ret;
+}
+
+esp_err_t audio_loopback_load(audio_loopback_result_t *result)
+{
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    size_t size = sizeof(*result);
+    ret = nvs_get_blob(nvs, NVS_KEY, result, &size);
+    nvs_close(nvs);
+    if (ret == ESP_OK && (size != sizeof(*result) || result->version != AUDIO_LOOPBACK_VERSION)) {
+        ret = ESP_ERR_NVS_NOT_FOUND;
+    }
+    return ret;
+}
+
+esp_err_t audio_loopback_run(audio_loopback_result_t *result)
+{
+    memset(result, 0, sizeof(*result));
+    result->version = AUDIO_LOOPBACK_VERSION;
+
+    // Stimulus at 24 kHz; the capture covers lead + stimulus + latency search + IR tail at 48 kHz
+    const size_t tx_samples = LEAD_SAMPLES + AUDIO_LOOPBACK_MLS_LENGTH;
+    const size_t y_len = tx_samples + MAX_LAG + AUDIO_LOOPBACK_IR_LENGTH + RATE / 10;
+    const size_t rx_samples = y_len * 2;
+
+    int8_t *mls = malloc(AUDIO_LOOPBACK_MLS_LENGTH);
+    int16_t *tx = heap_caps_malloc(tx_samples * sizeof(int16_t), MALLOC_CAP_SPIRAM);
+    int16_t *rx = heap_caps_malloc(rx_samples * sizeof(int16_t), MALLOC_CAP_SPIRAM);
+    if (!mls || !tx || !rx) {
+        ESP_LOGE(TAG, "Failed to allocate loopback buffers");
+        free(mls);
+        heap_caps_free(tx);
+        heap_caps_free(rx);
+        return ESP_ERR_NO_MEM;
+    }
+
+    generate_mls(mls);
+    memset(tx, 0, LEAD_SAMPLES * sizeof(int16_t));
+    for (int i = 0; i < AUDIO_LOOPBACK_MLS_LENGTH; i++) {
+        tx[LEAD_SAMPLES + i] = mls[i] * AUDIO_LOOPBACK_LEVEL;
+    }
+
+    ESP_LOGI(TAG, "🔁 Loopback test: %d-sample MLS at %d, searching %d ms",
+             AUDIO_LOOPBACK_MLS_LENGTH, AUDIO_LOOPBACK_LEVEL, AUDIO_LOOPBACK_MAX_LATENCY_MS);
+
+    int64_t tx_start_us = 0, rx_start_us = 0;
+    esp_err_t ret = audio_play_and_record(tx, tx_samples, rx, rx_samples, &tx_start_us, &rx_start_us);
+    if (ret == ESP_OK) {
+        // Same 48 -> 24 kHz path the uplink uses, in place
+        size_t n = audio_dsp_decimate_2x(rx, rx_samples, rx);
+        ret = analyse(mls, rx, n, tx_start_us, rx_start_us, result);
+    } else {
+        ESP_LOGE(TAG, "Play/record failed: %s", esp_err_to_name(ret));
+    }
+
+    free(mls);
+    heap_caps_free(tx);
+    heap_caps_free(rx);
+
+    audio_loopback_log(result);
+    if (ret == ESP_OK) {
+        esp_err_t save_ret = save(result);
+        if (save_ret != ESP_OK) {
+            ESP_LOGW(TAG, "Could not store loopback result: %s", esp_err_to_name(save_ret));
+        }
+    } else if (ret == ESP_ERR_NOT_FOUND) {
+        ESP_LOGW(TAG, "⚠️ Stimulus not detected (confidence %u%%) - speaker muted or mic blocked?",
+                 result->confidence_pct);
+    }
+    return ret;
+}
+
+void audio_loopback_log(const audio_loopback_result_t *r)
+{
+    ESP_LOGI(TAG, "🔁 Loopback: latency %.2f ms (pipeline %.2f ms), coupling %.1f dB, confidence %u%%%s%s",
+             r->latency_us / 1000.0f, r->pipeline_latency_us / 1000.0f, r->coupling_gain_db_x10 / 10.0f,
+             r->confidence_pct, r->polarity < 0 ? ", inverted" : "", r->valid ? "" : " (invalid)");
+    ESP_LOGI(TAG, "   Response: %d/%d/%d/%d/%d/%d/%d dB at 125/250/500/1k/2k/4k/8k Hz",
+             r->response_db_x10[0] / 10, r->response_db_x10[1] / 10, r->response_db_x10[2] / 10,
+             r->response_db_x10[3] / 10, r->response_db_x10[4] / 10, r->response_db_x10[5] / 10,
+             r->response_db_x10[6] / 10);
+}
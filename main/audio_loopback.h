@@ -0,0 +1,52 @@
+#ifndef AUDIO_LOOPBACK_H
+#define AUDIO_LOOPBACK_H
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Acoustic loopback self-test.
+// Plays a maximum length sequence (MLS) through the speaker while recording the
+// INMP441, then cross-correlates the two (in the 24 kHz uplink domain) to find:
+//   - latency: from the stimulus leaving the TX DMA to it arriving in the RX DMA
+//   - coupling gain: speaker-to-mic level at unity digital gain
+//   - frequency response of that path in octave bands
+// The result is kept in NVS so echo handling and interrupt thresholds can use
+// it without re-running the test (the test is audible: ~0.2 s of noise).
+
+#define AUDIO_LOOPBACK_MLS_ORDER        12
+#define AUDIO_LOOPBACK_MLS_LENGTH       ((1 << AUDIO_LOOPBACK_MLS_ORDER) - 1)   // 4095 samples, 171 ms
+#define AUDIO_LOOPBACK_LEVEL            4000    // stimulus amplitude, about -18 dBFS
+#define AUDIO_LOOPBACK_LEAD_MS          100     // silence before the stimulus
+#define AUDIO_LOOPBACK_MAX_LATENCY_MS   400     // correlation search range
+#define AUDIO_LOOPBACK_IR_LENGTH        512     // impulse response window, 21 ms
+#define AUDIO_LOOPBACK_MIN_CONFIDENCE_PCT 10    // normalised correlation peak to accept
+
+#define AUDIO_LOOPBACK_BANDS            7       // octave bands, 125 Hz .. 8 kHz
+#define AUDIO_LOOPBACK_VERSION          1
+
+typedef struct {
+    uint32_t version;                   // AUDIO_LOOPBACK_VERSION
+    int32_t latency_us;                 // TX DMA -> RX DMA
+    int32_t pipeline_latency_us;        // i2s_channel_write() -> RX DMA (adds the full TX DMA ring)
+    int16_t coupling_gain_db_x10;       // mic level over played level, 0.1 dB
+    int16_t response_db_x10[AUDIO_LOOPBACK_BANDS];  // path gain per band, 0.1 dB
+    uint16_t confidence_pct;            // normalised correlation peak
+    int8_t polarity;                    // -1 if the speaker or mic is wired inverted
+    uint8_t valid;                      // confidence reached AUDIO_LOOPBACK_MIN_CONFIDENCE_PCT
+} audio_loopback_result_t;
+
+// Band centre frequencies for response_db_x10
+extern const uint16_t audio_loopback_band_hz[AUDIO_LOOPBACK_BANDS];
+
+// Run the test (needs audio_init(); capture and playback must be idle) and
+// store a valid result in NVS. ESP_ERR_NOT_FOUND if no stimulus was detected.
+esp_err_t audio_loopback_run(audio_loopback_result_t *result);
+
+// Last stored result; ESP_ERR_NVS_NOT_FOUND if the test never ran
+esp_err_t audio_loopback_load(audio_loopback_result_t *result);
+
+void audio_loopback_log(const audio_loopback_result_t *result);
+
+#endif // AUDIO_LOOPBACK_H
@@ -0,0 +1,110 @@
+#include "clock_sync.h"
+#include "udp_client.h"
+#include "dlog.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <string.h>
+
+static const char *TAG = "CLOCK_SYNC";
+
+typedef struct {
+    int64_t offset_us;
+    uint32_t delay_us;
+} sync_sample_t;
+
+static sync_sample_t samples[CLOCK_SYNC_SAMPLES];
+static uint32_t sample_count = 0;
+static int64_t best_offset_us = 0;
+static uint32_t best_delay_us = 0;
+static volatile bool synced = false;
+static portMUX_TYPE sync_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t sync_task_handle = NULL;
+
+void clock_sync_on_response(const uint8_t *packet, size_t len, int64_t rx_time_us)
+{
+    if (len < CLOCK_SYNC_RESPONSE_SIZE) {
+        return;
+    }
+    int64_t t1, t2, t3;
+    memcpy(&t1, packet + 1, sizeof(t1));
+    memcpy(&t2, packet + 9, sizeof(t2));
+    memcpy(&t3, packet + 17, sizeof(t3));
+
+    int64_t delay = (rx_time_us - t1) - (t3 - t2);
+    if (t1 <= 0 || t1 > rx_time_us || delay < 0 || delay > CLOCK_SYNC_MAX_DELAY_US) {
+        return;
+    }
+
+    sync_sample_t sample = {
+        .offset_us = ((t2 - t1) + (t3 - rx_time_us)) / 2,
+        .delay_us = (uint32_t)delay,
+    };
+
+    portENTER_CRITICAL(&sync_lock);
+    samples[sample_count % CLOCK_SYNC_SAMPLES] = sample;
+    sample_count++;
+    uint32_t n = sample_count < CLOCK_SYNC_SAMPLES ? sample_count : CLOCK_SYNC_SAMPLES;
+    const sync_sample_t *best = &samples[0];
+    for (uint32_t i = 1; i < n; i++) {
+        if (samples[i].delay_us < best->delay_us) {
+            best = &samples[i];
+        }
+    }
+    best_offset_us = best->offset_us;
+    best_delay_us = best->delay_us;
+    portEXIT_CRITICAL(&sync_lock);
+
+    if (!synced) {
+        synced = true;
+        DLOGI(TAG, "🕒 Clock synced to bridge (delay %lu us)", (unsigned long)sample.delay_us);
+    }
+}
+
+static void clock_sync_task(void *pvParameters)
+{
+    while (1) {
+        udp_send_time_request();
+        vTaskDelay(pdMS_TO_TICKS(sample_count < CLOCK_SYNC_SAMPLES ? CLOCK_SYNC_BURST_MS
+                                                                   : CLOCK_SYNC_INTERVAL_MS));
+    }
+}
+
+esp_err_t clock_sync_init(void)
+{
+    if (sync_task_handle) {
+        return ESP_OK;
+    }
+
+    if (xTaskCreate(clock_sync_task, "clock_sync", 2048, NULL, 3, &sync_task_handle) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create clock sync task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "✅ Clock sync started (every %d ms)", CLOCK_SYNC_INTERVAL_MS);
+    return ESP_OK;
+}
+
+bool clock_sync_is_valid(void)
+{
+    return synced;
+}
+
+int64_t clock_sync_to_bridge_us(int64_t device_us)
+{
+    if (!synced) {
+        return 0;
+    }
+    portENTER_CRITICAL(&sync_lock);
+    int64_t bridge_us = device_us + best_offset_us;
+    portEXIT_CRITICAL(&sync_lock);
+    return bridge_us;
+}
+
+void clock_sync_get(int64_t *offset_us, uint32_t *delay_us)
+{
+    portENTER_CRITICAL(&sync_lock);
+    *offset_us = best_offset_us;
+    *delay_us = best_delay_us;
+    portEXIT_CRITICAL(&sync_lock);
+}
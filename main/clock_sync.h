@@ -0,0 +1,42 @@
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// NTP-style clock sync with the bridge, so device timestamps can be put on
+// the bridge's timeline for end-to-end latency measurement.
+// The device sends UDP_MSG_TIME_REQUEST [type][u64 t1]; the bridge answers
+// UDP_MSG_TIME_RESPONSE [type][u64 t1][u64 t2 bridge receive][u64 t3 bridge send].
+// With t4 the device receive time:
+//   offset = ((t2 - t1) + (t3 - t4)) / 2      bridge clock - device clock
+//   delay  = (t4 - t1) - (t3 - t2)            round trip on the wire
+// Of the last CLOCK_SYNC_SAMPLES exchanges the one with the smallest delay
+// wins (its offset has the smallest error bound, delay / 2).
+
+#define CLOCK_SYNC_SAMPLES          8
+#define CLOCK_SYNC_BURST_MS         100     // request spacing until the filter is full
+#define CLOCK_SYNC_INTERVAL_MS      5000    // then one request per interval (crystal drift)
+#define CLOCK_SYNC_MAX_DELAY_US     50000   // discard exchanges slower than this
+
+#define CLOCK_SYNC_REQUEST_SIZE     9
+#define CLOCK_SYNC_RESPONSE_SIZE    25
+
+// Starts the request task; needs udp_client_init()
+esp_err_t clock_sync_init(void);
+
+// Called by the UDP receive task for every UDP_MSG_TIME_RESPONSE
+void clock_sync_on_response(const uint8_t *packet, size_t len, int64_t rx_time_us);
+
+// True once the bridge has answered at least once
+bool clock_sync_is_valid(void);
+
+// Device esp_timer time to bridge time; 0 while unsynced
+int64_t clock_sync_to_bridge_us(int64_t device_us);
+
+// Current offset (bridge - device) and the delay of the exchange it came from
+void clock_sync_get(int64_t *offset_us, uint32_t *delay_us);
+
+#endif // CLOCK_SYNC_H
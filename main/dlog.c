@@ -0,0 +1,195 @@
+#include "dlog.h"
+#include "telemetry.h"
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <string.h>
+#include <stdio.h>
+
+static const char *TAG = "DLOG";
+
+// Bounded multi-producer ring: a slot is free for position p when its seq == p
+// and holds data for the consumer when seq == p + 1. seq is stored relative to
+// the slot index so the zero-initialized ring is valid before dlog_init().
+typedef struct {
+    uint32_t seq;
+    uint32_t timestamp_ms;
+    const char *tag;
+    const char *fmt;
+    uint8_t level;
+    uint8_t nargs;
+    uint32_t args[DLOG_MAX_ARGS];
+} dlog_entry_t;
+
+static DRAM_ATTR dlog_entry_t dlog_ring[DLOG_RING_ENTRIES];
+static uint32_t dlog_head = 0;      // next position to reserve (producers)
+static uint32_t dlog_tail = 0;      // next position to read (formatter task)
+static uint32_t dlog_dropped = 0;
+static TaskHandle_t dlog_task_handle = NULL;
+
+#define DLOG_FORMAT_BUFFER_SIZE 256
+#define DLOG_DRAIN_INTERVAL_MS  50
+
+#define DLOG_SLOT(pos) ((pos) & (DLOG_RING_ENTRIES - 1))
+
+static inline uint32_t dlog_load_seq(uint32_t pos)
+{
+    return __atomic_load_n(&dlog_ring[DLOG_SLOT(pos)].seq, __ATOMIC_ACQUIRE) + DLOG_SLOT(pos);
+}
+
+static inline void dlog_store_seq(uint32_t pos, uint32_t seq)
+{
+    __atomic_store_n(&dlog_ring[DLOG_SLOT(pos)].seq, seq - DLOG_SLOT(pos), __ATOMIC_RELEASE);
+}
+
+void IRAM_ATTR dlog_record(esp_log_level_t level, const char *tag, const char *fmt,
+                           size_t nargs, const uint32_t *args)
+{
+    uint32_t pos = __atomic_load_n(&dlog_head, __ATOMIC_RELAXED);
+    dlog_entry_t *entry;
+
+    for (;;) {
+        entry = &dlog_ring[DLOG_SLOT(pos)];
+        uint32_t seq = dlog_load_seq(pos);
+        int32_t diff = (int32_t)(seq - pos);
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&dlog_head, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+            // pos was reloaded by the failed CAS
+        } else if (diff < 0) {
+            // Ring full - never block a real-time task
+            __atomic_fetch_add(&dlog_dropped, 1, __ATOMIC_RELAXED);
+            return;
+        } else {
+            pos = __atomic_load_n(&dlog_head, __ATOMIC_RELAXED);
+        }
+    }
+
+    if (nargs > DLOG_MAX_ARGS) {
+        nargs = DLOG_MAX_ARGS;
+    }
+
+    entry->timestamp_ms = (uint32_t)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+    entry->tag = tag;
+    entry->fmt = fmt;
+    entry->level = level;
+    entry->nargs = nargs;
+    for (size_t i = 0; i < nargs; i++) {
+        entry->args[i] = args[i];
+    }
+
+    dlog_store_seq(pos, pos + 1);
+}
+
+// Format and print every committed entry; returns how many were printed
+static int dlog_drain(void)
+{
+    static char text[DLOG_FORMAT_BUFFER_SIZE];
+    static const char level_letters[] = { 'N', 'E', 'W', 'I', 'D', 'V' };
+    int printed = 0;
+
+    for (;;) {
+        dlog_entry_t *entry = &dlog_ring[DLOG_SLOT(dlog_tail)];
+        if (dlog_load_seq(dlog_tail) != dlog_tail + 1) {
+            break;
+        }
+
+        unsigned long a[DLOG_MAX_ARGS] = { 0 };
+        for (int i = 0; i < entry->nargs; i++) {
+            a[i] = entry->args[i];
+        }
+
+        // Unused arguments are passed as zero and ignored by snprintf
+        snprintf(text, sizeof(text), entry->fmt, a[0], a[1], a[2], a[3]);
+        char letter = entry->level < sizeof(level_letters) ? level_letters[entry->level] : '?';
+        esp_log_write(entry->level, entry->tag, "%c (%lu) %s: %s\n",
+                      letter, (unsigned long)entry->timestamp_ms, entry->tag, text);
+
+        dlog_store_seq(dlog_tail, dlog_tail + DLOG_RING_ENTRIES);
+        dlog_tail++;
+        printed++;
+    }
+
+    return printed;
+}
+
+static void dlog_task(void *pvParameters)
+{
+    uint32_t reported_dropped = 0;
+
+    while (1) {
+        dlog_drain();
+
+        uint32_t dropped = __atomic_load_n(&dlog_dropped, __ATOMIC_RELAXED);
+        if (dropped != reported_dropped) {
+            ESP_LOGW(TAG, "⚠️ %lu deferred log entries dropped (ring full)",
+                     (unsigned long)(dropped - reported_dropped));
+            reported_dropped = dropped;
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(DLOG_DRAIN_INTERVAL_MS));
+    }
+}
+
+esp_err_t dlog_init(void)
+{
+    if (dlog_task_handle) {
+        return ESP_OK;
+    }
+
+    // Lowest priority above idle: formatting only happens when the audio tasks are blocked
+    if (xTaskCreate(dlog_task, "dlog", 3072, NULL, 1, &dlog_task_handle) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create deferred log task");
+        return ESP_ERR_NO_MEM;
+    }
+    telemetry_register_task(TELEMETRY_TASK_DLOG, dlog_task_handle);
+
+    ESP_LOGI(TAG, "Deferred logging ready (%d entries, level %d)", DLOG_RING_ENTRIES, DLOG_LEVEL);
+    return ESP_OK;
+}
+
+uint32_t dlog_get_dropped(void)
+{
+    return __atomic_load_n(&dlog_dropped, __ATOMIC_RELAXED);
+}
+
+void dlog_measure_call_cost(void)
+{
+    const int iterations = 100;     // fits in the ring without draining
+    uint32_t esp_log_worst = 0, dlog_worst = 0;
+    uint64_t esp_log_total = 0, dlog_total = 0;
+
+    // Same shape as the old playback timing line: integers plus a float
+    for (int i = 0; i < iterations; i++) {
+        uint32_t start = esp_cpu_get_cycle_count();
+        ESP_LOGW(TAG, "bench chunk=#%d interval=%dms queue_depth=%d (%.1f%% full)",
+                 i, 40, 10, (10 * 100.0f) / 3500);
+        uint32_t cycles = esp_cpu_get_cycle_count() - start;
+        esp_log_total += cycles;
+        if (cycles > esp_log_worst) esp_log_worst = cycles;
+    }
+
+    for (int i = 0; i < iterations; i++) {
+        uint32_t start = esp_cpu_get_cycle_count();
+        DLOGW(TAG, "bench chunk=#%d interval=%dms queue_depth=%d (%d%% full)",
+              i, 40, 10, (10 * 100) / 3500);
+        uint32_t cycles = esp_cpu_get_cycle_count() - start;
+        dlog_total += cycles;
+        if (cycles > dlog_worst) dlog_worst = cycles;
+    }
+
+    // The ring holds all iterations; print them here unless the formatter task owns the ring
+    if (!dlog_task_handle) {
+        dlog_drain();
+    }
+
+    ESP_LOGI(TAG, "📊 Log call cost over %d calls (cycles):", iterations);
+    ESP_LOGI(TAG, "   ESP_LOGW: worst=%lu mean=%lu", (unsigned long)esp_log_worst,
+             (unsigned long)(esp_log_total / iterations));
+    ESP_LOGI(TAG, "   DLOGW:    worst=%lu mean=%lu", (unsigned long)dlog_worst,
+             (unsigned long)(dlog_total / iterations));
+}
@@ -0,0 +1,72 @@
+#ifndef DLOG_H
+#define DLOG_H
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Deferred logging for the real-time tasks.
+// A DLOGx() call stores the format string pointer (which doubles as the format
+// id), a timestamp and up to DLOG_MAX_ARGS raw 32-bit arguments in a lock-free
+// ring. A low-priority task formats and prints the entries later, so the
+// printf/UART cost never lands on the capture, playback or UDP receive loops.
+//
+// Restrictions: arguments must be 32-bit integers (%d, %u, %lu, %ld, %lx, %c).
+// No %f, %lld or %s - convert to integers at the call site instead.
+
+// Calls above this level are stripped at compile time (esp_log_level_t values)
+#ifndef DLOG_LEVEL
+#define DLOG_LEVEL CONFIG_LOG_DEFAULT_LEVEL
+#endif
+
+#define DLOG_MAX_ARGS 4
+#define DLOG_RING_ENTRIES 256   // must be a power of two
+
+#define DLOG_ARGS_(...) ((const uint32_t[]){ 0, ##__VA_ARGS__ })
+#define DLOG_NARGS_(...) (sizeof(DLOG_ARGS_(__VA_ARGS__)) / sizeof(uint32_t) - 1)
+#define DLOG_WRITE_(level, tag, fmt, ...) \
+    dlog_record((level), (tag), (fmt), DLOG_NARGS_(__VA_ARGS__), DLOG_ARGS_(__VA_ARGS__) + 1)
+#define DLOG_NOP_(...) do { } while (0)
+
+#if DLOG_LEVEL >= 1
+#define DLOGE(tag, fmt, ...) DLOG_WRITE_(ESP_LOG_ERROR, tag, fmt, ##__VA_ARGS__)
+#else
+#define DLOGE(tag, fmt, ...) DLOG_NOP_()
+#endif
+
+#if DLOG_LEVEL >= 2
+#define DLOGW(tag, fmt, ...) DLOG_WRITE_(ESP_LOG_WARN, tag, fmt, ##__VA_ARGS__)
+#else
+#define DLOGW(tag, fmt, ...) DLOG_NOP_()
+#endif
+
+#if DLOG_LEVEL >= 3
+#define DLOGI(tag, fmt, ...) DLOG_WRITE_(ESP_LOG_INFO, tag, fmt, ##__VA_ARGS__)
+#else
+#define DLOGI(tag, fmt, ...) DLOG_NOP_()
+#endif
+
+#if DLOG_LEVEL >= 4
+#define DLOGD(tag, fmt, ...) DLOG_WRITE_(ESP_LOG_DEBUG, tag, fmt, ##__VA_ARGS__)
+#else
+#define DLOGD(tag, fmt, ...) DLOG_NOP_()
+#endif
+
+// Start the formatter task (entries recorded before this are kept)
+esp_err_t dlog_init(void);
+
+// Record one entry; prefer the DLOGx() macros
+void dlog_record(esp_log_level_t level, const char *tag, const char *fmt,
+                 size_t nargs, const uint32_t *args);
+
+// Entries lost because the ring was full
+uint32_t dlog_get_dropped(void);
+
+// Compare worst-case cycles of ESP_LOGW against DLOGW for a typical hot-path
+// message and log the result
+void dlog_measure_call_cost(void);
+
+#endif // DLOG_H
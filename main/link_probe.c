@@ -0,0 +1,405 @@
+#include "link_probe.h"
+#include "udp_client.h"
+#include "audio_handler.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "LINK_PROBE";
+
+#define NVS_NAMESPACE "link"
+#define NVS_KEY       "profile"
+
+#define PHASE_GAP_MS        300     // let queues drain between phases
+#define CHUNK_BYTES_MAX     1440    // downlink frame size the bridge uses by default
+#define CHUNK_BYTES_LOSSY   960     // 20 ms frames when the link drops packets
+#define LOSSY_LINK_PCT_X100 100     // 1% round-trip loss
+
+// Phase 0 measures RTT with small probes; the rest ramp the rate with
+// audio-sized probes (UDP_AUDIO_HEADER_SIZE + 1440 bytes, like a real chunk)
+typedef struct {
+    uint16_t size;
+    uint16_t pps;
+    uint16_t count;
+} probe_phase_t;
+
+static const probe_phase_t phases[] = {
+    {   64,  50, 50 },
+    { 1445,  25, 25 },      // ~290 kbps
+    { 1445,  50, 50 },      // ~580 kbps, a little over one uplink stream
+    { 1445, 100, 60 },      // ~1.2 Mbit/s
+    { 1445, 200, 70 },      // ~2.3 Mbit/s
+};
+#define NUM_PHASES (sizeof(phases) / sizeof(phases[0]))
+
+typedef struct {
+    int64_t send_us;
+    int64_t rx_us;              // device time the echo arrived
+    uint64_t bridge_us;         // bridge clock at the bridge's receive
+    uint32_t bridge_count;      // probes of this run the bridge had seen
+    uint8_t phase;
+    uint8_t echoes;
+} probe_record_t;
+
+static probe_record_t *records = NULL;
+static volatile uint32_t probes_sent = 0;
+static volatile uint32_t current_run = 0;
+static uint32_t highest_echo_seq = 0;
+static uint16_t reordered = 0;
+static uint16_t duplicated = 0;
+static volatile bool running = false;
+static portMUX_TYPE records_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Profile in use, re-reported to the bridge with every HELLO
+static link_profile_t applied_profile;
+static bool profile_applied = false;
+
+static uint8_t packet[UDP_MAX_PAYLOAD];
+
+static void put_u32(uint8_t *p, uint32_t v) { memcpy(p, &v, sizeof(v)); }
+static void put_u64(uint8_t *p, uint64_t v) { memcpy(p, &v, sizeof(v)); }
+static uint32_t get_u32(const uint8_t *p) { uint32_t v; memcpy(&v, p, sizeof(v)); return v; }
+static uint64_t get_u64(const uint8_t *p) { uint64_t v; memcpy(&v, p, sizeof(v)); return v; }
+
+void link_probe_on_echo(const uint8_t *pkt, size_t len, int64_t rx_time_us)
+{
+    if (len < LINK_PROBE_HEADER_SIZE) {
+        return;
+    }
+    uint32_t run = get_u32(pkt + 1);
+    uint32_t seq = get_u32(pkt + 5);
+
+    portENTER_CRITICAL(&records_lock);
+    if (records && run == current_run && seq < probes_sent) {
+        probe_record_t *r = &records[seq];
+        if (r->echoes++ > 0) {
+            duplicated++;
+        } else {
+            r->rx_us = rx_time_us;
+            r->bridge_us = get_u64(pkt + 17);
+            r->bridge_count = get_u32(pkt + 25);
+            if (seq < highest_echo_seq) {
+                reordered++;
+            } else {
+                highest_echo_seq = seq;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&records_lock);
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// RTT statistics of one phase; false if nothing came back
+static bool phase_rtt(uint8_t phase, uint32_t *rtt, uint32_t *min_us, uint32_t *avg_us,
+                      uint32_t *p95_us, uint32_t *sent, uint32_t *echoed)
+{
+    uint32_t n = 0, total = 0;
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < probes_sent; i++) {
+        if (records[i].phase != phase) {
+            continue;
+        }
+        total++;
+        if (records[i].echoes) {
+            rtt[n] = (uint32_t)(records[i].rx_us - records[i].send_us);
+            sum += rtt[n++];
+        }
+    }
+    *sent = total;
+    *echoed = n;
+    if (n == 0) {
+        return false;
+    }
+    qsort(rtt, n, sizeof(uint32_t), compare_u32);
+    *min_us = rtt[0];
+    *avg_us = (uint32_t)(sum / n);
+    *p95_us = rtt[(n * 95) / 100 < n ? (n * 95) / 100 : n - 1];
+    return true;
+}
+
+static void analyse(link_profile_t *p)
+{
+    memset(p, 0, sizeof(*p));
+    p->version = LINK_PROBE_VERSION;
+    p->probes_sent = probes_sent;
+    p->reordered = reordered;
+    p->duplicated = duplicated;
+
+    uint32_t *rtt = malloc(LINK_PROBE_MAX_PROBES * sizeof(uint32_t));
+    if (!rtt) {
+        return;
+    }
+
+    uint32_t sent, echoed;
+    phase_rtt(0, rtt, &p->rtt_min_us, &p->rtt_avg_us, &p->rtt_p95_us, &sent, &echoed);
+    double base_loss = sent ? (double)(sent - echoed) / sent : 0.0;
+    double loss_floor = base_loss > 0.01 ? base_loss : 0.01;
+
+    // Ramp: the highest rate whose extra loss (over the low-rate phase) and
+    // queueing stay within limits
+    for (uint8_t ph = 1; ph < NUM_PHASES; ph++) {
+        uint32_t min_us, avg_us, p95_us;
+        if (!phase_rtt(ph, rtt, &min_us, &avg_us, &p95_us, &sent, &echoed)) {
+            break;
+        }
+        // The steps are short, so allow two standard deviations of the
+        // baseline loss on top of the margin or random loss fails them.
+        // Queueing shows as RTT spread beyond the low-rate phase's; the
+        // serialisation delay of the bigger probes moves min and p95 alike
+        double loss = (double)(sent - echoed) / sent;
+        double slack = 2.0 * sqrt(loss_floor * (1.0 - loss_floor) / sent);
+        if (loss > base_loss + LINK_PROBE_MAX_STEP_LOSS_PCT / 100.0 + slack ||
+            p95_us - min_us > p->rtt_p95_us - p->rtt_min_us + LINK_PROBE_MAX_RTT_GROWTH_US) {
+            break;
+        }
+        p->sustainable_kbps = (uint32_t)phases[ph].size * phases[ph].pps * 8 / 1000;
+    }
+    free(rtt);
+
+    // Loss per direction, loss bursts and RFC 3550 interarrival jitter; a
+    // probe's transit is measured against its predecessor in the same phase,
+    // so the unknown offset between the two clocks cancels
+    uint32_t bridge_seen = 0, unique_echoes = 0, burst = 0;
+    double jitter_up = 0.0, jitter_down = 0.0;
+    const probe_record_t *prev = NULL;
+    for (uint32_t i = 0; i < probes_sent; i++) {
+        const probe_record_t *r = &records[i];
+        if (!r->echoes) {
+            if (++burst > p->max_loss_burst) {
+                p->max_loss_burst = burst;
+            }
+            continue;
+        }
+        burst = 0;
+        unique_echoes++;
+        if (r->bridge_count > bridge_seen) {
+            bridge_seen = r->bridge_count;
+        }
+        if (prev && prev->phase == r->phase) {
+            int64_t d_up = (int64_t)(r->bridge_us - prev->bridge_us) - (r->send_us - prev->send_us);
+            int64_t d_down = (r->rx_us - prev->rx_us) - (int64_t)(r->bridge_us - prev->bridge_us);
+            jitter_up += (fabs((double)d_up) - jitter_up) / 16.0;
+            jitter_down += (fabs((double)d_down) - jitter_down) / 16.0;
+        }
+        prev = r;
+    }
+    p->jitter_up_us = (uint32_t)jitter_up;
+    p->jitter_down_us = (uint32_t)jitter_down;
+    if (bridge_seen > probes_sent) {
+        bridge_seen = probes_sent;  // bridge also counted duplicates
+    }
+    if (probes_sent > 0) {
+        p->loss_up_pct_x100 = (uint16_t)((probes_sent - bridge_seen) * 10000 / probes_sent);
+    }
+    if (bridge_seen > 0 && unique_echoes < bridge_seen) {
+        p->loss_down_pct_x100 = (uint16_t)((bridge_seen - unique_echoes) * 10000 / bridge_seen);
+    }
+
+    // Recommendations: drop to 20 ms frames on a lossy link so a lost
+    // datagram costs less audio, and pre-buffer enough to ride out downlink
+    // jitter, queueing delay and the longest loss burst
+    uint32_t round_trip_loss = probes_sent ? (probes_sent - unique_echoes) * 10000 / probes_sent : 0;
+    p->frame_bytes = round_trip_loss > LOSSY_LINK_PCT_X100 ? CHUNK_BYTES_LOSSY : CHUNK_BYTES_MAX;
+    uint32_t frame_us = p->frame_bytes * 1000000u / (AUDIO_SAMPLE_RATE_OUTPUT * 2);
+    uint32_t prebuffer_us = 4 * p->jitter_down_us + (p->rtt_p95_us - p->rtt_min_us) / 2 +
+                            p->max_loss_burst * frame_us;
+    uint32_t chunks = (prebuffer_us + frame_us - 1) / frame_us;
+    if (chunks < LINK_PROBE_MIN_PREBUFFER) {
+        chunks = LINK_PROBE_MIN_PREBUFFER;
+    } else if (chunks > LINK_PROBE_MAX_PREBUFFER) {
+        chunks = LINK_PROBE_MAX_PREBUFFER;
+    }
+    p->prebuffer_chunks = chunks;
+}
+
+static esp_err_t save(const link_profile_t *profile)
+{
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = nvs_set_blob(nvs, NVS_KEY, profile, sizeof(*profile));
+    if (ret == ESP_OK) {
+        ret = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    return ret;
+}
+
+esp_err_t link_probe_load(link_profile_t *profile)
+{
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    size_t size = sizeof(*profile);
+    ret = nvs_get_blob(nvs, NVS_KEY, profile, &size);
+    nvs_close(nvs);
+    if (ret == ESP_OK && (size != sizeof(*profile) || profile->version != LINK_PROBE_VERSION)) {
+        ret = ESP_ERR_NVS_NOT_FOUND;
+    }
+    return ret;
+}
+
+static void send_probe(uint32_t seq, uint8_t phase, uint16_t size)
+{
+    memset(packet, 0, size);
+    packet[0] = UDP_MSG_PROBE;
+    put_u32(packet + 1, current_run);
+    put_u32(packet + 5, seq);
+    packet[29] = phase;
+
+    portENTER_CRITICAL(&records_lock);
+    records[seq].phase = phase;
+    records[seq].send_us = esp_timer_get_time();
+    probes_sent = seq + 1;
+    portEXIT_CRITICAL(&records_lock);
+
+    put_u64(packet + 9, (uint64_t)records[seq].send_us);
+    udp_send_probe(packet, size);
+}
+
+static esp_err_t send_report(const link_profile_t *profile)
+{
+    uint8_t report[1 + sizeof(*profile)];
+    report[0] = UDP_MSG_PROBE_REPORT;
+    memcpy(report + 1, profile, sizeof(*profile));
+    return udp_send_probe_report(report, sizeof(report));
+}
+
+static void link_probe_task(void *pvParameters)
+{
+    uint32_t seq = 0;
+    for (uint8_t ph = 0; ph < NUM_PHASES; ph++) {
+        const probe_phase_t *phase = &phases[ph];
+        int64_t interval_us = 1000000 / phase->pps;
+        int64_t start_us = esp_timer_get_time();
+
+        // Paced on the esp_timer clock; with a coarse tick several probes
+        // leave back to back, which is part of what the ramp measures
+        for (uint16_t i = 0; i < phase->count && seq < LINK_PROBE_MAX_PROBES; i++) {
+            while (esp_timer_get_time() < start_us + i * interval_us) {
+                vTaskDelay(1);
+            }
+            send_probe(seq++, ph, phase->size);
+        }
+        vTaskDelay(pdMS_TO_TICKS(ph + 1 < NUM_PHASES ? PHASE_GAP_MS : LINK_PROBE_GRACE_MS));
+    }
+
+    link_profile_t profile;
+    analyse(&profile);
+
+    portENTER_CRITICAL(&records_lock);
+    probe_record_t *done = records;
+    records = NULL;
+    portEXIT_CRITICAL(&records_lock);
+    free(done);
+
+    link_probe_log(&profile);
+    if (profile.rtt_avg_us == 0) {
+        ESP_LOGW(TAG, "⚠️ No probe echoes - is the bridge running and reachable?");
+    } else {
+        link_probe_apply(&profile);
+        esp_err_t ret = save(&profile);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Could not store link profile: %s", esp_err_to_name(ret));
+        }
+    }
+
+    send_report(&profile);
+
+    running = false;
+    vTaskDelete(NULL);
+}
+
+bool link_probe_is_running(void)
+{
+    return running;
+}
+
+esp_err_t link_probe_start(void)
+{
+    if (!udp_client_is_ready()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    probe_record_t *buf = calloc(LINK_PROBE_MAX_PROBES, sizeof(probe_record_t));
+    if (!buf) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    portENTER_CRITICAL(&records_lock);
+    records = buf;
+    probes_sent = 0;
+    current_run = esp_random() | 1;     // never 0; the bridge keys its counts by run
+    highest_echo_seq = 0;
+    reordered = 0;
+    duplicated = 0;
+    portEXIT_CRITICAL(&records_lock);
+    running = true;
+
+    ESP_LOGI(TAG, "📶 Link probe #%lu started (%d phases)", (unsigned long)current_run, (int)NUM_PHASES);
+    if (xTaskCreate(link_probe_task, "link_probe", 4096, NULL, 4, NULL) != pdPASS) {
+        running = false;
+        portENTER_CRITICAL(&records_lock);
+        records = NULL;
+        portEXIT_CRITICAL(&records_lock);
+        free(buf);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void link_probe_apply(const link_profile_t *profile)
+{
+    audio_playback_set_prebuffer(profile->prebuffer_chunks);
+
+    portENTER_CRITICAL(&records_lock);
+    applied_profile = *profile;
+    profile_applied = true;
+    portEXIT_CRITICAL(&records_lock);
+}
+
+esp_err_t link_probe_report(void)
+{
+    // A running probe reports its own result when it completes
+    if (running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    link_profile_t profile;
+    portENTER_CRITICAL(&records_lock);
+    bool applied = profile_applied;
+    profile = applied_profile;
+    portEXIT_CRITICAL(&records_lock);
+
+    return applied ? send_report(&profile) : ESP_ERR_NOT_FOUND;
+}
+
+void link_probe_log(const link_profile_t *p)
+{
+    ESP_LOGI(TAG, "📶 Link: RTT min/avg/p95 %.1f/%.1f/%.1f ms, jitter up/down %.1f/%.1f ms",
+             p->rtt_min_us / 1000.0f, p->rtt_avg_us / 1000.0f, p->rtt_p95_us / 1000.0f,
+             p->jitter_up_us / 1000.0f, p->jitter_down_us / 1000.0f);
+    ESP_LOGI(TAG, "   Loss up/down %.2f/%.2f%% (burst %u), %u reordered, %u duplicated of %u probes",
+             p->loss_up_pct_x100 / 100.0f, p->loss_down_pct_x100 / 100.0f, p->max_loss_burst,
+             p->reordered, p->duplicated, p->probes_sent);
+    ESP_LOGI(TAG, "   Sustainable %lu kbps -> pre-buffer %u chunks, %u-byte frames",
+             (unsigned long)p->sustainable_kbps, p->prebuffer_chunks, p->frame_bytes);
+}
@@ -0,0 +1,79 @@
+#ifndef LINK_PROBE_H
+#define LINK_PROBE_H
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Link-quality probe between the device and the bridge (iperf-style).
+// Sends paced bursts of UDP_MSG_PROBE packets over the real audio path; the
+// bridge echoes each one as UDP_MSG_PROBE_ECHO with its own receive time and
+// a count of the probes it has seen. From that the device derives RTT,
+// one-way jitter per direction (RFC 3550 style, so no clock sync is needed),
+// per-direction loss, loss bursts, reordering and the highest probe rate the
+// link sustains. The result is a link_profile_t stored in NVS; it sets the
+// playback pre-buffer and is reported to the bridge, which sizes its
+// downlink frames from it.
+//
+// Probe packet, both directions (little endian):
+//   [type][u32 run][u32 seq][u64 device_send_us][u64 bridge_recv_us][u32 bridge_count][u8 phase][padding]
+
+#define LINK_PROBE_HEADER_SIZE  30
+#define LINK_PROBE_MAX_PROBES   256
+#define LINK_PROBE_GRACE_MS     500     // wait for late echoes after the last burst
+#define LINK_PROBE_VERSION      1
+
+// A ramp step counts as sustained while its round-trip loss and RTT spread
+// stay within these margins over the RTT phase's
+#define LINK_PROBE_MAX_STEP_LOSS_PCT    2
+#define LINK_PROBE_MAX_RTT_GROWTH_US    20000
+
+// Playback pre-buffer limits, in downlink chunks (1440 bytes = 30 ms)
+#define LINK_PROBE_MIN_PREBUFFER        3
+#define LINK_PROBE_MAX_PREBUFFER        20
+
+// Sent as [UDP_MSG_PROBE_REPORT][link_profile_t]; layout is shared with the
+// bridge (nodejs_bridge/link_probe.js), new fields are only appended
+typedef struct {
+    uint32_t version;               // LINK_PROBE_VERSION
+    uint32_t rtt_min_us;
+    uint32_t rtt_avg_us;
+    uint32_t rtt_p95_us;
+    uint32_t jitter_up_us;          // device -> bridge
+    uint32_t jitter_down_us;        // bridge -> device
+    uint16_t loss_up_pct_x100;
+    uint16_t loss_down_pct_x100;
+    uint16_t max_loss_burst;        // longest run of consecutive lost probes
+    uint16_t reordered;
+    uint16_t duplicated;
+    uint16_t probes_sent;
+    uint32_t sustainable_kbps;      // highest ramp step within the loss / RTT limits
+    uint16_t prebuffer_chunks;      // recommended playback pre-buffer
+    uint16_t frame_bytes;           // recommended downlink frame size
+} link_profile_t;
+
+// Run a probe in the background against the configured bridge. The profile
+// is applied, stored and reported when it completes. ESP_ERR_INVALID_STATE
+// if a probe is already running.
+esp_err_t link_probe_start(void);
+
+bool link_probe_is_running(void);
+
+// Called by the UDP receive task for every UDP_MSG_PROBE_ECHO
+void link_probe_on_echo(const uint8_t *packet, size_t len, int64_t rx_time_us);
+
+// Last stored profile; ESP_ERR_NVS_NOT_FOUND if no probe has completed
+esp_err_t link_probe_load(link_profile_t *profile);
+
+// Use a profile's recommendations (playback pre-buffer)
+void link_probe_apply(const link_profile_t *profile);
+
+// Send the applied profile to the bridge, so its downlink frames match the
+// pre-buffer (after every HELLO: a new or restarted bridge starts from the
+// default frame size). ESP_ERR_NOT_FOUND if none is applied yet.
+esp_err_t link_probe_report(void);
+
+void link_probe_log(const link_profile_t *profile);
+
+#endif // LINK_PROBE_H
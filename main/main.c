@@ -12,9 +12,18 @@
 #include "driver/gpio.h"
 #include "driver/i2s_std.h"
 #include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "wifi_handler.h"
 #include "udp_client.h"
 #include "audio_handler.h"
+#include "trace.h"
+#include "dlog.h"
+#include "telemetry.h"
+#include "mem_monitor.h"
+#include "audio_bench.h"
+#include "audio_loopback.h"
+#include "link_probe.h"
+#include "clock_sync.h"
 
 // loggin tag
 static const char *TAG = "VOICE_ASSISTANT";
@@ -30,9 +39,9 @@ static SemaphoreHandle_t state_mutex = NULL;
 #define RMS_THRESHOLD_NORMAL    100    // Normal speaking threshold
 #define RMS_THRESHOLD_INTERRUPT 400   // Interrupt threshold
 
-// Timing helpers
+// Timing helpers (esp_timer, not the 10 ms FreeRTOS tick)
 static inline int64_t get_time_ms(void) {
-    return (int64_t)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+    return esp_timer_get_time() / 1000;
 }
 
 // state handler function
@@ -50,6 +59,9 @@ static void set_voice_state(voice_state_t new_state)
         
         voice_state_t old_state = current_state;
         current_state = new_state;
+        TRACE_EVENT(TRACE_EV_STATE_CHANGE, old_state, new_state);
+        telemetry_note_state_change(new_state,
+                                    old_state == STATE_AI_SPEAKING && new_state == STATE_USER_SPEAKING);
         
         // Handle state transitions
         switch (new_state) {
@@ -93,6 +105,9 @@ static voice_state_t get_voice_state(void)
 // Enhanced audio monitoring task with state machine
 static void voice_assistant_task(void *pvParameters)
 {
+    // Registered from here: the early exit below can run before the creator gets the handle
+    telemetry_register_task(TELEMETRY_TASK_VOICE, xTaskGetCurrentTaskHandle());
+
     ESP_LOGI(TAG, "\n========================================");
     ESP_LOGI(TAG, "🎙️ Voice Assistant Task Started");
     ESP_LOGI(TAG, "========================================");
@@ -105,11 +120,12 @@ static void voice_assistant_task(void *pvParameters)
     esp_err_t ret = audio_start_streaming();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to start streaming");
+        telemetry_register_task(TELEMETRY_TASK_VOICE, NULL);
         vTaskDelete(NULL);
         return;
     }
 
-    uint8_t chunk_buffer[AUDIO_CHUNK_SIZE_OUTPUT]; // unsinged 8 bit int, simply a arr of audio
+    uint8_t chunk_buffer[AUDIO_CHUNK_SIZE_UPLINK]; // unsinged 8 bit int, simply a arr of audio
     int64_t silence_start = 0; // singed 64 bit int
     uint32_t sequence = 0; // unsinged 32 bit int, simply to track packets
 
@@ -134,13 +150,13 @@ static void voice_assistant_task(void *pvParameters)
         switch (state) {
             case STATE_IDLE:
                 if (rms > RMS_THRESHOLD_NORMAL) {
-                    ESP_LOGI(TAG, "\n🎙️ Audio detected (RMS=%lu) - USER_SPEAKING", rms);
+                    DLOGI(TAG, "🎙️ Audio detected (RMS=%lu) - USER_SPEAKING", rms);
                     set_voice_state(STATE_USER_SPEAKING);
                     silence_start = 0;
                     sequence = 0;
 
                     // Send this first chunk
-                    udp_send_audio_packet(chunk_buffer, bytes_captured, sequence++);
+                    udp_send_audio_packet(chunk_buffer, bytes_captured, sequence++, audio_get_capture_time_us());
                 }
                 break;
 
@@ -150,9 +166,9 @@ static void voice_assistant_task(void *pvParameters)
                     if (silence_start == 0) {
                         silence_start = get_time_ms();
                     } else if (get_time_ms() - silence_start > SILENCE_DURATION_MS) {
-                        ESP_LOGI(TAG, "🔇 Silence detected - returning to IDLE");
-                        ESP_LOGI(TAG, "Total chunks sent: %lu (%.2f seconds)\n",
-                                 sequence, (float)sequence / 25.0f);
+                        DLOGI(TAG, "🔇 Silence detected - returning to IDLE");
+                        DLOGI(TAG, "Total chunks sent: %lu (%lu ms)",
+                              sequence, sequence * AUDIO_CHUNK_DURATION_MS);
                         set_voice_state(STATE_IDLE);
                         silence_start = 0;
                         continue; // Don't send this chunk
@@ -162,23 +178,23 @@ static void voice_assistant_task(void *pvParameters)
                 }
 
                 // Send audio chunk
-                udp_send_audio_packet(chunk_buffer, bytes_captured, sequence++);
+                udp_send_audio_packet(chunk_buffer, bytes_captured, sequence++, audio_get_capture_time_us());
 
                 // Log every second
                 if (sequence % 25 == 0) {
-                    ESP_LOGI(TAG, "📤 Streaming: %lu chunks, RMS=%lu", sequence, rms);
+                    DLOGI(TAG, "📤 Streaming: %lu chunks, RMS=%lu", sequence, rms);
                 }
                 break;
 
             case STATE_AI_SPEAKING:
                 // Check for interrupt (high RMS during AI speech)
                 if (rms > RMS_THRESHOLD_INTERRUPT) {
-                    ESP_LOGI(TAG, "⚡ Interrupt detected (RMS=%lu) - USER_SPEAKING", rms);
+                    DLOGI(TAG, "⚡ Interrupt detected (RMS=%lu) - USER_SPEAKING", rms);
                     set_voice_state(STATE_USER_SPEAKING);
                     sequence = 0;
 
                     // Send this interrupt chunk
-                    udp_send_audio_packet(chunk_buffer, bytes_captured, sequence++);
+                    udp_send_audio_packet(chunk_buffer, bytes_captured, sequence++, audio_get_capture_time_us());
                 }
                 // In AI_SPEAKING state, we don't send audio unless interrupting
                 break;
@@ -203,6 +219,14 @@ void app_main(void)
     }
     ESP_ERROR_CHECK(ret);
 
+#ifdef DLOG_MEASURE_AT_BOOT
+    // Worst-case cycles of ESP_LOGW vs DLOGW, measured before the formatter task exists
+    dlog_measure_call_cost();
+#endif
+
+    // Deferred logger for the real-time tasks
+    ESP_ERROR_CHECK(dlog_init());
+
     // Initialize event loop
     ESP_ERROR_CHECK(esp_event_loop_create_default());
 
@@ -238,6 +262,9 @@ void app_main(void)
     // Register state callback for UDP
     udp_register_state_callback(set_voice_state);
 
+    // Bridge timeline for capture / playback timestamps (latency waterfall)
+    clock_sync_init();
+
     // Initialize Audio
     ESP_LOGI(TAG, "Initializing Audio...");
     ret = audio_init();
@@ -254,6 +281,33 @@ void app_main(void)
         return;
     }
 
+    // Speaker-to-mic latency and coupling: measured with AUDIO_LOOPBACK_AT_BOOT, otherwise the stored calibration
+    audio_loopback_result_t loopback;
+#ifdef AUDIO_LOOPBACK_AT_BOOT
+    audio_loopback_run(&loopback);
+#else
+    if (audio_loopback_load(&loopback) == ESP_OK) {
+        audio_loopback_log(&loopback);
+    } else {
+        ESP_LOGI(TAG, "No loopback calibration stored (build with -D AUDIO_LOOPBACK_AT_BOOT=1 to measure)");
+    }
+#endif
+
+    // Network-path pre-buffer: probe the link on first boot (or with LINK_PROBE_AT_BOOT), otherwise the stored profile
+#ifdef LINK_PROBE_AT_BOOT
+    link_probe_start();
+#else
+    link_profile_t link_profile;
+    if (link_probe_load(&link_profile) == ESP_OK) {
+        link_probe_log(&link_profile);
+        link_probe_apply(&link_profile);
+        link_probe_report();    // the boot HELLO went out before it was applied
+    } else {
+        ESP_LOGI(TAG, "No link profile stored, probing the link");
+        link_probe_start();
+    }
+#endif
+
     // Quick tests - DISABLED
     // ESP_LOGI(TAG, "Testing microphone...");
     // audio_test_microphone_quick();
@@ -267,6 +321,14 @@ void app_main(void)
     // Create voice assistant task
     xTaskCreatePinnedToCore(voice_assistant_task, "voice_assist", 8192, NULL, 5, NULL, 1);
 
+    // Stack / heap watermarks (tasks register themselves with telemetry)
+    mem_monitor_init();
+
+#ifdef AUDIO_BENCH_AT_BOOT
+    // Kernel cycles with WiFi up, so cache pressure shows in the jitter column
+    audio_bench_run();
+#endif
+
     ESP_LOGI(TAG, "\n============================================================");
     ESP_LOGI(TAG, "✅ Voice Assistant Ready!");
     ESP_LOGI(TAG, "============================================================");
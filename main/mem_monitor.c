@@ -0,0 +1,175 @@
+#include "mem_monitor.h"
+#include "telemetry.h"
+#include "udp_client.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <string.h>
+
+static const char *TAG = "MEM_MONITOR";
+
+static const uint32_t heap_caps[MEM_HEAP_COUNT] = {
+    [MEM_HEAP_INTERNAL] = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT,
+    [MEM_HEAP_DMA] = MALLOC_CAP_DMA,
+    [MEM_HEAP_PSRAM] = MALLOC_CAP_SPIRAM,
+};
+
+static const char *task_names[TELEMETRY_TASK_COUNT] = {
+    [TELEMETRY_TASK_VOICE] = "voice_assist",
+    [TELEMETRY_TASK_UDP_RX] = "udp_rx",
+    [TELEMETRY_TASK_PLAYBACK] = "audio_play_queue",
+    [TELEMETRY_TASK_DLOG] = "dlog",
+};
+
+static mem_heap_sample_t heap_samples[MEM_HEAP_COUNT];
+static uint32_t stack_min_free[TELEMETRY_TASK_COUNT];
+static bool stack_sampled[TELEMETRY_TASK_COUNT];
+static uint32_t active_alerts = 0;
+static uint32_t alert_count = 0;
+static TaskHandle_t monitor_task_handle = NULL;
+
+static void sample_heap(mem_heap_id_t id)
+{
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, heap_caps[id]);
+
+    mem_heap_sample_t *s = &heap_samples[id];
+    s->free_bytes = info.total_free_bytes;
+    s->largest_free_block = info.largest_free_block;
+    s->minimum_free_bytes = info.minimum_free_bytes;
+    s->free_blocks = info.free_blocks;
+    s->fragmentation_pct = info.total_free_bytes > 0 ?
+        100 - (uint32_t)(((uint64_t)info.largest_free_block * 100) / info.total_free_bytes) : 0;
+}
+
+void mem_monitor_sample(void)
+{
+    uint32_t alerts = 0;
+    int tightest_task = -1;
+    uint32_t tightest_free = UINT32_MAX;
+
+    for (int i = 0; i < TELEMETRY_TASK_COUNT; i++) {
+        uint32_t free_bytes;
+        if (!telemetry_get_stack_free(i, &free_bytes)) {
+            continue;  // not running
+        }
+
+        // A stack used up to its last byte (free 0) is the one to alert on
+        if (!stack_sampled[i] || free_bytes < stack_min_free[i]) {
+            stack_min_free[i] = free_bytes;
+            stack_sampled[i] = true;
+        }
+        if (free_bytes < MEM_ALERT_STACK_MIN_FREE) {
+            alerts |= MEM_ALERT_STACK_LOW;
+        }
+        if (free_bytes < tightest_free) {
+            tightest_free = free_bytes;
+            tightest_task = i;
+        }
+    }
+
+    for (int i = 0; i < MEM_HEAP_COUNT; i++) {
+        sample_heap(i);
+    }
+
+    const mem_heap_sample_t *internal = &heap_samples[MEM_HEAP_INTERNAL];
+    const mem_heap_sample_t *dma = &heap_samples[MEM_HEAP_DMA];
+    const mem_heap_sample_t *psram = &heap_samples[MEM_HEAP_PSRAM];
+
+    if (internal->free_bytes < MEM_ALERT_INTERNAL_MIN_FREE) {
+        alerts |= MEM_ALERT_INTERNAL_LOW;
+    }
+    if (internal->fragmentation_pct > MEM_ALERT_FRAGMENTATION_PCT ||
+        internal->largest_free_block < MEM_ALERT_INTERNAL_MIN_BLOCK) {
+        alerts |= MEM_ALERT_INTERNAL_FRAGMENTED;
+    }
+    if (dma->largest_free_block < MEM_ALERT_DMA_MIN_BLOCK) {
+        alerts |= MEM_ALERT_DMA_LOW;
+    }
+    // Boards without PSRAM report an empty heap; only alert on a heap that exists
+    if (psram->free_bytes > 0 || psram->minimum_free_bytes > 0) {
+        if (psram->free_bytes < MEM_ALERT_PSRAM_MIN_FREE) {
+            alerts |= MEM_ALERT_PSRAM_LOW;
+        }
+        if (psram->fragmentation_pct > MEM_ALERT_FRAGMENTATION_PCT) {
+            alerts |= MEM_ALERT_PSRAM_FRAGMENTED;
+        }
+    }
+
+    uint32_t raised = alerts & ~active_alerts;
+    active_alerts = alerts;
+
+    if (raised) {
+        alert_count++;
+        ESP_LOGW(TAG, "⚠️ Memory alert 0x%02lx (active 0x%02lx): internal free=%lu largest=%lu frag=%lu%%",
+                 (unsigned long)raised, (unsigned long)alerts, (unsigned long)internal->free_bytes,
+                 (unsigned long)internal->largest_free_block, (unsigned long)internal->fragmentation_pct);
+        if ((raised & MEM_ALERT_STACK_LOW) && tightest_task >= 0) {
+            ESP_LOGW(TAG, "⚠️ Stack low: %s has %lu bytes left",
+                     task_names[tightest_task], (unsigned long)tightest_free);
+        }
+        udp_send_mem_alert(raised, alerts);
+    }
+}
+
+static void mem_monitor_task(void *pvParameters)
+{
+    while (1) {
+        mem_monitor_sample();
+
+        // Periodic summary (debug level) - telemetry carries the same numbers
+        const mem_heap_sample_t *internal = &heap_samples[MEM_HEAP_INTERNAL];
+        const mem_heap_sample_t *psram = &heap_samples[MEM_HEAP_PSRAM];
+        ESP_LOGD(TAG, "📊 internal free=%lu min=%lu largest=%lu frag=%lu%%",
+                 (unsigned long)internal->free_bytes, (unsigned long)internal->minimum_free_bytes,
+                 (unsigned long)internal->largest_free_block, (unsigned long)internal->fragmentation_pct);
+        ESP_LOGD(TAG, "📊 psram free=%lu min=%lu largest=%lu frag=%lu%%",
+                 (unsigned long)psram->free_bytes, (unsigned long)psram->minimum_free_bytes,
+                 (unsigned long)psram->largest_free_block, (unsigned long)psram->fragmentation_pct);
+
+        vTaskDelay(pdMS_TO_TICKS(MEM_MONITOR_INTERVAL_MS));
+    }
+}
+
+esp_err_t mem_monitor_init(void)
+{
+    if (monitor_task_handle) {
+        return ESP_OK;
+    }
+
+    if (xTaskCreate(mem_monitor_task, "mem_monitor", 3072, NULL, 2, &monitor_task_handle) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create memory monitor task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "✅ Memory monitor started (every %d ms)", MEM_MONITOR_INTERVAL_MS);
+    return ESP_OK;
+}
+
+uint32_t mem_monitor_get_alerts(void)
+{
+    return active_alerts;
+}
+
+uint32_t mem_monitor_get_alert_count(void)
+{
+    return alert_count;
+}
+
+void mem_monitor_get_heap(mem_heap_id_t heap, mem_heap_sample_t *sample)
+{
+    if (heap < MEM_HEAP_COUNT) {
+        *sample = heap_samples[heap];
+    } else {
+        memset(sample, 0, sizeof(*sample));
+    }
+}
+
+uint32_t mem_monitor_get_stack_min_free(int task_id)
+{
+    if (task_id < 0 || task_id >= TELEMETRY_TASK_COUNT) {
+        return 0;
+    }
+    return stack_min_free[task_id];
+}
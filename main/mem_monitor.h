@@ -0,0 +1,67 @@
+#ifndef MEM_MONITOR_H
+#define MEM_MONITOR_H
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Periodic heap / stack sampler.
+// Every MEM_MONITOR_INTERVAL_MS it records stack high-water marks of the tasks
+// registered with telemetry_register_task() and free size, largest free block
+// and fragmentation for each heap capability. Crossing a threshold raises an
+// alert bit: new alerts are logged and pushed to the server as
+// UDP_MSG_MEM_ALERT, and all samples are carried in the telemetry snapshot.
+
+#define MEM_MONITOR_INTERVAL_MS 5000
+
+// Alert thresholds
+#define MEM_ALERT_STACK_MIN_FREE        768         // bytes left on any task stack
+#define MEM_ALERT_INTERNAL_MIN_FREE     (24 * 1024)
+#define MEM_ALERT_INTERNAL_MIN_BLOCK    (8 * 1024)  // largest allocatable internal block
+#define MEM_ALERT_DMA_MIN_BLOCK         (4 * 1024)  // I2S/WiFi DMA buffers come from here
+#define MEM_ALERT_PSRAM_MIN_FREE        (256 * 1024)
+#define MEM_ALERT_FRAGMENTATION_PCT     70
+
+typedef enum {
+    MEM_ALERT_STACK_LOW          = 1 << 0,
+    MEM_ALERT_INTERNAL_LOW       = 1 << 1,
+    MEM_ALERT_INTERNAL_FRAGMENTED = 1 << 2,
+    MEM_ALERT_DMA_LOW            = 1 << 3,
+    MEM_ALERT_PSRAM_LOW          = 1 << 4,
+    MEM_ALERT_PSRAM_FRAGMENTED   = 1 << 5,
+} mem_alert_t;
+
+// Heaps sampled, in snapshot order
+typedef enum {
+    MEM_HEAP_INTERNAL,
+    MEM_HEAP_DMA,
+    MEM_HEAP_PSRAM,
+    MEM_HEAP_COUNT
+} mem_heap_id_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t free_bytes;
+    uint32_t largest_free_block;
+    uint32_t minimum_free_bytes;    // low-water mark since boot
+    uint32_t free_blocks;
+    uint32_t fragmentation_pct;     // 100 - largest block as % of free
+} mem_heap_sample_t;
+
+// Start the sampling task
+esp_err_t mem_monitor_init(void);
+
+// Take one sample now (also called by the task)
+void mem_monitor_sample(void);
+
+// Currently active alert bits and how many times any alert was raised
+uint32_t mem_monitor_get_alerts(void);
+uint32_t mem_monitor_get_alert_count(void);
+
+// Latest heap sample
+void mem_monitor_get_heap(mem_heap_id_t heap, mem_heap_sample_t *sample);
+
+// Lowest stack free seen for a telemetry task id, across restarts of that task
+uint32_t mem_monitor_get_stack_min_free(int task_id);
+
+#endif // MEM_MONITOR_H
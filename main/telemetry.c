@@ -0,0 +1,155 @@
+#include "telemetry.h"
+#include "audio_handler.h"
+#include "udp_client.h"
+#include "dlog.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include <string.h>
+
+static telemetry_hist_t histograms[TELEMETRY_HIST_COUNT];
+static TaskHandle_t tracked_tasks[TELEMETRY_TASK_COUNT];
+// Stack scans in progress per task. The lock only covers the handle and this
+// count (a scan is too long to run with interrupts off); a task unregistering
+// on its way out waits for the count to drop, so it cannot be deleted mid-scan.
+static uint8_t stack_scans[TELEMETRY_TASK_COUNT];
+static portMUX_TYPE tasks_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t state_changes = 0;
+static uint32_t interrupts = 0;
+static uint8_t voice_state = 0;
+
+void telemetry_record_latency(telemetry_hist_id_t hist, uint32_t us)
+{
+    if (hist >= TELEMETRY_HIST_COUNT) {
+        return;
+    }
+
+    // Bucket = floor(log2(us)), clamped to the histogram range
+    uint32_t bucket = us > 1 ? 31 - __builtin_clz(us) : 0;
+    if (bucket >= TELEMETRY_HIST_BUCKETS) {
+        bucket = TELEMETRY_HIST_BUCKETS - 1;
+    }
+
+    // Each histogram is fed by a single task, so a plain increment is enough
+    histograms[hist].buckets[bucket]++;
+}
+
+void telemetry_note_state_change(uint8_t new_state, bool interrupt)
+{
+    voice_state = new_state;
+    state_changes++;
+    if (interrupt) {
+        interrupts++;
+    }
+}
+
+void telemetry_register_task(telemetry_task_id_t id, TaskHandle_t handle)
+{
+    if (id >= TELEMETRY_TASK_COUNT) {
+        return;
+    }
+
+    while (1) {
+        portENTER_CRITICAL(&tasks_lock);
+        bool scanning = stack_scans[id] > 0;
+        if (!scanning) {
+            tracked_tasks[id] = handle;
+        }
+        portEXIT_CRITICAL(&tasks_lock);
+        if (!scanning) {
+            return;
+        }
+        vTaskDelay(1);
+    }
+}
+
+TaskHandle_t telemetry_get_task(telemetry_task_id_t id)
+{
+    return id < TELEMETRY_TASK_COUNT ? tracked_tasks[id] : NULL;
+}
+
+bool telemetry_get_stack_free(telemetry_task_id_t id, uint32_t *free_bytes)
+{
+    if (id >= TELEMETRY_TASK_COUNT) {
+        return false;
+    }
+
+    portENTER_CRITICAL(&tasks_lock);
+    TaskHandle_t task = tracked_tasks[id];
+    if (task) {
+        stack_scans[id]++;
+    }
+    portEXIT_CRITICAL(&tasks_lock);
+    if (!task) {
+        return false;
+    }
+
+    *free_bytes = uxTaskGetStackHighWaterMark(task);
+
+    portENTER_CRITICAL(&tasks_lock);
+    stack_scans[id]--;
+    portEXIT_CRITICAL(&tasks_lock);
+    return true;
+}
+
+void telemetry_build_snapshot(telemetry_snapshot_t *snapshot)
+{
+    memset(snapshot, 0, sizeof(*snapshot));
+
+    snapshot->msg_type = UDP_MSG_STATS_RESPONSE;
+    snapshot->version = TELEMETRY_VERSION;
+    snapshot->size = sizeof(*snapshot);
+    snapshot->uptime_ms = (uint32_t)(esp_timer_get_time() / 1000);
+
+    audio_stats_t audio;
+    audio_get_stats(&audio);
+    snapshot->chunks_captured = audio.chunks_captured;
+    snapshot->capture_errors = audio.capture_errors;
+    snapshot->chunks_played = audio.chunks_played;
+    snapshot->playback_sessions = audio.playback_sessions;
+    snapshot->underruns = audio.underruns;
+    snapshot->i2s_write_errors = audio.i2s_write_errors;
+    snapshot->state_changes = state_changes;
+    snapshot->interrupts = interrupts;
+    snapshot->voice_state = voice_state;
+
+    udp_stats_t net;
+    udp_get_stats(&net);
+    snapshot->packets_sent = net.packets_sent;
+    snapshot->packets_received = net.packets_received;
+    snapshot->packets_lost = net.packets_lost;
+    snapshot->send_errors = net.send_errors;
+    snapshot->bytes_sent = net.bytes_sent;
+    snapshot->bytes_received = net.bytes_received;
+
+    snapshot->queue_depth = audio.queue_depth;
+    snapshot->queue_high_water = audio.queue_high_water;
+    snapshot->queue_capacity = AUDIO_QUEUE_LENGTH;
+    snapshot->chunks_queued = audio.chunks_queued;
+    snapshot->queue_drops = audio.queue_drops;
+
+    snapshot->heap_internal_free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    snapshot->heap_internal_min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+    snapshot->heap_internal_largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+    snapshot->heap_psram_free = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    snapshot->heap_psram_min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM);
+    snapshot->heap_psram_largest = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
+
+    snapshot->task_count = uxTaskGetNumberOfTasks();
+    for (int i = 0; i < TELEMETRY_TASK_COUNT; i++) {
+        uint32_t free_bytes;
+        snapshot->stack_free[i] = telemetry_get_stack_free(i, &free_bytes) ? free_bytes : 0;
+    }
+    snapshot->dlog_dropped = dlog_get_dropped();
+
+    memcpy(snapshot->hist, histograms, sizeof(histograms));
+
+    snapshot->mem_alerts = mem_monitor_get_alerts();
+    snapshot->mem_alert_count = mem_monitor_get_alert_count();
+    for (int i = 0; i < MEM_HEAP_COUNT; i++) {
+        mem_monitor_get_heap(i, &snapshot->heap[i]);
+    }
+    for (int i = 0; i < TELEMETRY_TASK_COUNT; i++) {
+        snapshot->stack_min_free[i] = mem_monitor_get_stack_min_free(i);
+    }
+}
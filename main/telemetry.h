@@ -0,0 +1,121 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "mem_monitor.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Device telemetry served over the UDP channel.
+// The host sends UDP_MSG_STATS_REQUEST and gets back one UDP_MSG_STATS_RESPONSE
+// holding a telemetry_snapshot_t. Fields are only ever appended; bump
+// TELEMETRY_VERSION when they are, and keep nodejs_bridge/telemetry.js in sync.
+
+#define TELEMETRY_VERSION 2
+
+// Latency histograms: bucket k counts samples in [2^k, 2^(k+1)) microseconds,
+// bucket 0 also takes 0-1 us and the last bucket everything above
+#define TELEMETRY_HIST_BUCKETS 20
+
+typedef enum {
+    TELEMETRY_HIST_I2S_READ,        // blocking time of one capture read
+    TELEMETRY_HIST_I2S_WRITE,       // blocking time of one playback write
+    TELEMETRY_HIST_UDP_SEND,        // sendto() of one uplink audio packet
+    TELEMETRY_HIST_CHUNK_INTERVAL,  // time between played chunks
+    TELEMETRY_HIST_COUNT
+} telemetry_hist_id_t;
+
+// Tasks whose stack high-water marks are reported
+typedef enum {
+    TELEMETRY_TASK_VOICE,
+    TELEMETRY_TASK_UDP_RX,
+    TELEMETRY_TASK_PLAYBACK,
+    TELEMETRY_TASK_DLOG,
+    TELEMETRY_TASK_COUNT
+} telemetry_task_id_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t buckets[TELEMETRY_HIST_BUCKETS];
+} telemetry_hist_t;
+
+// Wire format (little endian). All counters are cumulative since boot.
+typedef struct __attribute__((packed)) {
+    uint8_t msg_type;               // UDP_MSG_STATS_RESPONSE
+    uint8_t version;                // TELEMETRY_VERSION
+    uint16_t size;                  // sizeof(telemetry_snapshot_t)
+    uint32_t uptime_ms;
+
+    // Audio and state machine
+    uint32_t chunks_captured;
+    uint32_t capture_errors;
+    uint32_t chunks_played;
+    uint32_t playback_sessions;
+    uint32_t underruns;
+    uint32_t i2s_write_errors;
+    uint32_t state_changes;
+    uint32_t interrupts;
+    uint8_t voice_state;
+    uint8_t reserved[3];
+
+    // Network
+    uint32_t packets_sent;
+    uint32_t packets_received;
+    uint32_t packets_lost;
+    uint32_t send_errors;
+    uint32_t bytes_sent;
+    uint32_t bytes_received;
+
+    // Playback queue
+    uint32_t queue_depth;
+    uint32_t queue_high_water;
+    uint32_t queue_capacity;
+    uint32_t chunks_queued;
+    uint32_t queue_drops;
+
+    // Heap
+    uint32_t heap_internal_free;
+    uint32_t heap_internal_min_free;
+    uint32_t heap_internal_largest;
+    uint32_t heap_psram_free;
+    uint32_t heap_psram_min_free;
+    uint32_t heap_psram_largest;
+
+    // Tasks (stack high-water marks in bytes, 0 if the task is not running)
+    uint32_t task_count;
+    uint32_t stack_free[TELEMETRY_TASK_COUNT];
+    uint32_t dlog_dropped;
+
+    telemetry_hist_t hist[TELEMETRY_HIST_COUNT];
+
+    // Version 2: memory monitor (see mem_monitor.h)
+    uint32_t mem_alerts;                            // active mem_alert_t bits
+    uint32_t mem_alert_count;                       // alerts raised since boot
+    mem_heap_sample_t heap[MEM_HEAP_COUNT];         // internal, DMA, PSRAM
+    uint32_t stack_min_free[TELEMETRY_TASK_COUNT];  // lowest seen, across task restarts
+} telemetry_snapshot_t;
+
+// Record one latency sample in microseconds
+void telemetry_record_latency(telemetry_hist_id_t hist, uint32_t us);
+
+// Count a voice state transition (interrupt = user barged in on the AI)
+void telemetry_note_state_change(uint8_t new_state, bool interrupt);
+
+// Track a task for stack reporting; pass NULL when the task exits, before
+// vTaskDelete(NULL) (waits out a stack scan of it in progress)
+void telemetry_register_task(telemetry_task_id_t id, TaskHandle_t handle);
+
+// Handle of a tracked task, NULL if it is not running. Only for checking
+// whether it runs: the task may exit and be freed right after this returns.
+TaskHandle_t telemetry_get_task(telemetry_task_id_t id);
+
+// Stack high-water mark of a tracked task in bytes; false if it is not
+// running (safe against the task exiting concurrently)
+bool telemetry_get_stack_free(telemetry_task_id_t id, uint32_t *free_bytes);
+
+// Fill a snapshot from every module's counters
+void telemetry_build_snapshot(telemetry_snapshot_t *snapshot);
+
+#endif // TELEMETRY_H
@@ -0,0 +1,113 @@
+#include "trace.h"
+#include "udp_client.h"
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+#include <string.h>
+
+static const char *TAG = "TRACE";
+
+#define TRACE_NUM_CORES 2
+
+typedef struct {
+    uint32_t head;      // total slots ever reserved (wraps the ring)
+    uint32_t dropped;   // events recorded while paused
+    trace_event_t events[TRACE_RING_EVENTS];
+} trace_ring_t;
+
+// Rings live in internal RAM so recording never touches PSRAM
+static DRAM_ATTR trace_ring_t trace_rings[TRACE_NUM_CORES];
+static volatile bool trace_enabled = true;
+
+// Packet assembly buffer for trace_dump()
+static uint8_t trace_packet_buffer[sizeof(trace_packet_header_t) +
+                                  TRACE_EVENTS_PER_PACKET * sizeof(trace_event_t)];
+
+void IRAM_ATTR trace_record(uint16_t event, uint16_t arg0, uint32_t arg1)
+{
+    trace_ring_t *ring = &trace_rings[esp_cpu_get_core_id()];
+
+    if (!trace_enabled) {
+        __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    uint32_t slot = __atomic_fetch_add(&ring->head, 1, __ATOMIC_RELAXED);
+    trace_event_t *ev = &ring->events[slot & (TRACE_RING_EVENTS - 1)];
+    ev->cycles = esp_cpu_get_cycle_count();
+    ev->event = event;
+    ev->arg0 = arg0;
+    ev->arg1 = arg1;
+}
+
+void trace_set_enabled(bool enabled)
+{
+    trace_enabled = enabled;
+}
+
+void trace_reset(void)
+{
+    bool was_enabled = trace_enabled;
+    trace_enabled = false;
+
+    for (int core = 0; core < TRACE_NUM_CORES; core++) {
+        __atomic_store_n(&trace_rings[core].head, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&trace_rings[core].dropped, 0, __ATOMIC_RELAXED);
+    }
+
+    trace_enabled = was_enabled;
+}
+
+esp_err_t trace_dump(void (*send)(const uint8_t *packet, size_t len, void *ctx), void *ctx)
+{
+    if (!send) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    bool was_enabled = trace_enabled;
+    trace_enabled = false;
+
+    for (int core = 0; core < TRACE_NUM_CORES; core++) {
+        trace_ring_t *ring = &trace_rings[core];
+        uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+        // Oldest surviving event first
+        uint32_t count = head < TRACE_RING_EVENTS ? head : TRACE_RING_EVENTS;
+        uint32_t first = head - count;
+        uint32_t overwritten = first;
+        uint16_t part_count = (count + TRACE_EVENTS_PER_PACKET - 1) / TRACE_EVENTS_PER_PACKET;
+        if (part_count == 0) {
+            part_count = 1;  // still report an empty core so the host knows it exists
+        }
+
+        for (uint16_t part = 0; part < part_count; part++) {
+            uint32_t offset = part * TRACE_EVENTS_PER_PACKET;
+            uint32_t n = count - offset < TRACE_EVENTS_PER_PACKET ? count - offset : TRACE_EVENTS_PER_PACKET;
+
+            trace_packet_header_t header = {
+                .msg_type = UDP_MSG_TRACE_DATA,
+                .core = core,
+                .part = part,
+                .part_count = part_count,
+                .event_count = n,
+                .cpu_hz = (uint32_t)CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ * 1000000,
+                .dropped = ring->dropped + overwritten,
+            };
+            memcpy(trace_packet_buffer, &header, sizeof(header));
+
+            trace_event_t *out = (trace_event_t *)(trace_packet_buffer + sizeof(header));
+            for (uint32_t i = 0; i < n; i++) {
+                out[i] = ring->events[(first + offset + i) & (TRACE_RING_EVENTS - 1)];
+            }
+
+            send(trace_packet_buffer, sizeof(header) + n * sizeof(trace_event_t), ctx);
+        }
+
+        ESP_LOGI(TAG, "Core %d: dumped %lu events in %u packets (%lu dropped)",
+                 core, count, part_count, ring->dropped + overwritten);
+    }
+
+    trace_enabled = was_enabled;
+    return ESP_OK;
+}
@@ -0,0 +1,81 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Binary event tracing for the real-time audio paths.
+// Each core owns a ring of fixed-size events stamped with its cycle counter.
+// Writers reserve a slot with one atomic add, so recording never takes a lock
+// and is safe from tasks and ISRs. The rings are dumped over UDP on request
+// (UDP_MSG_TRACE_REQUEST) and converted on the host by tools/trace_dump.js.
+
+// Set to 0 to compile every TRACE_EVENT() call site out of the firmware
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+// Events kept per core (must be a power of two) - 1024 * 12 bytes per core
+#define TRACE_RING_EVENTS 1024
+
+// Events carried by one UDP_MSG_TRACE_DATA packet (fits the 1440-byte budget)
+#define TRACE_EVENTS_PER_PACKET 100
+
+// Event ids - keep in sync with EVENT_NAMES in nodejs_bridge/tools/trace_dump.js
+typedef enum {
+    TRACE_EV_I2S_READ_BEGIN = 1,    // arg1 = bytes requested
+    TRACE_EV_I2S_READ_END,          // arg0 = esp_err_t, arg1 = bytes read
+    TRACE_EV_I2S_WRITE_BEGIN,       // arg0 = sequence, arg1 = bytes
+    TRACE_EV_I2S_WRITE_END,         // arg0 = esp_err_t, arg1 = bytes written
+    TRACE_EV_QUEUE_PUSH,            // arg0 = queue depth, arg1 = sequence
+    TRACE_EV_QUEUE_POP,             // arg0 = queue depth, arg1 = sequence
+    TRACE_EV_STATE_CHANGE,          // arg0 = old state, arg1 = new state
+    TRACE_EV_UDP_SEND,              // arg0 = bytes, arg1 = sequence
+    TRACE_EV_UDP_RECV,              // arg0 = message type, arg1 = bytes
+    TRACE_EV_I2S_RX_DMA,            // ISR: arg1 = bytes in the finished DMA buffer
+    TRACE_EV_I2S_RX_OVERFLOW,       // ISR: arg1 = bytes dropped
+    TRACE_EV_I2S_TX_DMA,            // ISR: arg1 = bytes in the finished DMA buffer
+    TRACE_EV_I2S_TX_OVERFLOW,       // ISR: arg1 = bytes replayed
+} trace_event_id_t;
+
+// One recorded event (12 bytes, little endian on the wire)
+typedef struct __attribute__((packed)) {
+    uint32_t cycles;    // CPU cycle counter of the recording core
+    uint16_t event;     // trace_event_id_t
+    uint16_t arg0;
+    uint32_t arg1;
+} trace_event_t;
+
+// Header of every UDP_MSG_TRACE_DATA packet, followed by event_count events
+typedef struct __attribute__((packed)) {
+    uint8_t msg_type;       // UDP_MSG_TRACE_DATA
+    uint8_t core;
+    uint16_t part;          // packet index for this core, oldest events first
+    uint16_t part_count;    // packets sent for this core
+    uint16_t event_count;
+    uint32_t cpu_hz;        // cycle counter frequency
+    uint32_t dropped;       // events overwritten or discarded on this core
+} trace_packet_header_t;
+
+#if TRACE_ENABLED
+#define TRACE_EVENT(id, a0, a1) trace_record((id), (uint16_t)(a0), (uint32_t)(a1))
+#else
+#define TRACE_EVENT(id, a0, a1) do { } while (0)
+#endif
+
+// Record one event on the calling core (task or ISR context)
+void trace_record(uint16_t event, uint16_t arg0, uint32_t arg1);
+
+// Enable or pause recording (paused events are counted as dropped)
+void trace_set_enabled(bool enabled);
+
+// Discard everything recorded so far
+void trace_reset(void);
+
+// Serialize both rings into UDP_MSG_TRACE_DATA packets and hand each one to
+// send(). Recording is paused for the duration so the snapshot is consistent.
+esp_err_t trace_dump(void (*send)(const uint8_t *packet, size_t len, void *ctx), void *ctx);
+
+#endif // TRACE_H
@@ -1,5 +1,12 @@
 #include "udp_client.h"
 #include "audio_handler.h"
+#include "trace.h"
+#include "dlog.h"
+#include "telemetry.h"
+#include "link_probe.h"
+#include "clock_sync.h"
+#include "esp_timer.h"
+#include "esp_mac.h"
 #include "esp_log.h"
 #include "lwip/sockets.h"
 #include "lwip/netdb.h"
@@ -19,6 +26,10 @@ static uint32_t packets_sent = 0;
 static uint32_t packets_received = 0;
 static uint32_t last_received_seq = 0;
 static uint32_t packets_lost = 0;
+static uint32_t total_packets_lost = 0;
+static uint32_t send_errors = 0;
+static uint32_t bytes_sent = 0;
+static uint32_t bytes_received = 0;
 
 // State callback
 static void (*state_change_callback)(voice_state_t state) = NULL;
@@ -27,9 +38,76 @@ static void (*state_change_callback)(voice_state_t state) = NULL;
 #define RX_BUFFER_SIZE 2048
 static uint8_t rx_buffer[RX_BUFFER_SIZE];
 
+// Arrival of the first chunk of the current response (for the latency waterfall)
+static int64_t first_play_rx_us = 0;
+
+// Last host that asked for a link probe (gets the report too)
+static struct sockaddr_in probe_requester;
+static bool probe_requested = false;
+
+// Host a trace dump is being sent to (one dump at a time)
+static struct sockaddr_in trace_requester;
+static volatile bool trace_dump_running = false;
+
+// Telemetry snapshot buffer (kept off the receive task stack)
+static telemetry_snapshot_t stats_snapshot;
+
+size_t udp_packet_build_audio(uint8_t *out, size_t out_size, uint8_t msg_type,
+                              const uint8_t *audio, size_t audio_len, uint32_t sequence)
+{
+    size_t packet_size = UDP_AUDIO_HEADER_SIZE + audio_len;
+    if (packet_size > out_size) {
+        return 0;
+    }
+
+    out[0] = msg_type;
+    memcpy(out + 1, &sequence, sizeof(sequence));
+    memcpy(out + UDP_AUDIO_HEADER_SIZE, audio, audio_len);
+    return packet_size;
+}
+
+bool udp_packet_parse_audio(const uint8_t *packet, size_t len, uint32_t *sequence,
+                            const uint8_t **audio, size_t *audio_len)
+{
+    if (len < UDP_AUDIO_HEADER_SIZE) {
+        return false;
+    }
+
+    // memcpy: the sequence sits at an odd offset
+    memcpy(sequence, packet + 1, sizeof(*sequence));
+    *audio = packet + UDP_AUDIO_HEADER_SIZE;
+    *audio_len = len - UDP_AUDIO_HEADER_SIZE;
+    return true;
+}
+
+// Sends one trace dump packet back to whoever asked for it
+static void send_trace_packet(const uint8_t *packet, size_t len, void *ctx)
+{
+    const struct sockaddr_in *dest = (const struct sockaddr_in *)ctx;
+
+    if (sendto(udp_socket, packet, len, 0, (const struct sockaddr *)dest, sizeof(*dest)) < 0) {
+        ESP_LOGW(TAG, "Failed to send trace packet: errno %d", errno);
+    }
+
+    // Give lwIP and the host a moment so the burst is not dropped
+    // (at least one tick: 2 ms rounds down to 0 at 100 Hz)
+    TickType_t pace = pdMS_TO_TICKS(2);
+    vTaskDelay(pace > 0 ? pace : 1);
+}
+
+// Paced dumps take tens of milliseconds, so they run on their own low
+// priority task; udp_rx must keep draining PLAY_AUDIO meanwhile
+static void trace_dump_task(void *pvParameters)
+{
+    trace_dump(send_trace_packet, &trace_requester);
+    trace_dump_running = false;
+    vTaskDelete(NULL);
+}
+
 // UDP receive task - handles incoming audio and state changes
 static void udp_receive_task(void *pvParameters)
 {
+    telemetry_register_task(TELEMETRY_TASK_UDP_RX, xTaskGetCurrentTaskHandle());
     ESP_LOGI(TAG, "UDP receive task started");
     
     struct sockaddr_in source_addr;
@@ -38,36 +116,42 @@ static void udp_receive_task(void *pvParameters)
     while (udp_socket >= 0) {
         int len = recvfrom(udp_socket, rx_buffer, RX_BUFFER_SIZE, 0,
                           (struct sockaddr *)&source_addr, &socklen);
+        int64_t rx_time_us = esp_timer_get_time();
         
         if (len > 0) {
             packets_received++;
+            bytes_received += len;
             
             // Check message type
             uint8_t msg_type = rx_buffer[0];
+            TRACE_EVENT(TRACE_EV_UDP_RECV, msg_type, len);
             
             switch (msg_type) {
-                case UDP_MSG_PLAY_AUDIO:
-                    if (len >= 5) {
-                        uint32_t seq = *(uint32_t *)&rx_buffer[1];
-                        uint8_t *audio_data = &rx_buffer[5];
-                        size_t audio_len = len - 5;
-
+                case UDP_MSG_PLAY_AUDIO: {
+                    uint32_t seq;
+                    const uint8_t *audio_data;
+                    size_t audio_len;
+                    if (udp_packet_parse_audio(rx_buffer, len, &seq, &audio_data, &audio_len)) {
                         // PACKET LOSS DETECTION: Check for sequence number gaps
                         if (seq > 0 && last_received_seq > 0 && seq != last_received_seq + 1) {
                             uint32_t gap = seq - last_received_seq - 1;
                             packets_lost += gap;
-                            ESP_LOGW(TAG, "⚠️ PACKET LOSS: Expected seq #%lu, got #%lu (lost %lu packets, total lost: %lu)",
+                            total_packets_lost += gap;
+                            DLOGW(TAG, "⚠️ PACKET LOSS: Expected seq #%lu, got #%lu (lost %lu packets, total lost: %lu)",
                                      last_received_seq + 1, seq, gap, packets_lost);
                         }
                         last_received_seq = seq;
+                        if (seq == 0 || first_play_rx_us == 0) {
+                            first_play_rx_us = rx_time_us;
+                        }
 
                         // Validate packet size
                         if (audio_len > 1440) {
-                            ESP_LOGW(TAG, "⚠️ Received oversized packet #%lu: %zu bytes (max 1440), truncating", seq, audio_len);
+                            DLOGW(TAG, "⚠️ Received oversized packet #%lu: %lu bytes (max 1440), truncating", seq, audio_len);
                             audio_len = 1440;
                         }
                         if (audio_len == 0) {
-                            ESP_LOGW(TAG, "⚠️ Received empty packet #%lu, skipping", seq);
+                            DLOGW(TAG, "⚠️ Received empty packet #%lu, skipping", seq);
                             break;
                         }
 
@@ -76,33 +160,37 @@ static void udp_receive_task(void *pvParameters)
                         audio_playback_queue_push(audio_data, audio_len, seq, false);
                     }
                     break;
+                }
 
-                case UDP_MSG_PLAY_AUDIO_LAST:
-                    if (len >= 5) {
-                        uint32_t seq = *(uint32_t *)&rx_buffer[1];
-                        uint8_t *audio_data = &rx_buffer[5];
-                        size_t audio_len = len - 5;
-
+                case UDP_MSG_PLAY_AUDIO_LAST: {
+                    uint32_t seq;
+                    const uint8_t *audio_data;
+                    size_t audio_len;
+                    if (udp_packet_parse_audio(rx_buffer, len, &seq, &audio_data, &audio_len)) {
                         // PACKET LOSS DETECTION: Check for sequence number gaps before LAST
                         if (seq > 0 && last_received_seq > 0 && seq != last_received_seq + 1) {
                             uint32_t gap = seq - last_received_seq - 1;
                             packets_lost += gap;
-                            ESP_LOGW(TAG, "⚠️ PACKET LOSS BEFORE LAST: Expected seq #%lu, got #%lu (lost %lu packets, total lost: %lu)",
+                            total_packets_lost += gap;
+                            DLOGW(TAG, "⚠️ PACKET LOSS BEFORE LAST: Expected seq #%lu, got #%lu (lost %lu packets, total lost: %lu)",
                                      last_received_seq + 1, seq, gap, packets_lost);
                         }
                         last_received_seq = seq;
+                        if (seq == 0 || first_play_rx_us == 0) {
+                            first_play_rx_us = rx_time_us;
+                        }
 
                         // Validate packet size
                         if (audio_len > 1440) {
-                            ESP_LOGW(TAG, "⚠️ Received oversized LAST packet #%lu: %zu bytes (max 1440), truncating", seq, audio_len);
+                            DLOGW(TAG, "⚠️ Received oversized LAST packet #%lu: %lu bytes (max 1440), truncating", seq, audio_len);
                             audio_len = 1440;
                         }
                         if (audio_len == 0) {
-                            ESP_LOGW(TAG, "⚠️ Received empty LAST packet #%lu, skipping", seq);
+                            DLOGW(TAG, "⚠️ Received empty LAST packet #%lu, skipping", seq);
                             break;
                         }
 
-                        ESP_LOGI(TAG, "📥 Received LAST chunk #%lu (%zu bytes) - Total packets lost this session: %lu", seq, audio_len, packets_lost);
+                        DLOGI(TAG, "📥 Received LAST chunk #%lu (%lu bytes) - Total packets lost this session: %lu", seq, audio_len, packets_lost);
 
                         // CRITICAL FIX: Do NOT scale here - it blocks UDP receive and causes packet loss!
                         // Volume scaling is done in the playback task instead
@@ -113,23 +201,68 @@ static void udp_receive_task(void *pvParameters)
                         packets_lost = 0;
                     }
                     break;
+                }
                     
                 case UDP_MSG_STATE_IDLE:
-                    ESP_LOGI(TAG, "📡 Received: STATE_IDLE");
+                    DLOGI(TAG, "📡 Received: STATE_IDLE");
                     if (state_change_callback) {
                         state_change_callback(STATE_IDLE);
                     }
                     break;
                     
                 case UDP_MSG_STATE_AI_SPEAKING:
-                    ESP_LOGI(TAG, "📡 Received: STATE_AI_SPEAKING");
+                    DLOGI(TAG, "📡 Received: STATE_AI_SPEAKING");
                     if (state_change_callback) {
                         state_change_callback(STATE_AI_SPEAKING);
                     }
                     break;
                     
+                case UDP_MSG_TRACE_REQUEST:
+                    DLOGI(TAG, "📡 Received: TRACE_REQUEST");
+                    if (trace_dump_running) {
+                        DLOGW(TAG, "Trace dump already running");
+                        break;
+                    }
+                    trace_requester = source_addr;
+                    trace_dump_running = true;
+                    if (xTaskCreate(trace_dump_task, "trace_tx", 3072, NULL, 1, NULL) != pdPASS) {
+                        trace_dump_running = false;
+                        DLOGW(TAG, "Failed to create trace dump task");
+                    }
+                    break;
+
+                case UDP_MSG_STATS_REQUEST:
+                    telemetry_build_snapshot(&stats_snapshot);
+                    if (sendto(udp_socket, &stats_snapshot, sizeof(stats_snapshot), 0,
+                               (struct sockaddr *)&source_addr, sizeof(source_addr)) < 0) {
+                        DLOGW(TAG, "Failed to send stats: errno %d", errno);
+                    }
+                    break;
+
+                case UDP_MSG_PROBE_ECHO:
+                    link_probe_on_echo(rx_buffer, len, rx_time_us);
+                    break;
+
+                case UDP_MSG_TIME_RESPONSE:
+                    clock_sync_on_response(rx_buffer, len, rx_time_us);
+                    break;
+
+                case UDP_MSG_HELLO_REQUEST:
+                    DLOGI(TAG, "📡 Received: HELLO_REQUEST");
+                    udp_send_hello();
+                    break;
+
+                case UDP_MSG_PROBE_REQUEST:
+                    DLOGI(TAG, "📡 Received: PROBE_REQUEST");
+                    probe_requester = source_addr;
+                    probe_requested = true;
+                    if (link_probe_start() != ESP_OK) {
+                        DLOGW(TAG, "Link probe already running");
+                    }
+                    break;
+
                 default:
-                    ESP_LOGD(TAG, "Unknown message type: 0x%02x", msg_type);
+                    DLOGD(TAG, "Unknown message type: 0x%02x", msg_type);
                     break;
             }
         } else if (len < 0) {
@@ -143,6 +276,7 @@ static void udp_receive_task(void *pvParameters)
     }
     
     ESP_LOGI(TAG, "UDP receive task exiting");
+    telemetry_register_task(TELEMETRY_TASK_UDP_RX, NULL);
     vTaskDelete(NULL);
 }
 
@@ -200,46 +334,63 @@ esp_err_t udp_client_init(void)
     
     ESP_LOGI(TAG, "📡 Server: %s:%d", UDP_SERVER_IP, UDP_SERVER_PORT);
     
-    // Start receive task
+    // Start receive task (it registers itself with telemetry)
     xTaskCreate(udp_receive_task, "udp_rx", 4096, NULL, 5, NULL);
     
     is_initialized = true;
     ESP_LOGI(TAG, "✅ UDP client initialized");
+
+    // Introduce ourselves; the bridge asks again if it misses this
+    udp_send_hello();
     
     return ESP_OK;
 }
 
-esp_err_t udp_send_audio_packet(const uint8_t *audio_data, size_t audio_len, uint32_t sequence)
+esp_err_t udp_send_audio_packet(const uint8_t *audio_data, size_t audio_len, uint32_t sequence,
+                                int64_t capture_us)
 {
     if (!is_initialized || udp_socket < 0) {
         return ESP_ERR_INVALID_STATE;
     }
     
-    // Build packet: [sequence][audio_data]
-    size_t packet_size = sizeof(uint32_t) + audio_len;
+    // Build packet: [type][sequence][capture time, once synced][audio_data]
+    int64_t capture_bridge_us = capture_us > 0 ? clock_sync_to_bridge_us(capture_us) : 0;
+    size_t header_size = capture_bridge_us > 0 ? UDP_AUDIO_TS_HEADER_SIZE : UDP_AUDIO_HEADER_SIZE;
+    size_t packet_size = header_size + audio_len;
     uint8_t *packet = malloc(packet_size);
     if (!packet) {
         return ESP_ERR_NO_MEM;
     }
     
-    memcpy(packet, &sequence, sizeof(uint32_t));
-    memcpy(packet + sizeof(uint32_t), audio_data, audio_len);
+    if (capture_bridge_us > 0) {
+        packet[0] = UDP_MSG_AUDIO_DATA_TS;
+        memcpy(packet + 1, &sequence, sizeof(sequence));
+        memcpy(packet + UDP_AUDIO_HEADER_SIZE, &capture_bridge_us, sizeof(capture_bridge_us));
+        memcpy(packet + UDP_AUDIO_TS_HEADER_SIZE, audio_data, audio_len);
+    } else {
+        udp_packet_build_audio(packet, packet_size, UDP_MSG_AUDIO_DATA, audio_data, audio_len, sequence);
+    }
     
+    int64_t send_start_us = esp_timer_get_time();
     int sent = sendto(udp_socket, packet, packet_size, 0,
                      (struct sockaddr *)&server_addr, sizeof(server_addr));
+    telemetry_record_latency(TELEMETRY_HIST_UDP_SEND, (uint32_t)(esp_timer_get_time() - send_start_us));
     
     free(packet);
     
     if (sent < 0) {
-        ESP_LOGE(TAG, "sendto failed: errno %d", errno);
+        send_errors++;
+        DLOGE(TAG, "sendto failed: errno %d", errno);
         return ESP_FAIL;
     }
     
     packets_sent++;
+    bytes_sent += sent;
+    TRACE_EVENT(TRACE_EV_UDP_SEND, sent, sequence);
     
     // Log every 25 packets
     if (sequence % 25 == 0) {
-        ESP_LOGI(TAG, "📤 Sent packet #%lu (%d bytes)", sequence, sent);
+        DLOGI(TAG, "📤 Sent packet #%lu (%d bytes)", sequence, sent);
     }
     
     return ESP_OK;
@@ -257,11 +408,12 @@ esp_err_t udp_send_interrupt_signal(void)
                      (struct sockaddr *)&server_addr, sizeof(server_addr));
 
     if (sent < 0) {
-        ESP_LOGE(TAG, "Failed to send interrupt: errno %d", errno);
+        send_errors++;
+        DLOGE(TAG, "Failed to send interrupt: errno %d", errno);
         return ESP_FAIL;
     }
 
-    ESP_LOGI(TAG, "⚡ Sent interrupt signal to server");
+    DLOGI(TAG, "⚡ Sent interrupt signal to server");
     return ESP_OK;
 }
 
@@ -278,16 +430,156 @@ esp_err_t udp_send_playback_complete(void)
                      (struct sockaddr *)&server_addr, sizeof(server_addr));
 
     if (sent < 0) {
-        ESP_LOGE(TAG, "Failed to send playback complete: errno %d", errno);
+        send_errors++;
+        DLOGE(TAG, "Failed to send playback complete: errno %d", errno);
         return ESP_FAIL;
     }
 
-    ESP_LOGI(TAG, "✅ Sent playback complete signal to server");
+    DLOGI(TAG, "✅ Sent playback complete signal to server");
     return ESP_OK;
 }
 
 
 
+esp_err_t udp_send_mem_alert(uint32_t raised, uint32_t active)
+{
+    if (!is_initialized || udp_socket < 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t alert_msg[9];
+    alert_msg[0] = UDP_MSG_MEM_ALERT;
+    memcpy(&alert_msg[1], &raised, sizeof(raised));
+    memcpy(&alert_msg[5], &active, sizeof(active));
+
+    int sent = sendto(udp_socket, alert_msg, sizeof(alert_msg), 0,
+                     (struct sockaddr *)&server_addr, sizeof(server_addr));
+
+    if (sent < 0) {
+        send_errors++;
+        ESP_LOGE(TAG, "Failed to send memory alert: errno %d", errno);
+        return ESP_FAIL;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t udp_send_probe(const uint8_t *packet, size_t len)
+{
+    if (!is_initialized || udp_socket < 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int sent = sendto(udp_socket, packet, len, 0,
+                     (struct sockaddr *)&server_addr, sizeof(server_addr));
+
+    if (sent < 0) {
+        send_errors++;
+        return ESP_FAIL;
+    }
+
+    packets_sent++;
+    bytes_sent += sent;
+    return ESP_OK;
+}
+
+esp_err_t udp_send_time_request(void)
+{
+    if (!is_initialized || udp_socket < 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t request[CLOCK_SYNC_REQUEST_SIZE];
+    request[0] = UDP_MSG_TIME_REQUEST;
+    int64_t t1 = esp_timer_get_time();
+    memcpy(&request[1], &t1, sizeof(t1));
+
+    if (sendto(udp_socket, request, sizeof(request), 0,
+               (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+        send_errors++;
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t udp_send_hello(void)
+{
+    if (!is_initialized || udp_socket < 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t hello[UDP_HELLO_SIZE];
+    hello[0] = UDP_MSG_HELLO;
+    hello[1] = UDP_HELLO_VERSION;
+    if (esp_read_mac(&hello[2], ESP_MAC_WIFI_STA) != ESP_OK) {
+        memset(&hello[2], 0, 6);
+    }
+    uint16_t uplink_hz = AUDIO_SAMPLE_RATE_UPLINK;     // capture is decimated to this
+    uint16_t downlink_hz = AUDIO_SAMPLE_RATE_OUTPUT;
+    memcpy(&hello[8], &uplink_hz, sizeof(uplink_hz));
+    memcpy(&hello[10], &downlink_hz, sizeof(downlink_hz));
+
+    if (sendto(udp_socket, hello, sizeof(hello), 0,
+               (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+        send_errors++;
+        DLOGE(TAG, "Failed to send hello: errno %d", errno);
+        return ESP_FAIL;
+    }
+
+    // Followed by the link profile in use, if there is one yet
+    link_probe_report();
+    return ESP_OK;
+}
+
+esp_err_t udp_send_playback_started(uint32_t sequence, int64_t first_output_us)
+{
+    if (!is_initialized || udp_socket < 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Both times on the bridge clock, 0 while the clock is not synced
+    int64_t first_rx = first_play_rx_us ? clock_sync_to_bridge_us(first_play_rx_us) : 0;
+    int64_t first_output = clock_sync_to_bridge_us(first_output_us);
+    first_play_rx_us = 0;
+
+    uint8_t msg[21];
+    msg[0] = UDP_MSG_PLAYBACK_STARTED;
+    memcpy(&msg[1], &sequence, sizeof(sequence));
+    memcpy(&msg[5], &first_rx, sizeof(first_rx));
+    memcpy(&msg[13], &first_output, sizeof(first_output));
+
+    if (sendto(udp_socket, msg, sizeof(msg), 0,
+               (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+        send_errors++;
+        DLOGE(TAG, "Failed to send playback started: errno %d", errno);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t udp_send_probe_report(const uint8_t *report, size_t len)
+{
+    if (!is_initialized || udp_socket < 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int sent = sendto(udp_socket, report, len, 0,
+                     (struct sockaddr *)&server_addr, sizeof(server_addr));
+    if (probe_requested &&
+        (probe_requester.sin_addr.s_addr != server_addr.sin_addr.s_addr ||
+         probe_requester.sin_port != server_addr.sin_port)) {
+        sendto(udp_socket, report, len, 0, (struct sockaddr *)&probe_requester, sizeof(probe_requester));
+    }
+    probe_requested = false;
+
+    if (sent < 0) {
+        send_errors++;
+        ESP_LOGE(TAG, "Failed to send probe report: errno %d", errno);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
 void udp_register_state_callback(void (*callback)(voice_state_t state))
 {
     state_change_callback = callback;
@@ -309,6 +601,16 @@ uint32_t udp_get_packets_received(void)
     return packets_received;
 }
 
+void udp_get_stats(udp_stats_t *stats)
+{
+    stats->packets_sent = packets_sent;
+    stats->packets_received = packets_received;
+    stats->packets_lost = total_packets_lost;
+    stats->send_errors = send_errors;
+    stats->bytes_sent = bytes_sent;
+    stats->bytes_received = bytes_received;
+}
+
 void udp_client_deinit(void)
 {
     is_initialized = false;
@@ -6,14 +6,21 @@
 #include <stddef.h>
 #include <stdbool.h>
 
-// Server configuration
+// Server configuration (the host build supplies these at run time)
+#ifndef UDP_SERVER_IP
 #define UDP_SERVER_IP "put a ip"
+#endif
+#ifndef UDP_SERVER_PORT
 #define UDP_SERVER_PORT 8080
+#endif
+#ifndef UDP_LOCAL_PORT
 #define UDP_LOCAL_PORT 3333
+#endif
 
 // Message types for new architecture
 typedef enum {
     UDP_MSG_AUDIO_DATA = 0x10,      // Audio data from ESP32
+    UDP_MSG_AUDIO_DATA_TS = 0x11,   // Audio data with its capture time (clock synced)
     UDP_MSG_PLAY_AUDIO = 0x20,      // Audio to play
     UDP_MSG_PLAY_AUDIO_LAST = 0x21, // ADD THIS - Last audio chunk
     UDP_MSG_STATE_IDLE = 0x30,      // State: IDLE
@@ -21,6 +28,20 @@ typedef enum {
     UDP_MSG_STATE_AI_SPEAKING = 0x32,    // State: AI_SPEAKING
     UDP_MSG_INTERRUPT = 0x40,       // User interrupt signal
     UDP_MSG_PLAYBACK_COMPLETE = 0x50, // ADD THIS - Playback completed
+    UDP_MSG_PLAYBACK_STARTED = 0x51,  // [type][u32 seq][i64 first rx][i64 first output], bridge clock
+    UDP_MSG_TRACE_REQUEST = 0x60,   // Host asks for the trace rings (see trace.h)
+    UDP_MSG_TRACE_DATA = 0x61,      // One packet of trace events, sent to the requester
+    UDP_MSG_STATS_REQUEST = 0x70,   // Host asks for a telemetry snapshot
+    UDP_MSG_STATS_RESPONSE = 0x71,  // telemetry_snapshot_t, sent to the requester
+    UDP_MSG_MEM_ALERT = 0x72,       // [type][uint32 raised][uint32 active] mem_alert_t bits
+    UDP_MSG_PROBE = 0x80,           // Link probe, echoed by the bridge (see link_probe.h)
+    UDP_MSG_PROBE_ECHO = 0x81,      // Bridge echo of a probe with its receive time and count
+    UDP_MSG_PROBE_REPORT = 0x82,    // [type][link_profile_t], to the bridge and the requester
+    UDP_MSG_PROBE_REQUEST = 0x83,   // Host asks the device to run a link probe
+    UDP_MSG_TIME_REQUEST = 0x84,    // Clock sync request (see clock_sync.h)
+    UDP_MSG_TIME_RESPONSE = 0x85,   // Clock sync response from the bridge
+    UDP_MSG_HELLO = 0x90,           // Device handshake, see UDP_HELLO_SIZE
+    UDP_MSG_HELLO_REQUEST = 0x91,   // Bridge does not know this address: send HELLO again
     UDP_MSG_ERROR = 0xFF
 } udp_message_type_t;
 
@@ -34,14 +55,56 @@ typedef enum {
 // Maximum UDP payload size
 #define UDP_MAX_PAYLOAD 2000
 
+// Uplink audio packet: [UDP_MSG_AUDIO_DATA][uint32 sequence][PCM16 audio]
+#define UDP_AUDIO_HEADER_SIZE 5
+
+// Once the clock is synced: [UDP_MSG_AUDIO_DATA_TS][uint32 sequence][int64 capture_us][PCM16 audio],
+// capture_us being the first sample's capture time on the bridge clock
+#define UDP_AUDIO_TS_HEADER_SIZE 13
+
+// Handshake, sent at start-up and whenever the bridge asks:
+// [UDP_MSG_HELLO][u8 version][u8 mac[6]][u16 uplink Hz][u16 downlink Hz]
+// The WiFi STA MAC is the device id the bridge keys its sessions by.
+#define UDP_HELLO_VERSION 1
+#define UDP_HELLO_SIZE 12
+
+// Cumulative network counters (never reset while the client is up)
+typedef struct {
+    uint32_t packets_sent;
+    uint32_t packets_received;
+    uint32_t packets_lost;      // downlink audio sequence gaps
+    uint32_t send_errors;
+    uint32_t bytes_sent;
+    uint32_t bytes_received;
+} udp_stats_t;
+
 // Function prototypes
 esp_err_t udp_client_init(void);
-esp_err_t udp_send_audio_packet(const uint8_t *audio_data, size_t audio_len, uint32_t sequence);
+// Audio packet framing: [type][uint32 LE sequence][PCM16]
+// Build returns the packet size, or 0 if out_size is too small
+size_t udp_packet_build_audio(uint8_t *out, size_t out_size, uint8_t msg_type,
+                              const uint8_t *audio, size_t audio_len, uint32_t sequence);
+// Parse returns false for a packet shorter than the header
+bool udp_packet_parse_audio(const uint8_t *packet, size_t len, uint32_t *sequence,
+                            const uint8_t **audio, size_t *audio_len);
+
+// capture_us: esp_timer time of the first sample (0 if unknown)
+esp_err_t udp_send_audio_packet(const uint8_t *audio_data, size_t audio_len, uint32_t sequence,
+                                int64_t capture_us);
 esp_err_t udp_send_interrupt_signal(void);
 esp_err_t udp_send_playback_complete(void);
+esp_err_t udp_send_mem_alert(uint32_t raised, uint32_t active);
+esp_err_t udp_send_probe(const uint8_t *packet, size_t len);
+esp_err_t udp_send_time_request(void);
+esp_err_t udp_send_hello(void);
+// First chunk of a response entered the TX DMA at first_output_us (esp_timer)
+esp_err_t udp_send_playback_started(uint32_t sequence, int64_t first_output_us);
+// To the bridge, and to whoever sent the last UDP_MSG_PROBE_REQUEST
+esp_err_t udp_send_probe_report(const uint8_t *report, size_t len);
 bool udp_client_is_ready(void);
 uint32_t udp_get_packets_sent(void);
 uint32_t udp_get_packets_received(void);
+void udp_get_stats(udp_stats_t *stats);
 void udp_client_deinit(void);
 void udp_register_state_callback(void (*callback)(voice_state_t state));
 
@@ -0,0 +1,791 @@
+// One device's conversation: its own OpenAI Realtime session, uplink
+// batcher, downlink rechunker (sequence space and pacing), playback timeout,
+// telemetry and latency stats. realtime_bridge.js keeps the table of these,
+// keyed by the device id from the HELLO handshake (the WiFi STA MAC).
+//
+// Upstream sessions come configured from upstream_pool.js. When one drops,
+// the session takes the next one straight away; uplink audio in between is
+// held (up to MAX_FAILOVER_BYTES) and appended to the new session, so the
+// device's words are not lost, only the conversation history is.
+const { performance } = require('perf_hooks');
+const WebSocket = require('ws');
+const {
+    UDP_AUDIO_HEADER_SIZE,
+    UDP_AUDIO_TS_HEADER_SIZE,
+    UDP_HELLO_SIZE,
+    UDP_MSG_AUDIO_DATA,
+    UDP_MSG_AUDIO_DATA_TS,
+    UDP_MSG_PLAY_AUDIO,
+    UDP_MSG_PLAY_AUDIO_LAST,
+    UDP_MSG_STATE_IDLE,
+    UDP_MSG_STATE_AI_SPEAKING,
+    UDP_MSG_INTERRUPT,
+    UDP_MSG_PLAYBACK_COMPLETE,
+    UDP_MSG_PLAYBACK_STARTED,
+    UDP_MSG_STATS_RESPONSE,
+    UDP_MSG_MEM_ALERT,
+    UDP_MSG_PROBE_REPORT,
+    UDP_MSG_HELLO
+} = require('./protocol');
+const { buildStatsRequest, parseStatsSnapshot, parseMemAlert, formatSnapshot } = require('./telemetry');
+const { AudioRechunker } = require('./rechunker');
+const { LAG_EDGES_MS } = require('./metrics');
+const { UplinkBatcher } = require('./uplink');
+const { UplinkReorder } = require('./uplink_reorder');
+const { PolyphaseResampler } = require('./resampler');
+const { Endpointer, EndpointComparison } = require('./endpointer');
+const { parseProbeReport, formatProbeReport } = require('./link_probe');
+const { normalizeText } = require('./response_cache');
+const { REC_UDP_OUT, REC_WS_IN, REC_WS_OUT, SessionRecorder } = require('./session_recorder');
+const {
+    LatencyHistogram,
+    bridgeClockUs,
+    parsePlaybackStarted,
+    TurnLatency,
+    formatWaterfall,
+    formatSummary
+} = require('./latency');
+
+// PCM16 mono at 24 kHz: downlink chunks are paced at their playback duration
+const PCM_BYTES_PER_MS = 48;
+const UPLINK_RATE = 24000;          // what the Realtime session is configured for
+const MIN_UPLINK_RATE = 8000;       // HELLO uplink rates the resampler takes
+const MAX_UPLINK_RATE = 48000;
+const MAX_AUDIO_SIZE = 1440;        // largest PLAY_AUDIO payload the device accepts
+const LATENCY_SUMMARY_EVERY = 10;   // turns between percentile summaries
+const MAX_FAILOVER_BYTES = 5000 * PCM_BYTES_PER_MS;   // uplink held while no upstream session is open
+const PLAYBACK_TIMEOUT_MS = 180000; // fallback IDLE if PLAYBACK_COMPLETE never comes
+const COMMIT_MESSAGE = JSON.stringify({ type: 'input_audio_buffer.commit' });
+const RESPONSE_CREATE_MESSAGE = JSON.stringify({ type: 'response.create' });
+const RESPONSE_CANCEL_MESSAGE = JSON.stringify({ type: 'response.cancel' });
+
+const sleep = (ms) => new Promise((resolve) => setTimeout(resolve, ms));
+
+// UDP_MSG_HELLO [type][u8 version][u8 mac[6]][u16 uplink Hz][u16 downlink Hz]; null if malformed
+function parseHello(msg) {
+    if (msg.length < UDP_HELLO_SIZE || msg[0] !== UDP_MSG_HELLO) return null;
+    const mac = Array.from(msg.subarray(2, 8), (b) => b.toString(16).padStart(2, '0')).join(':');
+    return {
+        version: msg[1],
+        id: mac,
+        uplinkHz: msg.readUInt16LE(8),
+        downlinkHz: msg.readUInt16LE(10)
+    };
+}
+
+class DeviceSession {
+    // ctx: { udpServer, encodePool, upstreamPool, uplinkBatchMs, uplinkReorderMs, recordDir, paceSpeed,
+    //        endpointing, endpointSilenceMs, responseCache }
+    constructor(hello, rinfo, key, ctx) {
+        this.id = hello.id;
+        this.hello = hello;
+        this.address = rinfo.address;
+        this.port = rinfo.port;
+        this.ctx = ctx;
+        this.tag = `[${this.id}]`;
+
+        this.openaiWs = null;
+        this.closed = false;
+        this.acquiring = false;
+        this.upstreamBytes = 0;         // PCM appended to (or given up for) the current upstream session
+        this.failoverFrames = [];       // { frame, bytes } waiting for an upstream session
+        this.failoverBytes = 0;
+        this.failoverDropped = 0;
+        this.upstreamSessions = 0;
+
+        // Downlink
+        this.rechunker = new AudioRechunker(MAX_AUDIO_SIZE);
+        this.deltaCount = 0;
+        this.isFirstChunk = true;
+        this.pumping = false;           // one pacer per session
+        this.audioDone = false;         // response.audio.done arrived while pacing
+        this.audioGeneration = 0;       // bumped on reset, stops a running pacer
+        this.nextSendMs = 0;            // pacer schedule (performance.now())
+        this.pacingLag = new LatencyHistogram(LAG_EDGES_MS);
+        this.playbackTimeout = null;
+
+        // Uplink
+        // Sessions take 24 kHz; a device sending less is resampled after reordering
+        let uplinkHz = hello.uplinkHz;
+        if (uplinkHz < MIN_UPLINK_RATE || uplinkHz > MAX_UPLINK_RATE) {
+            console.warn(`⚠️ ${this.tag} HELLO uplink rate ${uplinkHz} Hz not supported, assuming ${UPLINK_RATE}`);
+            uplinkHz = UPLINK_RATE;
+        }
+        this.uplinkResampler = uplinkHz !== UPLINK_RATE ? new PolyphaseResampler(uplinkHz, UPLINK_RATE) : null;
+        this.uplinkReorder = new UplinkReorder((pcm, captureUs, recvUs, concealed) => {
+            if (this.uplinkResampler) pcm = this.uplinkResampler.process(pcm);
+            this.uplinkBatcher.push(pcm);
+            this.turnLatency.onUplinkAudio(captureUs, pcm.length, recvUs, concealed);
+            if (this.endpointer) this.endpointer.push(pcm);
+        }, { windowMs: ctx.uplinkReorderMs, sampleRate: uplinkHz });
+        this.uplinkBatcher = new UplinkBatcher((frame, bytes) => this.sendUplink(frame, bytes),
+                                               { batchMs: ctx.uplinkBatchMs, pool: ctx.encodePool, key });
+
+        // Local endpointing (endpointer.js), on the audio as appended upstream
+        this.endpointer = ctx.endpointing !== 'off' ?
+            new Endpointer((trailingMs) => this.onLocalEndpoint(trailingMs), { silenceMs: ctx.endpointSilenceMs }) : null;
+        this.endpointComparison = ctx.endpointing === 'shadow' ? new EndpointComparison() : null;
+        this.responseRequested = false;     // ENDPOINTING=on: response.create sent, response not done
+        this.localCommits = 0;
+
+        // Response cache (response_cache.js): the current turn's prompt and
+        // upstream response, and whether its answer came from the cache
+        this.cacheTurn = null;
+        this.upstreamResponding = false;    // response.created seen, not yet done or cancelled
+        this.suppressUpstream = false;      // cache hit: cancel and drop this turn's upstream response
+        this.responseItems = [];            // output items of the running upstream response
+        this.cachedAnswer = null;           // transcript of a hit, added upstream once no response runs
+
+        this.turnLatency = new TurnLatency();
+        this.deviceStats = null;
+        this.linkProfile = null;
+
+        this.packetsReceived = 0;
+        this.packetsSent = 0;
+        this.lastSeenMs = Date.now();
+
+        // Optional binary recording of this session (session_recorder.js)
+        this.recorder = ctx.recordDir ? new SessionRecorder(ctx.recordDir, this.id) : null;
+    }
+
+    record(kind, payload) {
+        if (this.recorder) this.recorder.record(kind, payload);
+    }
+
+    get addressKey() {
+        return `${this.address}:${this.port}`;
+    }
+
+    send(packet, what) {
+        this.record(REC_UDP_OUT, packet);
+        this.ctx.udpServer.send(packet, this.port, this.address, (err) => {
+            if (err) {
+                console.error(`❌ ${this.tag} Failed to send ${what}: ${err.message}`);
+            }
+        });
+    }
+
+    // Helper: Send state message to ESP32
+    sendState(state) {
+        const packet = Buffer.alloc(1);
+        packet[0] = state;
+        this.send(packet, 'state');
+
+        const stateName = state === UDP_MSG_STATE_IDLE ? 'IDLE' :
+                         state === UDP_MSG_STATE_AI_SPEAKING ? 'AI_SPEAKING' : 'UNKNOWN';
+        console.log(`📡 ${this.tag} Sent state to ESP32: ${stateName}`);
+    }
+
+    // Helper: Send audio chunk to ESP32
+    sendAudioChunk(audioBuffer, isLast = false) {
+        if (audioBuffer.length > MAX_AUDIO_SIZE) {
+            console.warn(`⚠️ ${this.tag} Chunk oversized (${audioBuffer.length} bytes), truncating to ${MAX_AUDIO_SIZE}`);
+            audioBuffer = audioBuffer.subarray(0, MAX_AUDIO_SIZE);
+        }
+
+        const packet = Buffer.alloc(5 + audioBuffer.length);
+        packet[0] = isLast ? UDP_MSG_PLAY_AUDIO_LAST : UDP_MSG_PLAY_AUDIO;
+
+        const currentSeq = this.rechunker.sequence++;
+        packet.writeUInt32LE(currentSeq, 1);
+        if (currentSeq === 0) {
+            this.turnLatency.onFirstSend();
+            this.noteFirstAudio();
+        }
+        audioBuffer.copy(packet, 5);
+
+        this.record(REC_UDP_OUT, packet);
+        this.ctx.udpServer.send(packet, this.port, this.address, (err) => {
+            if (err) {
+                console.error(`❌ ${this.tag} Failed to send chunk #${currentSeq}: ${err.message}`);
+            } else {
+                this.packetsSent++;
+                if (currentSeq % 10 === 0 || isLast) {
+                    console.log(`📤 ${this.tag} Sent chunk #${currentSeq} to ESP32 (${audioBuffer.length} bytes)${isLast ? ' [LAST]' : ''}`);
+                }
+            }
+        });
+    }
+
+    // Send the available chunks at their playback rate. Only one pacer runs
+    // per session; deltas that arrive meanwhile are picked up by the running
+    // one. Send times follow an absolute schedule, so timer lateness under
+    // load does not add up over a long response.
+    async blastAvailableChunks() {
+        if (this.pumping) return;
+        this.pumping = true;
+        const generation = this.audioGeneration;
+        const startSeq = this.rechunker.sequence;
+        let chunksSent = 0;
+        let sendAt = Math.max(this.nextSendMs, performance.now());
+
+        while (this.rechunker.length >= this.rechunker.chunkSize) {
+            this.sendAudioChunk(this.rechunker.getChunk(), false);
+            chunksSent++;
+            sendAt += this.rechunker.chunkSize / PCM_BYTES_PER_MS / this.ctx.paceSpeed;
+            this.nextSendMs = sendAt;
+            await sleep(Math.max(0, sendAt - performance.now()));
+            this.pacingLag.add(Math.max(0, performance.now() - sendAt));
+            if (generation !== this.audioGeneration) return;    // interrupted; state already reset
+        }
+        this.pumping = false;
+
+        if (chunksSent > 0) {
+            console.log(`⚡ ${this.tag} BLASTED ${chunksSent} chunks (#${startSeq}-#${this.rechunker.sequence - 1})`);
+        }
+        if (this.audioDone) {
+            this.audioDone = false;
+            this.finishAudioStream();
+        }
+    }
+
+    // Handle audio completion - send any remaining partial chunk
+    async finishAudioStream() {
+        if (this.pumping) {
+            // The pacer sends the rest first, then comes back here
+            this.audioDone = true;
+            return;
+        }
+        console.log(`🎵 ${this.tag} Audio response completed`);
+        const generation = this.audioGeneration;
+
+        const remainingChunks = this.rechunker.flush();
+        if (remainingChunks.length > 0) {
+            for (let i = 0; i < remainingChunks.length; i++) {
+                const isLast = (i === remainingChunks.length - 1);
+                this.sendAudioChunk(remainingChunks[i], isLast);
+                if (!isLast) {
+                    await sleep(5);
+                    if (generation !== this.audioGeneration) return;
+                }
+            }
+        } else {
+            // ESP32 rejects empty packets: send 8 samples of silence as the LAST packet
+            this.sendAudioChunk(Buffer.alloc(16, 0), true);
+        }
+
+        console.log(`⏳ ${this.tag} Waiting for ESP32 playback complete...`);
+        this.clearPlaybackTimeout();
+        this.playbackTimeout = setTimeout(() => {
+            this.playbackTimeout = null;
+            console.log(`⏰ ${this.tag} Timeout (3min) - sending IDLE`);
+            this.sendState(UDP_MSG_STATE_IDLE);
+            this.resetAudio();
+        }, PLAYBACK_TIMEOUT_MS);
+    }
+
+    clearPlaybackTimeout() {
+        if (this.playbackTimeout) {
+            clearTimeout(this.playbackTimeout);
+            this.playbackTimeout = null;
+        }
+    }
+
+    // New response, interrupt or timeout: drop queued downlink audio
+    resetAudio() {
+        this.rechunker.reset();
+        this.isFirstChunk = true;
+        this.deltaCount = 0;
+        this.pumping = false;
+        this.audioDone = false;
+        this.audioGeneration++;
+        this.nextSendMs = 0;
+    }
+
+    // Append to the upstream input buffer, or hold it until there is one
+    sendUplink(frame, bytes) {
+        if (this.openaiWs && this.openaiWs.readyState === WebSocket.OPEN) {
+            this.sendUpstream(frame);
+            this.upstreamBytes += bytes;
+            return;
+        }
+        this.failoverFrames.push({ frame, bytes });
+        this.failoverBytes += bytes;
+        while (this.failoverBytes > MAX_FAILOVER_BYTES) {
+            // Oldest first; it will never reach an upstream session
+            const dropped = this.failoverFrames.shift();
+            this.failoverBytes -= dropped.bytes;
+            this.upstreamBytes += dropped.bytes;
+            this.failoverDropped += dropped.bytes;
+        }
+    }
+
+    sendUpstream(message) {
+        this.record(REC_WS_OUT, message);
+        this.openaiWs.send(message, { binary: false });
+    }
+
+    acquireUpstream() {
+        if (this.closed || this.acquiring) return;
+        this.acquiring = true;
+        this.ctx.upstreamPool.acquire().then(({ ws, acquireMs, warm }) => {
+            this.acquiring = false;
+            if (this.closed) {
+                ws.close();
+                return;
+            }
+            console.log(`🔗 ${this.tag} Upstream session ready in ${acquireMs.toFixed(1)} ms (${warm ? 'warm' : 'waited'})`);
+            if (this.recorder) this.recorder.event({ event: 'upstream', acquireMs: +acquireMs.toFixed(1), warm });
+            this.attachUpstream(ws);
+        });
+    }
+
+    attachUpstream(ws) {
+        this.openaiWs = ws;
+        this.upstreamSessions++;
+
+        ws.on('message', (data) => {
+            this.record(REC_WS_IN, data);
+            this.handleOpenAIMessage(data);
+        });
+
+        ws.on('close', (code, reason) => {
+            if (this.openaiWs !== ws) return;
+            this.openaiWs = null;
+            if (this.closed) return;
+            console.log(`❌ ${this.tag} OpenAI connection closed: ${code} ${reason}, failing over`);
+            if (this.recorder) this.recorder.event({ event: 'upstream_closed', code });
+            // A response cut off mid-stream never gets response.audio.done
+            if (!this.isFirstChunk && !this.audioDone && !this.playbackTimeout) this.finishAudioStream();
+            this.acquireUpstream();
+        });
+
+        ws.on('error', (error) => {
+            console.error(`❌ ${this.tag} OpenAI WebSocket error:`, error.message);
+        });
+
+        // audio_end_ms in this session counts from the first audio it gets
+        this.turnLatency.rebase(this.upstreamBytes / PCM_BYTES_PER_MS);
+        if (this.endpointComparison) this.endpointComparison.reset();
+        this.responseRequested = false;
+        this.upstreamResponding = false;
+        this.suppressUpstream = false;
+        this.responseItems = [];
+        this.cachedAnswer = null;
+        this.cacheTurn = null;
+        this.upstreamBytes = 0;
+
+        const held = this.failoverFrames;
+        if (held.length > 0) {
+            console.log(`🔁 ${this.tag} Replaying ${Math.round(this.failoverBytes / PCM_BYTES_PER_MS)} ms of held uplink audio` +
+                        (this.failoverDropped > 0 ? ` (${Math.round(this.failoverDropped / PCM_BYTES_PER_MS)} ms dropped)` : ''));
+        }
+        this.failoverFrames = [];
+        this.failoverBytes = 0;
+        this.failoverDropped = 0;
+        for (const { frame, bytes } of held) this.sendUplink(frame, bytes);
+        console.log(`🎤 ${this.tag} Ready to receive audio from ESP32\n`);
+    }
+
+    handleOpenAIMessage(data) {
+        try {
+            const message = JSON.parse(data.toString());
+
+            switch (message.type) {
+                case 'input_audio_buffer.speech_started':
+                    console.log(`🎙️ ${this.tag} OpenAI VAD: Speech detected`);
+                    break;
+
+                case 'input_audio_buffer.speech_stopped':
+                    console.log(`🤐 ${this.tag} OpenAI VAD: Speech ended (auto-committing)`);
+                    if (this.endpointComparison) {
+                        this.logEndpointMatch(this.endpointComparison.onServer(message.audio_end_ms));
+                    }
+                    this.turnLatency.onSpeechStopped(message.audio_end_ms);
+                    this.startCacheTurn();
+                    break;
+
+                case 'input_audio_buffer.committed':
+                    console.log(`✅ ${this.tag} Audio buffer committed by ${this.ctx.endpointing === 'on' ? 'local endpoint' : 'VAD'}`);
+                    if (this.cacheTurn && !this.cacheTurn.itemId) this.cacheTurn.itemId = message.item_id;
+                    break;
+
+                case 'conversation.item.created':
+                    console.log(`📝 ${this.tag} Conversation item created`);
+                    break;
+
+                case 'response.created':
+                    this.upstreamResponding = true;
+                    this.responseItems = [];
+                    if (this.suppressUpstream) {
+                        // Answered from the cache already
+                        this.sendUpstream(RESPONSE_CANCEL_MESSAGE);
+                        break;
+                    }
+                    console.log(`🤖 ${this.tag} Response generation started`);
+                    this.resetAudio();
+                    if (this.cacheTurn) {
+                        this.cacheTurn.pcm = [];
+                        this.cacheTurn.bytes = 0;
+                    }
+                    break;
+
+                case 'response.output_item.added':
+                    if (message.item && message.item.id) this.responseItems.push(message.item.id);
+                    if (this.suppressUpstream) break;
+                    console.log(`📝 ${this.tag} Output item added to response`);
+                    break;
+
+                case 'response.audio.delta':
+                    if (message.delta && !this.suppressUpstream) {
+                        const audioBuffer = Buffer.from(message.delta, 'base64');
+                        if (this.cacheTurn) {
+                            this.cacheTurn.audioStarted = true;
+                            this.cacheTurn.pcm.push(audioBuffer);
+                            this.cacheTurn.bytes += audioBuffer.length;
+                        }
+
+                        if (++this.deltaCount % 5 === 0) {
+                            console.log(`📥 ${this.tag} OpenAI delta #${this.deltaCount}: ${audioBuffer.length} bytes`);
+                        }
+
+                        this.rechunker.addData(audioBuffer);
+
+                        // Send AI_SPEAKING state on first chunk
+                        if (this.isFirstChunk) {
+                            console.log(`🔊 ${this.tag} First audio delta - starting stream`);
+                            this.turnLatency.onFirstDelta();
+                            this.sendState(UDP_MSG_STATE_AI_SPEAKING);
+                            this.isFirstChunk = false;
+                        }
+
+                        this.blastAvailableChunks();
+                    }
+                    break;
+
+                case 'response.audio.done':
+                    if (!this.suppressUpstream) this.finishAudioStream();
+                    break;
+
+                case 'response.audio_transcript.delta':
+                    break;
+
+                case 'response.audio_transcript.done':
+                    if (message.transcript && !this.suppressUpstream) {
+                        console.log(`🤖 ${this.tag} Teddy said: "${message.transcript}"`);
+                        if (this.cacheTurn) this.cacheTurn.responseText = message.transcript;
+                    }
+                    break;
+
+                case 'response.content_part.done':
+                    console.log(`✅ ${this.tag} Content part complete`);
+                    break;
+
+                case 'response.output_item.done':
+                    console.log(`✅ ${this.tag} Output item complete`);
+                    break;
+
+                case 'response.done':
+                    console.log(`✅ ${this.tag} Response fully complete`);
+                    this.responseRequested = false;
+                    this.upstreamResponding = false;
+                    if (this.suppressUpstream) {
+                        this.suppressUpstream = false;
+                        this.replaceSuppressedResponse();
+                    } else if (this.cacheTurn && message.response && message.response.status === 'completed') {
+                        this.cacheTurn.completed = true;
+                        this.storeCacheTurn();
+                    }
+                    break;
+
+                case 'response.cancelled':
+                    this.responseRequested = false;
+                    this.upstreamResponding = false;
+                    if (this.suppressUpstream) {
+                        // Our own cancel after a cache hit; the cached answer keeps playing
+                        this.suppressUpstream = false;
+                        this.replaceSuppressedResponse();
+                        break;
+                    }
+                    console.log(`⚠️ ${this.tag} Response interrupted by user`);
+                    this.stopAudioPipeline();
+                    break;
+
+                case 'conversation.item.input_audio_transcription.completed':
+                    if (message.transcript) {
+                        console.log(`📝 ${this.tag} User said: "${message.transcript}"`);
+                        this.onInputTranscript(message.item_id, message.transcript);
+                    }
+                    break;
+
+                case 'error':
+                    console.error(`❌ ${this.tag} OpenAI error:`, JSON.stringify(message.error, null, 2));
+                    break;
+
+                default:
+                    break;
+            }
+        } catch (error) {
+            console.error(`${this.tag} Error processing OpenAI message:`, error);
+        }
+    }
+
+    // Endpointer callback: speech ended trailingMs ago in the appended audio
+    onLocalEndpoint(trailingMs) {
+        const audioEndMs = this.turnLatency.positionMs - trailingMs;
+        if (this.endpointComparison) {
+            this.logEndpointMatch(this.endpointComparison.onLocal(audioEndMs));
+            return;
+        }
+
+        // ENDPOINTING=on: commit the turn behind the audio already pushed and ask
+        // for its response; a response still running for the last turn is replaced
+        console.log(`🎯 ${this.tag} Local endpoint: speech ended ${trailingMs.toFixed(0)} ms ago, committing turn`);
+        if (this.responseRequested) this.uplinkBatcher.sendAfter(RESPONSE_CANCEL_MESSAGE);
+        this.uplinkBatcher.sendAfter(COMMIT_MESSAGE);
+        this.uplinkBatcher.sendAfter(RESPONSE_CREATE_MESSAGE);
+        this.responseRequested = true;
+        this.localCommits++;
+        this.turnLatency.onSpeechStopped(audioEndMs);
+        this.startCacheTurn();
+    }
+
+    // A turn was committed: its prompt and answer are collected for the cache
+    startCacheTurn() {
+        if (!this.ctx.responseCache) return;
+        this.suppressUpstream = false;
+        this.cacheTurn = {
+            itemId: null,
+            prompt: null,
+            responseText: null,
+            pcm: [],
+            bytes: 0,
+            audioStarted: false,    // upstream audio already on its way to the device
+            completed: false,
+            hit: false,             // answered from the cache
+            stored: false,
+            committedUs: bridgeClockUs(),
+            firstAudioNoted: false
+        };
+    }
+
+    // The user's words: the cache key. A hit only helps while the upstream
+    // answer has not started playing.
+    onInputTranscript(itemId, transcript) {
+        const turn = this.cacheTurn;
+        const cache = this.ctx.responseCache;
+        if (!turn || turn.prompt !== null || (turn.itemId && itemId && itemId !== turn.itemId)) return;
+        turn.prompt = transcript;
+        if (turn.audioStarted) {
+            cache.late++;
+        } else {
+            const hit = cache.lookup(transcript);
+            if (hit) this.playCached(hit);
+        }
+        this.storeCacheTurn();
+    }
+
+    // Cache hit: the stored answer goes through the usual rechunker and
+    // pacer; the upstream response for this turn is cancelled and dropped,
+    // and the cached answer takes its place in the upstream conversation
+    playCached({ pcm, text }) {
+        console.log(`💾 ${this.tag} Response cache hit for "${normalizeText(this.cacheTurn.prompt)}": ` +
+                    `${Math.round(pcm.length / PCM_BYTES_PER_MS)} ms of audio`);
+        if (this.recorder) this.recorder.event({ event: 'cache_hit', bytes: pcm.length });
+        this.suppressUpstream = true;
+        this.cachedAnswer = text;
+        if (!this.upstreamResponding) {
+            // A response still to come is cancelled (and its items deleted) when it is created
+            this.addCachedAnswer();
+        } else if (this.openaiWs && this.openaiWs.readyState === WebSocket.OPEN) {
+            this.sendUpstream(RESPONSE_CANCEL_MESSAGE);
+        }
+        this.cacheTurn.hit = true;
+        this.resetAudio();
+        this.rechunker.addData(pcm);
+        this.turnLatency.onFirstDelta();
+        this.sendState(UDP_MSG_STATE_AI_SPEAKING);
+        this.isFirstChunk = false;
+        this.blastAvailableChunks();
+        this.finishAudioStream();
+    }
+
+    // The cancelled response's partial answer out of the upstream conversation,
+    // the cached one in, so the model's context holds what the user heard
+    replaceSuppressedResponse() {
+        if (!this.openaiWs || this.openaiWs.readyState !== WebSocket.OPEN) return;
+        for (const itemId of this.responseItems) {
+            this.sendUpstream(JSON.stringify({ type: 'conversation.item.delete', item_id: itemId }));
+        }
+        this.responseItems = [];
+        this.addCachedAnswer();
+    }
+
+    addCachedAnswer() {
+        if (!this.cachedAnswer || !this.openaiWs || this.openaiWs.readyState !== WebSocket.OPEN) return;
+        this.sendUpstream(JSON.stringify({
+            type: 'conversation.item.create',
+            item: { type: 'message', role: 'assistant', content: [{ type: 'text', text: this.cachedAnswer }] }
+        }));
+        console.log(`💾 ${this.tag} Cached answer added to the upstream conversation`);
+        this.cachedAnswer = null;
+    }
+
+    // Completed upstream turn with both transcripts: teach the cache
+    storeCacheTurn() {
+        const turn = this.cacheTurn;
+        if (!turn || turn.hit || turn.stored || !turn.completed || turn.prompt === null || !turn.responseText || turn.bytes === 0) return;
+        this.ctx.responseCache.record(turn.prompt, turn.responseText, Buffer.concat(turn.pcm, turn.bytes));
+        turn.pcm = [];
+        turn.bytes = 0;
+        turn.stored = true;
+    }
+
+    // First PLAY_AUDIO of a turn: time from commit, by cache outcome
+    noteFirstAudio() {
+        const turn = this.cacheTurn;
+        if (!turn || turn.firstAudioNoted) return;
+        turn.firstAudioNoted = true;
+        const histograms = this.ctx.responseCache.firstAudio;
+        (turn.hit ? histograms.hit : histograms.miss).add((bridgeClockUs() - turn.committedUs) / 1000);
+    }
+
+    // ENDPOINTING=shadow: a local endpoint matched (or not) with the server VAD's
+    logEndpointMatch(match) {
+        if (!match) return;
+        switch (match.result) {
+            case 'agreed':
+                console.log(`🎯 ${this.tag} Local endpoint ${match.ms.toFixed(0)} ms ahead of server VAD`);
+                break;
+            case 'late':
+                console.log(`🎯 ${this.tag} Local endpoint ${match.ms.toFixed(0)} ms behind server VAD`);
+                break;
+            case 'spurious':
+                console.log(`🎯 ${this.tag} Local endpoint spurious: speech went on ${match.ms.toFixed(0)} ms`);
+                break;
+        }
+    }
+
+    // Stop pipeline (used for interrupts)
+    stopAudioPipeline() {
+        console.log(`🛑 ${this.tag} Stopping audio pipeline (interrupted)`);
+        this.resetAudio();
+    }
+
+    handleInterrupt() {
+        console.log(`⚡ ${this.tag} INTERRUPT received from ESP32`);
+        this.stopAudioPipeline();
+        this.uplinkReorder.reset();
+        if (this.uplinkResampler) this.uplinkResampler.reset();
+        if (this.endpointer) this.endpointer.reset();
+        if (this.endpointComparison) this.endpointComparison.reset();
+        this.responseRequested = false;
+        this.cacheTurn = null;
+        this.uplinkBatcher.clear();
+        this.upstreamBytes += this.failoverBytes;
+        this.failoverFrames = [];
+        this.failoverBytes = 0;
+
+        if (this.openaiWs && this.openaiWs.readyState === WebSocket.OPEN) {
+            this.sendUpstream(JSON.stringify({ type: 'response.cancel' }));
+            this.sendUpstream(JSON.stringify({ type: 'input_audio_buffer.clear' }));
+            console.log(`📡 ${this.tag} Sent cancel & clear to OpenAI`);
+        }
+    }
+
+    // Everything the device sends except the stateless requests the bridge answers itself
+    handleDatagram(msg, recvUs) {
+        this.packetsReceived++;
+        this.lastSeenMs = Date.now();
+
+        switch (msg[0]) {
+            case UDP_MSG_INTERRUPT:
+                this.handleInterrupt();
+                return;
+
+            case UDP_MSG_PLAYBACK_COMPLETE:
+                console.log(`✅ ${this.tag} Received PLAYBACK_COMPLETE from ESP32`);
+                this.clearPlaybackTimeout();
+                this.sendState(UDP_MSG_STATE_IDLE);
+                return;
+
+            case UDP_MSG_PLAYBACK_STARTED: {
+                const result = this.turnLatency.onPlaybackStarted(parsePlaybackStarted(msg));
+                if (result) {
+                    console.log(`${this.tag} ${formatWaterfall(result, this.turnLatency.turns)}`);
+                    if (this.turnLatency.turns % LATENCY_SUMMARY_EVERY === 0) {
+                        console.log(`${this.tag} ${formatSummary(this.turnLatency.summary())}`);
+                    }
+                }
+                return;
+            }
+
+            case UDP_MSG_STATS_RESPONSE:
+                this.deviceStats = parseStatsSnapshot(msg);
+                if (this.deviceStats) {
+                    console.log(`📊 ${this.tag} Device: ${formatSnapshot(this.deviceStats)}`);
+                }
+                return;
+
+            case UDP_MSG_MEM_ALERT: {
+                const alert = parseMemAlert(msg);
+                if (alert) {
+                    console.warn(`⚠️ ${this.tag} Device memory alert: ${alert.raisedNames.join(', ')} ` +
+                                 `(active: ${alert.activeNames.join(', ') || 'none'})`);
+                    // Pull a full snapshot so the heap/stack numbers land in the log
+                    this.send(buildStatsRequest(), 'stats request');
+                }
+                return;
+            }
+
+            case UDP_MSG_PROBE_REPORT: {
+                const report = parseProbeReport(msg);
+                if (!report) return;
+                this.linkProfile = report;
+                console.log(`📶 ${this.tag} Link probe: ${formatProbeReport(report)}`);
+                // Downlink frame size recommended for this link (whole samples, at most what the device accepts)
+                const frameBytes = report.frameBytes & ~1;
+                if (frameBytes > 0 && frameBytes <= MAX_AUDIO_SIZE && frameBytes !== this.rechunker.chunkSize) {
+                    this.rechunker.chunkSize = frameBytes;
+                    console.log(`📶 ${this.tag} Downlink frames now ${frameBytes} bytes`);
+                }
+                return;
+            }
+
+            case UDP_MSG_AUDIO_DATA:
+            case UDP_MSG_AUDIO_DATA_TS:
+                break;
+
+            default:
+                return;
+        }
+
+        // Audio packet: [type][4-byte sequence][8-byte capture time, 0x11 only][audio data]
+        const headerSize = msg[0] === UDP_MSG_AUDIO_DATA_TS ? UDP_AUDIO_TS_HEADER_SIZE : UDP_AUDIO_HEADER_SIZE;
+        if (msg.length < headerSize) return;
+        const sequence = msg.readUInt32LE(1);
+        const captureUs = headerSize === UDP_AUDIO_TS_HEADER_SIZE ? Number(msg.readBigInt64LE(5)) : null;
+        const audioData = msg.subarray(headerSize);
+
+        // Forward to OpenAI in sequence order, holes concealed (batched; held while failing over)
+        this.uplinkReorder.push(sequence, audioData, captureUs, recvUs);
+
+        if (sequence % 25 === 0) {
+            console.log(`📥 ${this.tag} Packet #${sequence} → ${this.openaiWs ? 'OpenAI' : 'failover buffer'} (${audioData.length} bytes)`);
+        }
+    }
+
+    pollStats() {
+        this.send(buildStatsRequest(), 'stats request');
+    }
+
+    close() {
+        this.closed = true;
+        this.failoverFrames = [];
+        this.failoverBytes = 0;
+        this.clearPlaybackTimeout();
+        this.resetAudio();
+        this.uplinkReorder.reset();
+        this.uplinkBatcher.clear();
+        if (this.openaiWs) {
+            this.openaiWs.close();
+            this.openaiWs = null;
+        }
+        if (this.recorder) {
+            console.log(`💾 ${this.tag} Recorded ${Math.round(this.recorder.bytes / 1024)} KB to ${this.recorder.file}`);
+            this.recorder.close();
+        }
+    }
+}
+
+module.exports = { parseHello, DeviceSession };
@@ -0,0 +1,208 @@
+// Local end-of-speech detection on the uplink the bridge appends (24 kHz,
+// after reordering and resampling), so a turn can be committed without
+// waiting for the server VAD's speech_stopped to come back.
+//
+// ENDPOINTING (realtime_bridge.js):
+//   off     server VAD only
+//   shadow  server VAD decides; every local endpoint is matched against its
+//           speech_stopped (EndpointComparison) to measure what local
+//           endpointing would save and how often it would cut a turn short
+//   on      sessions use manual turn detection (session_config.js); a local
+//           endpoint sends input_audio_buffer.commit + response.create
+//
+// The detector is an energy VAD on 20 ms frames against the noise floor,
+// tracked by minimum statistics: the quietest frame of the last 3 s, which
+// follows the background through speech and never locks onto it. The device
+// only streams once it hears speech, so until 3 s have been seen the floor
+// starts from PRIOR_FLOOR_DBFS. Speech starts after ONSET_FRAMES loud
+// frames in a row; it ends after silenceMs with no voiced frame, and is
+// only an endpoint if it held at least minSpeechMs of voiced frames (clicks
+// and bumps are not turns).
+const { bridgeClockUs, LatencyHistogram } = require('./latency');
+
+const PCM_BYTES_PER_MS = 48;        // PCM16 mono, 24 kHz
+const FRAME_MS = 20;
+const FRAME_BYTES = FRAME_MS * PCM_BYTES_PER_MS;
+const ONSET_FRAMES = 3;
+const START_DB = 12;                // above the noise floor to start speech
+const HOLD_DB = 8;                  // above the noise floor to stay voiced
+const MIN_SPEECH_DBFS = -55;        // never speech below this, however quiet the room
+const MIN_FLOOR_DBFS = -80;
+const PRIOR_FLOOR_DBFS = -60;
+const FLOOR_BLOCK_FRAMES = 10;      // minimum statistics in 200 ms blocks...
+const FLOOR_BLOCKS = 15;            // ...over the last 3 s
+const MATCH_MS = 300;               // local and server end positions this close are the same endpoint
+
+const MODES = ['off', 'shadow', 'on'];
+
+function frameDbfs(pcm, offset) {
+    let sum = 0;
+    for (let i = 0; i < FRAME_BYTES; i += 2) {
+        const s = pcm.readInt16LE(offset + i);
+        sum += s * s;
+    }
+    return 10 * Math.log10(sum / (FRAME_BYTES >> 1) + 1) - 90.3;
+}
+
+class Endpointer {
+    // onEndpoint(trailingMs) is called when speech has ended; trailingMs is
+    // the audio pushed since the last voiced frame (the end of speech is
+    // that far back in the stream)
+    constructor(onEndpoint, { silenceMs = 300, minSpeechMs = 200 } = {}) {
+        this.onEndpoint = onEndpoint;
+        this.silenceMs = silenceMs;
+        this.minSpeechMs = minSpeechMs;
+        this.blocks = new Array(FLOOR_BLOCKS).fill(PRIOR_FLOOR_DBFS);
+        this.blockIndex = 0;
+        this.blockMin = Infinity;
+        this.blockFrames = 0;
+        this.floorDb = PRIOR_FLOOR_DBFS;
+        this.reset();
+        this.endpoints = 0;
+    }
+
+    push(pcm) {
+        const data = this.carry.length ? Buffer.concat([this.carry, pcm]) : pcm;
+        let at = 0;
+        for (; at + FRAME_BYTES <= data.length; at += FRAME_BYTES) {
+            this.frame(frameDbfs(data, at));
+        }
+        this.carry = Buffer.from(data.subarray(at));
+        if (this.speaking && this.positionMs - this.lastVoicedMs >= this.silenceMs) {
+            this.speaking = false;
+            if (this.voicedMs >= this.minSpeechMs) {
+                this.endpoints++;
+                this.onEndpoint(this.positionMs + this.carry.length / PCM_BYTES_PER_MS - this.lastVoicedMs);
+            }
+        }
+    }
+
+    frame(db) {
+        this.positionMs += FRAME_MS;
+        this.trackFloor(db);
+
+        if (!this.speaking) {
+            if (db <= Math.max(this.floorDb + START_DB, MIN_SPEECH_DBFS)) {
+                this.onset = 0;
+            } else if (++this.onset >= ONSET_FRAMES) {
+                this.speaking = true;
+                this.voicedMs = this.onset * FRAME_MS;
+                this.lastVoicedMs = this.positionMs;
+                this.onset = 0;
+            }
+        } else if (db > Math.max(this.floorDb + HOLD_DB, MIN_SPEECH_DBFS)) {
+            this.voicedMs += FRAME_MS;
+            this.lastVoicedMs = this.positionMs;
+        }
+    }
+
+    trackFloor(db) {
+        this.blockMin = Math.min(this.blockMin, db);
+        if (++this.blockFrames === FLOOR_BLOCK_FRAMES) {
+            this.blocks[this.blockIndex] = this.blockMin;
+            this.blockIndex = (this.blockIndex + 1) % FLOOR_BLOCKS;
+            this.blockMin = Infinity;
+            this.blockFrames = 0;
+        }
+        this.floorDb = Math.max(MIN_FLOOR_DBFS, Math.min(this.blockMin, ...this.blocks));
+    }
+
+    // Stream restarted (interrupt): any speech in progress is abandoned; the
+    // noise floor carries over
+    reset() {
+        this.carry = Buffer.alloc(0);
+        this.positionMs = 0;
+        this.speaking = false;
+        this.onset = 0;
+        this.voicedMs = 0;
+        this.lastVoicedMs = 0;
+    }
+}
+
+// Shadow mode: local endpoints against the server VAD's, by position in the
+// session's input audio. agreed: local first (lead = how much sooner the
+// turn would have been committed); late: server first; spurious: no server
+// endpoint near it (a pause the server rightly waited through, i.e. a turn
+// "on" would have cut short); missed: a server endpoint local never matched.
+class EndpointComparison {
+    constructor() {
+        this.lead = new LatencyHistogram();
+        this.lag = new LatencyHistogram();
+        this.agreed = 0;
+        this.late = 0;
+        this.spurious = 0;
+        this.serverEndpoints = 0;
+        this.pending = null;        // local endpoint waiting for the server: { audioEndMs, atUs }
+        this.lastServer = null;     // server endpoint local may still match: { audioEndMs, atUs }
+    }
+
+    // Returns { result, ms } for the log, or null while it waits for the server
+    onLocal(audioEndMs) {
+        const now = bridgeClockUs();
+        const server = this.lastServer;
+        if (server && Math.abs(server.audioEndMs - audioEndMs) <= MATCH_MS) {
+            this.lastServer = null;
+            this.late++;
+            const ms = (now - server.atUs) / 1000;
+            this.lag.add(ms);
+            return { result: 'late', ms };
+        }
+        let superseded = null;
+        if (this.pending) {
+            this.spurious++;
+            superseded = { result: 'spurious', ms: audioEndMs - this.pending.audioEndMs };
+        }
+        this.pending = { audioEndMs, atUs: now };
+        return superseded;
+    }
+
+    // audioEndMs undefined (no position from the server) matches any pending one
+    onServer(audioEndMs) {
+        const now = bridgeClockUs();
+        this.serverEndpoints++;
+        const local = this.pending;
+        this.pending = null;
+        if (local && (audioEndMs === undefined || Math.abs(local.audioEndMs - audioEndMs) <= MATCH_MS)) {
+            this.lastServer = null;
+            this.agreed++;
+            const ms = (now - local.atUs) / 1000;
+            this.lead.add(ms);
+            return { result: 'agreed', ms };
+        }
+        this.lastServer = audioEndMs === undefined ? null : { audioEndMs, atUs: now };
+        if (local) {
+            this.spurious++;
+            return { result: 'spurious', ms: audioEndMs - local.audioEndMs };
+        }
+        return null;
+    }
+
+    // Positions restart (new upstream session) or the turn was abandoned (interrupt)
+    reset() {
+        this.pending = null;
+        this.lastServer = null;
+    }
+
+    get missed() {
+        return this.serverEndpoints - this.agreed - this.late;
+    }
+
+    stats() {
+        return {
+            serverEndpoints: this.serverEndpoints,
+            agreed: this.agreed,
+            late: this.late,
+            missed: this.missed,
+            spurious: this.spurious,
+            lead: this.lead.summary(),
+            lag: this.lag.summary()
+        };
+    }
+}
+
+function formatEndpointStats(s) {
+    return `endpoints: ${s.agreed}/${s.serverEndpoints} ahead of server VAD (p50 ${s.lead.p50Ms} ms, ` +
+           `p90 ${s.lead.p90Ms} ms), ${s.late} behind, ${s.missed} missed, ${s.spurious} spurious`;
+}
+
+module.exports = { MODES, Endpointer, EndpointComparison, formatEndpointStats };
@@ -0,0 +1,231 @@
+// Network impairment model for the UDP impairment proxy (tools/net_impair.js).
+// One Link per direction decides, for every datagram, whether it is dropped
+// and when each copy of it is delivered. All randomness comes from a seeded
+// PRNG, so the same scenario and seed give the same packet fates.
+const fs = require('fs');
+
+// Small, fast, seedable PRNG (mulberry32)
+function createRandom(seed) {
+    let a = seed >>> 0;
+    return () => {
+        a = (a + 0x6D2B79F5) >>> 0;
+        let t = a;
+        t = Math.imul(t ^ (t >>> 15), t | 1);
+        t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+        return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+    };
+}
+
+// Delay distributions, all in ms:
+//   { dist: 'constant', meanMs }
+//   { dist: 'uniform', minMs, maxMs }
+//   { dist: 'normal', meanMs, jitterMs }          (clipped at 0)
+//   { dist: 'pareto', minMs, alpha }              (heavy tail, WiFi retries)
+//   { dist: 'empirical', samples: [ms, ...] }
+function sampleDelay(spec, random) {
+    if (!spec) return 0;
+    switch (spec.dist || 'constant') {
+        case 'constant':
+            return spec.meanMs || 0;
+        case 'uniform':
+            return spec.minMs + random() * (spec.maxMs - spec.minMs);
+        case 'normal': {
+            // Box-Muller
+            const u = 1 - random();
+            const v = random();
+            const z = Math.sqrt(-2 * Math.log(u)) * Math.cos(2 * Math.PI * v);
+            return Math.max(0, (spec.meanMs || 0) + z * (spec.jitterMs || 0));
+        }
+        case 'pareto':
+            return spec.minMs / Math.pow(1 - random(), 1 / (spec.alpha || 2.5));
+        case 'empirical':
+            return spec.samples[Math.floor(random() * spec.samples.length)];
+        default:
+            throw new Error(`unknown delay distribution '${spec.dist}'`);
+    }
+}
+
+// Captured link trace: one record per datagram, in order. Each line is either
+// a delay in ms or a loss marker ('loss', 'lost' or -1); with two or more
+// comma-separated columns the last one is used, so "time_ms,delay_ms" exports
+// work as is. Blank lines, '#' comments and a non-numeric header are skipped.
+function loadTrace(file) {
+    const records = [];
+    for (const raw of fs.readFileSync(file, 'utf8').split('\n')) {
+        const line = raw.trim();
+        if (!line || line.startsWith('#')) continue;
+        const value = line.split(',').pop().trim().toLowerCase();
+        if (value === 'loss' || value === 'lost' || value === '-1') {
+            records.push({ lost: true, delayMs: 0 });
+            continue;
+        }
+        const delayMs = parseFloat(value);
+        if (Number.isFinite(delayMs)) {
+            records.push({ lost: false, delayMs });
+        }
+    }
+    if (records.length === 0) {
+        throw new Error(`${file}: no trace records`);
+    }
+    return records;
+}
+
+// Impairment profile for one direction:
+//   loss:       probability of independent loss
+//   burst:      Gilbert-Elliott loss { pGoodToBad, pBadToGood, lossInBad = 1, lossInGood = 0 }
+//   delay:      delay distribution (see sampleDelay)
+//   fifo:       keep delivery order under jitter (default true, like a WiFi queue)
+//   reorder:    { probability, delayMs }: the packet is held back so later ones overtake it
+//   duplicate:  probability of delivering a second copy
+//   rateKbps:   bandwidth cap; packets queue behind each other at this rate
+//   queueMs:    tail-drop once the rate-cap queue holds more than this (default 200)
+//   trace:      path to a captured trace; replaces loss and delay
+function normalizeProfile(profile = {}) {
+    return {
+        loss: profile.loss || 0,
+        burst: profile.burst ? {
+            pGoodToBad: profile.burst.pGoodToBad || 0,
+            pBadToGood: profile.burst.pBadToGood ?? 1,
+            lossInBad: profile.burst.lossInBad ?? 1,
+            lossInGood: profile.burst.lossInGood || 0
+        } : null,
+        delay: profile.delay || null,
+        fifo: profile.fifo !== false,
+        reorder: profile.reorder ? {
+            probability: profile.reorder.probability || 0,
+            delayMs: profile.reorder.delayMs ?? 50
+        } : null,
+        duplicate: profile.duplicate || 0,
+        rateKbps: profile.rateKbps || 0,
+        queueMs: profile.queueMs ?? 200,
+        trace: profile.trace ? loadTrace(profile.trace) : null
+    };
+}
+
+class Link {
+    constructor(name, seed) {
+        this.name = name;
+        this.random = createRandom(seed);
+        this.profile = normalizeProfile();
+        this.badState = false;      // Gilbert-Elliott channel state
+        this.busyUntil = 0;         // rate cap: when the link finishes the queued bytes
+        this.lastDelivery = 0;      // fifo: latest scheduled delivery
+        this.traceIndex = 0;
+        this.stats = {
+            received: 0,
+            delivered: 0,
+            bytes: 0,
+            lost: 0,
+            burstLost: 0,
+            traceLost: 0,
+            queueDropped: 0,
+            duplicated: 0,
+            reordered: 0,
+            outOfOrder: 0
+        };
+        this.delays = [];
+    }
+
+    setProfile(profile) {
+        this.profile = normalizeProfile(profile);
+        this.traceIndex = 0;
+    }
+
+    // Delivery times (ms, same clock as now) for one datagram; empty if it is dropped
+    plan(bytes, now) {
+        const p = this.profile;
+        const s = this.stats;
+        s.received++;
+        s.bytes += bytes;
+
+        let baseDelay;
+        if (p.trace) {
+            const record = p.trace[this.traceIndex++ % p.trace.length];
+            if (record.lost) {
+                s.traceLost++;
+                return [];
+            }
+            baseDelay = record.delayMs;
+        } else {
+            if (p.burst) {
+                this.badState = this.badState
+                    ? this.random() >= p.burst.pBadToGood
+                    : this.random() < p.burst.pGoodToBad;
+                if (this.random() < (this.badState ? p.burst.lossInBad : p.burst.lossInGood)) {
+                    s.burstLost++;
+                    return [];
+                }
+            }
+            if (p.loss && this.random() < p.loss) {
+                s.lost++;
+                return [];
+            }
+            baseDelay = sampleDelay(p.delay, this.random);
+        }
+
+        let queueDelay = 0;
+        if (p.rateKbps) {
+            const start = Math.max(now, this.busyUntil);
+            if (start - now > p.queueMs) {
+                s.queueDropped++;
+                return [];
+            }
+            this.busyUntil = start + (bytes * 8) / p.rateKbps;
+            queueDelay = this.busyUntil - now;
+        }
+
+        let deliverAt = now + queueDelay + baseDelay;
+        if (p.fifo) {
+            deliverAt = Math.max(deliverAt, this.lastDelivery);
+            this.lastDelivery = deliverAt;
+        }
+        if (p.reorder && this.random() < p.reorder.probability) {
+            deliverAt += p.reorder.delayMs;
+            s.reordered++;
+        }
+
+        const times = [deliverAt];
+        if (p.duplicate && this.random() < p.duplicate) {
+            times.push(deliverAt + 1);
+            s.duplicated++;
+        }
+        this.delays.push(deliverAt - now);
+        return times;
+    }
+
+    summary() {
+        const sorted = this.delays.slice().sort((a, b) => a - b);
+        const pct = (q) => sorted.length ? +sorted[Math.min(sorted.length - 1, Math.floor(q * sorted.length))].toFixed(2) : 0;
+        const dropped = this.stats.lost + this.stats.burstLost + this.stats.traceLost + this.stats.queueDropped;
+        return {
+            direction: this.name,
+            ...this.stats,
+            dropped,
+            lossPct: this.stats.received ? +(dropped * 100 / this.stats.received).toFixed(2) : 0,
+            delayP50Ms: pct(0.5),
+            delayP95Ms: pct(0.95),
+            delayP99Ms: pct(0.99),
+            delayMaxMs: sorted.length ? +sorted[sorted.length - 1].toFixed(2) : 0
+        };
+    }
+}
+
+// Scenario: { seed, loop, phases: [{ name, durationMs, uplink, downlink, both }] }.
+// A profile given as 'both' applies to the two directions; the last phase
+// stays in force once its duration ends unless 'loop' is set.
+function loadScenario(file) {
+    const scenario = JSON.parse(fs.readFileSync(file, 'utf8'));
+    if (!Array.isArray(scenario.phases) || scenario.phases.length === 0) {
+        throw new Error(`${file}: scenario needs a non-empty 'phases' array`);
+    }
+    return scenario;
+}
+
+function phaseProfiles(phase) {
+    return {
+        uplink: { ...phase.both, ...phase.uplink },
+        downlink: { ...phase.both, ...phase.downlink }
+    };
+}
+
+module.exports = { createRandom, sampleDelay, loadTrace, Link, loadScenario, phaseProfiles };
@@ -0,0 +1,239 @@
+// End-to-end (mouth-to-ear) latency per turn.
+//
+// The device syncs its clock to the bridge (main/clock_sync.h), stamps each
+// uplink frame with its capture time and reports when the first chunk of a
+// response reached its speaker DMA, all on the bridge clock below. Together
+// with the bridge's own stamps a turn breaks down as:
+//
+//   speech end    capture time of the audio where OpenAI's VAD says speech stopped
+//   vad           -> input_audio_buffer.speech_stopped reaches the bridge
+//   model         -> first response.audio.delta
+//   bridge        -> first PLAY_AUDIO datagram sent
+//   downlink      -> first chunk arrives at the device
+//   playout       -> first chunk enters the TX DMA (pre-buffer, queue)
+//   total         speech end -> first output, mouth to ear
+const { performance } = require('perf_hooks');
+const {
+    UDP_MSG_TIME_RESPONSE,
+    UDP_MSG_PLAYBACK_STARTED
+} = require('./protocol');
+
+const PCM_BYTES_PER_MS = 48;        // PCM16 mono, 24 kHz
+const MAX_FRAMES = 3000;            // uplink frame index, ~2 min of speech
+const MAX_SAMPLES = 1000;           // per histogram, for the percentiles
+
+// Bridge clock: microseconds on the wall-clock timeline (monotonic within the
+// process). Every bridge process on a host agrees, and NTP-synced hosts agree
+// to within their sync error, so a device keeps its clock offset when
+// udp_dispatcher.js moves it to another worker.
+function bridgeClockUs() {
+    return Math.round((performance.timeOrigin + performance.now()) * 1000);
+}
+
+// UDP_MSG_TIME_REQUEST [type][i64 t1] -> [type][i64 t1][i64 t2][i64 t3]
+function buildTimeResponse(request, recvUs) {
+    if (request.length < 9) return null;
+    const response = Buffer.alloc(25);
+    response[0] = UDP_MSG_TIME_RESPONSE;
+    request.copy(response, 1, 1, 9);
+    response.writeBigInt64LE(BigInt(recvUs), 9);
+    response.writeBigInt64LE(BigInt(bridgeClockUs()), 17);
+    return response;
+}
+
+// UDP_MSG_PLAYBACK_STARTED [type][u32 seq][i64 first rx][i64 first output]; 0 = not synced
+function parsePlaybackStarted(msg) {
+    if (msg.length < 21 || msg[0] !== UDP_MSG_PLAYBACK_STARTED) return null;
+    const firstRxUs = Number(msg.readBigInt64LE(5));
+    const firstOutputUs = Number(msg.readBigInt64LE(13));
+    return {
+        sequence: msg.readUInt32LE(1),
+        firstRxUs: firstRxUs || null,
+        firstOutputUs: firstOutputUs || null
+    };
+}
+
+// Latency samples in ms: exact percentiles over the last MAX_SAMPLES, and a
+// cumulative histogram on fixed bucket edges (BUCKET_EDGES_MS unless given)
+const BUCKET_EDGES_MS = [25, 50, 100, 200, 400, 800, 1600, 3200];
+
+class LatencyHistogram {
+    constructor(edges = BUCKET_EDGES_MS) {
+        this.edges = edges;
+        this.samples = [];
+        this.buckets = new Array(edges.length + 1).fill(0);
+        this.count = 0;
+        this.sum = 0;
+    }
+
+    add(ms) {
+        this.samples.push(ms);
+        if (this.samples.length > MAX_SAMPLES) this.samples.shift();
+        let b = this.edges.findIndex((edge) => ms <= edge);
+        if (b < 0) b = this.edges.length;
+        this.buckets[b]++;
+        this.count++;
+        this.sum += ms;
+    }
+
+    percentile(p) {
+        if (this.samples.length === 0) return 0;
+        const sorted = this.samples.slice().sort((a, b) => a - b);
+        return sorted[Math.min(sorted.length - 1, Math.floor(p / 100 * sorted.length))];
+    }
+
+    summary() {
+        return {
+            count: this.count,
+            meanMs: this.count ? +(this.sum / this.count).toFixed(1) : 0,
+            p50Ms: +this.percentile(50).toFixed(1),
+            p90Ms: +this.percentile(90).toFixed(1),
+            p99Ms: +this.percentile(99).toFixed(1),
+            maxMs: this.samples.length ? +Math.max(...this.samples).toFixed(1) : 0,
+            buckets: this.edges.map((edge, i) => [edge, this.buckets[i]])
+                .concat([[Infinity, this.buckets[this.edges.length]]])
+        };
+    }
+}
+
+// Waterfall segments: [name, from stamp, to stamp]
+const STAGES = [
+    ['vad', 'speechEndUs', 'speechStoppedUs'],
+    ['model', 'speechStoppedUs', 'firstDeltaUs'],
+    ['bridge', 'firstDeltaUs', 'firstSendUs'],
+    ['downlink', 'firstSendUs', 'deviceFirstRxUs'],
+    ['playout', 'deviceFirstRxUs', 'firstOutputUs'],
+    ['total', 'speechEndUs', 'firstOutputUs']
+];
+
+class TurnLatency {
+    constructor() {
+        this.histograms = { uplink: new LatencyHistogram() };
+        for (const [name] of STAGES) this.histograms[name] = new LatencyHistogram();
+        this.frames = [];
+        this.positionMs = 0;
+        this.turn = null;
+        this.turns = 0;
+    }
+
+    // New OpenAI session whose input audio starts offsetMs into the current
+    // one (audio the old session got is not in it): audio_end_ms counts from
+    // zero at that point
+    rebase(offsetMs) {
+        this.frames = this.frames.filter((frame) => frame.startMs >= offsetMs);
+        for (const frame of this.frames) frame.startMs -= offsetMs;
+        this.positionMs = Math.max(0, this.positionMs - offsetMs);
+        this.turn = null;
+    }
+
+    // Every uplink frame appended to the input buffer. captureUs is null for
+    // untimestamped frames; the arrival time stands in (uplink delay is lost).
+    // Concealed frames (uplink_reorder.js) take part in the timeline only.
+    onUplinkAudio(captureUs, bytes, arrivalUs, concealed = false) {
+        if (captureUs && !concealed) {
+            this.histograms.uplink.add((arrivalUs - captureUs) / 1000);
+        }
+        this.frames.push({ startMs: this.positionMs, captureUs: captureUs || arrivalUs - bytes / PCM_BYTES_PER_MS * 1000 });
+        if (this.frames.length > MAX_FRAMES) this.frames.shift();
+        this.positionMs += bytes / PCM_BYTES_PER_MS;
+    }
+
+    // Capture time of a position in the session's input audio
+    captureTimeAt(audioMs) {
+        for (let i = this.frames.length - 1; i >= 0; i--) {
+            const frame = this.frames[i];
+            if (frame.startMs <= audioMs) {
+                return frame.captureUs + (audioMs - frame.startMs) * 1000;
+            }
+        }
+        return null;
+    }
+
+    onSpeechStopped(audioEndMs) {
+        if (this.turn) this.finish();
+        this.turn = {
+            speechEndUs: audioEndMs !== undefined ? this.captureTimeAt(audioEndMs) : null,
+            speechStoppedUs: bridgeClockUs()
+        };
+    }
+
+    onFirstDelta() {
+        if (this.turn && !this.turn.firstDeltaUs) this.turn.firstDeltaUs = bridgeClockUs();
+    }
+
+    onFirstSend() {
+        if (this.turn && this.turn.firstDeltaUs && !this.turn.firstSendUs) this.turn.firstSendUs = bridgeClockUs();
+    }
+
+    onPlaybackStarted(report) {
+        if (!this.turn || !this.turn.firstSendUs || !report) return null;
+        this.turn.deviceFirstRxUs = report.firstRxUs;
+        this.turn.firstOutputUs = report.firstOutputUs;
+        return this.finish();
+    }
+
+    // Record the stages this turn got through; returns { stage: ms }
+    finish() {
+        const turn = this.turn;
+        this.turn = null;
+        if (!turn) return null;
+
+        const result = {};
+        for (const [name, from, to] of STAGES) {
+            if (turn[from] && turn[to]) {
+                result[name] = (turn[to] - turn[from]) / 1000;
+                this.histograms[name].add(result[name]);
+            }
+        }
+        this.turns++;
+        return result;
+    }
+
+    summary() {
+        const out = {};
+        for (const [name, histogram] of Object.entries(this.histograms)) {
+            out[name] = histogram.summary();
+        }
+        return out;
+    }
+}
+
+function bar(ms, scaleMs, width = 30) {
+    return '█'.repeat(Math.max(ms > 0 ? 1 : 0, Math.round(ms / scaleMs * width)));
+}
+
+function formatWaterfall(result, turnNumber) {
+    const lines = [`⏱️ Turn ${turnNumber} latency` +
+        (result.total !== undefined ? ` (mouth-to-ear ${result.total.toFixed(0)} ms)` : ' (partial)')];
+    const scale = result.total || Math.max(1, ...Object.values(result));
+    for (const [name] of STAGES) {
+        if (name === 'total' || result[name] === undefined) continue;
+        lines.push(`   ${name.padEnd(9)} ${result[name].toFixed(1).padStart(7)} ms ${bar(result[name], scale)}`);
+    }
+    return lines.join('\n');
+}
+
+function formatSummary(summary) {
+    const lines = ['⏱️ Latency percentiles (ms)     n     p50     p90     p99     max'];
+    for (const [name, s] of Object.entries(summary)) {
+        if (s.count === 0) continue;
+        lines.push(`   ${name.padEnd(24)} ${String(s.count).padStart(5)} ${[s.p50Ms, s.p90Ms, s.p99Ms, s.maxMs]
+            .map((v) => v.toFixed(0).padStart(7)).join(' ')}`);
+        const lastEdge = s.buckets[s.buckets.length - 2][0];
+        const buckets = s.buckets.filter(([, n]) => n > 0)
+            .map(([edge, n]) => `${edge === Infinity ? '>' + lastEdge : '≤' + edge}:${n}`);
+        lines.push(`      ${buckets.join(' ')}`);
+    }
+    return lines.join('\n');
+}
+
+module.exports = {
+    BUCKET_EDGES_MS,
+    bridgeClockUs,
+    buildTimeResponse,
+    parsePlaybackStarted,
+    LatencyHistogram,
+    TurnLatency,
+    formatWaterfall,
+    formatSummary
+};
@@ -0,0 +1,98 @@
+// Bridge side of the link-quality probe (main/link_probe.h).
+// Probes are echoed unchanged except for the bridge's receive time and a
+// running count of the probes it has seen from that run, which lets the
+// device split loss and jitter into the uplink and downlink directions.
+const { UDP_MSG_PROBE, UDP_MSG_PROBE_ECHO, UDP_MSG_PROBE_REPORT, UDP_MSG_PROBE_REQUEST } = require('./protocol');
+const { bridgeClockUs } = require('./latency');
+
+// [type][u32 run][u32 seq][u64 device_send_us][u64 bridge_recv_us][u32 bridge_count][u8 phase][padding]
+const PROBE_HEADER_SIZE = 30;
+const MAX_RUNS = 16;
+
+const runCounts = new Map();
+
+function isProbe(msg) {
+    return msg.length >= PROBE_HEADER_SIZE && msg[0] === UDP_MSG_PROBE;
+}
+
+// Echo for one probe (same length, so each direction carries the same load), or null
+function buildProbeEcho(msg) {
+    if (!isProbe(msg)) return null;
+    const recvUs = BigInt(bridgeClockUs());
+    const run = msg.readUInt32LE(1);
+
+    const count = (runCounts.get(run) || 0) + 1;
+    runCounts.delete(run);
+    runCounts.set(run, count);
+    if (runCounts.size > MAX_RUNS) {
+        runCounts.delete(runCounts.keys().next().value);
+    }
+
+    const echo = Buffer.from(msg);
+    echo[0] = UDP_MSG_PROBE_ECHO;
+    echo.writeBigUInt64LE(recvUs, 17);
+    echo.writeUInt32LE(count, 25);
+    return echo;
+}
+
+function buildProbeRequest() {
+    return Buffer.from([UDP_MSG_PROBE_REQUEST]);
+}
+
+// link_profile_t; field order must match the C struct, new fields are only appended
+const PROFILE_FIELDS = [
+    ['version', 'u32'],
+    ['rttMinUs', 'u32'],
+    ['rttAvgUs', 'u32'],
+    ['rttP95Us', 'u32'],
+    ['jitterUpUs', 'u32'],
+    ['jitterDownUs', 'u32'],
+    ['lossUpPctX100', 'u16'],
+    ['lossDownPctX100', 'u16'],
+    ['maxLossBurst', 'u16'],
+    ['reordered', 'u16'],
+    ['duplicated', 'u16'],
+    ['probesSent', 'u16'],
+    ['sustainableKbps', 'u32'],
+    ['prebufferChunks', 'u16'],
+    ['frameBytes', 'u16']
+];
+
+// UDP_MSG_PROBE_REPORT: [type][link_profile_t]; null if malformed
+function parseProbeReport(msg) {
+    if (msg.length < 1 + 4 || msg[0] !== UDP_MSG_PROBE_REPORT) return null;
+    const report = {};
+    let off = 1;
+    for (const [name, type] of PROFILE_FIELDS) {
+        const size = type === 'u32' ? 4 : 2;
+        if (off + size > msg.length) break;
+        report[name] = type === 'u32' ? msg.readUInt32LE(off) : msg.readUInt16LE(off);
+        off += size;
+    }
+    if (report.lossUpPctX100 !== undefined) {
+        report.lossUpPct = report.lossUpPctX100 / 100;
+        report.lossDownPct = report.lossDownPctX100 / 100;
+    }
+    return report;
+}
+
+function formatProbeReport(r) {
+    const ms = (us) => (us / 1000).toFixed(1);
+    return [
+        `rtt ${ms(r.rttMinUs)}/${ms(r.rttAvgUs)}/${ms(r.rttP95Us)} ms`,
+        `jitter up/down ${ms(r.jitterUpUs)}/${ms(r.jitterDownUs)} ms`,
+        `loss up/down ${r.lossUpPct}/${r.lossDownPct}% burst=${r.maxLossBurst}`,
+        `reordered=${r.reordered} dup=${r.duplicated} of ${r.probesSent}`,
+        `sustainable ${r.sustainableKbps} kbps`,
+        `prebuffer=${r.prebufferChunks} frame=${r.frameBytes}B`
+    ].join(' | ');
+}
+
+module.exports = {
+    PROBE_HEADER_SIZE,
+    isProbe,
+    buildProbeEcho,
+    buildProbeRequest,
+    parseProbeReport,
+    formatProbeReport
+};
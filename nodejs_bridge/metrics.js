@@ -0,0 +1,236 @@
+// Prometheus text exposition of the bridge's counters and histograms, served
+// on METRICS_PORT (GET /metrics) and/or written to METRICS_TEXTFILE for
+// node_exporter's textfile collector.
+//
+// Bridge-wide: sessions, packet totals (closed sessions included), event
+// loop lag, the upstream pool and the response cache. Per device (label device="<mac>"):
+//
+//   voice_bridge_device_uplink_packets_total     datagrams from the device
+//   voice_bridge_device_downlink_packets_total   PLAY_AUDIO datagrams sent
+//   voice_bridge_device_uplink_lost_total        uplink datagrams missing (uplink_reorder.js),
+//                                                also _concealed, _reordered, _late, _duplicates
+//   voice_bridge_device_rechunker_depth_ms       downlink audio queued in the rechunker
+//   voice_bridge_device_pacing_lag_ms            downlink sends behind their schedule
+//   voice_bridge_device_upstream_buffered_bytes  WebSocket send buffer (bufferedAmount)
+//   voice_bridge_device_turn_stage_ms            latency.js stages; stage="model" is the
+//                                                upstream time to first delta
+//   voice_bridge_device_endpoints_total          ENDPOINTING=shadow: local endpoints by result
+//                                                (endpointer.js), with _lead_ms / _lag_ms against
+//                                                the server VAD; ENDPOINTING=on: result="committed"
+//
+// Rates are left to the scraper: rate(voice_bridge_device_uplink_packets_total[1m]).
+const fs = require('fs');
+const http = require('http');
+const { performance } = require('perf_hooks');
+const { LatencyHistogram } = require('./latency');
+
+// Short delays: timer lateness, event loop stalls
+const LAG_EDGES_MS = [1, 2, 5, 10, 20, 50, 100, 200, 500];
+const LOOP_LAG_INTERVAL_MS = 50;
+
+// Event loop lag: how late a periodic timer fires
+class EventLoopLag {
+    constructor() {
+        this.histogram = new LatencyHistogram(LAG_EDGES_MS);
+        let expected = performance.now() + LOOP_LAG_INTERVAL_MS;
+        this.timer = setInterval(() => {
+            const now = performance.now();
+            this.histogram.add(Math.max(0, now - expected));
+            expected = now + LOOP_LAG_INTERVAL_MS;
+        }, LOOP_LAG_INTERVAL_MS);
+        this.timer.unref();
+    }
+
+    close() {
+        clearInterval(this.timer);
+    }
+}
+
+function escapeLabel(value) {
+    return String(value).replace(/\\/g, '\\\\').replace(/"/g, '\\"').replace(/\n/g, '\\n');
+}
+
+function labelString(labels) {
+    const parts = Object.entries(labels).map(([k, v]) => `${k}="${escapeLabel(v)}"`);
+    return parts.length ? `{${parts.join(',')}}` : '';
+}
+
+// Collects samples grouped by metric name, so HELP/TYPE come once per family
+class Exposition {
+    constructor() {
+        this.families = new Map();
+    }
+
+    family(name, type, help) {
+        let family = this.families.get(name);
+        if (!family) {
+            family = { type, help, lines: [] };
+            this.families.set(name, family);
+        }
+        return family;
+    }
+
+    counter(name, help, value, labels = {}) {
+        this.family(name, 'counter', help).lines.push(`${name}${labelString(labels)} ${value}`);
+    }
+
+    gauge(name, help, value, labels = {}) {
+        this.family(name, 'gauge', help).lines.push(`${name}${labelString(labels)} ${value}`);
+    }
+
+    // LatencyHistogram -> cumulative _bucket / _sum / _count
+    histogram(name, help, h, labels = {}) {
+        const lines = this.family(name, 'histogram', help).lines;
+        let cumulative = 0;
+        h.edges.forEach((edge, i) => {
+            cumulative += h.buckets[i];
+            lines.push(`${name}_bucket${labelString({ ...labels, le: edge })} ${cumulative}`);
+        });
+        lines.push(`${name}_bucket${labelString({ ...labels, le: '+Inf' })} ${h.count}`);
+        lines.push(`${name}_sum${labelString(labels)} ${+h.sum.toFixed(3)}`);
+        lines.push(`${name}_count${labelString(labels)} ${h.count}`);
+    }
+
+    toString() {
+        const out = [];
+        for (const [name, family] of this.families) {
+            out.push(`# HELP ${name} ${family.help}`, `# TYPE ${name} ${family.type}`, ...family.lines);
+        }
+        return out.join('\n') + '\n';
+    }
+}
+
+// state: { sessions, closedReceived, closedSent, upstreamPool, loopLag, responseCache (or null) }
+function renderMetrics(state) {
+    const m = new Exposition();
+    let received = state.closedReceived;
+    let sent = state.closedSent;
+    for (const session of state.sessions) {
+        received += session.packetsReceived;
+        sent += session.packetsSent;
+    }
+
+    m.gauge('voice_bridge_sessions', 'Open device sessions', state.sessions.length);
+    m.counter('voice_bridge_uplink_packets_total', 'Datagrams received from devices, all sessions', received);
+    m.counter('voice_bridge_downlink_packets_total', 'Audio datagrams sent to devices, all sessions', sent);
+    m.histogram('voice_bridge_event_loop_lag_ms', 'Event loop lag', state.loopLag.histogram);
+
+    const pool = state.upstreamPool.stats();
+    m.gauge('voice_bridge_upstream_pool_warm', 'Configured upstream sessions waiting in the pool', pool.warm);
+    m.gauge('voice_bridge_upstream_pool_connecting', 'Upstream sessions being opened', pool.connecting);
+    m.gauge('voice_bridge_upstream_pool_waiting', 'Devices waiting for an upstream session', pool.waiting);
+    m.counter('voice_bridge_upstream_pool_acquires_total', 'Upstream sessions handed out', pool.warmHits, { result: 'warm' });
+    m.counter('voice_bridge_upstream_pool_acquires_total', 'Upstream sessions handed out', pool.waits, { result: 'waited' });
+    m.counter('voice_bridge_upstream_pool_connect_failures_total', 'Failed upstream connection attempts', pool.failures);
+    m.histogram('voice_bridge_upstream_pool_acquire_ms', 'Time to get an upstream session',
+                state.upstreamPool.acquireLatency);
+
+    const cache = state.responseCache;
+    if (cache) {
+        const c = cache.stats();
+        const lookups = 'Response cache lookups by input transcript';
+        m.counter('voice_bridge_response_cache_lookups_total', lookups, c.hits, { result: 'hit' });
+        m.counter('voice_bridge_response_cache_lookups_total', lookups, c.misses, { result: 'miss' });
+        m.counter('voice_bridge_response_cache_lookups_total', lookups, c.late, { result: 'late' });
+        m.counter('voice_bridge_response_cache_stores_total', 'Responses written to the cache', c.stores);
+        m.counter('voice_bridge_response_cache_evictions_total', 'Responses overwritten by the cache log', c.evictions);
+        m.gauge('voice_bridge_response_cache_entries', 'Responses stored', c.entries);
+        m.gauge('voice_bridge_response_cache_servable_prompts', 'Prompts answered from the cache', c.servable);
+        m.gauge('voice_bridge_response_cache_used_bytes', 'Cache file in use', c.usedBytes);
+        m.gauge('voice_bridge_response_cache_capacity_bytes', 'Cache file size', c.capacityBytes);
+        for (const [result, h] of Object.entries(cache.firstAudio)) {
+            m.histogram('voice_bridge_response_cache_first_audio_ms', 'Turn commit to first audio sent, by cache result',
+                        h, { result });
+        }
+    }
+
+    for (const session of state.sessions) {
+        const device = { device: session.id };
+        m.counter('voice_bridge_device_uplink_packets_total', 'Datagrams received from the device',
+                  session.packetsReceived, device);
+        m.counter('voice_bridge_device_downlink_packets_total', 'Audio datagrams sent to the device',
+                  session.packetsSent, device);
+        const uplink = session.uplinkReorder;
+        m.counter('voice_bridge_device_uplink_lost_total', 'Uplink audio datagrams missing after the reorder window',
+                  uplink.lost, device);
+        m.counter('voice_bridge_device_uplink_concealed_total', 'Lost uplink datagrams replaced with concealment',
+                  uplink.concealed, device);
+        m.counter('voice_bridge_device_uplink_reordered_total', 'Uplink datagrams put back in sequence',
+                  uplink.reordered, device);
+        m.counter('voice_bridge_device_uplink_late_total', 'Uplink datagrams dropped, arrived after concealment',
+                  uplink.late, device);
+        m.counter('voice_bridge_device_uplink_duplicates_total', 'Duplicate uplink datagrams dropped',
+                  uplink.duplicates, device);
+        m.gauge('voice_bridge_device_rechunker_depth_ms', 'Downlink audio queued for pacing',
+                +(session.rechunker.length / 48).toFixed(1), device);
+        m.histogram('voice_bridge_device_pacing_lag_ms', 'Downlink chunk sends behind schedule',
+                    session.pacingLag, device);
+        m.gauge('voice_bridge_device_upstream_buffered_bytes', 'Upstream WebSocket send buffer',
+                session.openaiWs ? session.openaiWs.bufferedAmount : 0, device);
+        m.gauge('voice_bridge_device_failover_held_ms', 'Uplink audio held for the next upstream session',
+                +(session.failoverBytes / 48).toFixed(1), device);
+        m.counter('voice_bridge_device_upstream_sessions_total', 'Upstream sessions used (1 + failovers)',
+                  session.upstreamSessions, device);
+        const endpoints = session.endpointComparison;
+        if (endpoints) {
+            for (const result of ['agreed', 'late', 'missed', 'spurious']) {
+                m.counter('voice_bridge_device_endpoints_total', 'Local endpoints by result against the server VAD',
+                          endpoints[result], { ...device, result });
+            }
+            m.histogram('voice_bridge_device_endpoint_lead_ms', 'Local endpoint ahead of server speech_stopped',
+                        endpoints.lead, device);
+            m.histogram('voice_bridge_device_endpoint_lag_ms', 'Local endpoint behind server speech_stopped',
+                        endpoints.lag, device);
+        } else if (session.endpointer) {
+            m.counter('voice_bridge_device_endpoints_total', 'Local endpoints by result against the server VAD',
+                      session.localCommits, { ...device, result: 'committed' });
+        }
+        for (const [stage, h] of Object.entries(session.turnLatency.histograms)) {
+            m.histogram('voice_bridge_device_turn_stage_ms', 'Turn latency by stage (latency.js)', h,
+                        { ...device, stage });
+        }
+    }
+    return m.toString();
+}
+
+// GET /metrics on host:port; render() returns the exposition text
+function startMetricsServer(port, host, render) {
+    const server = http.createServer((req, res) => {
+        if (req.method !== 'GET' || req.url.split('?')[0] !== '/metrics') {
+            res.writeHead(404);
+            res.end();
+            return;
+        }
+        res.writeHead(200, { 'Content-Type': 'text/plain; version=0.0.4' });
+        res.end(render());
+    });
+    server.on('error', (err) => console.error(`❌ Metrics server: ${err.message}`));
+    server.listen(port, host, () => console.log(`📈 Metrics on http://${host}:${port}/metrics`));
+    return server;
+}
+
+// Rewrite file every intervalMs, atomically (the collector never sees half a file)
+function startTextfileExporter(file, intervalMs, render) {
+    const timer = setInterval(() => {
+        const tmp = `${file}.${process.pid}.tmp`;
+        fs.writeFile(tmp, render(), (err) => {
+            if (err) {
+                console.error(`❌ Metrics textfile ${file}: ${err.message}`);
+                return;
+            }
+            fs.rename(tmp, file, (renameErr) => {
+                if (renameErr) console.error(`❌ Metrics textfile ${file}: ${renameErr.message}`);
+            });
+        });
+    }, intervalMs);
+    timer.unref();
+    return timer;
+}
+
+module.exports = {
+    LAG_EDGES_MS,
+    EventLoopLag,
+    renderMetrics,
+    startMetricsServer,
+    startTextfileExporter
+};
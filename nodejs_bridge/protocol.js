@@ -0,0 +1,36 @@
+// UDP message types shared with the firmware - keep in sync with main/udp_client.h
+module.exports = {
+    DEVICE_UDP_PORT: 3333,
+
+    // Uplink audio: [UDP_MSG_AUDIO_DATA][uint32 LE sequence][PCM16]
+    UDP_AUDIO_HEADER_SIZE: 5,
+    // Once the device clock is synced: [UDP_MSG_AUDIO_DATA_TS][uint32 LE sequence][int64 LE capture_us][PCM16]
+    UDP_AUDIO_TS_HEADER_SIZE: 13,
+    // Handshake: [UDP_MSG_HELLO][u8 version][u8 mac[6]][u16 LE uplink Hz][u16 LE downlink Hz]
+    UDP_HELLO_SIZE: 12,
+
+    UDP_MSG_AUDIO_DATA: 0x10,
+    UDP_MSG_AUDIO_DATA_TS: 0x11,
+    UDP_MSG_PLAY_AUDIO: 0x20,
+    UDP_MSG_PLAY_AUDIO_LAST: 0x21,
+    UDP_MSG_STATE_IDLE: 0x30,
+    UDP_MSG_STATE_USER_SPEAKING: 0x31,
+    UDP_MSG_STATE_AI_SPEAKING: 0x32,
+    UDP_MSG_INTERRUPT: 0x40,
+    UDP_MSG_PLAYBACK_COMPLETE: 0x50,
+    UDP_MSG_PLAYBACK_STARTED: 0x51,
+    UDP_MSG_TRACE_REQUEST: 0x60,
+    UDP_MSG_TRACE_DATA: 0x61,
+    UDP_MSG_STATS_REQUEST: 0x70,
+    UDP_MSG_STATS_RESPONSE: 0x71,
+    UDP_MSG_MEM_ALERT: 0x72,
+    UDP_MSG_PROBE: 0x80,
+    UDP_MSG_PROBE_ECHO: 0x81,
+    UDP_MSG_PROBE_REPORT: 0x82,
+    UDP_MSG_PROBE_REQUEST: 0x83,
+    UDP_MSG_TIME_REQUEST: 0x84,
+    UDP_MSG_TIME_RESPONSE: 0x85,
+    UDP_MSG_HELLO: 0x90,
+    UDP_MSG_HELLO_REQUEST: 0x91,
+    UDP_MSG_ERROR: 0xFF
+};
@@ -1,471 +1,263 @@
 const dgram = require('dgram');
-const WebSocket = require('ws');
+const fs = require('fs');
+const os = require('os');
 
 // Configuration
-const OPENAI_API_KEY = "";
-const LISTEN_PORT = 8080;
+const OPENAI_API_KEY = process.env.OPENAI_API_KEY || "";
+const LISTEN_PORT = parseInt(process.env.LISTEN_PORT || '8080', 10);
 const LISTEN_HOST = '0.0.0.0';
-const OPENAI_REALTIME_URL = 'wss://api.openai.com/v1/realtime?model=gpt-realtime-2025-08-28';
-
-// Message types
-const UDP_MSG_PLAY_AUDIO = 0x20;
-const UDP_MSG_PLAY_AUDIO_LAST = 0x21;
-const UDP_MSG_STATE_IDLE = 0x30;
-const UDP_MSG_STATE_AI_SPEAKING = 0x32;
-const UDP_MSG_INTERRUPT = 0x40;
-const UDP_MSG_PLAYBACK_COMPLETE = 0x50;
-
-// Audio rechunking buffer - converts variable OpenAI chunks to fixed 1920-byte chunks
-class AudioRechunker {
-    constructor(chunkSize = 1440) {  // 40ms @ 24kHz
-        this.chunkSize = chunkSize;
-        this.buffer = Buffer.alloc(0);
-        this.sequence = 0;
-    }
-
-    // Add variable-sized data from OpenAI
-    addData(audioBuffer) {
-        this.buffer = Buffer.concat([this.buffer, audioBuffer]);
-    }
-
-    // Extract ONE fixed-size chunk for ESP32
-    getChunk() {
-        if (this.buffer.length >= this.chunkSize) {
-            const chunk = this.buffer.slice(0, this.chunkSize);
-            this.buffer = this.buffer.slice(this.chunkSize);
-            return chunk;
-        }
-        return null;
-    }
-
-    // Get any remaining partial chunk (at end of response)
-    flush() {
-        const chunks = [];
-
-        // Extract all full-sized chunks first
-        while (this.buffer.length >= this.chunkSize) {
-            const chunk = this.buffer.slice(0, this.chunkSize);
-            this.buffer = this.buffer.slice(this.chunkSize);
-            chunks.push(chunk);
-        }
-
-        // Return any remaining partial chunk (less than chunkSize)
-        if (this.buffer.length > 0) {
-            chunks.push(this.buffer);
-            this.buffer = Buffer.alloc(0);
-        }
-
-        return chunks;
-    }
-
-    reset() {
-        this.buffer = Buffer.alloc(0);
-        this.sequence = 0;
-    }
+const OPENAI_REALTIME_URL = process.env.OPENAI_REALTIME_URL ||
+                            'wss://api.openai.com/v1/realtime?model=gpt-realtime-2025-08-28';
+
+// Message types (shared with the firmware)
+const {
+    UDP_MSG_HELLO,
+    UDP_MSG_HELLO_REQUEST,
+    UDP_MSG_PROBE,
+    UDP_MSG_TIME_REQUEST
+} = require('./protocol');
+const { EncodePool } = require('./uplink');
+const { buildProbeEcho } = require('./link_probe');
+const { bridgeClockUs, buildTimeResponse, formatSummary } = require('./latency');
+const { parseHello, DeviceSession } = require('./device_session');
+const { UpstreamPool, formatPoolStats } = require('./upstream_pool');
+const { REC_UDP_IN, REC_UDP_OUT } = require('./session_recorder');
+const { SESSION_UPDATE, manualTurnsUpdate } = require('./session_config');
+const { formatUplinkStats } = require('./uplink_reorder');
+const { MODES: ENDPOINTING_MODES, formatEndpointStats } = require('./endpointer');
+const { ResponseCache, formatCacheStats } = require('./response_cache');
+const { EventLoopLag, renderMetrics, startMetricsServer, startTextfileExporter } = require('./metrics');
+
+// Device telemetry poll interval (0 disables polling)
+const STATS_POLL_INTERVAL_MS = parseInt(process.env.STATS_POLL_INTERVAL_MS || '30000', 10);
+
+// Uplink appends: one per batch instead of one per datagram (0 = per datagram),
+// base64/JSON encoded on worker threads (0 = on the main thread). Workers only
+// pay off with a spare core, so the default is none on a single-core host.
+// See uplink.js and tools/uplink_bench.js.
+const UPLINK_BATCH_MS = parseInt(process.env.UPLINK_BATCH_MS || '100', 10);
+const UPLINK_ENCODE_WORKERS = parseInt(process.env.UPLINK_ENCODE_WORKERS ||
+                                       String(Math.min(2, os.cpus().length - 1)), 10);
+
+// Out-of-order uplink audio is held this long for the missing datagrams
+// before the hole is concealed (uplink_reorder.js); 0 conceals at once
+const UPLINK_REORDER_MS = parseInt(process.env.UPLINK_REORDER_MS || '80', 10);
+
+// A session whose device has sent nothing for this long is closed (the
+// device streams continuously while it is up)
+const SESSION_IDLE_MS = parseInt(process.env.SESSION_IDLE_MS || '60000', 10);
+const HELLO_REQUEST_INTERVAL_MS = 1000;     // per unknown address
+
+// Upstream sessions kept connected and configured ahead of demand, so a new
+// device or a failover gets one without a handshake (see upstream_pool.js)
+const UPSTREAM_POOL_SIZE = parseInt(process.env.UPSTREAM_POOL_SIZE || '2', 10);
+
+// Record every session to this directory (session_recorder.js,
+// tools/session_replay.js); empty disables recording
+const SESSION_RECORD_DIR = process.env.SESSION_RECORD_DIR || '';
+
+// Downlink pacing this many times faster than playback. Only for replays at
+// --speed (tools/session_replay.js), where the device's clock runs as fast
+const DOWNLINK_PACE_SPEED = parseFloat(process.env.DOWNLINK_PACE_SPEED || '1');
+
+// Local end-of-speech detection (endpointer.js): off, shadow (measured
+// against the server VAD, which still decides) or on (the bridge commits
+// turns, server VAD disabled). ENDPOINT_SILENCE_MS of silence ends speech.
+let ENDPOINTING = process.env.ENDPOINTING || 'off';
+if (!ENDPOINTING_MODES.includes(ENDPOINTING)) {
+    console.warn(`⚠️ ENDPOINTING=${ENDPOINTING} unknown (${ENDPOINTING_MODES.join(', ')}), using off`);
+    ENDPOINTING = 'off';
 }
+const ENDPOINT_SILENCE_MS = parseInt(process.env.ENDPOINT_SILENCE_MS || '300', 10);
+
+// Response audio cache (response_cache.js) in RESPONSE_CACHE_FILE (empty
+// disables) of RESPONSE_CACHE_MB. A prompt is answered from the cache once
+// it has got the same answer RESPONSE_CACHE_MIN_REPEATS times in a row,
+// revalidated upstream after RESPONSE_CACHE_TTL_S.
+const RESPONSE_CACHE_FILE = process.env.RESPONSE_CACHE_FILE || '';
+const RESPONSE_CACHE_MB = parseInt(process.env.RESPONSE_CACHE_MB || '64', 10);
+const RESPONSE_CACHE_MIN_REPEATS = parseInt(process.env.RESPONSE_CACHE_MIN_REPEATS || '2', 10);
+const RESPONSE_CACHE_TTL_S = parseInt(process.env.RESPONSE_CACHE_TTL_S || '86400', 10);
+
+// Prometheus metrics (metrics.js): GET /metrics on METRICS_PORT (0 disables),
+// and/or a textfile for node_exporter rewritten every METRICS_TEXTFILE_INTERVAL_MS
+const METRICS_PORT = parseInt(process.env.METRICS_PORT || '0', 10);
+const METRICS_HOST = process.env.METRICS_HOST || '127.0.0.1';
+const METRICS_TEXTFILE = process.env.METRICS_TEXTFILE || '';
+const METRICS_TEXTFILE_INTERVAL_MS = parseInt(process.env.METRICS_TEXTFILE_INTERVAL_MS || '15000', 10);
 
 console.log('='.repeat(60));
 console.log('ESP32S3 Realtime Bridge - VAD Mode');
 console.log('Continuous Recording + OpenAI Server VAD');
+console.log(`Uplink: ${UPLINK_BATCH_MS > 0 ? UPLINK_BATCH_MS + ' ms batches' : 'one append per datagram'}, ` +
+            `${UPLINK_ENCODE_WORKERS > 0 ? UPLINK_ENCODE_WORKERS + ' encoder worker(s)' : 'encoding on main thread'}, ` +
+            `${UPLINK_REORDER_MS} ms reorder window`);
+console.log(`Upstream pool: ${UPSTREAM_POOL_SIZE} warm session(s)`);
+console.log(`Endpointing: ${ENDPOINTING}` + (ENDPOINTING !== 'off' ? ` (${ENDPOINT_SILENCE_MS} ms silence)` : ''));
+if (RESPONSE_CACHE_FILE) {
+    console.log(`Response cache: ${RESPONSE_CACHE_FILE}, ${RESPONSE_CACHE_MB} MB, ` +
+                `after ${RESPONSE_CACHE_MIN_REPEATS} identical answers`);
+}
+if (SESSION_RECORD_DIR) {
+    fs.mkdirSync(SESSION_RECORD_DIR, { recursive: true });
+    console.log(`Recording sessions to ${SESSION_RECORD_DIR}`);
+}
 console.log('='.repeat(60));
 
 const udpServer = dgram.createSocket('udp4');
-let espClient = null;
-let openaiWs = null;
-
-// Packet counters
-let packetsReceived = 0;
-let packetsSent = 0;
 
-// Audio pipeline - WALKIE-TALKIE STYLE (no timing control)
-const audioRechunker = new AudioRechunker(1440);
-let deltaCount = 0;
-let isFirstChunk = true;  // Track first chunk for state transition
+// Uplink encoders, shared by all sessions
+const encodePool = UPLINK_ENCODE_WORKERS > 0 ? new EncodePool(UPLINK_ENCODE_WORKERS) : null;
 
-// Helper: Send state message to ESP32
-function sendStateToESP32(state) {
-    if (!espClient) return;
-
-    const packet = Buffer.alloc(1);
-    packet[0] = state;
-
-    udpServer.send(packet, espClient.port, espClient.address, (err) => {
-        if (err) {
-            console.error(`❌ Failed to send state: ${err.message}`);
+const upstreamPool = new UpstreamPool({
+    url: OPENAI_REALTIME_URL,
+    apiKey: OPENAI_API_KEY,
+    sessionUpdate: ENDPOINTING === 'on' ? manualTurnsUpdate(SESSION_UPDATE) : SESSION_UPDATE,
+    size: UPSTREAM_POOL_SIZE
+});
+upstreamPool.start();
+
+// Session configuration as namespace: new instructions or voice, new answers
+const responseCache = RESPONSE_CACHE_FILE ? new ResponseCache({
+    file: RESPONSE_CACHE_FILE,
+    capacityBytes: RESPONSE_CACHE_MB * 1024 * 1024,
+    namespace: JSON.stringify(SESSION_UPDATE.session),
+    minRepeats: RESPONSE_CACHE_MIN_REPEATS,
+    ttlMs: RESPONSE_CACHE_TTL_S * 1000
+}) : null;
+
+// Device sessions (see device_session.js), by device id and by current address
+const sessions = new Map();
+const sessionsByAddress = new Map();
+const helloRequests = new Map();    // unknown "ip:port" -> last HELLO_REQUEST time
+let nextSessionKey = 0;
+
+const sessionContext = {
+    udpServer,
+    encodePool,
+    upstreamPool,
+    uplinkBatchMs: UPLINK_BATCH_MS,
+    uplinkReorderMs: UPLINK_REORDER_MS,
+    recordDir: SESSION_RECORD_DIR,
+    paceSpeed: DOWNLINK_PACE_SPEED,
+    endpointing: ENDPOINTING,
+    endpointSilenceMs: ENDPOINT_SILENCE_MS,
+    responseCache
+};
+
+// Packet counters of closed sessions
+let closedReceived = 0;
+let closedSent = 0;
+
+function handleHello(msg, rinfo) {
+    const hello = parseHello(msg);
+    if (!hello) return;
+    const addressKey = `${rinfo.address}:${rinfo.port}`;
+    helloRequests.delete(addressKey);
+
+    let session = sessions.get(hello.id);
+    if (session) {
+        // Same device from a new address (reboot, DHCP renew, NAT rebinding)
+        if (session.addressKey !== addressKey) {
+            sessionsByAddress.delete(session.addressKey);
+            session.address = rinfo.address;
+            session.port = rinfo.port;
+            sessionsByAddress.set(addressKey, session);
+            session.record(REC_UDP_IN, msg);
+            console.log(`📱 ${session.tag} ESP32 moved to ${addressKey}`);
         }
-    });
-
-    const stateName = state === UDP_MSG_STATE_IDLE ? 'IDLE' :
-                     state === UDP_MSG_STATE_AI_SPEAKING ? 'AI_SPEAKING' : 'UNKNOWN';
-    console.log(`📡 Sent state to ESP32: ${stateName}`);
-}
-
-// Helper: Send audio chunk to ESP32
-function sendAudioChunkToESP32(audioBuffer, isLast = false) {
-    if (!espClient) return;
-
-    const MAX_AUDIO_SIZE = 1440;
-
-    if (audioBuffer.length > MAX_AUDIO_SIZE) {
-        console.warn(`⚠️ Chunk oversized (${audioBuffer.length} bytes), truncating to ${MAX_AUDIO_SIZE}`);
-        audioBuffer = audioBuffer.slice(0, MAX_AUDIO_SIZE);
+        session.hello = hello;
+        session.lastSeenMs = Date.now();
+        return;
     }
 
-    const packet = Buffer.alloc(5 + audioBuffer.length);
-    packet[0] = isLast ? UDP_MSG_PLAY_AUDIO_LAST : UDP_MSG_PLAY_AUDIO;
-
-    // CRITICAL FIX: Capture sequence number BEFORE incrementing to fix logging bug
-    const currentSeq = audioRechunker.sequence;
-    packet.writeUInt32LE(audioRechunker.sequence++, 1);
-    audioBuffer.copy(packet, 5);
-
-    udpServer.send(packet, espClient.port, espClient.address, (err) => {
-        if (err) {
-            console.error(`❌ Failed to send chunk #${currentSeq}: ${err.message}`);
-        } else {
-            packetsSent++;
-
-            // IMPROVED LOGGING: Log every chunk to detect packet loss
-            const marker = isLast ? ' [LAST]' : '';
-            if (currentSeq % 10 === 0 || isLast) {
-                console.log(`📤 Sent chunk #${currentSeq} to ESP32 (${audioBuffer.length} bytes)${marker}`);
-            }
-        }
-    });
+    // A different device taking over an address (rare): retire the old session
+    const previous = sessionsByAddress.get(addressKey);
+    if (previous) closeSession(previous, 'address reused');
+
+    session = new DeviceSession(hello, rinfo, nextSessionKey++, sessionContext);
+    session.record(REC_UDP_IN, msg);
+    sessions.set(session.id, session);
+    sessionsByAddress.set(addressKey, session);
+    console.log(`\n📱 ${session.tag} ESP32 connected: ${addressKey} ` +
+                `(hello v${hello.version}, uplink ${hello.uplinkHz} Hz, downlink ${hello.downlinkHz} Hz, ` +
+                `${sessions.size} session(s))`);
+    session.acquireUpstream();
 }
 
-// Send chunks with rate limiting to prevent UDP packet loss
-async function blastAvailableChunks() {
-    let chunksSent = 0;
-    const startSeq = audioRechunker.sequence;
-
-    // Extract and send chunks with a tiny delay to prevent overwhelming ESP32
-    while (audioRechunker.buffer.length >= audioRechunker.chunkSize) {
-        const chunk = audioRechunker.getChunk();
-        if (chunk) {
-            sendAudioChunkToESP32(chunk, false);
-            chunksSent++;
-
-            // CRITICAL FIX: Add 5ms delay AFTER EVERY packet to prevent UDP buffer overflow
-            // WiFi + FreeRTOS on ESP32 needs significant time between packets
-            // At 40ms per chunk playback, 5ms per chunk = 12.5% overhead (necessary for reliability)
-            // This reduces send rate from 500pkt/s to 200pkt/s - within ESP32 WiFi capacity
-            await new Promise(resolve => setTimeout(resolve, 30));
-        }
+function closeSession(session, reason) {
+    console.log(`👋 ${session.tag} Closing session (${reason}), ${formatUplinkStats(session.uplinkReorder.stats())}`);
+    if (session.turnLatency.turns > 0) {
+        console.log(`${session.tag} ${formatSummary(session.turnLatency.summary())}`);
     }
-
-    if (chunksSent > 0) {
-        console.log(`⚡ BLASTED ${chunksSent} chunks (#${startSeq}-#${audioRechunker.sequence - 1}) - ${chunksSent * 1440} bytes`);
+    if (session.endpointComparison) {
+        console.log(`🎯 ${session.tag} ${formatEndpointStats(session.endpointComparison.stats())}`);
     }
-
-    return chunksSent;
-}
-
-// Handle audio completion - send any remaining partial chunk
-async function finishAudioStream() {
-    console.log('🎵 Audio response completed');
-
-    // Flush any remaining chunks
-    const remainingChunks = audioRechunker.flush();
-
-    if (remainingChunks.length > 0) {
-        console.log(`📤 Flushing ${remainingChunks.length} remaining chunks`);
-
-        // Send remaining chunks with rate limiting to prevent packet loss
-        for (let i = 0; i < remainingChunks.length; i++) {
-            const isLast = (i === remainingChunks.length - 1);
-            sendAudioChunkToESP32(remainingChunks[i], isLast);
-
-            // Add 5ms delay after every flush chunk to prevent packet loss (matching blastAvailableChunks)
-            if (i < remainingChunks.length - 1) {
-                await new Promise(resolve => setTimeout(resolve, 5));
-            }
-        }
-    } else {
-        // CRITICAL FIX: ESP32 rejects empty packets
-        // Instead, send a minimal silent packet (8 samples = 16 bytes of PCM16 silence)
-        console.log('📤 No remaining chunks, sending silent LAST packet');
-        const silentPacket = Buffer.alloc(16, 0);  // 16 bytes of silence (8 samples @ 16-bit)
-        sendAudioChunkToESP32(silentPacket, true);
+    session.close();
+    closedReceived += session.packetsReceived;
+    closedSent += session.packetsSent;
+    sessions.delete(session.id);
+    if (sessionsByAddress.get(session.addressKey) === session) {
+        sessionsByAddress.delete(session.addressKey);
     }
-
-    console.log('⏳ Waiting for ESP32 playback complete...');
-
-    // Fallback timeout - increased to 3 minutes to handle longer responses
-    // At 40ms per chunk, 180s = 4500 chunks = ~648KB of audio
-    const idleTimeout = setTimeout(() => {
-        console.log('⏰ Timeout (3min) - sending IDLE');
-        sendStateToESP32(UDP_MSG_STATE_IDLE);
-        audioRechunker.reset();
-        isFirstChunk = true;
-    }, 180000);
-
-    if (!global.playbackTimeouts) global.playbackTimeouts = new Map();
-    global.playbackTimeouts.set('current', idleTimeout);
 }
 
-// Stop pipeline (used for interrupts)
-function stopAudioPipeline() {
-    console.log('🛑 Stopping audio pipeline (interrupted)');
-    audioRechunker.reset();
-    isFirstChunk = true;
+// Datagram from an address with no session: ask the device to introduce itself
+function requestHello(rinfo) {
+    const addressKey = `${rinfo.address}:${rinfo.port}`;
+    const now = Date.now();
+    const last = helloRequests.get(addressKey);
+    if (last !== undefined && now - last < HELLO_REQUEST_INTERVAL_MS) return;
+    helloRequests.set(addressKey, now);
+    udpServer.send(Buffer.from([UDP_MSG_HELLO_REQUEST]), rinfo.port, rinfo.address);
 }
 
-function connectToOpenAI() {
-    console.log('\n🔗 Connecting to OpenAI Realtime API...');
-
-    openaiWs = new WebSocket(OPENAI_REALTIME_URL, {
-        headers: {
-            'Authorization': `Bearer ${OPENAI_API_KEY}`,
-            'OpenAI-Beta': 'realtime=v1'
-        }
-    });
-
-    openaiWs.on('open', () => {
-        console.log('✅ Connected to OpenAI Realtime API');
-    });
-
-    openaiWs.on('message', (data) => {
-        handleOpenAIMessage(data);
-    });
-
-    openaiWs.on('close', (code, reason) => {
-        console.log(`❌ OpenAI connection closed: ${code} ${reason}`);
-        openaiWs = null;
-        setTimeout(() => {
-            console.log('🔄 Reconnecting to OpenAI...');
-            connectToOpenAI();
-        }, 5000);
-    });
-
-    openaiWs.on('error', (error) => {
-        console.error('❌ OpenAI WebSocket error:', error.message);
-    });
+function reply(packet, rinfo, session) {
+    if (session) session.record(REC_UDP_OUT, packet);
+    udpServer.send(packet, rinfo.port, rinfo.address);
 }
 
-function configureSession() {
-    const sessionConfig = {
-        type: 'session.update',
-        session: {
-            modalities: ['text', 'audio'],
-            instructions: 'CRITICAL RULES SYSTEM WILL FAIL IF NOT FOLLOWED EXACTLY: You are a real time Farsi to English voice translator. Your role is ESSENTIAL and must be performed precisely. YOUR CORE FUNCTION: 1. Listen for Farsi speech from OTHER PEOPLE not me 2. Translate their Farsi into English for me 3. Suggest a relevant Farsi response I can say back CRITICAL: DO NOT translate when I repeat the Farsi phrases you just taught me. You must remember each suggestion you give me and IGNORE IT when I say it back. If I say something in Farsi that is VERY SIMILAR to your suggestion even if not exactly the same you must recognize it as me speaking and stay silent. Use reasoning to determine if the words are close enough to what you suggested. Only translate NEW Farsi speech from the other person. When you need to stay silent simply say staying silent and nothing else. RESPONSE FORMAT use this exact structure every time: Translation: English translation of what they said Suggestion: Keep this SHORT with minimal filler words. Format is English phrase then Farsi phrase. Examples: yes bale, no thank you na moteshakeram, I want a latte man ye latte mikham, hot coffee ghahve dagh. CONTEXT: I am an English speaker in Iran trying to order coffee. Everyone around me speaks Farsi. I need help understanding them and responding appropriately. My goal is to successfully complete a coffee order. EXAMPLE FLOW: Barista says chi mikhay? You respond Translation: What do you want? Suggestion: I want a latte man ye latte mikham. I then say man ye latte mikham lotfan. You simply say staying silent because this is very similar to what you taught me. Barista says khameh mikhay? You respond Translation: Do you want cream? Suggestion: yes with cream bale ba khameh. REMEMBER: Track every phrase you teach me and stay silent when I use it or something very similar. Use reasoning to identify when I am speaking versus when the other person is speaking. Only translate new Farsi from others. When staying silent only say staying silent. Keep suggestions SHORT no filler words just English then Farsi.',
-            voice: 'sage',
-            input_audio_format: 'pcm16',
-            output_audio_format: 'pcm16',
-            input_audio_transcription: {
-                model: 'whisper-1'
-            },
-            turn_detection: {
-                type: 'server_vad',
-                threshold: 0.01,
-                prefix_padding_ms: 300,
-                silence_duration_ms: 10,
-                create_response: true
-            },
-            temperature: 0.8,
-            max_response_output_tokens: 4096
+// UDP message handler
+udpServer.on('message', (msg, rinfo) => {
+    const recvUs = bridgeClockUs();
+    if (msg.length === 0) return;
+
+    const session = sessionsByAddress.get(`${rinfo.address}:${rinfo.port}`);
+    if (session) session.record(REC_UDP_IN, msg);
+
+    // Stateless requests, answered before (and without) a session
+    switch (msg[0]) {
+        case UDP_MSG_TIME_REQUEST: {
+            const response = buildTimeResponse(msg, recvUs);
+            if (response) reply(response, rinfo, session);
+            return;
         }
-    };
 
-    console.log('⚙️ Configuring OpenAI session with server_vad...');
-    openaiWs.send(JSON.stringify(sessionConfig));
-}
-
-function handleOpenAIMessage(data) {
-    try {
-        const message = JSON.parse(data.toString());
-
-        switch (message.type) {
-            case 'session.created':
-                console.log('✅ OpenAI session created');
-                configureSession();
-                break;
-
-            case 'session.updated':
-                console.log('✅ OpenAI session configured with VAD');
-                console.log('🎤 Ready to receive audio from ESP32\n');
-                break;
-
-            case 'input_audio_buffer.speech_started':
-                console.log('🎙️ OpenAI VAD: Speech detected');
-                break;
-
-            case 'input_audio_buffer.speech_stopped':
-                console.log('🤐 OpenAI VAD: Speech ended (auto-committing)');
-                break;
-
-            case 'input_audio_buffer.committed':
-                console.log('✅ Audio buffer committed by VAD');
-                break;
-
-            case 'conversation.item.created':
-                console.log('📝 Conversation item created');
-                break;
-
-            case 'response.created':
-                console.log('🤖 Response generation started');
-                // Reset state for new response
-                audioRechunker.reset();
-                isFirstChunk = true;
-                deltaCount = 0;
-                break;
-
-            case 'response.output_item.added':
-                console.log('📝 Output item added to response');
-                break;
-
-            case 'response.audio.delta':
-                if (message.delta) {
-                    const audioBuffer = Buffer.from(message.delta, 'base64');
-
-                    // Log OpenAI data receipt (every 5th packet)
-                    if (++deltaCount % 5 === 0) {
-                        console.log(`📥 OpenAI delta #${deltaCount}: ${audioBuffer.length} bytes`);
-                    }
-
-                    // WALKIE-TALKIE APPROACH: Add data and blast immediately
-                    audioRechunker.addData(audioBuffer);
-
-                    // Send AI_SPEAKING state on first chunk
-                    if (isFirstChunk) {
-                        console.log('🔊 First audio delta - starting stream');
-                        sendStateToESP32(UDP_MSG_STATE_AI_SPEAKING);
-                        isFirstChunk = false;
-                    }
-
-                    // Blast all available chunks immediately (no timer, no delay)
-                    blastAvailableChunks();
-                }
-                break;
-
-            case 'response.audio.done':
-                finishAudioStream();
-                break;
-
-            case 'response.audio_transcript.delta':
-                if (message.delta) {
-                    process.stdout.write(message.delta);
-                }
-                break;
-
-            case 'response.audio_transcript.done':
-                if (message.transcript) {
-                    console.log(`\n🤖 Teddy said: "${message.transcript}"`);
-                }
-                break;
-
-            case 'response.content_part.done':
-                console.log('✅ Content part complete');
-                break;
-
-            case 'response.output_item.done':
-                console.log('✅ Output item complete');
-                break;
-
-            case 'response.done':
-                console.log('✅ Response fully complete');
-                console.log('---\nReady for next interaction\n');
-                break;
-
-            case 'response.cancelled':
-                console.log('⚠️ Response interrupted by user');
-                stopAudioPipeline();
-                break;
-
-            case 'conversation.item.input_audio_transcription.completed':
-                if (message.transcript) {
-                    console.log(`📝 User said: "${message.transcript}"`);
-                }
-                break;
-
-            case 'error':
-                console.error('❌ OpenAI error:', JSON.stringify(message.error, null, 2));
-                break;
-
-            case 'rate_limits.updated':
-                break;
-
-            default:
-                break;
+        case UDP_MSG_PROBE: {
+            const echo = buildProbeEcho(msg);
+            if (echo) reply(echo, rinfo, session);
+            return;
         }
-    } catch (error) {
-        console.error('Error processing OpenAI message:', error);
-    }
-}
-
-// Handle interrupt signal from ESP32
-function handleInterruptFromESP32() {
-    console.log('⚡ INTERRUPT received from ESP32');
-
-    stopAudioPipeline();
-
-    if (openaiWs && openaiWs.readyState === WebSocket.OPEN) {
-        openaiWs.send(JSON.stringify({ type: 'response.cancel' }));
-        openaiWs.send(JSON.stringify({ type: 'input_audio_buffer.clear' }));
-        console.log('📡 Sent cancel & clear to OpenAI');
-    }
-}
-
-// UDP message handler
-udpServer.on('message', (msg, rinfo) => {
-    packetsReceived++;
 
-    // Track ESP32 client
-    if (!espClient || espClient.address !== rinfo.address) {
-        espClient = { address: rinfo.address, port: rinfo.port };
-        console.log(`\n📱 ESP32 connected: ${rinfo.address}:${rinfo.port}`);
-    }
+        case UDP_MSG_HELLO:
+            handleHello(msg, rinfo);
+            return;
 
-    // Check for interrupt message
-    if (msg.length === 1 && msg[0] === UDP_MSG_INTERRUPT) {
-        handleInterruptFromESP32();
-        return;
+        default:
+            break;
     }
 
-    // Check for playback complete message
-    if (msg.length === 1 && msg[0] === UDP_MSG_PLAYBACK_COMPLETE) {
-        console.log('✅ Received PLAYBACK_COMPLETE from ESP32');
-
-        // Cancel timeout
-        if (global.playbackTimeouts && global.playbackTimeouts.has('current')) {
-            clearTimeout(global.playbackTimeouts.get('current'));
-            global.playbackTimeouts.delete('current');
-        }
-
-        // Send IDLE state
-        sendStateToESP32(UDP_MSG_STATE_IDLE);
+    if (!session) {
+        requestHello(rinfo);
         return;
     }
-
-    // Audio packet: [4-byte sequence][audio data]
-    if (msg.length >= 4) {
-        const sequence = msg.readUInt32LE(0);
-        const audioData = msg.slice(4);
-
-        // Forward to OpenAI
-        if (openaiWs && openaiWs.readyState === WebSocket.OPEN) {
-            const base64Audio = audioData.toString('base64');
-            openaiWs.send(JSON.stringify({
-                type: 'input_audio_buffer.append',
-                audio: base64Audio
-            }));
-
-            if (sequence % 25 === 0) {
-                console.log(`📥 Packet #${sequence} → OpenAI (${audioData.length} bytes)`);
-            }
-        } else {
-            if (packetsReceived % 100 === 0) {
-                console.warn('⚠️ OpenAI not connected, dropping packets');
-            }
-        }
-    }
+    session.handleDatagram(msg, recvUs);
 });
 
 udpServer.on('listening', () => {
     const address = udpServer.address();
     console.log(`\n✅ UDP server listening: ${address.address}:${address.port}`);
     console.log('Waiting for ESP32 connection...\n');
-    connectToOpenAI();
 });
 
 udpServer.on('error', (err) => {
@@ -474,23 +266,81 @@ udpServer.on('error', (err) => {
 
 udpServer.bind(LISTEN_PORT, LISTEN_HOST);
 
+// Idle sessions and stale HELLO requests
+setInterval(() => {
+    const now = Date.now();
+    for (const session of sessions.values()) {
+        if (now - session.lastSeenMs > SESSION_IDLE_MS) {
+            closeSession(session, `silent for ${Math.round((now - session.lastSeenMs) / 1000)} s`);
+        }
+    }
+    for (const [addressKey, last] of helloRequests) {
+        if (now - last > SESSION_IDLE_MS) helloRequests.delete(addressKey);
+    }
+}, 5000);
+
 // Statistics logging
 setInterval(() => {
-    if (packetsReceived > 0 || packetsSent > 0) {
-        console.log(`📊 Stats: ${packetsReceived} received, ${packetsSent} sent`);
+    let received = closedReceived;
+    let sent = closedSent;
+    let appends = 0;
+    let datagrams = 0;
+    let lost = 0;
+    let concealed = 0;
+    for (const session of sessions.values()) {
+        received += session.packetsReceived;
+        sent += session.packetsSent;
+        appends += session.uplinkBatcher.appends;
+        datagrams += session.uplinkBatcher.datagrams;
+        lost += session.uplinkReorder.lost;
+        concealed += session.uplinkReorder.concealed;
+    }
+    if (received > 0 || sent > 0) {
+        console.log(`📊 Stats: ${sessions.size} session(s), ${received} received, ${sent} sent, ` +
+                    `${appends} appends for ${datagrams} uplink datagrams, ` +
+                    `${lost} uplink lost (${concealed} concealed)`);
+        console.log(`📊 ${formatPoolStats(upstreamPool.stats())}`);
+        if (responseCache) console.log(`📊 ${formatCacheStats(responseCache.stats())}`);
     }
 }, 30000);
 
+// Device telemetry polling - one 1-byte request per device, answered by a single datagram
+if (STATS_POLL_INTERVAL_MS > 0) {
+    setInterval(() => {
+        for (const session of sessions.values()) {
+            session.pollStats();
+        }
+    }, STATS_POLL_INTERVAL_MS);
+}
+
+// Metrics
+const loopLag = new EventLoopLag();
+const metricsState = () => ({
+    sessions: [...sessions.values()],
+    closedReceived,
+    closedSent,
+    upstreamPool,
+    loopLag,
+    responseCache
+});
+const metricsServer = METRICS_PORT > 0 ?
+    startMetricsServer(METRICS_PORT, METRICS_HOST, () => renderMetrics(metricsState())) : null;
+if (METRICS_TEXTFILE) {
+    startTextfileExporter(METRICS_TEXTFILE, METRICS_TEXTFILE_INTERVAL_MS, () => renderMetrics(metricsState()));
+}
+
 // Graceful shutdown
 process.on('SIGINT', () => {
     console.log('\n🛑 Shutting down...');
-    if (openaiWs) {
-        openaiWs.close();
+    for (const session of [...sessions.values()]) {
+        closeSession(session, 'shutdown');
     }
+    upstreamPool.close();
+    if (responseCache) responseCache.close();
+    loopLag.close();
+    if (metricsServer) metricsServer.close();
     udpServer.close(() => {
         console.log('👋 Goodbye!');
         process.exit(0);
     });
 });
-
-console.log('🚀 Bridge server running in VAD mode!\n');
\ No newline at end of file
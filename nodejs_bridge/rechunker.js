@@ -0,0 +1,91 @@
+// Rechunks variable-size OpenAI audio deltas into fixed-size frames for the
+// device (1440 bytes = 30 ms at 24 kHz by default).
+//
+// Deltas are kept as a list of buffer references instead of being
+// concatenated into one growing buffer. A frame that lies inside a single
+// delta is returned as a view of it (no copy); one that spans deltas is
+// assembled into a fresh buffer, so each input byte is referenced or copied
+// at most once however long the response is.
+class AudioRechunker {
+    constructor(chunkSize = 1440) {
+        this.chunkSize = chunkSize;
+        this.reset();
+    }
+
+    // Bytes waiting to be framed
+    get length() {
+        return this.pending;
+    }
+
+    // Add variable-sized data from OpenAI; the buffer is referenced, not copied
+    addData(audioBuffer) {
+        if (audioBuffer.length === 0) return;
+        this.list.push(audioBuffer);
+        this.pending += audioBuffer.length;
+    }
+
+    // Next n bytes (n <= pending): a view when they sit in one buffer, else one copy
+    take(n) {
+        const head = this.list[this.head];
+        const available = head.length - this.offset;
+        let out;
+        if (available >= n) {
+            out = head.subarray(this.offset, this.offset + n);
+            this.offset += n;
+            if (this.offset === head.length) this.advance();
+        } else {
+            out = Buffer.allocUnsafe(n);
+            let filled = 0;
+            while (filled < n) {
+                const buf = this.list[this.head];
+                const count = Math.min(buf.length - this.offset, n - filled);
+                buf.copy(out, filled, this.offset, this.offset + count);
+                filled += count;
+                this.offset += count;
+                if (this.offset === buf.length) this.advance();
+            }
+        }
+        this.pending -= n;
+        return out;
+    }
+
+    // Drop the consumed head buffer; compact the list once the dead prefix dominates
+    advance() {
+        this.list[this.head++] = undefined;
+        this.offset = 0;
+        if (this.head === this.list.length) {
+            this.list.length = 0;
+            this.head = 0;
+        } else if (this.head >= 64 && this.head * 2 >= this.list.length) {
+            this.list = this.list.slice(this.head);
+            this.head = 0;
+        }
+    }
+
+    // Extract ONE fixed-size chunk for ESP32
+    getChunk() {
+        return this.pending >= this.chunkSize ? this.take(this.chunkSize) : null;
+    }
+
+    // All remaining full chunks, then any partial one (at end of response)
+    flush() {
+        const chunks = [];
+        while (this.pending >= this.chunkSize) {
+            chunks.push(this.take(this.chunkSize));
+        }
+        if (this.pending > 0) {
+            chunks.push(this.take(this.pending));
+        }
+        return chunks;
+    }
+
+    reset() {
+        this.list = [];
+        this.head = 0;
+        this.offset = 0;
+        this.pending = 0;
+        this.sequence = 0;
+    }
+}
+
+module.exports = { AudioRechunker };
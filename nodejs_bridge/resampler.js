@@ -0,0 +1,117 @@
+// Streaming polyphase resampler for PCM16 mono, used to bring a device's
+// uplink to the 24 kHz the Realtime session takes when the device sends
+// less (HELLO uplink rate 16000: a third less uplink bandwidth; see
+// AUDIO_SAMPLE_RATE_UPLINK in main/audio_handler.h).
+//
+// Rational ratio up/down (16 -> 24 kHz is 3/2). The prototype lowpass runs
+// at the virtual rate inRate * up, cut off at the lower of the two Nyquist
+// rates, Kaiser windowed, split into `up` phases of `tapsPerPhase` taps.
+// Each output sample costs one phase: tapsPerPhase multiply-adds. Filter
+// history and phase carry across process() calls, so datagrams can be fed
+// one at a time without clicks at their edges.
+const TAPS_PER_PHASE = 16;
+const KAISER_BETA = 6;
+
+function gcd(a, b) {
+    while (b) [a, b] = [b, a % b];
+    return a;
+}
+
+// Zeroth-order modified Bessel function, for the Kaiser window
+function besselI0(x) {
+    let sum = 1;
+    let term = 1;
+    for (let k = 1; k < 30; k++) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+class PolyphaseResampler {
+    constructor(inRate, outRate, { tapsPerPhase = TAPS_PER_PHASE } = {}) {
+        const g = gcd(inRate, outRate);
+        this.inRate = inRate;
+        this.outRate = outRate;
+        this.up = outRate / g;
+        this.down = inRate / g;
+        this.taps = tapsPerPhase;
+
+        // Prototype: windowed sinc at inRate * up, DC gain `up` (zero stuffing loses it)
+        const length = this.up * tapsPerPhase;
+        const cutoff = 0.5 * Math.min(inRate, outRate) / (inRate * this.up);    // cycles per sample
+        const prototype = new Float64Array(length);
+        let sum = 0;
+        for (let i = 0; i < length; i++) {
+            const n = i - (length - 1) / 2;
+            const x = 2 * cutoff * n;
+            const sinc = n === 0 ? 1 : Math.sin(Math.PI * x) / (Math.PI * x);
+            const r = 2 * i / (length - 1) - 1;
+            prototype[i] = sinc * besselI0(KAISER_BETA * Math.sqrt(1 - r * r)) / besselI0(KAISER_BETA);
+            sum += prototype[i];
+        }
+
+        // coefs[p * taps + k] multiplies the k-th newest input in phase p of the virtual rate
+        this.coefs = new Float64Array(length);
+        for (let p = 0; p < this.up; p++) {
+            for (let k = 0; k < tapsPerPhase; k++) {
+                this.coefs[p * tapsPerPhase + k] = prototype[p + k * this.up] * this.up / sum;
+            }
+        }
+
+        this.history = new Float64Array(tapsPerPhase - 1);
+        this.work = new Float64Array(0);
+        this.t = 0;     // next output's position at the virtual rate, from the start of the next input
+    }
+
+    // Delay through the filter, in output samples
+    get delaySamples() {
+        return (this.up * this.taps - 1) / 2 / this.down;
+    }
+
+    // PCM16 LE in, PCM16 LE out (roughly in.length * outRate / inRate bytes)
+    process(pcm) {
+        const n = pcm.length >> 1;
+        const h = this.history.length;
+        if (this.work.length !== h + n) this.work = new Float64Array(h + n);
+        const x = this.work;
+        x.set(this.history);
+        for (let i = 0; i < n; i++) {
+            const lo = pcm[i << 1];
+            const hi = pcm[(i << 1) + 1];
+            x[h + i] = ((hi << 24) >> 16) | lo;
+        }
+
+        const up = this.up;
+        const down = this.down;
+        const taps = this.taps;
+        const coefs = this.coefs;
+        const count = Math.max(0, Math.ceil((n * up - this.t) / down));
+        // Own ArrayBuffer: aligned for the Int16Array, and safe to hand to an encoder worker
+        const out = new Int16Array(count);
+        // t = newest * up + phase, stepped without dividing
+        let newest = h + Math.floor(this.t / up);
+        let phase = this.t % up;
+        for (let o = 0; o < count; o++) {
+            const c = phase * taps;
+            let acc = 0;
+            for (let k = 0; k < taps; k++) acc += coefs[c + k] * x[newest - k];
+            out[o] = acc > 32767 ? 32767 : acc < -32768 ? -32768 : Math.round(acc);
+            phase += down;
+            while (phase >= up) {
+                phase -= up;
+                newest++;
+            }
+        }
+        this.t = (newest - h - n) * up + phase;
+        this.history.set(x.subarray(n, n + h));
+        return Buffer.from(out.buffer);
+    }
+
+    reset() {
+        this.history.fill(0);
+        this.t = 0;
+    }
+}
+
+module.exports = { PolyphaseResampler };
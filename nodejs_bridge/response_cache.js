@@ -0,0 +1,255 @@
+// Response audio cache: answers a device has heard before (confirmations,
+// greetings, error messages) streamed from disk instead of a fresh
+// upstream response.
+//
+// Content addressed: a response's audio is stored once, with its transcript
+// (a hit adds it to the upstream conversation), under the hash of its
+// normalized transcript in a namespace derived from the session
+// configuration (new instructions or a new voice start a new namespace). A
+// prompt, the user's normalized input transcript, maps to the response it
+// got. Once the same prompt has got the same response minRepeats times in
+// a row, the next turn with that prompt is a hit. Answers that change (the
+// time, the weather) never repeat exactly, so they never become hits. A
+// mapping not confirmed by the upstream for ttlMs goes back upstream once
+// to be revalidated.
+//
+// Storage: one preallocated file of FRAME_BYTES slots (the largest
+// PLAY_AUDIO payload) written as a circular log. An entry is a run of
+// consecutive slots; it is evicted when the log wraps over it. The index
+// (<file>.json) is rewritten atomically a moment after changes and on
+// close, so after a crash it can name slots the log has since overwritten:
+// every entry keeps a hash of its audio, and a read that does not match is
+// a miss (the entry is dropped). Hits are positioned reads served from the
+// page cache, so a hot entry costs no disk I/O.
+const crypto = require('crypto');
+const fs = require('fs');
+const { LatencyHistogram } = require('./latency');
+
+const FRAME_BYTES = 1440;
+const INDEX_VERSION = 3;          // 2: entries keep their transcript, 3: and an audio hash
+const INDEX_WRITE_DELAY_MS = 2000;
+const MAX_PROMPTS = 10000;
+const MAX_ENTRY_BYTES = 60 * 1000 * 48;     // a minute of PCM16 at 24 kHz
+
+function pcmHash(pcm) {
+    return crypto.createHash('sha256').update(pcm).digest('hex').slice(0, 32);
+}
+
+// Case, punctuation and spacing do not make a different phrase
+function normalizeText(text) {
+    return String(text).normalize('NFKC').toLowerCase().replace(/[^\p{L}\p{N}]+/gu, ' ').trim();
+}
+
+class ResponseCache {
+    // opts: { file, capacityBytes, namespace, minRepeats, ttlMs }
+    constructor(opts) {
+        this.file = opts.file;
+        this.indexFile = `${opts.file}.json`;
+        this.slots = Math.max(1, Math.floor(opts.capacityBytes / FRAME_BYTES));
+        this.namespace = crypto.createHash('sha256').update(opts.namespace || '').digest('hex').slice(0, 16);
+        this.minRepeats = opts.minRepeats;
+        this.ttlMs = opts.ttlMs;
+
+        this.phrases = new Map();       // response key -> { slot, frames, bytes, hash, text, storedAt, hits }
+        this.prompts = new Map();       // prompt key -> { response, repeats, seenAt }, oldest first
+        this.cursor = 0;                // next slot of the circular log
+        this.indexTimer = null;
+
+        // Stats
+        this.hits = 0;
+        this.misses = 0;
+        this.late = 0;                  // input transcript arrived after upstream audio had started
+        this.stores = 0;
+        this.evictions = 0;
+        this.firstAudio = { hit: new LatencyHistogram(), miss: new LatencyHistogram() };
+
+        this.fd = this.open();
+    }
+
+    open() {
+        const size = this.slots * FRAME_BYTES;
+        let fd;
+        try {
+            fd = fs.openSync(this.file, fs.existsSync(this.file) ? 'r+' : 'w+');
+            if (fs.fstatSync(fd).size !== size) fs.ftruncateSync(fd, size);
+        } catch (err) {
+            console.error(`❌ Response cache ${this.file}: ${err.message}, cache disabled`);
+            if (fd !== undefined) fs.closeSync(fd);
+            return null;
+        }
+
+        let index = null;
+        try {
+            index = JSON.parse(fs.readFileSync(this.indexFile, 'utf8'));
+        } catch (err) {
+            if (err.code !== 'ENOENT') console.warn(`⚠️ Response cache index ${this.indexFile} unreadable, starting empty`);
+        }
+        // Entries are slot positions: only valid for the same layout
+        if (index && index.version === INDEX_VERSION && index.slots === this.slots) {
+            this.phrases = new Map(index.phrases);
+            this.prompts = new Map(index.prompts);
+            this.cursor = index.cursor;
+        }
+        return fd;
+    }
+
+    key(text) {
+        const normalized = normalizeText(text || '');
+        if (!normalized) return null;
+        return crypto.createHash('sha256').update(`${this.namespace}\n${normalized}`).digest('hex');
+    }
+
+    // Stored answer to this prompt as { pcm, text }, or null (a miss)
+    lookup(promptText) {
+        const prompt = this.prompts.get(this.key(promptText));
+        const entry = prompt && prompt.repeats >= this.minRepeats && Date.now() - prompt.seenAt <= this.ttlMs ?
+            this.phrases.get(prompt.response) : null;
+        const pcm = entry ? this.read(prompt.response, entry) : null;
+        if (!pcm) {
+            this.misses++;
+            return null;
+        }
+        this.hits++;
+        entry.hits++;
+        return { pcm, text: entry.text };
+    }
+
+    // A completed upstream turn: store its audio (once per response text)
+    // and count how often this prompt got this response
+    record(promptText, responseText, pcm) {
+        const promptKey = this.key(promptText);
+        const responseKey = this.key(responseText);
+        if (this.fd === null || !promptKey || !responseKey) return;
+        if (!this.phrases.has(responseKey) && !this.write(responseKey, responseText, pcm)) return;
+
+        const prompt = this.prompts.get(promptKey);
+        const repeats = prompt && prompt.response === responseKey ? prompt.repeats + 1 : 1;
+        this.prompts.delete(promptKey);
+        this.prompts.set(promptKey, { response: responseKey, repeats, seenAt: Date.now() });
+        while (this.prompts.size > MAX_PROMPTS) this.prompts.delete(this.prompts.keys().next().value);
+        this.scheduleIndexWrite();
+    }
+
+    write(key, text, pcm) {
+        const frames = Math.ceil(pcm.length / FRAME_BYTES);
+        if (frames === 0 || frames > this.slots || pcm.length > MAX_ENTRY_BYTES) return false;
+        if (this.cursor + frames > this.slots) this.cursor = 0;
+        const start = this.cursor;
+        const end = start + frames;
+        for (const [k, entry] of this.phrases) {
+            if (entry.slot < end && entry.slot + entry.frames > start) {
+                this.phrases.delete(k);
+                this.evictions++;
+            }
+        }
+        try {
+            fs.writeSync(this.fd, pcm, 0, pcm.length, start * FRAME_BYTES);
+        } catch (err) {
+            console.error(`❌ Response cache write failed: ${err.message}`);
+            return false;
+        }
+        this.phrases.set(key, {
+            slot: start, frames, bytes: pcm.length, hash: pcmHash(pcm), text, storedAt: Date.now(), hits: 0
+        });
+        this.cursor = end;
+        this.stores++;
+        return true;
+    }
+
+    read(key, entry) {
+        const pcm = Buffer.allocUnsafe(entry.bytes);
+        try {
+            if (fs.readSync(this.fd, pcm, 0, entry.bytes, entry.slot * FRAME_BYTES) !== entry.bytes) return null;
+        } catch (err) {
+            console.error(`❌ Response cache read failed: ${err.message}`);
+            return null;
+        }
+        // Overwritten after the index was last saved (crash after the log wrapped)
+        if (pcmHash(pcm) !== entry.hash) {
+            console.warn(`⚠️ Response cache slot ${entry.slot} no longer holds its entry, dropped`);
+            this.phrases.delete(key);
+            this.evictions++;
+            this.scheduleIndexWrite();
+            return null;
+        }
+        return pcm;
+    }
+
+    indexJson() {
+        return JSON.stringify({
+            version: INDEX_VERSION,
+            slots: this.slots,
+            cursor: this.cursor,
+            phrases: [...this.phrases],
+            prompts: [...this.prompts]
+        });
+    }
+
+    // Atomically, like the metrics textfile (a crash never leaves half an index)
+    scheduleIndexWrite() {
+        if (this.indexTimer) return;
+        this.indexTimer = setTimeout(() => {
+            this.indexTimer = null;
+            const tmp = `${this.indexFile}.${process.pid}.tmp`;
+            fs.writeFile(tmp, this.indexJson(), (err) => {
+                if (err) {
+                    console.error(`❌ Response cache index ${this.indexFile}: ${err.message}`);
+                    return;
+                }
+                fs.rename(tmp, this.indexFile, (renameErr) => {
+                    if (renameErr) console.error(`❌ Response cache index ${this.indexFile}: ${renameErr.message}`);
+                });
+            });
+        }, INDEX_WRITE_DELAY_MS);
+        this.indexTimer.unref();
+    }
+
+    close() {
+        if (this.fd === null) return;
+        if (this.indexTimer) {
+            clearTimeout(this.indexTimer);
+            this.indexTimer = null;
+        }
+        try {
+            const tmp = `${this.indexFile}.${process.pid}.tmp`;
+            fs.writeFileSync(tmp, this.indexJson());
+            fs.renameSync(tmp, this.indexFile);
+        } catch (err) {
+            console.error(`❌ Response cache index ${this.indexFile}: ${err.message}`);
+        }
+        fs.closeSync(this.fd);
+        this.fd = null;
+    }
+
+    stats() {
+        let usedFrames = 0;
+        for (const entry of this.phrases.values()) usedFrames += entry.frames;
+        let servable = 0;
+        for (const prompt of this.prompts.values()) {
+            if (prompt.repeats >= this.minRepeats && this.phrases.has(prompt.response)) servable++;
+        }
+        return {
+            entries: this.phrases.size,
+            prompts: this.prompts.size,
+            servable,
+            usedBytes: usedFrames * FRAME_BYTES,
+            capacityBytes: this.slots * FRAME_BYTES,
+            hits: this.hits,
+            misses: this.misses,
+            late: this.late,
+            stores: this.stores,
+            evictions: this.evictions
+        };
+    }
+}
+
+function formatCacheStats(s) {
+    const lookups = s.hits + s.misses;
+    return `Response cache: ${s.hits}/${lookups} hits` +
+           (lookups ? ` (${(100 * s.hits / lookups).toFixed(1)}%)` : '') +
+           `, ${s.late} too late, ${s.entries} responses (${s.servable} servable) in ` +
+           `${(s.usedBytes / 1048576).toFixed(1)}/${(s.capacityBytes / 1048576).toFixed(1)} MB, ` +
+           `${s.stores} stored, ${s.evictions} evicted`;
+}
+
+module.exports = { FRAME_BYTES, normalizeText, ResponseCache, formatCacheStats };
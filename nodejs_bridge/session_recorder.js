@@ -0,0 +1,111 @@
+// Per-session binary recording of everything crossing the bridge, for
+// reproducing field problems with tools/session_replay.js.
+//
+// Enabled with SESSION_RECORD_DIR: each device session writes
+// <dir>/<device id>-<start time>.vsr. Layout (little endian):
+//
+//   header  "VSRC" [u8 version=1][u8 reserved x3][f64 start, epoch ms]
+//   record  [u8 kind][u32 us since previous record][u32 length][payload]
+//
+// Times are monotonic (performance.now()). Payloads are the datagrams and
+// WebSocket messages exactly as sent or received; REC_EVENT payloads are
+// JSON ({"event":"upstream",...} when an upstream session is attached, etc.).
+const fs = require('fs');
+const path = require('path');
+const { performance } = require('perf_hooks');
+
+const REC_MAGIC = 'VSRC';
+const REC_VERSION = 1;
+const REC_HEADER_SIZE = 16;
+const REC_RECORD_HEADER_SIZE = 9;
+
+const REC_UDP_IN = 1;       // device -> bridge datagram
+const REC_UDP_OUT = 2;      // bridge -> device datagram
+const REC_WS_IN = 3;        // upstream -> bridge message
+const REC_WS_OUT = 4;       // bridge -> upstream message
+const REC_EVENT = 5;        // bridge event, JSON
+
+const REC_KIND_NAMES = { 1: 'udp_in', 2: 'udp_out', 3: 'ws_in', 4: 'ws_out', 5: 'event' };
+
+class SessionRecorder {
+    constructor(dir, deviceId) {
+        const start = new Date();
+        const name = `${deviceId.replace(/:/g, '')}-${start.toISOString().replace(/[:.]/g, '-')}.vsr`;
+        this.file = path.join(dir, name);
+        this.stream = fs.createWriteStream(this.file);
+        this.stream.on('error', (err) => {
+            console.error(`❌ Recording ${this.file} failed: ${err.message}`);
+            this.stream = null;
+        });
+        this.lastUs = performance.now() * 1000;
+        this.bytes = REC_HEADER_SIZE;
+
+        const header = Buffer.alloc(REC_HEADER_SIZE);
+        header.write(REC_MAGIC, 0, 'latin1');
+        header[4] = REC_VERSION;
+        header.writeDoubleLE(start.getTime(), 8);
+        this.stream.write(header);
+    }
+
+    // payload: Buffer or string (WebSocket text)
+    record(kind, payload) {
+        if (!this.stream) return;
+        const data = typeof payload === 'string' ? Buffer.from(payload) : payload;
+        const nowUs = performance.now() * 1000;
+        const record = Buffer.allocUnsafe(REC_RECORD_HEADER_SIZE + data.length);
+        record[0] = kind;
+        record.writeUInt32LE(Math.min(0xFFFFFFFF, Math.round(nowUs - this.lastUs)), 1);
+        record.writeUInt32LE(data.length, 5);
+        data.copy(record, REC_RECORD_HEADER_SIZE);
+        this.lastUs = nowUs;
+        this.bytes += record.length;
+        this.stream.write(record);
+    }
+
+    event(fields) {
+        this.record(REC_EVENT, JSON.stringify(fields));
+    }
+
+    close() {
+        if (!this.stream) return;
+        this.stream.end();
+        this.stream = null;
+    }
+}
+
+// { startMs, records: [{ kind, tUs (since start), data }] }; throws on a bad file
+function readRecording(buf) {
+    if (buf.length < REC_HEADER_SIZE || buf.toString('latin1', 0, 4) !== REC_MAGIC) {
+        throw new Error('not a session recording');
+    }
+    if (buf[4] !== REC_VERSION) {
+        throw new Error(`unsupported recording version ${buf[4]}`);
+    }
+    const records = [];
+    let tUs = 0;
+    let at = REC_HEADER_SIZE;
+    // A recording cut short (bridge killed) ends at its last whole record
+    while (at + REC_RECORD_HEADER_SIZE <= buf.length) {
+        const length = buf.readUInt32LE(at + 5);
+        if (at + REC_RECORD_HEADER_SIZE + length > buf.length) break;
+        tUs += buf.readUInt32LE(at + 1);
+        records.push({
+            kind: buf[at],
+            tUs,
+            data: buf.subarray(at + REC_RECORD_HEADER_SIZE, at + REC_RECORD_HEADER_SIZE + length)
+        });
+        at += REC_RECORD_HEADER_SIZE + length;
+    }
+    return { startMs: buf.readDoubleLE(8), records };
+}
+
+module.exports = {
+    REC_UDP_IN,
+    REC_UDP_OUT,
+    REC_WS_IN,
+    REC_WS_OUT,
+    REC_EVENT,
+    REC_KIND_NAMES,
+    SessionRecorder,
+    readRecording
+};
@@ -0,0 +1,197 @@
+// Decoder for the device telemetry snapshot (telemetry_snapshot_t in main/telemetry.h)
+const { UDP_MSG_STATS_REQUEST, UDP_MSG_STATS_RESPONSE } = require('./protocol');
+
+const HIST_BUCKETS = 20;
+const HIST_NAMES = ['i2sReadUs', 'i2sWriteUs', 'udpSendUs', 'chunkIntervalUs'];
+const TASK_NAMES = ['voice', 'udpRx', 'playback', 'dlog'];
+const STATE_NAMES = ['IDLE', 'USER_SPEAKING', 'AI_SPEAKING'];
+const HEAP_NAMES = ['internal', 'dma', 'psram'];
+const HEAP_SAMPLE_FIELDS = ['free', 'largestFreeBlock', 'minFree', 'freeBlocks', 'fragmentationPct'];
+
+// mem_alert_t bits (main/mem_monitor.h)
+const MEM_ALERT_NAMES = [
+    'STACK_LOW',
+    'INTERNAL_LOW',
+    'INTERNAL_FRAGMENTED',
+    'DMA_LOW',
+    'PSRAM_LOW',
+    'PSRAM_FRAGMENTED'
+];
+
+// Field order must match the C struct exactly; new fields are only appended
+const FIELDS = [
+    ['chunksCaptured', 'u32'],
+    ['captureErrors', 'u32'],
+    ['chunksPlayed', 'u32'],
+    ['playbackSessions', 'u32'],
+    ['underruns', 'u32'],
+    ['i2sWriteErrors', 'u32'],
+    ['stateChanges', 'u32'],
+    ['interrupts', 'u32'],
+    ['voiceState', 'u8'],
+    [null, 'pad3'],
+    ['packetsSent', 'u32'],
+    ['packetsReceived', 'u32'],
+    ['packetsLost', 'u32'],
+    ['sendErrors', 'u32'],
+    ['bytesSent', 'u32'],
+    ['bytesReceived', 'u32'],
+    ['queueDepth', 'u32'],
+    ['queueHighWater', 'u32'],
+    ['queueCapacity', 'u32'],
+    ['chunksQueued', 'u32'],
+    ['queueDrops', 'u32'],
+    ['heapInternalFree', 'u32'],
+    ['heapInternalMinFree', 'u32'],
+    ['heapInternalLargest', 'u32'],
+    ['heapPsramFree', 'u32'],
+    ['heapPsramMinFree', 'u32'],
+    ['heapPsramLargest', 'u32'],
+    ['taskCount', 'u32'],
+    ['stackFree', 'tasks'],
+    ['dlogDropped', 'u32'],
+    ['histograms', 'hist'],
+    // v2
+    ['memAlerts', 'u32'],
+    ['memAlertCount', 'u32'],
+    ['heaps', 'heaps'],
+    ['stackMinFree', 'tasks']
+];
+
+const HEADER_SIZE = 8;
+
+function buildStatsRequest() {
+    return Buffer.from([UDP_MSG_STATS_REQUEST]);
+}
+
+function isStatsResponse(msg) {
+    return msg.length >= HEADER_SIZE && msg[0] === UDP_MSG_STATS_RESPONSE;
+}
+
+// Returns a plain object, or null if the packet is malformed.
+// Fields beyond the advertised size (older firmware) are simply absent.
+function parseStatsSnapshot(msg) {
+    if (!isStatsResponse(msg)) return null;
+
+    const size = Math.min(msg.readUInt16LE(2), msg.length);
+    const snapshot = {
+        version: msg[1],
+        uptimeMs: msg.readUInt32LE(4)
+    };
+
+    let off = HEADER_SIZE;
+    for (const [name, type] of FIELDS) {
+        if (type === 'u32') {
+            if (off + 4 > size) break;
+            snapshot[name] = msg.readUInt32LE(off);
+            off += 4;
+        } else if (type === 'u8') {
+            if (off + 1 > size) break;
+            snapshot[name] = msg[off];
+            off += 1;
+        } else if (type === 'pad3') {
+            off += 3;
+        } else if (type === 'tasks') {
+            if (off + 4 * TASK_NAMES.length > size) break;
+            snapshot[name] = {};
+            TASK_NAMES.forEach((task, i) => {
+                snapshot[name][task] = msg.readUInt32LE(off + i * 4);
+            });
+            off += 4 * TASK_NAMES.length;
+        } else if (type === 'hist') {
+            if (off + 4 * HIST_BUCKETS * HIST_NAMES.length > size) break;
+            snapshot[name] = {};
+            for (const hist of HIST_NAMES) {
+                const buckets = [];
+                for (let b = 0; b < HIST_BUCKETS; b++) {
+                    buckets.push(msg.readUInt32LE(off));
+                    off += 4;
+                }
+                snapshot[name][hist] = buckets;
+            }
+        } else if (type === 'heaps') {
+            const sampleSize = 4 * HEAP_SAMPLE_FIELDS.length;
+            if (off + sampleSize * HEAP_NAMES.length > size) break;
+            snapshot[name] = {};
+            for (const heap of HEAP_NAMES) {
+                const sample = {};
+                for (const field of HEAP_SAMPLE_FIELDS) {
+                    sample[field] = msg.readUInt32LE(off);
+                    off += 4;
+                }
+                snapshot[name][heap] = sample;
+            }
+        }
+    }
+
+    if (snapshot.voiceState !== undefined) {
+        snapshot.voiceStateName = STATE_NAMES[snapshot.voiceState] || 'UNKNOWN';
+    }
+    if (snapshot.memAlerts !== undefined) {
+        snapshot.memAlertNames = memAlertNames(snapshot.memAlerts);
+    }
+    return snapshot;
+}
+
+function memAlertNames(bits) {
+    return MEM_ALERT_NAMES.filter((name, i) => bits & (1 << i));
+}
+
+// UDP_MSG_MEM_ALERT: [type][uint32 raised][uint32 active]
+function parseMemAlert(msg) {
+    if (msg.length < 9) return null;
+    const raised = msg.readUInt32LE(1);
+    const active = msg.readUInt32LE(5);
+    return {
+        raised,
+        active,
+        raisedNames: memAlertNames(raised),
+        activeNames: memAlertNames(active)
+    };
+}
+
+// Approximate percentile from a log2 histogram (upper edge of the bucket, in us)
+function histogramPercentile(buckets, pct) {
+    const total = buckets.reduce((a, b) => a + b, 0);
+    if (total === 0) return 0;
+
+    const target = total * pct / 100;
+    let seen = 0;
+    for (let b = 0; b < buckets.length; b++) {
+        seen += buckets[b];
+        if (seen >= target) return 2 ** (b + 1);
+    }
+    return 2 ** buckets.length;
+}
+
+function formatSnapshot(s) {
+    const parts = [
+        `v${s.version} up=${Math.round(s.uptimeMs / 1000)}s state=${s.voiceStateName}`,
+        `net tx=${s.packetsSent} rx=${s.packetsReceived} lost=${s.packetsLost} err=${s.sendErrors}`,
+        `audio cap=${s.chunksCaptured} played=${s.chunksPlayed} underruns=${s.underruns}`,
+        `queue ${s.queueDepth}/${s.queueCapacity} hw=${s.queueHighWater} drops=${s.queueDrops}`,
+        `heap int=${s.heapInternalFree} (min ${s.heapInternalMinFree}) psram=${s.heapPsramFree}`
+    ];
+    if (s.heaps) {
+        parts.push(`frag int=${s.heaps.internal.fragmentationPct}% psram=${s.heaps.psram.fragmentationPct}% ` +
+                   `dma_largest=${s.heaps.dma.largestFreeBlock}`);
+    }
+    if (s.memAlertNames && s.memAlertNames.length) {
+        parts.push(`alerts ${s.memAlertNames.join(',')}`);
+    }
+    if (s.histograms) {
+        const h = s.histograms;
+        parts.push(`p99 i2s_write<${histogramPercentile(h.i2sWriteUs, 99)}us ` +
+                   `udp_send<${histogramPercentile(h.udpSendUs, 99)}us`);
+    }
+    return parts.join(' | ');
+}
+
+module.exports = {
+    buildStatsRequest,
+    isStatsResponse,
+    parseStatsSnapshot,
+    parseMemAlert,
+    histogramPercentile,
+    formatSnapshot
+};
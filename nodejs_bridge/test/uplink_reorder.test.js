@@ -0,0 +1,83 @@
+// Regression cases for the uplink reorder window (uplink_reorder.js).
+//
+//   npm test
+const test = require('node:test');
+const assert = require('node:assert');
+const { UplinkReorder } = require('../uplink_reorder');
+
+const FRAME_BYTES = 40 * 24 * 2;    // the device's 40 ms chunk at 24 kHz
+
+// A frame whose first sample is its sequence number, so deliveries can be told apart
+function frame(sequence) {
+    const pcm = Buffer.alloc(FRAME_BYTES);
+    pcm.writeInt16LE(1000 + sequence, 0);
+    return pcm;
+}
+
+// windowMs 0 would conceal every hole at once; a long window leaves the
+// order to the arrivals. Each arrival is [sequence] or [sequence, recvMs].
+function run(arrivals, opts = { windowMs: 10000 }) {
+    const out = [];
+    const reorder = new UplinkReorder((pcm, captureUs, recvUs, concealed) => {
+        out.push(concealed ? 'c' : pcm.readInt16LE(0) - 1000);
+    }, opts);
+    let nowMs = 0;
+    for (const [sequence, recvMs] of arrivals) {
+        nowMs = recvMs !== undefined ? recvMs : nowMs + 40;
+        reorder.push(sequence, frame(sequence), null, nowMs * 1000);
+    }
+    reorder.reset();
+    return { out, stats: reorder.stats() };
+}
+
+test('in order', () => {
+    const { out, stats } = run([[0], [1], [2]]);
+    assert.deepStrictEqual(out, [0, 1, 2]);
+    assert.strictEqual(stats.lost, 0);
+});
+
+test('start of stream overtaken: 1, 0, 2', () => {
+    const { out, stats } = run([[1], [0], [2]]);
+    assert.deepStrictEqual(out, [0, 1, 2]);
+    assert.strictEqual(stats.reordered, 1);
+    assert.strictEqual(stats.lost, 0);
+});
+
+test('first datagram duplicated: 0, 1, 0', () => {
+    const { out, stats } = run([[0], [1], [0]]);
+    assert.deepStrictEqual(out, [0, 1]);
+    assert.strictEqual(stats.duplicates, 1);
+    assert.strictEqual(stats.late, 0);
+});
+
+test('first datagram lost, later 0 too late: 1, 2, (concealed), 0', () => {
+    const { out, stats } = run([[1], [2], [0]], { windowMs: 0 });
+    assert.deepStrictEqual(out, ['c', 1, 2]);
+    assert.strictEqual(stats.concealed, 1);
+    assert.strictEqual(stats.late, 1);
+});
+
+test('late datagram after its hole was concealed', () => {
+    const { out, stats } = run([[0], [2], [3], [1], [1]], { windowMs: 0 });
+    assert.deepStrictEqual(out, [0, 'c', 2, 3]);
+    assert.strictEqual(stats.late, 1);
+    assert.strictEqual(stats.duplicates, 1);
+});
+
+test('new stream after an idle gap', () => {
+    const { out } = run([[0, 0], [1, 40], [2, 80], [0, 2000], [1, 2040]]);
+    assert.deepStrictEqual(out, [0, 1, 2, 0, 1]);
+});
+
+test('new stream whose start was overtaken after an idle gap', () => {
+    const { out } = run([[0, 0], [1, 40], [2, 80], [3, 120], [1, 2000], [0, 2010], [2, 2040]]);
+    assert.deepStrictEqual(out, [0, 1, 2, 3, 0, 1, 2]);
+});
+
+test('new stream far behind without a gap', () => {
+    const arrivals = [];
+    for (let seq = 0; seq < 100; seq++) arrivals.push([seq]);
+    arrivals.push([0], [1]);
+    const { out } = run(arrivals);
+    assert.deepStrictEqual(out.slice(-3), [99, 0, 1]);
+});
@@ -0,0 +1,82 @@
+// Compares two kernel benchmark runs (main/audio_bench.c JSON lines).
+//
+//   node tools/bench_compare.js [--threshold <pct>] <baseline.jsonl> <current.jsonl>
+//
+// Inputs may be raw serial logs: lines that are not {"bench":"kernel",...}
+// objects are ignored. Exits 1 if any kernel's median cycles per frame grew
+// by more than the threshold (default 10%), so it can gate a build.
+
+const fs = require('fs');
+
+const args = process.argv.slice(2);
+let thresholdPct = 10;
+const files = [];
+
+for (let i = 0; i < args.length; i++) {
+    if (args[i] === '--threshold') thresholdPct = parseFloat(args[++i]);
+    else files.push(args[i]);
+}
+
+if (files.length !== 2 || !(thresholdPct >= 0)) {
+    console.error('Usage: node tools/bench_compare.js [--threshold <pct>] <baseline.jsonl> <current.jsonl>');
+    process.exit(2);
+}
+
+function loadRun(file) {
+    const kernels = new Map();
+    for (const line of fs.readFileSync(file, 'utf8').split('\n')) {
+        const start = line.indexOf('{"bench":"kernel"');
+        if (start < 0) continue;
+        try {
+            const result = JSON.parse(line.slice(start));
+            kernels.set(result.kernel, result);
+        } catch (e) {
+            // Truncated serial line
+        }
+    }
+    return kernels;
+}
+
+const baseline = loadRun(files[0]);
+const current = loadRun(files[1]);
+
+const first = (run) => run.values().next().value;
+const b0 = first(baseline);
+const c0 = first(current);
+if (!b0 || !c0) {
+    console.error('No benchmark results found');
+    process.exit(2);
+}
+if (b0.target !== c0.target || b0.profile !== c0.profile) {
+    console.warn(`⚠️ Comparing ${b0.target}/${b0.profile} against ${c0.target}/${c0.profile}`);
+}
+
+let regressions = 0;
+const rows = [];
+for (const [name, cur] of current) {
+    const base = baseline.get(name);
+    if (!base) {
+        rows.push([name, '-', cur.median, '', 'new']);
+        continue;
+    }
+    const deltaPct = base.median > 0 ? (cur.median - base.median) * 100 / base.median : 0;
+    const regressed = deltaPct > thresholdPct;
+    if (regressed) regressions++;
+    rows.push([name, base.median, cur.median, `${deltaPct >= 0 ? '+' : ''}${deltaPct.toFixed(1)}%`,
+               regressed ? 'REGRESSION' : '']);
+}
+for (const name of baseline.keys()) {
+    if (!current.has(name)) rows.push([name, baseline.get(name).median, '-', '', 'missing']);
+}
+
+const header = ['kernel', 'base median', 'median', 'delta', ''];
+const widths = header.map((h, i) => Math.max(h.length, ...rows.map(r => String(r[i]).length)));
+const fmt = (r) => r.map((c, i) => String(c).padEnd(widths[i])).join('  ').trimEnd();
+console.log(fmt(header));
+rows.forEach(r => console.log(fmt(r)));
+
+if (regressions > 0) {
+    console.log(`\n❌ ${regressions} kernel(s) regressed by more than ${thresholdPct}%`);
+    process.exit(1);
+}
+console.log(`\n✅ No kernel regressed by more than ${thresholdPct}%`);
@@ -0,0 +1,351 @@
+// Load test: how many concurrent devices one bridge process sustains at a
+// given latency.
+//
+//   node tools/bridge_load_test.js [--json] [--devices 1,10,25,50,100] [--seconds <n>]
+//                                  [--slo-ms <n>] [--turn-ms <n>] [--response-ms <n>]
+//                                  [--workers 0,1,2,4]
+//
+// Runs realtime_bridge.js as a child process against a mock Realtime API
+// (tools/mock_realtime_server.js, in another child) and drives it with
+// simulated devices on UDP: HELLO, a 40 ms uplink datagram every 40 ms,
+// PLAYBACK_COMPLETE after each response. The mock
+// answers every --turn-ms of received audio with a --response-ms response,
+// delivered faster than real time like the real API.
+//
+// Timestamps ride inside the audio (first 8 bytes, float64 epoch ms), so
+// all three processes measure on one clock:
+//   uplink       device send -> append received by the mock (includes batching)
+//   first chunk  mock sends the first delta -> device receives PLAY_AUDIO #0
+//   slip         how far the last chunk of a response arrives behind the
+//                30 ms-per-chunk schedule set by the first (pacing drift)
+// A step passes if first chunk p99 <= --slo-ms, uplink p99 <= UPLINK_BATCH_MS
+// + --slo-ms, slip p99 <= --slo-ms and no downlink chunk was lost.
+//
+// --workers repeats the ramp for each entry: 0 is a single bridge process,
+// n > 0 is udp_dispatcher.js in front of n bridge workers (scaling across
+// cores). Bridge CPU is then the dispatcher plus its workers.
+
+const dgram = require('dgram');
+const path = require('path');
+const { fork } = require('child_process');
+const fs = require('fs');
+const { performance } = require('perf_hooks');
+const {
+    UDP_HELLO_SIZE,
+    UDP_MSG_AUDIO_DATA,
+    UDP_MSG_HELLO,
+    UDP_MSG_HELLO_REQUEST,
+    UDP_MSG_PLAY_AUDIO,
+    UDP_MSG_PLAY_AUDIO_LAST,
+    UDP_MSG_PLAYBACK_COMPLETE
+} = require('../protocol');
+const { createMockRealtime } = require('./mock_realtime_server');
+
+const DATAGRAM_MS = 40;
+const DATAGRAM_BYTES = 48 * DATAGRAM_MS;   // PCM16 mono, 24 kHz
+const CHUNK_MS = 30;                        // 1440-byte downlink chunks
+const DELTA_BYTES = 4800;                   // 100 ms per response.audio.delta
+const DELTA_INTERVAL_MS = 20;               // 5x real time
+
+const nowMs = () => performance.timeOrigin + performance.now();
+
+function percentile(samples, p) {
+    if (samples.length === 0) return 0;
+    const sorted = samples.slice().sort((a, b) => a - b);
+    return sorted[Math.min(sorted.length - 1, Math.floor(p / 100 * sorted.length))];
+}
+
+// ==================== Mock Realtime API ====================
+
+// tools/mock_realtime_server.js in turn mode, no think time, with the
+// timestamps above read from the appends and written into each first delta
+function runMock(turnMs, responseMs) {
+    let uplinkMs = [];
+    createMockRealtime({
+        port: 0,
+        turnMs,
+        responseMs,
+        firstDeltaMs: 0,
+        deltaBytes: DELTA_BYTES,
+        deltaIntervalMs: DELTA_INTERVAL_MS,
+        onAppend: (audio) => {
+            const now = nowMs();
+            for (let at = 0; at + 8 <= audio.length; at += DATAGRAM_BYTES) {
+                uplinkMs.push(now - audio.readDoubleLE(at));
+            }
+        },
+        onDelta: (delta, index) => {
+            if (index === 0) delta.writeDoubleLE(nowMs(), 0);
+        }
+    }).then(({ port }) => process.send({ port }));
+
+    process.on('message', (m) => {
+        if (m === 'collect') {
+            process.send({ uplinkMs });
+            uplinkMs = [];
+        }
+    });
+}
+
+if (process.argv[2] === '--mock') {
+    runMock(parseFloat(process.argv[3]), parseFloat(process.argv[4]));
+    return;
+}
+
+// ==================== Simulated devices ====================
+
+let nextDeviceId = 1;
+
+class SimDevice {
+    constructor(bridgePort, results) {
+        this.id = nextDeviceId++;
+        this.bridgePort = bridgePort;
+        this.results = results;
+        this.socket = dgram.createSocket('udp4');
+        this.sequence = 0;
+        this.response = null;
+        this.timer = null;
+        this.socket.on('message', (msg) => this.onMessage(msg));
+    }
+
+    start() {
+        return new Promise((resolve) => {
+            this.socket.bind(0, '127.0.0.1', () => {
+                this.sendHello();
+                setTimeout(() => {
+                    this.timer = setInterval(() => this.sendAudio(), DATAGRAM_MS);
+                    resolve();
+                }, Math.random() * DATAGRAM_MS);
+            });
+        });
+    }
+
+    stop() {
+        clearInterval(this.timer);
+        this.socket.close();
+    }
+
+    send(packet) {
+        this.socket.send(packet, this.bridgePort, '127.0.0.1');
+    }
+
+    sendHello() {
+        const hello = Buffer.alloc(UDP_HELLO_SIZE);
+        hello[0] = UDP_MSG_HELLO;
+        hello[1] = 1;
+        hello.set([0x02, 0x10, 0xad, (this.id >> 16) & 0xff, (this.id >> 8) & 0xff, this.id & 0xff], 2);
+        hello.writeUInt16LE(24000, 8);
+        hello.writeUInt16LE(24000, 10);
+        this.send(hello);
+    }
+
+    sendAudio() {
+        const packet = Buffer.alloc(5 + DATAGRAM_BYTES);
+        packet[0] = UDP_MSG_AUDIO_DATA;
+        packet.writeUInt32LE(this.sequence++, 1);
+        packet.writeDoubleLE(nowMs(), 5);
+        this.send(packet);
+    }
+
+    onMessage(msg) {
+        const now = nowMs();
+        switch (msg[0]) {
+            case UDP_MSG_HELLO_REQUEST:
+                this.sendHello();
+                return;
+
+            case UDP_MSG_PLAY_AUDIO:
+            case UDP_MSG_PLAY_AUDIO_LAST: {
+                const sequence = msg.readUInt32LE(1);
+                if (sequence === 0) {
+                    this.finishResponse();
+                    this.response = { firstAt: now, expected: 1, lastFullAt: now, lastFullSeq: 0 };
+                    if (msg.length >= 5 + 8) this.results.firstChunkMs.push(now - msg.readDoubleLE(5));
+                } else if (this.response) {
+                    if (sequence !== this.response.expected) this.results.lost += Math.max(0, sequence - this.response.expected);
+                    this.response.expected = sequence + 1;
+                    if (msg[0] === UDP_MSG_PLAY_AUDIO) {
+                        this.response.lastFullAt = now;
+                        this.response.lastFullSeq = sequence;
+                    }
+                }
+                this.results.chunks++;
+                if (msg[0] === UDP_MSG_PLAY_AUDIO_LAST) {
+                    this.finishResponse();
+                    this.send(Buffer.from([UDP_MSG_PLAYBACK_COMPLETE]));
+                }
+                return;
+            }
+
+            default:
+                return;
+        }
+    }
+
+    finishResponse() {
+        const r = this.response;
+        if (!r) return;
+        this.response = null;
+        this.results.responses++;
+        this.results.slipMs.push(Math.max(0, r.lastFullAt - r.firstAt - r.lastFullSeq * CHUNK_MS));
+    }
+}
+
+// ==================== Driver ====================
+
+const args = process.argv.slice(2);
+const opts = {
+    json: false,
+    devices: [1, 10, 25, 50, 100],
+    seconds: 20,
+    sloMs: 100,
+    turnMs: 4000,
+    responseMs: 3000,
+    workers: [0]
+};
+for (let i = 0; i < args.length; i++) {
+    switch (args[i]) {
+        case '--json': opts.json = true; break;
+        case '--devices': opts.devices = args[++i].split(',').map((n) => parseInt(n, 10)); break;
+        case '--seconds': opts.seconds = parseFloat(args[++i]); break;
+        case '--slo-ms': opts.sloMs = parseFloat(args[++i]); break;
+        case '--turn-ms': opts.turnMs = parseFloat(args[++i]); break;
+        case '--response-ms': opts.responseMs = parseFloat(args[++i]); break;
+        case '--workers': opts.workers = args[++i].split(',').map((n) => parseInt(n, 10)); break;
+        default:
+            console.error('Usage: node tools/bridge_load_test.js [--json] [--devices 1,10,...] [--seconds <n>] ' +
+                          '[--slo-ms <n>] [--turn-ms <n>] [--response-ms <n>] [--workers 0,1,2,...]');
+            process.exit(1);
+    }
+}
+
+const sleep = (ms) => new Promise((resolve) => setTimeout(resolve, ms));
+const BRIDGE_PORT = 18080 + Math.floor(Math.random() * 1000);
+const UPLINK_BATCH_MS = parseInt(process.env.UPLINK_BATCH_MS || '100', 10);
+
+// CPU time of the bridge processes in ms from /proc (Linux only; null elsewhere)
+function cpuTimeMs(pids) {
+    try {
+        let total = 0;
+        for (const pid of pids) {
+            const fields = fs.readFileSync(`/proc/${pid}/stat`, 'utf8').split(') ')[1].split(' ');
+            total += (parseInt(fields[11], 10) + parseInt(fields[12], 10)) * 10;   // utime + stime, 100 Hz ticks
+        }
+        return total;
+    } catch (e) {
+        return null;
+    }
+}
+
+async function runStep(pids, mock, deviceCount, workerCount) {
+    const results = { firstChunkMs: [], slipMs: [], lost: 0, chunks: 0, responses: 0 };
+    const devices = Array.from({ length: deviceCount }, () => new SimDevice(BRIDGE_PORT, results));
+    await Promise.all(devices.map((d) => d.start()));
+
+    // Sessions connect upstream and the first turns start; then measure
+    await sleep(opts.turnMs + 1000);
+    results.firstChunkMs = [];
+    results.slipMs = [];
+    results.lost = 0;
+    results.chunks = 0;
+    results.responses = 0;
+    await new Promise((resolve) => { mock.once('message', resolve); mock.send('collect'); });
+    const cpuStart = cpuTimeMs(pids);
+    const start = performance.now();
+
+    await sleep(opts.seconds * 1000);
+
+    const elapsedMs = performance.now() - start;
+    const cpuEnd = cpuTimeMs(pids);
+    const { uplinkMs } = await new Promise((resolve) => { mock.once('message', resolve); mock.send('collect'); });
+    for (const d of devices) d.stop();
+
+    const row = {
+        bench: 'bridge_load',
+        workers: workerCount,
+        devices: deviceCount,
+        responses: results.responses,
+        firstChunkP50Ms: +percentile(results.firstChunkMs, 50).toFixed(1),
+        firstChunkP99Ms: +percentile(results.firstChunkMs, 99).toFixed(1),
+        uplinkP50Ms: +percentile(uplinkMs, 50).toFixed(1),
+        uplinkP99Ms: +percentile(uplinkMs, 99).toFixed(1),
+        slipP99Ms: +percentile(results.slipMs, 99).toFixed(1),
+        lostChunks: results.lost,
+        bridgeCpuPct: cpuStart !== null && cpuEnd !== null ? +((cpuEnd - cpuStart) / elapsedMs * 100).toFixed(1) : null
+    };
+    row.pass = results.responses > 0 &&
+        row.firstChunkP99Ms <= opts.sloMs &&
+        row.uplinkP99Ms <= UPLINK_BATCH_MS + opts.sloMs &&
+        row.slipP99Ms <= opts.sloMs &&
+        row.lostChunks === 0;
+
+    // Let the bridge retire these sessions before the next step
+    await sleep(4000);
+    return row;
+}
+
+async function main() {
+    const mock = fork(__filename, ['--mock', String(opts.turnMs), String(opts.responseMs)]);
+    const { port: mockPort } = await new Promise((resolve) => mock.once('message', resolve));
+
+    const env = {
+        ...process.env,
+        OPENAI_REALTIME_URL: `ws://127.0.0.1:${mockPort}`,
+        STATS_POLL_INTERVAL_MS: '0',
+        SESSION_IDLE_MS: '2000'
+    };
+    const stdio = ['ignore', 'ignore', 'inherit', 'ipc'];
+
+    const rows = [];
+    for (const workerCount of opts.workers) {
+        let target;
+        let pids;
+        if (workerCount === 0) {
+            target = fork(path.join(__dirname, '..', 'realtime_bridge.js'), [],
+                          { env: { ...env, LISTEN_PORT: String(BRIDGE_PORT) }, stdio });
+            pids = [target.pid];
+        } else {
+            target = fork(path.join(__dirname, '..', 'udp_dispatcher.js'),
+                          ['--listen', String(BRIDGE_PORT), '--spawn', String(workerCount), '--base-port', String(BRIDGE_PORT + 1)],
+                          { env, stdio });
+            const ready = await new Promise((resolve) => target.once('message', resolve));
+            pids = [ready.dispatcherPid, ...ready.workerPids];
+        }
+        await sleep(1500);
+
+        for (const devices of opts.devices) {
+            const row = await runStep(pids, mock, devices, workerCount);
+            rows.push(row);
+            if (opts.json) console.log(JSON.stringify(row));
+        }
+        target.kill('SIGINT');
+        await new Promise((resolve) => target.once('exit', resolve));
+    }
+    mock.kill();
+
+    if (!opts.json) {
+        console.log(`SLO: first chunk p99 <= ${opts.sloMs} ms, uplink p99 <= ${UPLINK_BATCH_MS + opts.sloMs} ms, ` +
+                    `slip p99 <= ${opts.sloMs} ms, no lost chunks`);
+        console.log('workers  devices  responses  first p50  first p99  uplink p50  uplink p99  slip p99  lost  bridge CPU %  pass');
+        for (const r of rows) {
+            console.log(`${String(r.workers).padStart(7)}  ${String(r.devices).padStart(7)} ${String(r.responses).padStart(10)} ` +
+                `${r.firstChunkP50Ms.toFixed(1).padStart(10)} ${r.firstChunkP99Ms.toFixed(1).padStart(10)} ` +
+                `${r.uplinkP50Ms.toFixed(1).padStart(11)} ${r.uplinkP99Ms.toFixed(1).padStart(11)} ` +
+                `${r.slipP99Ms.toFixed(1).padStart(9)} ${String(r.lostChunks).padStart(5)} ` +
+                `${(r.bridgeCpuPct === null ? '-' : r.bridgeCpuPct.toFixed(1)).padStart(13)}  ${r.pass ? 'yes' : 'NO'}`);
+        }
+    }
+    for (const workerCount of opts.workers) {
+        const sustained = rows.filter((r) => r.workers === workerCount && r.pass).map((r) => r.devices);
+        const summary = {
+            bench: 'bridge_load',
+            workers: workerCount,
+            sustainedDevices: sustained.length ? Math.max(...sustained) : 0,
+            sloMs: opts.sloMs
+        };
+        console.log(opts.json ? JSON.stringify(summary) :
+            `Sustained (${workerCount === 0 ? 'single bridge' : workerCount + ' worker(s)'}): ${summary.sustainedDevices} devices`);
+    }
+}
+
+main();
@@ -0,0 +1,68 @@
+// Polls telemetry snapshots from one or more devices over UDP.
+//
+//   node tools/device_stats.js [--json] [--interval <ms>] <device-ip> [<device-ip> ...]
+//
+// One request datagram per device per poll, all from a single socket, so a
+// large fleet costs one small packet each way.
+
+const dgram = require('dgram');
+const { DEVICE_UDP_PORT } = require('../protocol');
+const { buildStatsRequest, parseStatsSnapshot, formatSnapshot } = require('../telemetry');
+
+const args = process.argv.slice(2);
+let json = false;
+let intervalMs = 0;
+const devices = [];
+
+for (let i = 0; i < args.length; i++) {
+    if (args[i] === '--json') json = true;
+    else if (args[i] === '--interval') intervalMs = parseInt(args[++i], 10);
+    else devices.push(args[i]);
+}
+
+if (devices.length === 0) {
+    console.error('Usage: node tools/device_stats.js [--json] [--interval <ms>] <device-ip> [...]');
+    process.exit(1);
+}
+
+const TIMEOUT_MS = 1000;
+const socket = dgram.createSocket('udp4');
+let pending = new Set();
+let timeout = null;
+
+socket.on('message', (msg, rinfo) => {
+    const snapshot = parseStatsSnapshot(msg);
+    if (!snapshot) return;
+
+    pending.delete(rinfo.address);
+    if (json) {
+        console.log(JSON.stringify({ device: rinfo.address, time: Date.now(), ...snapshot }));
+    } else {
+        console.log(`📊 ${rinfo.address}: ${formatSnapshot(snapshot)}`);
+    }
+
+    if (pending.size === 0 && !intervalMs) finish();
+});
+
+function finish() {
+    clearTimeout(timeout);
+    for (const device of pending) {
+        console.warn(`⚠️ ${device}: no response`);
+    }
+    if (!intervalMs) socket.close();
+}
+
+function poll() {
+    pending = new Set(devices);
+    const request = buildStatsRequest();
+    for (const device of devices) {
+        socket.send(request, DEVICE_UDP_PORT, device);
+    }
+    clearTimeout(timeout);
+    timeout = setTimeout(finish, Math.min(TIMEOUT_MS, intervalMs || TIMEOUT_MS));
+}
+
+socket.bind(() => {
+    poll();
+    if (intervalMs) setInterval(poll, intervalMs);
+});
@@ -0,0 +1,55 @@
+// Asks a device to probe its link to the bridge and prints the result.
+//
+//   node tools/link_probe.js [--json] [--port <n>] [--timeout <ms>] <device-ip>
+//
+// The device sends paced probe bursts to its configured bridge, which echoes
+// them; the resulting link profile goes to the bridge and back to this tool.
+// The bridge has to be running, or every probe is counted as lost.
+
+const dgram = require('dgram');
+const { DEVICE_UDP_PORT } = require('../protocol');
+const { buildProbeRequest, parseProbeReport, formatProbeReport } = require('../link_probe');
+
+const args = process.argv.slice(2);
+let json = false;
+let port = DEVICE_UDP_PORT;
+let timeoutMs = 15000;
+let device = null;
+
+for (let i = 0; i < args.length; i++) {
+    if (args[i] === '--json') json = true;
+    else if (args[i] === '--port') port = parseInt(args[++i], 10);
+    else if (args[i] === '--timeout') timeoutMs = parseInt(args[++i], 10);
+    else device = args[i];
+}
+
+if (!device) {
+    console.error('Usage: node tools/link_probe.js [--json] [--port <n>] [--timeout <ms>] <device-ip>');
+    process.exit(1);
+}
+
+const socket = dgram.createSocket('udp4');
+
+const timeout = setTimeout(() => {
+    console.warn(`⚠️ ${device}: no probe report within ${timeoutMs} ms`);
+    socket.close();
+    process.exitCode = 1;
+}, timeoutMs);
+
+socket.on('message', (msg, rinfo) => {
+    const report = parseProbeReport(msg);
+    if (!report) return;
+
+    clearTimeout(timeout);
+    if (json) {
+        console.log(JSON.stringify({ device: rinfo.address, time: Date.now(), ...report }));
+    } else {
+        console.log(`📶 ${rinfo.address}: ${formatProbeReport(report)}`);
+    }
+    socket.close();
+});
+
+socket.bind(() => {
+    socket.send(buildProbeRequest(), port, device);
+    if (!json) console.log(`📶 Probing ${device}:${port} (takes a few seconds)...`);
+});
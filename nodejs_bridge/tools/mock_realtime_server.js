@@ -0,0 +1,354 @@
+// Local stand-in for the OpenAI Realtime API, for benchmarking and
+// regression runs of the bridge without network access or an API key.
+//
+//   node tools/mock_realtime_server.js [--port <n>] [--pcm <file>] [--response-ms <n>]
+//                                      [--delta-bytes <n>] [--delta-interval-ms <n>]
+//                                      [--first-delta-ms <n>] [--jitter-ms <n>] [--seed <n>]
+//                                      [--turn-ms <n>] [--vad-threshold <n>] [--silence-ms <n>]
+//                                      [--transcript <text>] [--transcript-ms <n>]
+//
+// Then run the bridge with OPENAI_REALTIME_URL=ws://127.0.0.1:<port>.
+//
+// Speaks the subset of the protocol the bridge uses: session.created /
+// session.update / session.updated, input_audio_buffer.append / commit /
+// clear (speech_started, speech_stopped, committed, cleared),
+// response.create, response.cancel (response.cancelled) and a response per
+// turn: created, audio.delta..., audio.done, audio_transcript.done, done.
+//
+// Turns end by a simple server VAD (mean |sample| of 20 ms frames above
+// --vad-threshold starts speech, --silence-ms below it ends it), or with
+// --turn-ms after every that much received audio whatever it contains.
+// A session updated with turn_detection: null has neither: like the live
+// API, turns are only committed by input_audio_buffer.commit and answered
+// on response.create.
+// Each response streams --pcm (raw PCM16 mono 24 kHz, or a WAV with a
+// 44-byte header) or a 440 Hz tone, cut to --response-ms, as --delta-bytes
+// deltas every --delta-interval-ms, the first --first-delta-ms after the
+// turn ends. --jitter-ms adds uniform +/- jitter to each of those delays
+// from a PRNG seeded with --seed, so a run repeats exactly. With
+// --transcript every committed turn gets that input transcription
+// (conversation.item.input_audio_transcription.completed) --transcript-ms
+// after the commit, as the bridge's response cache keys on it.
+// conversation.item.create and conversation.item.delete are acknowledged
+// (no conversation is kept).
+//
+// Also a module: createMockRealtime(opts) with the same options (camelCase)
+// plus hooks onAppend(audio) and onDelta(delta, index) for instrumentation
+// (tools/bridge_load_test.js uses them to stamp audio).
+
+const fs = require('fs');
+const WebSocket = require('ws');
+
+const PCM_BYTES_PER_MS = 48;        // PCM16 mono, 24 kHz
+const VAD_FRAME_BYTES = 20 * PCM_BYTES_PER_MS;
+
+const DEFAULTS = {
+    port: 8090,
+    host: '127.0.0.1',
+    pcm: null,
+    responseMs: null,               // null: all of --pcm, 2000 ms of tone
+    deltaBytes: 4800,               // 100 ms per delta
+    deltaIntervalMs: 20,            // 5x real time, like the live API
+    firstDeltaMs: 300,
+    jitterMs: 0,
+    seed: 1,
+    turnMs: 0,                      // 0: server VAD
+    vadThreshold: 500,
+    silenceMs: 500,
+    transcript: null,
+    transcriptMs: 150,
+    onAppend: null,
+    onDelta: null
+};
+
+// mulberry32: small deterministic PRNG in [0, 1)
+function prng(seed) {
+    let a = seed >>> 0;
+    return () => {
+        a = (a + 0x6D2B79F5) >>> 0;
+        let t = a;
+        t = Math.imul(t ^ (t >>> 15), t | 1);
+        t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+        return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+    };
+}
+
+function loadPcm(file) {
+    const data = fs.readFileSync(file);
+    const pcm = data.length > 44 && data.toString('latin1', 0, 4) === 'RIFF' ? data.subarray(44) : data;
+    return pcm.subarray(0, pcm.length & ~1);
+}
+
+function tone(ms) {
+    const samples = Math.round(ms * PCM_BYTES_PER_MS / 2);
+    const pcm = Buffer.alloc(samples * 2);
+    for (let i = 0; i < samples; i++) {
+        pcm.writeInt16LE(Math.round(8000 * Math.sin(2 * Math.PI * 440 * i / 24000)), i * 2);
+    }
+    return pcm;
+}
+
+function meanLevel(pcm) {
+    let sum = 0;
+    const samples = pcm.length >> 1;
+    for (let i = 0; i < samples; i++) sum += Math.abs(pcm.readInt16LE(i * 2));
+    return samples ? sum / samples : 0;
+}
+
+// One upstream session: its input buffer position, VAD state and response
+class MockSession {
+    constructor(ws, server, index) {
+        this.ws = ws;
+        this.server = server;
+        this.opts = server.opts;
+        this.id = `sess_mock_${index}`;
+        this.config = {};
+        this.positionMs = 0;            // input audio received in this session
+        this.turnMs = 0;                // --turn-ms: audio since the last turn
+        this.speaking = false;
+        this.lastSpeechMs = 0;
+        this.vadCarry = Buffer.alloc(0);
+        this.response = null;           // { id, cancelled }
+        this.items = 0;
+        this.addedItems = 0;            // conversation.item.create
+
+        ws.on('message', (data) => this.handle(data));
+        ws.on('close', () => {
+            if (this.response) this.response.cancelled = true;
+        });
+        this.send({ type: 'session.created', session: { id: this.id } });
+    }
+
+    send(message) {
+        if (this.ws.readyState === WebSocket.OPEN) this.ws.send(JSON.stringify(message));
+    }
+
+    handle(data) {
+        let message;
+        try {
+            message = JSON.parse(data.toString());
+        } catch (e) {
+            this.send({ type: 'error', error: { type: 'invalid_request_error', message: 'Invalid JSON' } });
+            return;
+        }
+        switch (message.type) {
+            case 'session.update':
+                Object.assign(this.config, message.session);
+                this.send({ type: 'session.updated', session: { id: this.id, ...this.config } });
+                break;
+
+            case 'input_audio_buffer.append':
+                this.append(Buffer.from(message.audio || '', 'base64'));
+                break;
+
+            case 'input_audio_buffer.commit':
+                this.endTurn(this.positionMs, false);
+                break;
+
+            case 'response.create':
+                this.respond();
+                break;
+
+            case 'input_audio_buffer.clear':
+                this.speaking = false;
+                this.turnMs = 0;
+                this.vadCarry = Buffer.alloc(0);
+                this.send({ type: 'input_audio_buffer.cleared' });
+                break;
+
+            case 'conversation.item.create': {
+                const item = { id: `item_mock_added_${++this.addedItems}`, ...message.item };
+                this.send({ type: 'conversation.item.created', item });
+                break;
+            }
+
+            case 'conversation.item.delete':
+                this.send({ type: 'conversation.item.deleted', item_id: message.item_id });
+                break;
+
+            case 'response.cancel':
+                if (this.response && !this.response.cancelled) {
+                    this.response.cancelled = true;
+                    this.send({ type: 'response.cancelled', response_id: this.response.id });
+                    this.response = null;
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    append(audio) {
+        if (this.opts.onAppend) this.opts.onAppend(audio);
+        const startMs = this.positionMs;
+        this.positionMs += audio.length / PCM_BYTES_PER_MS;
+        if (this.config.turn_detection === null) return;      // manual turns
+
+        if (this.opts.turnMs > 0) {
+            this.turnMs += audio.length / PCM_BYTES_PER_MS;
+            if (this.turnMs >= this.opts.turnMs) {
+                this.turnMs = 0;
+                if (!this.response) {
+                    this.send({ type: 'input_audio_buffer.speech_started', audio_start_ms: Math.round(startMs) });
+                    this.endTurn(this.positionMs, true);
+                }
+            }
+            return;
+        }
+
+        // Server VAD on whole 20 ms frames
+        let pcm = this.vadCarry.length ? Buffer.concat([this.vadCarry, audio]) : audio;
+        let frameStartMs = startMs - this.vadCarry.length / PCM_BYTES_PER_MS;
+        while (pcm.length >= VAD_FRAME_BYTES) {
+            const loud = meanLevel(pcm.subarray(0, VAD_FRAME_BYTES)) > this.opts.vadThreshold;
+            const frameEndMs = frameStartMs + VAD_FRAME_BYTES / PCM_BYTES_PER_MS;
+            if (loud) {
+                if (!this.speaking) {
+                    this.speaking = true;
+                    this.send({ type: 'input_audio_buffer.speech_started', audio_start_ms: Math.round(frameStartMs) });
+                }
+                this.lastSpeechMs = frameEndMs;
+            } else if (this.speaking && frameEndMs - this.lastSpeechMs >= this.opts.silenceMs) {
+                this.speaking = false;
+                this.endTurn(this.lastSpeechMs, true);
+            }
+            pcm = pcm.subarray(VAD_FRAME_BYTES);
+            frameStartMs = frameEndMs;
+        }
+        this.vadCarry = Buffer.from(pcm);
+    }
+
+    endTurn(audioEndMs, vad) {
+        const itemId = `item_mock_${++this.items}`;
+        if (vad) this.send({ type: 'input_audio_buffer.speech_stopped', audio_end_ms: Math.round(audioEndMs) });
+        this.send({ type: 'input_audio_buffer.committed', item_id: itemId });
+        this.send({ type: 'conversation.item.created', item: { id: itemId, type: 'message', role: 'user' } });
+        if (this.opts.transcript) {
+            this.server.delay(this.opts.transcriptMs).then(() => this.send({
+                type: 'conversation.item.input_audio_transcription.completed',
+                item_id: itemId,
+                content_index: 0,
+                transcript: this.opts.transcript
+            }));
+        }
+        // A manual commit waits for response.create
+        const detection = this.config.turn_detection;
+        if (vad && (!detection || detection.create_response !== false)) {
+            this.respond();
+        }
+    }
+
+    async respond() {
+        if (this.response) this.response.cancelled = true;
+        const response = { id: `resp_mock_${this.items}`, cancelled: false };
+        this.response = response;
+        const ids = { response_id: response.id, item_id: `item_mock_out_${this.items}`, output_index: 0, content_index: 0 };
+        const { deltaBytes, deltaIntervalMs, firstDeltaMs } = this.opts;
+        const clip = this.server.clip;
+
+        this.send({ type: 'response.created', response: { id: response.id, status: 'in_progress' } });
+        this.send({
+            type: 'response.output_item.added',
+            response_id: response.id,
+            output_index: 0,
+            item: { id: ids.item_id, type: 'message', role: 'assistant' }
+        });
+        await this.server.delay(firstDeltaMs);
+
+        for (let at = 0, index = 0; at < clip.length; at += deltaBytes, index++) {
+            if (response.cancelled) return;
+            // Copied so a hook may stamp it without touching the clip
+            const delta = Buffer.from(clip.subarray(at, at + deltaBytes));
+            if (this.opts.onDelta) this.opts.onDelta(delta, index);
+            this.send({ type: 'response.audio.delta', ...ids, delta: delta.toString('base64') });
+            if (at + deltaBytes < clip.length) await this.server.delay(deltaIntervalMs);
+        }
+        if (response.cancelled) return;
+
+        this.send({ type: 'response.audio.done', ...ids });
+        this.send({ type: 'response.audio_transcript.done', ...ids, transcript: 'Mock response.' });
+        this.send({ type: 'response.content_part.done', ...ids });
+        this.send({ type: 'response.output_item.done', response_id: response.id, output_index: 0 });
+        this.send({ type: 'response.done', response: { id: response.id, status: 'completed' } });
+        if (this.response === response) this.response = null;
+    }
+}
+
+// Resolves to { port, close() } once listening
+function createMockRealtime(options = {}) {
+    const opts = { ...DEFAULTS, ...options };
+    let clip = opts.pcm ? loadPcm(opts.pcm) : tone(opts.responseMs || 2000);
+    if (opts.responseMs) clip = clip.subarray(0, Math.round(opts.responseMs * PCM_BYTES_PER_MS) & ~1);
+    opts.deltaBytes &= ~1;
+
+    const random = prng(opts.seed);
+    const server = {
+        opts,
+        clip,
+        sessions: 0,
+        // A configured delay with its jitter (never negative)
+        delay(ms) {
+            const jittered = ms + (opts.jitterMs > 0 ? (random() * 2 - 1) * opts.jitterMs : 0);
+            return new Promise((resolve) => setTimeout(resolve, Math.max(0, jittered)));
+        }
+    };
+
+    const wss = new WebSocket.Server({ port: opts.port, host: opts.host });
+    wss.on('connection', (ws) => new MockSession(ws, server, ++server.sessions));
+
+    return new Promise((resolve, reject) => {
+        wss.once('error', reject);
+        wss.once('listening', () => resolve({
+            port: wss.address().port,
+            close: () => new Promise((done) => {
+                for (const client of wss.clients) client.terminate();
+                wss.close(done);
+            })
+        }));
+    });
+}
+
+module.exports = { createMockRealtime };
+
+if (require.main === module) {
+    const args = process.argv.slice(2);
+    const opts = {};
+    const numeric = {
+        '--port': 'port',
+        '--response-ms': 'responseMs',
+        '--delta-bytes': 'deltaBytes',
+        '--delta-interval-ms': 'deltaIntervalMs',
+        '--first-delta-ms': 'firstDeltaMs',
+        '--jitter-ms': 'jitterMs',
+        '--seed': 'seed',
+        '--turn-ms': 'turnMs',
+        '--vad-threshold': 'vadThreshold',
+        '--silence-ms': 'silenceMs',
+        '--transcript-ms': 'transcriptMs'
+    };
+    for (let i = 0; i < args.length; i++) {
+        if (args[i] === '--pcm' && i + 1 < args.length) {
+            opts.pcm = args[++i];
+        } else if (args[i] === '--transcript' && i + 1 < args.length) {
+            opts.transcript = args[++i];
+        } else if (numeric[args[i]] && i + 1 < args.length) {
+            opts[numeric[args[i]]] = parseFloat(args[++i]);
+        } else {
+            console.error('Usage: node tools/mock_realtime_server.js [--port <n>] [--pcm <file>] [--response-ms <n>]\n' +
+                          '           [--delta-bytes <n>] [--delta-interval-ms <n>] [--first-delta-ms <n>]\n' +
+                          '           [--jitter-ms <n>] [--seed <n>] [--turn-ms <n>] [--vad-threshold <n>] [--silence-ms <n>]\n' +
+                          '           [--transcript <text>] [--transcript-ms <n>]');
+            process.exit(1);
+        }
+    }
+    createMockRealtime(opts).then(({ port }) => {
+        const o = { ...DEFAULTS, ...opts };
+        console.log(`🧪 Mock Realtime API on ws://127.0.0.1:${port} ` +
+                    `(${o.turnMs > 0 ? `turn every ${o.turnMs} ms` : 'server VAD'}, first delta ${o.firstDeltaMs} ms, ` +
+                    `${o.deltaBytes}-byte deltas every ${o.deltaIntervalMs} ms, jitter ${o.jitterMs} ms)`);
+    }).catch((err) => {
+        console.error(`❌ Mock Realtime API: ${err.message}`);
+        process.exit(1);
+    });
+}
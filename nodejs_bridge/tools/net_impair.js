@@ -0,0 +1,271 @@
+// UDP impairment proxy between a device (or the host build) and the bridge.
+//
+//   node tools/net_impair.js [options]
+//   build-host/voice_host --mic in.wav --port 8081      # device talks to the proxy
+//
+// Datagrams from the device to --listen go to --bridge ("uplink"); everything
+// the bridge sends back to the proxy goes to the last device address seen
+// ("downlink"). Each direction runs its own impairment Link (impairment.js):
+// loss, Gilbert-Elliott burst loss, reordering, duplication, delay
+// distributions, a bandwidth cap, or a captured trace replayed packet by packet.
+//
+// Options (quick profile applied to both directions):
+//   --listen <port>         device-facing port (default 8081)
+//   --bridge <host:port>    bridge address (default 127.0.0.1:8080)
+//   --loss <p>              independent loss probability
+//   --burst <pGB,pBG>       Gilbert-Elliott burst loss transition probabilities
+//   --delay <ms>            mean one-way delay
+//   --jitter <ms>           normal jitter around --delay
+//   --reorder <p[,ms]>      hold back a fraction of packets by ms (default 50)
+//   --duplicate <p>         duplicate probability
+//   --rate <kbps>           bandwidth cap
+//   --trace <file>          replay a captured trace on both directions
+//   --scenario <file>       JSON scenario with timed phases (overrides the above)
+//   --seed <n>              PRNG seed (default 1)
+//   --duration-ms <n>       exit after n ms
+//   --report-ms <n>         status line interval (default 5000, 0 = off)
+//   --json                  print the final summary as JSON lines
+//
+// A scenario (see tools/scenarios/) is
+//   { "seed": 7, "loop": false, "phases": [
+//       { "name": "clean", "durationMs": 5000, "both": { "delay": { "dist": "constant", "meanMs": 5 } } },
+//       { "name": "fade", "durationMs": 10000, "uplink": { "burst": { "pGoodToBad": 0.02, "pBadToGood": 0.3 } } } ] }
+
+const dgram = require('dgram');
+const { performance } = require('perf_hooks');
+const { UDP_MSG_AUDIO_DATA, UDP_MSG_AUDIO_DATA_TS, UDP_MSG_PLAY_AUDIO, UDP_MSG_PLAY_AUDIO_LAST, UDP_AUDIO_HEADER_SIZE } = require('../protocol');
+const { Link, loadScenario, phaseProfiles } = require('../impairment');
+
+const args = process.argv.slice(2);
+const opts = {
+    listenPort: 8081,
+    bridgeHost: '127.0.0.1',
+    bridgePort: 8080,
+    seed: 1,
+    durationMs: 0,
+    reportMs: 5000,
+    json: false,
+    scenario: null
+};
+const quick = {};
+
+function usage() {
+    console.error('Usage: node tools/net_impair.js [--listen <port>] [--bridge <host:port>] [--loss <p>] [--burst <pGB,pBG>]');
+    console.error('       [--delay <ms>] [--jitter <ms>] [--reorder <p[,ms]>] [--duplicate <p>] [--rate <kbps>]');
+    console.error('       [--trace <file>] [--scenario <file>] [--seed <n>] [--duration-ms <n>] [--report-ms <n>] [--json]');
+    process.exit(1);
+}
+
+for (let i = 0; i < args.length; i++) {
+    const next = () => {
+        if (i + 1 >= args.length) usage();
+        return args[++i];
+    };
+    switch (args[i]) {
+        case '--listen': opts.listenPort = parseInt(next(), 10); break;
+        case '--bridge': {
+            const [host, port] = next().split(':');
+            opts.bridgeHost = host;
+            opts.bridgePort = parseInt(port || '8080', 10);
+            break;
+        }
+        case '--loss': quick.loss = parseFloat(next()); break;
+        case '--burst': {
+            const [pGoodToBad, pBadToGood] = next().split(',').map(parseFloat);
+            quick.burst = { pGoodToBad, pBadToGood };
+            break;
+        }
+        case '--delay': quick.delayMs = parseFloat(next()); break;
+        case '--jitter': quick.jitterMs = parseFloat(next()); break;
+        case '--reorder': {
+            const [probability, delayMs] = next().split(',').map(parseFloat);
+            quick.reorder = { probability, delayMs };
+            break;
+        }
+        case '--duplicate': quick.duplicate = parseFloat(next()); break;
+        case '--rate': quick.rateKbps = parseFloat(next()); break;
+        case '--trace': quick.trace = next(); break;
+        case '--scenario': opts.scenario = next(); break;
+        case '--seed': opts.seed = parseInt(next(), 10); break;
+        case '--duration-ms': opts.durationMs = parseInt(next(), 10); break;
+        case '--report-ms': opts.reportMs = parseInt(next(), 10); break;
+        case '--json': opts.json = true; break;
+        default: usage();
+    }
+}
+
+function quickPhases() {
+    const profile = {
+        loss: quick.loss,
+        burst: quick.burst,
+        reorder: quick.reorder,
+        duplicate: quick.duplicate,
+        rateKbps: quick.rateKbps,
+        trace: quick.trace
+    };
+    if (quick.delayMs !== undefined || quick.jitterMs !== undefined) {
+        profile.delay = quick.jitterMs
+            ? { dist: 'normal', meanMs: quick.delayMs || 0, jitterMs: quick.jitterMs }
+            : { dist: 'constant', meanMs: quick.delayMs };
+    }
+    return { phases: [{ name: 'cli', both: profile }] };
+}
+
+let scenario;
+try {
+    scenario = opts.scenario ? loadScenario(opts.scenario) : quickPhases();
+} catch (e) {
+    console.error(`❌ ${e.message}`);
+    process.exit(1);
+}
+const seed = scenario.seed ?? opts.seed;
+
+const links = {
+    uplink: new Link('uplink', seed),
+    downlink: new Link('downlink', seed + 1)
+};
+
+// ---- Scenario phases ----
+
+let phaseIndex = 0;
+
+function applyPhase(index) {
+    const phase = scenario.phases[index];
+    const profiles = phaseProfiles(phase);
+    try {
+        links.uplink.setProfile(profiles.uplink);
+        links.downlink.setProfile(profiles.downlink);
+    } catch (e) {
+        console.error(`❌ ${e.message}`);
+        process.exit(1);
+    }
+    if (scenario.phases.length > 1 || phase.name !== 'cli') {
+        console.log(`🎬 Phase ${index + 1}/${scenario.phases.length}: ${phase.name || 'unnamed'}`);
+    }
+
+    if (phase.durationMs && (index + 1 < scenario.phases.length || scenario.loop)) {
+        setTimeout(() => {
+            phaseIndex = (index + 1) % scenario.phases.length;
+            applyPhase(phaseIndex);
+        }, phase.durationMs).unref();
+    }
+}
+
+// ---- Delivery scheduler ----
+// One timer for all pending datagrams, ordered by (time, arrival), so equal
+// delivery times keep their order
+
+const pending = [];
+let nextId = 0;
+let timer = null;
+
+function schedule(at, send) {
+    const item = { at, id: nextId++, send };
+    let i = pending.length;
+    while (i > 0 && (pending[i - 1].at > at || (pending[i - 1].at === at && pending[i - 1].id > item.id))) {
+        i--;
+    }
+    pending.splice(i, 0, item);
+    if (i === 0) arm();
+}
+
+function arm() {
+    if (timer) clearTimeout(timer);
+    timer = null;
+    if (pending.length === 0) return;
+    timer = setTimeout(flush, Math.max(0, pending[0].at - performance.now()));
+}
+
+function flush() {
+    timer = null;
+    const now = performance.now();
+    while (pending.length && pending[0].at <= now + 0.5) {
+        pending.shift().send();
+    }
+    arm();
+}
+
+// ---- Sockets ----
+
+const deviceSocket = dgram.createSocket('udp4');     // faces the device
+const bridgeSocket = dgram.createSocket('udp4');     // faces the bridge
+let device = null;
+const highestSeq = { uplink: -1, downlink: -1 };
+
+function audioSequence(msg, direction) {
+    if (msg.length < UDP_AUDIO_HEADER_SIZE) return -1;
+    const type = msg[0];
+    const isAudio = direction === 'uplink'
+        ? type === UDP_MSG_AUDIO_DATA || type === UDP_MSG_AUDIO_DATA_TS
+        : type === UDP_MSG_PLAY_AUDIO || type === UDP_MSG_PLAY_AUDIO_LAST;
+    return isAudio ? msg.readUInt32LE(1) : -1;
+}
+
+function forward(direction, msg, deliver) {
+    const link = links[direction];
+    const now = performance.now();
+    for (const at of link.plan(msg.length, now)) {
+        schedule(at, () => {
+            const seq = audioSequence(msg, direction);
+            if (seq === 0) {
+                // A new response or recording restarts the sequence
+                highestSeq[direction] = 0;
+            } else if (seq > 0) {
+                if (seq < highestSeq[direction]) link.stats.outOfOrder++;
+                else highestSeq[direction] = seq;
+            }
+            link.stats.delivered++;
+            deliver(msg);
+        });
+    }
+}
+
+deviceSocket.on('message', (msg, rinfo) => {
+    if (!device || device.address !== rinfo.address || device.port !== rinfo.port) {
+        device = { address: rinfo.address, port: rinfo.port };
+        console.log(`📱 Device ${device.address}:${device.port}`);
+    }
+    forward('uplink', msg, (m) => bridgeSocket.send(m, opts.bridgePort, opts.bridgeHost));
+});
+
+bridgeSocket.on('message', (msg) => {
+    if (!device) return;
+    const target = device;
+    forward('downlink', msg, (m) => deviceSocket.send(m, target.port, target.address));
+});
+
+// ---- Reporting ----
+
+function statusLine(summary) {
+    return `${summary.received} in, ${summary.delivered} out, ${summary.lossPct}% dropped, ` +
+        `${summary.reordered} reordered, ${summary.outOfOrder} out of order, ` +
+        `p50/p95 ${summary.delayP50Ms}/${summary.delayP95Ms} ms`;
+}
+
+function report() {
+    console.log(`⬆️  ${statusLine(links.uplink.summary())}`);
+    console.log(`⬇️  ${statusLine(links.downlink.summary())}`);
+}
+
+function finish() {
+    if (opts.json) {
+        for (const link of Object.values(links)) {
+            console.log(JSON.stringify({ bench: 'impair', seed, scenario: opts.scenario, ...link.summary() }));
+        }
+    } else {
+        console.log('\n==== impairment summary ====');
+        report();
+    }
+    process.exit(0);
+}
+
+deviceSocket.bind(opts.listenPort, () => {
+    console.log(`🌐 Impairment proxy: device -> :${opts.listenPort} -> ${opts.bridgeHost}:${opts.bridgePort} (seed ${seed})`);
+    applyPhase(0);
+    if (opts.reportMs > 0) setInterval(report, opts.reportMs).unref();
+    if (opts.durationMs > 0) setTimeout(finish, opts.durationMs);
+});
+bridgeSocket.bind(0);
+
+process.on('SIGINT', finish);
+process.on('SIGTERM', finish);
@@ -0,0 +1,215 @@
+// Microbenchmark: chunk-list AudioRechunker (rechunker.js) against the
+// Buffer.concat version it replaced, on long responses and many concurrent
+// streams. Reports throughput and GC pauses; the output of both is checked
+// against the input byte for byte.
+//
+//   node tools/rechunker_bench.js [--json] [--seconds <n>] [--streams <n>] [--runs <n>]
+//
+// Deltas are sized like OpenAI's response.audio.delta (a few KB, varying).
+// Two consumer patterns:
+//   interleaved  each delta is followed by draining the full frames, like blastAvailableChunks()
+//   backlog      the whole response arrives before the drain (slow device pacing)
+
+const crypto = require('crypto');
+const { PerformanceObserver, performance } = require('perf_hooks');
+const { AudioRechunker } = require('../rechunker');
+
+// The previous implementation: concat on every delta, slice per frame
+class ConcatRechunker {
+    constructor(chunkSize = 1440) {
+        this.chunkSize = chunkSize;
+        this.buffer = Buffer.alloc(0);
+    }
+
+    get length() {
+        return this.buffer.length;
+    }
+
+    addData(audioBuffer) {
+        this.buffer = Buffer.concat([this.buffer, audioBuffer]);
+    }
+
+    getChunk() {
+        if (this.buffer.length >= this.chunkSize) {
+            const chunk = this.buffer.slice(0, this.chunkSize);
+            this.buffer = this.buffer.slice(this.chunkSize);
+            return chunk;
+        }
+        return null;
+    }
+
+    flush() {
+        const chunks = [];
+        while (this.buffer.length >= this.chunkSize) {
+            chunks.push(this.getChunk());
+        }
+        if (this.buffer.length > 0) {
+            chunks.push(this.buffer);
+            this.buffer = Buffer.alloc(0);
+        }
+        return chunks;
+    }
+}
+
+const IMPLEMENTATIONS = { concat: ConcatRechunker, chunklist: AudioRechunker };
+
+const args = process.argv.slice(2);
+const opts = { json: false, seconds: 120, streams: 64, runs: 3 };
+for (let i = 0; i < args.length; i++) {
+    switch (args[i]) {
+        case '--json': opts.json = true; break;
+        case '--seconds': opts.seconds = parseFloat(args[++i]); break;
+        case '--streams': opts.streams = parseInt(args[++i], 10); break;
+        case '--runs': opts.runs = parseInt(args[++i], 10); break;
+        default:
+            console.error('Usage: node tools/rechunker_bench.js [--json] [--seconds <n>] [--streams <n>] [--runs <n>]');
+            process.exit(1);
+    }
+}
+
+const BYTES_PER_SECOND = 48000;     // PCM16 mono, 24 kHz
+
+// Deterministic deltas: 2-10 KB, even lengths
+function makeDeltas(seconds, seed) {
+    let state = seed >>> 0;
+    const random = () => {
+        state = (Math.imul(state, 1664525) + 1013904223) >>> 0;
+        return state / 4294967296;
+    };
+    const total = Math.round(seconds * BYTES_PER_SECOND) & ~1;
+    const deltas = [];
+    let made = 0;
+    while (made < total) {
+        const size = Math.min(total - made, (1024 + Math.floor(random() * 4096)) * 2);
+        const delta = Buffer.allocUnsafe(size);
+        for (let i = 0; i < size; i++) delta[i] = (made + i) * 31 + (made >> 8);
+        deltas.push(delta);
+        made += size;
+    }
+    return deltas;
+}
+
+function digest(buffers) {
+    const hash = crypto.createHash('sha1');
+    for (const b of buffers) hash.update(b);
+    return hash.digest('hex');
+}
+
+// Feeds every stream's deltas round-robin. Timed runs only touch each
+// frame (like the UDP send copying it); verify runs hash the output per stream.
+function run(Impl, streams, pattern, verify) {
+    const rechunkers = streams.map(() => new Impl(1440));
+    const hashes = verify ? streams.map(() => crypto.createHash('sha1')) : null;
+    const longest = Math.max(...streams.map((s) => s.length));
+    let frames = 0;
+    let sink = 0;
+
+    const consume = (s, chunk) => {
+        if (verify) hashes[s].update(chunk);
+        sink += chunk[0] + chunk[chunk.length - 1];
+        frames++;
+    };
+    const drain = (s) => {
+        let chunk;
+        while ((chunk = rechunkers[s].getChunk()) !== null) consume(s, chunk);
+    };
+
+    for (let d = 0; d < longest; d++) {
+        for (let s = 0; s < streams.length; s++) {
+            if (d >= streams[s].length) continue;
+            rechunkers[s].addData(streams[s][d]);
+            if (pattern === 'interleaved') drain(s);
+        }
+    }
+    for (let s = 0; s < streams.length; s++) {
+        drain(s);
+        for (const chunk of rechunkers[s].flush()) consume(s, chunk);
+    }
+    return { frames, sink, hashes: verify ? hashes.map((h) => h.digest('hex')) : null };
+}
+
+// GC pauses observed while fn runs
+async function measure(fn) {
+    const pauses = [];
+    const observer = new PerformanceObserver((list) => {
+        for (const entry of list.getEntries()) pauses.push(entry.duration);
+    });
+    observer.observe({ entryTypes: ['gc'] });
+    const start = performance.now();
+    const result = fn();
+    const elapsedMs = performance.now() - start;
+    // GC entries are delivered asynchronously
+    await new Promise((resolve) => setTimeout(resolve, 10));
+    observer.disconnect();
+    return {
+        result,
+        elapsedMs,
+        gcCount: pauses.length,
+        gcTotalMs: pauses.reduce((a, b) => a + b, 0),
+        gcMaxMs: pauses.length ? Math.max(...pauses) : 0
+    };
+}
+
+const CASES = [
+    { name: 'long_response', streams: 1, seconds: opts.seconds },
+    { name: 'concurrent', streams: opts.streams, seconds: Math.min(opts.seconds, 20) }
+];
+
+async function main() {
+    const rows = [];
+    let mismatches = 0;
+
+    for (const c of CASES) {
+        const streams = [];
+        for (let s = 0; s < c.streams; s++) streams.push(makeDeltas(c.seconds, 1 + s));
+        const expected = streams.map(digest);
+        const bytes = streams.reduce((n, s) => n + s.reduce((m, d) => m + d.length, 0), 0);
+
+        for (const pattern of ['interleaved', 'backlog']) {
+            for (const [implName, Impl] of Object.entries(IMPLEMENTATIONS)) {
+                const check = run(Impl, streams, pattern, true);
+                if (check.hashes.some((h, i) => h !== expected[i])) mismatches++;
+
+                let best = null;
+                for (let r = 0; r < opts.runs; r++) {
+                    if (global.gc) global.gc();
+                    const m = await measure(() => run(Impl, streams, pattern, false));
+                    if (!best || m.elapsedMs < best.elapsedMs) best = m;
+                }
+                const row = {
+                    bench: 'rechunker',
+                    case: c.name,
+                    pattern,
+                    impl: implName,
+                    streams: c.streams,
+                    audioSeconds: c.seconds,
+                    bytes,
+                    frames: best.result.frames,
+                    elapsedMs: +best.elapsedMs.toFixed(2),
+                    mbPerSec: +(bytes / 1e6 / (best.elapsedMs / 1000)).toFixed(1),
+                    realtimeFactor: Math.round(c.streams * c.seconds * 1000 / best.elapsedMs),
+                    gcCount: best.gcCount,
+                    gcTotalMs: +best.gcTotalMs.toFixed(2),
+                    gcMaxMs: +best.gcMaxMs.toFixed(2)
+                };
+                rows.push(row);
+                if (opts.json) console.log(JSON.stringify(row));
+            }
+        }
+    }
+
+    if (!opts.json) {
+        console.log('case            pattern      impl       streams   MB/s   x realtime  GC n  GC total ms  GC max ms');
+        for (const r of rows) {
+            console.log(`${r.case.padEnd(15)} ${r.pattern.padEnd(12)} ${r.impl.padEnd(10)} ${String(r.streams).padStart(7)} ` +
+                `${String(r.mbPerSec).padStart(6)} ${String(r.realtimeFactor).padStart(12)} ${String(r.gcCount).padStart(5)} ` +
+                `${r.gcTotalMs.toFixed(2).padStart(12)} ${r.gcMaxMs.toFixed(2).padStart(10)}`);
+        }
+    }
+    if (mismatches) {
+        console.error(`❌ ${mismatches} runs produced output different from the input`);
+        process.exit(1);
+    }
+}
+
+main();
@@ -0,0 +1,149 @@
+// Benchmark: 16 -> 24 kHz uplink resampling (resampler.js), the bridge's
+// cost of devices sending AUDIO_SAMPLE_RATE_UPLINK=16000.
+//
+//   node tools/resampler_bench.js [--json] [--streams <n>] [--seconds <n>] [--runs <n>]
+//
+// Quality: pure tones at 16 kHz fed in 40 ms datagrams, compared with the
+// same tones generated at 24 kHz (filter delay removed); SNR per tone.
+// Throughput: --streams devices (default 100) of --seconds audio each, fed
+// datagram by datagram round-robin like the bridge sees them. Reported as
+// CPU per 40 ms datagram and as the share of one core the resampling of all
+// streams takes in real time. Also the uplink bandwidth saved per device.
+
+const { performance } = require('perf_hooks');
+const { PolyphaseResampler } = require('../resampler');
+const { UDP_AUDIO_TS_HEADER_SIZE } = require('../protocol');
+
+const args = process.argv.slice(2);
+const opts = { json: false, streams: 100, seconds: 20, runs: 3 };
+for (let i = 0; i < args.length; i++) {
+    switch (args[i]) {
+        case '--json': opts.json = true; break;
+        case '--streams': opts.streams = parseInt(args[++i], 10); break;
+        case '--seconds': opts.seconds = parseFloat(args[++i]); break;
+        case '--runs': opts.runs = parseInt(args[++i], 10); break;
+        default:
+            console.error('Usage: node tools/resampler_bench.js [--json] [--streams <n>] [--seconds <n>] [--runs <n>]');
+            process.exit(1);
+    }
+}
+
+const IN_RATE = 16000;
+const OUT_RATE = 24000;
+const FRAME_MS = 40;
+const FRAME_SAMPLES = IN_RATE * FRAME_MS / 1000;
+const IP_UDP_OVERHEAD = 28;
+
+function tone(rate, hz, samples, amplitude = 10000) {
+    const pcm = Buffer.alloc(samples * 2);
+    for (let i = 0; i < samples; i++) {
+        pcm.writeInt16LE(Math.round(amplitude * Math.sin(2 * Math.PI * hz * i / rate)), i * 2);
+    }
+    return pcm;
+}
+
+function frames(pcm) {
+    const out = [];
+    for (let at = 0; at < pcm.length; at += FRAME_SAMPLES * 2) out.push(pcm.subarray(at, at + FRAME_SAMPLES * 2));
+    return out;
+}
+
+// SNR of a tone through the resampler against the ideal 24 kHz tone
+function toneSnr(hz) {
+    const seconds = 1;
+    const resampler = new PolyphaseResampler(IN_RATE, OUT_RATE);
+    const out = Buffer.concat(frames(tone(IN_RATE, hz, IN_RATE * seconds)).map((f) => resampler.process(f)));
+    const delay = resampler.delaySamples;
+    let signal = 0;
+    let noise = 0;
+    // Skip the filter's start-up
+    for (let i = 480; i < (out.length >> 1); i++) {
+        const ideal = 10000 * Math.sin(2 * Math.PI * hz * (i - delay) / OUT_RATE);
+        const err = out.readInt16LE(i * 2) - ideal;
+        signal += ideal * ideal;
+        noise += err * err;
+    }
+    return +(10 * Math.log10(signal / Math.max(noise, 1e-9))).toFixed(1);
+}
+
+// Deterministic speech-band noise, one buffer per stream
+function makeStream(seconds, seed) {
+    let state = seed >>> 0;
+    const samples = Math.round(seconds * IN_RATE / FRAME_SAMPLES) * FRAME_SAMPLES;
+    const pcm = Buffer.alloc(samples * 2);
+    let y = 0;
+    for (let i = 0; i < samples; i++) {
+        state = (Math.imul(state, 1664525) + 1013904223) >>> 0;
+        y = 0.9 * y + 0.1 * ((state >>> 16) - 32768);      // lowpassed noise
+        pcm.writeInt16LE(Math.max(-32768, Math.min(32767, Math.round(y))), i * 2);
+    }
+    return frames(pcm);
+}
+
+function runStreams(streams) {
+    const resamplers = streams.map(() => new PolyphaseResampler(IN_RATE, OUT_RATE));
+    let outBytes = 0;
+    const cpuStart = process.cpuUsage();
+    const start = performance.now();
+    for (let f = 0; f < streams[0].length; f++) {
+        for (let s = 0; s < streams.length; s++) outBytes += resamplers[s].process(streams[s][f]).length;
+    }
+    const elapsedMs = performance.now() - start;
+    const cpu = process.cpuUsage(cpuStart);
+    return { elapsedMs, cpuMs: (cpu.user + cpu.system) / 1000, outBytes };
+}
+
+function main() {
+    const rows = [];
+    for (const hz of [300, 1000, 3000, 5000, 7000]) {
+        rows.push({ bench: 'resampler', case: 'tone', hz, snrDb: toneSnr(hz) });
+    }
+
+    const streams = [];
+    for (let s = 0; s < opts.streams; s++) streams.push(makeStream(opts.seconds, 1 + s));
+    const datagrams = opts.streams * streams[0].length;
+    let best = null;
+    for (let r = 0; r < opts.runs; r++) {
+        const m = runStreams(streams);
+        if (!best || m.cpuMs < best.cpuMs) best = m;
+    }
+    const expectedBytes = datagrams * FRAME_SAMPLES * 2 * OUT_RATE / IN_RATE;
+    rows.push({
+        bench: 'resampler',
+        case: 'throughput',
+        streams: opts.streams,
+        audioSeconds: opts.seconds,
+        datagrams,
+        outputComplete: Math.abs(best.outBytes - expectedBytes) <= opts.streams * 4,
+        cpuMs: +best.cpuMs.toFixed(1),
+        usPerDatagram: +(best.cpuMs * 1000 / datagrams).toFixed(2),
+        corePctPerStream: +(100 * best.cpuMs / (opts.seconds * 1000) / opts.streams).toFixed(4),
+        corePctAllStreams: +(100 * best.cpuMs / (opts.seconds * 1000)).toFixed(2)
+    });
+
+    // Uplink datagram on the wire (timestamped audio), per device
+    const wire = (rate) => (IP_UDP_OVERHEAD + UDP_AUDIO_TS_HEADER_SIZE + rate * FRAME_MS / 1000 * 2) * 8 * 1000 / FRAME_MS / 1000;
+    rows.push({
+        bench: 'resampler',
+        case: 'bandwidth',
+        kbps24k: +wire(OUT_RATE).toFixed(1),
+        kbps16k: +wire(IN_RATE).toFixed(1),
+        savedPct: +(100 * (1 - wire(IN_RATE) / wire(OUT_RATE))).toFixed(1)
+    });
+
+    if (opts.json) {
+        for (const row of rows) console.log(JSON.stringify(row));
+    } else {
+        console.log('tone SNR (16 -> 24 kHz): ' + rows.filter((r) => r.case === 'tone')
+            .map((r) => `${r.hz} Hz ${r.snrDb} dB`).join(', '));
+        const t = rows.find((r) => r.case === 'throughput');
+        console.log(`${t.streams} streams x ${t.audioSeconds} s: ${t.usPerDatagram} us per 40 ms datagram, ` +
+                    `${t.corePctPerStream}% of a core per stream, ${t.corePctAllStreams}% for all` +
+                    (t.outputComplete ? '' : ' (OUTPUT LENGTH MISMATCH)'));
+        const b = rows.find((r) => r.case === 'bandwidth');
+        console.log(`uplink per device: ${b.kbps24k} kbps at 24 kHz, ${b.kbps16k} kbps at 16 kHz (${b.savedPct}% less)`);
+    }
+    if (!rows.find((r) => r.case === 'throughput').outputComplete) process.exit(1);
+}
+
+main();
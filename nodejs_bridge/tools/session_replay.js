@@ -0,0 +1,590 @@
+// Replays a session recorded by the bridge (SESSION_RECORD_DIR, see
+// session_recorder.js), to reproduce field problems offline.
+//
+//   node tools/session_replay.js <file.vsr> --info
+//   node tools/session_replay.js <file.vsr> [--bridge] [--speed <x>] [--json]
+//   node tools/session_replay.js <file.vsr> --device <voice_host> [--speaker out.wav] [--speed <x>] [--json]
+//
+// --info        what is in the recording: message counts, upstream events,
+//               responses and the largest downlink gaps.
+// --bridge      (default) a fresh realtime_bridge.js between the recorded
+//               device (its datagrams, at their recorded times) and the
+//               recorded upstream (its messages, on the session the bridge
+//               uses; a recorded upstream loss closes it). What the bridge
+//               sends both ways is compared with the recording: downlink
+//               chunks and states, and the uplink audio it appends. Also
+//               reported: the bridge's first-chunk latency and CPU time.
+// --device      a host-built device (host/, voice_host) fed the recorded
+//               downlink at the recorded times; time and probe requests are
+//               answered live. Its mic plays the recorded uplink audio
+//               (upsampled to 48 kHz), so barge-ins happen as they did.
+//               Compared: what the device reports back
+//               (PLAYBACK_STARTED / COMPLETE, interrupts), plus the device's
+//               run summary (underruns, lost packets).
+// --speed x     runs the timeline x times faster. The bridge paces the
+//               downlink as much faster (DOWNLINK_PACE_SPEED) and the device
+//               runs its virtual clock at x, so the replay stays in step.
+//
+// Exits 1 when the replay does not match the recording, so it can gate a
+// change. Timestamps inside the audio are replayed as recorded.
+
+const crypto = require('crypto');
+const dgram = require('dgram');
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const { fork, spawn } = require('child_process');
+const { performance } = require('perf_hooks');
+const WebSocket = require('ws');
+const protocol = require('../protocol');
+const {
+    REC_UDP_IN,
+    REC_UDP_OUT,
+    REC_WS_IN,
+    REC_WS_OUT,
+    REC_EVENT,
+    REC_KIND_NAMES,
+    readRecording
+} = require('../session_recorder');
+const { buildTimeResponse, bridgeClockUs } = require('../latency');
+const { buildProbeEcho } = require('../link_probe');
+const { parseHello } = require('../device_session');
+
+const {
+    UDP_AUDIO_HEADER_SIZE,
+    UDP_AUDIO_TS_HEADER_SIZE,
+    UDP_MSG_AUDIO_DATA,
+    UDP_MSG_AUDIO_DATA_TS,
+    UDP_MSG_HELLO,
+    UDP_MSG_HELLO_REQUEST,
+    UDP_MSG_PLAY_AUDIO,
+    UDP_MSG_PLAY_AUDIO_LAST,
+    UDP_MSG_TIME_REQUEST,
+    UDP_MSG_TIME_RESPONSE,
+    UDP_MSG_PROBE,
+    UDP_MSG_PROBE_ECHO
+} = protocol;
+
+const DRAIN_IDLE_MS = 1500;         // replay is over once nothing moved for this long
+const DRAIN_MAX_MS = 30000;
+
+// Compared between recording and replay
+const DOWNLINK_TYPES = ['PLAY_AUDIO', 'PLAY_AUDIO_LAST', 'STATE_IDLE', 'STATE_USER_SPEAKING', 'STATE_AI_SPEAKING'];
+const DEVICE_REPORT_TYPES = ['PLAYBACK_STARTED', 'PLAYBACK_COMPLETE', 'INTERRUPT'];
+
+const TYPE_NAMES = {};
+for (const [key, value] of Object.entries(protocol)) {
+    if (key.startsWith('UDP_MSG_')) TYPE_NAMES[value] = key.slice(8);
+}
+const typeName = (msg) => TYPE_NAMES[msg[0]] || `0x${msg[0].toString(16)}`;
+
+function wsType(data) {
+    try {
+        return JSON.parse(data.toString()).type || '?';
+    } catch (e) {
+        return '?';
+    }
+}
+
+const sleep = (ms) => new Promise((resolve) => setTimeout(resolve, ms));
+
+const args = process.argv.slice(2);
+const opts = { file: null, mode: 'bridge', device: null, speaker: null, speed: 1, json: false };
+function usage() {
+    console.error('Usage: node tools/session_replay.js <file.vsr> [--info | --bridge | --device <voice_host>] ' +
+                  '[--speaker <out.wav>] [--speed <x>] [--json]');
+    process.exit(2);
+}
+for (let i = 0; i < args.length; i++) {
+    switch (args[i]) {
+        case '--info': opts.mode = 'info'; break;
+        case '--bridge': opts.mode = 'bridge'; break;
+        case '--device': opts.mode = 'device'; opts.device = args[++i]; break;
+        case '--speaker': opts.speaker = args[++i]; break;
+        case '--speed': opts.speed = parseFloat(args[++i]); break;
+        case '--json': opts.json = true; break;
+        default:
+            if (args[i].startsWith('--') || opts.file) usage();
+            opts.file = args[i];
+    }
+}
+if (!opts.file || !(opts.speed > 0) || (opts.mode === 'device' && !opts.device)) usage();
+
+let recording;
+try {
+    recording = readRecording(fs.readFileSync(opts.file));
+} catch (err) {
+    console.error(`❌ ${opts.file}: ${err.message}`);
+    process.exit(2);
+}
+const records = recording.records;
+const durationMs = records.length ? records[records.length - 1].tUs / 1000 : 0;
+
+// ==================== Digests ====================
+
+function countBy(items, key) {
+    const counts = {};
+    for (const item of items) {
+        const k = key(item);
+        counts[k] = (counts[k] || 0) + 1;
+    }
+    return counts;
+}
+
+// Downlink audio and states as the device got them
+function downlinkDigest(datagrams) {
+    const hash = crypto.createHash('sha1');
+    let audioBytes = 0;
+    for (const msg of datagrams) {
+        if (msg[0] === UDP_MSG_PLAY_AUDIO || msg[0] === UDP_MSG_PLAY_AUDIO_LAST) {
+            hash.update(msg.subarray(5));
+            audioBytes += msg.length - 5;
+        }
+    }
+    const counts = countBy(datagrams, typeName);
+    const compared = {};
+    for (const name of DOWNLINK_TYPES) compared[name] = counts[name] || 0;
+    return { counts: compared, audioBytes, audioSha1: hash.digest('hex').slice(0, 16) };
+}
+
+// Uplink audio as appended upstream, and the other requests; batching may
+// differ with timing, so appends are compared by content, not count
+function upstreamDigest(messages) {
+    const hash = crypto.createHash('sha1');
+    let audioBytes = 0;
+    const counts = {};
+    for (const data of messages) {
+        let message;
+        try {
+            message = JSON.parse(data.toString());
+        } catch (e) {
+            continue;
+        }
+        if (message.type === 'input_audio_buffer.append') {
+            const audio = Buffer.from(message.audio, 'base64');
+            hash.update(audio);
+            audioBytes += audio.length;
+        } else {
+            counts[message.type] = (counts[message.type] || 0) + 1;
+        }
+    }
+    return { counts, audioBytes, audioSha1: hash.digest('hex').slice(0, 16) };
+}
+
+function percentile(samples, p) {
+    if (samples.length === 0) return 0;
+    const sorted = samples.slice().sort((a, b) => a - b);
+    return sorted[Math.min(sorted.length - 1, Math.floor(p / 100 * sorted.length))];
+}
+
+// Bridge first-chunk latency of the recording: first delta of a response -> PLAY_AUDIO #0
+function recordedFirstChunkMs() {
+    const samples = [];
+    let firstDeltaUs = null;
+    for (const rec of records) {
+        if (rec.kind === REC_WS_IN && firstDeltaUs === null && wsType(rec.data) === 'response.audio.delta') {
+            firstDeltaUs = rec.tUs;
+        } else if (rec.kind === REC_UDP_OUT && firstDeltaUs !== null &&
+                   rec.data[0] === UDP_MSG_PLAY_AUDIO && rec.data.readUInt32LE(1) === 0) {
+            samples.push((rec.tUs - firstDeltaUs) / 1000);
+            firstDeltaUs = null;
+        } else if (rec.kind === REC_WS_IN && wsType(rec.data) === 'response.created') {
+            firstDeltaUs = null;
+        }
+    }
+    return samples;
+}
+
+function compare(label, recorded, replayed) {
+    const a = JSON.stringify(recorded);
+    const b = JSON.stringify(replayed);
+    if (!opts.json) {
+        console.log(`${a === b ? '✅' : '❌'} ${label}`);
+        if (a !== b) {
+            console.log(`     recorded: ${a}`);
+            console.log(`     replayed: ${b}`);
+        }
+    }
+    return a === b;
+}
+
+// ==================== --info ====================
+
+function info() {
+    const byKind = countBy(records, (r) => REC_KIND_NAMES[r.kind] || r.kind);
+    const udpIn = countBy(records.filter((r) => r.kind === REC_UDP_IN), (r) => typeName(r.data));
+    const udpOut = countBy(records.filter((r) => r.kind === REC_UDP_OUT), (r) => typeName(r.data));
+    const wsIn = countBy(records.filter((r) => r.kind === REC_WS_IN), (r) => wsType(r.data));
+    const wsOut = countBy(records.filter((r) => r.kind === REC_WS_OUT), (r) => wsType(r.data));
+    const events = records.filter((r) => r.kind === REC_EVENT)
+        .map((r) => ({ atMs: +(r.tUs / 1000).toFixed(1), ...JSON.parse(r.data.toString()) }));
+
+    // Gaps between consecutive downlink chunks of a response
+    const gaps = [];
+    let last = null;
+    for (const rec of records) {
+        if (rec.kind !== REC_UDP_OUT) continue;
+        const type = rec.data[0];
+        if (type !== UDP_MSG_PLAY_AUDIO && type !== UDP_MSG_PLAY_AUDIO_LAST) continue;
+        const seq = rec.data.readUInt32LE(1);
+        if (last && seq === last.seq + 1) {
+            gaps.push({ atMs: +(rec.tUs / 1000).toFixed(1), seq, gapMs: +((rec.tUs - last.tUs) / 1000).toFixed(1) });
+        }
+        last = type === UDP_MSG_PLAY_AUDIO_LAST ? null : { seq, tUs: rec.tUs };
+    }
+    gaps.sort((a, b) => b.gapMs - a.gapMs);
+    const firstChunk = recordedFirstChunkMs();
+
+    const result = {
+        replay: 'info',
+        file: path.basename(opts.file),
+        start: new Date(recording.startMs).toISOString(),
+        durationMs: +durationMs.toFixed(1),
+        records: byKind,
+        udpIn,
+        udpOut,
+        wsIn,
+        wsOut,
+        events,
+        responses: firstChunk.length,
+        bridgeFirstChunkP50Ms: +percentile(firstChunk, 50).toFixed(1),
+        largestGaps: gaps.slice(0, 5)
+    };
+    if (opts.json) {
+        console.log(JSON.stringify(result));
+        return;
+    }
+    console.log(`${result.file}: ${result.start}, ${(durationMs / 1000).toFixed(1)} s, ${records.length} records`);
+    for (const key of ['records', 'udpIn', 'udpOut', 'wsIn', 'wsOut']) {
+        console.log(`  ${key.padEnd(8)} ${Object.entries(result[key]).map(([k, v]) => `${k} ${v}`).join(', ')}`);
+    }
+    for (const e of events) console.log(`  ${String(e.atMs).padStart(10)} ms  ${JSON.stringify(e)}`);
+    console.log(`  ${firstChunk.length} response(s), bridge first chunk p50 ${result.bridgeFirstChunkP50Ms} ms`);
+    for (const g of result.largestGaps) {
+        console.log(`  gap ${g.gapMs} ms before chunk #${g.seq} at ${g.atMs} ms`);
+    }
+}
+
+// ==================== Timeline ====================
+
+// Calls dispatch(rec) for every record of the given kinds at its time / speed
+async function playTimeline(kinds, dispatch) {
+    const start = performance.now();
+    for (const rec of records) {
+        if (!kinds.includes(rec.kind)) continue;
+        const wait = start + rec.tUs / 1000 / opts.speed - performance.now();
+        if (wait > 1) await sleep(wait);
+        dispatch(rec);
+    }
+}
+
+// Resolves once activity() has not changed for DRAIN_IDLE_MS
+async function drain(activity) {
+    const start = Date.now();
+    let last = activity();
+    let lastChange = Date.now();
+    while (Date.now() - lastChange < DRAIN_IDLE_MS && Date.now() - start < DRAIN_MAX_MS) {
+        await sleep(100);
+        const now = activity();
+        if (now !== last) {
+            last = now;
+            lastChange = Date.now();
+        }
+    }
+}
+
+function cpuTimeMs(pid) {
+    try {
+        const fields = fs.readFileSync(`/proc/${pid}/stat`, 'utf8').split(') ')[1].split(' ');
+        return (parseInt(fields[11], 10) + parseInt(fields[12], 10)) * 10;
+    } catch (e) {
+        return null;
+    }
+}
+
+function bindSocket(socket) {
+    return new Promise((resolve) => socket.bind(0, '127.0.0.1', () => resolve(socket.address().port)));
+}
+
+// ==================== --bridge ====================
+
+async function replayBridge() {
+    // Recorded upstream: every pool connection is configured, the one the
+    // bridge starts talking on gets the recorded messages
+    const wss = new WebSocket.Server({ port: 0, host: '127.0.0.1' });
+    await new Promise((resolve) => wss.once('listening', resolve));
+    const connections = [];
+    let active = null;
+    const pendingWs = [];
+    const upstreamOut = [];
+    let wsSentAt = [];              // replay time of each first delta
+    const activate = (conn) => {
+        active = conn;
+        while (pendingWs.length > 0) deliverWs(pendingWs.shift());
+    };
+    const deliverWs = (data) => {
+        if (!active || active.ws.readyState !== WebSocket.OPEN) {
+            pendingWs.push(data);
+            return;
+        }
+        active.ws.send(data.toString());
+    };
+    wss.on('connection', (ws) => {
+        const conn = { ws, used: false };
+        connections.push(conn);
+        ws.on('message', (data) => {
+            const type = wsType(data);
+            if (type === 'session.update') {
+                ws.send(JSON.stringify({ type: 'session.updated' }));
+                return;
+            }
+            upstreamOut.push(data);
+            if (active !== conn && !conn.used) {
+                conn.used = true;
+                activate(conn);
+            }
+        });
+        ws.on('close', () => {
+            if (active === conn) active = null;
+        });
+        ws.send(JSON.stringify({ type: 'session.created' }));
+    });
+
+    const device = dgram.createSocket('udp4');
+    await bindSocket(device);
+    const bridgePort = 19080 + Math.floor(Math.random() * 1000);
+    const bridge = fork(path.join(__dirname, '..', 'realtime_bridge.js'), [], {
+        env: {
+            ...process.env,
+            LISTEN_PORT: String(bridgePort),
+            OPENAI_REALTIME_URL: `ws://127.0.0.1:${wss.address().port}`,
+            UPSTREAM_POOL_SIZE: '1',
+            STATS_POLL_INTERVAL_MS: '0',
+            SESSION_RECORD_DIR: '',
+            DOWNLINK_PACE_SPEED: String(opts.speed)
+        },
+        silent: true
+    });
+    bridge.stdout.resume();
+    bridge.stderr.resume();
+    // Ready once a warm upstream session exists
+    while (!connections.some((c) => c.ws.readyState === WebSocket.OPEN)) await sleep(20);
+    await sleep(100);
+    const cpuStart = cpuTimeMs(bridge.pid);
+
+    const downlink = [];
+    const firstChunkMs = [];
+    let firstDeltaAt = null;
+    const hello = records.find((r) => r.kind === REC_UDP_IN && r.data[0] === UDP_MSG_HELLO);
+    device.on('message', (msg) => {
+        if (msg[0] === UDP_MSG_HELLO_REQUEST) {
+            if (hello) device.send(hello.data, bridgePort, '127.0.0.1');
+            return;
+        }
+        downlink.push(msg);
+        if (msg[0] === UDP_MSG_PLAY_AUDIO && msg.readUInt32LE(1) === 0 && firstDeltaAt !== null) {
+            firstChunkMs.push(performance.now() - firstDeltaAt);
+            firstDeltaAt = null;
+        }
+    });
+
+    const wallStart = performance.now();
+    await playTimeline([REC_UDP_IN, REC_WS_IN, REC_EVENT], (rec) => {
+        if (rec.kind === REC_UDP_IN) {
+            device.send(rec.data, bridgePort, '127.0.0.1');
+        } else if (rec.kind === REC_WS_IN) {
+            const type = wsType(rec.data);
+            if (type === 'response.created') firstDeltaAt = null;
+            if (type === 'response.audio.delta' && firstDeltaAt === null) firstDeltaAt = performance.now();
+            deliverWs(rec.data);
+        } else {
+            const event = JSON.parse(rec.data.toString());
+            if (event.event === 'upstream_closed' && active) {
+                const conn = active;
+                active = null;
+                conn.ws.close();
+            }
+        }
+    });
+    await drain(() => downlink.length + upstreamOut.length);
+    const wallMs = performance.now() - wallStart;
+    const cpuEnd = cpuTimeMs(bridge.pid);
+
+    bridge.kill('SIGINT');
+    device.close();
+    for (const client of wss.clients) client.terminate();
+    wss.close();
+
+    const recordedDown = downlinkDigest(records.filter((r) => r.kind === REC_UDP_OUT).map((r) => r.data));
+    const replayedDown = downlinkDigest(downlink);
+    const recordedUp = upstreamDigest(records.filter((r) => r.kind === REC_WS_OUT).map((r) => r.data));
+    const replayedUp = upstreamDigest(upstreamOut);
+    const recordedFirst = recordedFirstChunkMs();
+
+    const ok = [
+        compare('downlink messages', recordedDown.counts, replayedDown.counts),
+        compare('downlink audio', [recordedDown.audioBytes, recordedDown.audioSha1], [replayedDown.audioBytes, replayedDown.audioSha1]),
+        compare('upstream requests', recordedUp.counts, replayedUp.counts),
+        compare('uplink audio', [recordedUp.audioBytes, recordedUp.audioSha1], [replayedUp.audioBytes, replayedUp.audioSha1])
+    ].every(Boolean);
+
+    const result = {
+        replay: 'bridge',
+        file: path.basename(opts.file),
+        speed: opts.speed,
+        recordedMs: +durationMs.toFixed(1),
+        wallMs: +wallMs.toFixed(1),
+        responses: firstChunkMs.length,
+        firstChunkRecordedP50Ms: +percentile(recordedFirst, 50).toFixed(1),
+        firstChunkP50Ms: +percentile(firstChunkMs, 50).toFixed(1),
+        firstChunkMaxMs: +(firstChunkMs.length ? Math.max(...firstChunkMs) : 0).toFixed(1),
+        bridgeCpuMs: cpuStart !== null && cpuEnd !== null ? cpuEnd - cpuStart : null,
+        downlink: replayedDown,
+        upstream: replayedUp,
+        match: ok
+    };
+    if (opts.json) {
+        console.log(JSON.stringify(result));
+    } else {
+        console.log(`${result.responses} response(s) in ${(wallMs / 1000).toFixed(1)} s ` +
+                    `(${(durationMs / 1000).toFixed(1)} s recorded, speed ${opts.speed}); ` +
+                    `bridge first chunk p50 ${result.firstChunkP50Ms} ms (recorded ${result.firstChunkRecordedP50Ms} ms), ` +
+                    `max ${result.firstChunkMaxMs} ms; bridge CPU ${result.bridgeCpuMs === null ? 'n/a' : result.bridgeCpuMs + ' ms'}`);
+        console.log(ok ? '✅ Replay matches the recording' : '❌ Replay differs from the recording');
+    }
+    return ok;
+}
+
+// ==================== --device ====================
+
+// The recorded uplink as a 48 kHz mic WAV for voice_host: each datagram at
+// the time it arrived (the device only streams in some states, so sequence
+// numbers have no fixed place in time), silence in between, each sample
+// repeated up to 48 kHz (the device decimates to its HELLO uplink rate)
+function writeMicWav(file) {
+    const audio = records.filter((r) => r.kind === REC_UDP_IN &&
+                                        (r.data[0] === UDP_MSG_AUDIO_DATA || r.data[0] === UDP_MSG_AUDIO_DATA_TS));
+    if (audio.length === 0) return false;
+    const helloRecord = records.find((r) => r.kind === REC_UDP_IN && r.data[0] === UDP_MSG_HELLO);
+    const hello = helloRecord ? parseHello(helloRecord.data) : null;
+    const uplinkHz = hello && 48000 % hello.uplinkHz === 0 ? hello.uplinkHz : 24000;
+    const factor = 48000 / uplinkHz;
+    const headerSize = (msg) => msg[0] === UDP_MSG_AUDIO_DATA_TS ? UDP_AUDIO_TS_HEADER_SIZE : UDP_AUDIO_HEADER_SIZE;
+    const offset = (rec) => Math.round(rec.tUs / 1000 * uplinkHz / 500) & ~1;   // uplink bytes
+    const last = audio[audio.length - 1];
+    const pcm = Buffer.alloc(offset(last) + last.data.length);
+    for (const rec of audio) {
+        const at = offset(rec);
+        // Ends the previous datagram early if it arrived late
+        rec.data.copy(pcm, at, headerSize(rec.data));
+    }
+
+    const samples = (pcm.length >> 1) * factor;
+    const wav = Buffer.alloc(44 + samples * 2);
+    wav.write('RIFF', 0, 'latin1');
+    wav.writeUInt32LE(36 + samples * 2, 4);
+    wav.write('WAVEfmt ', 8, 'latin1');
+    wav.writeUInt32LE(16, 16);
+    wav.writeUInt16LE(1, 20);               // PCM
+    wav.writeUInt16LE(1, 22);               // mono
+    wav.writeUInt32LE(48000, 24);
+    wav.writeUInt32LE(96000, 28);
+    wav.writeUInt16LE(2, 32);
+    wav.writeUInt16LE(16, 34);
+    wav.write('data', 36, 'latin1');
+    wav.writeUInt32LE(samples * 2, 40);
+    for (let i = 0; i < samples; i++) {
+        wav.writeInt16LE(pcm.readInt16LE(Math.floor(i / factor) * 2), 44 + i * 2);
+    }
+    fs.writeFileSync(file, wav);
+    return true;
+}
+
+async function replayDevice() {
+    const bridge = dgram.createSocket('udp4');
+    const bridgePort = await bindSocket(bridge);
+    const localPort = 20000 + Math.floor(Math.random() * 1000);
+    const hostArgs = ['--server', '127.0.0.1', '--port', String(bridgePort), '--local-port', String(localPort),
+                      '--speed', String(opts.speed), '--log-level', '2',
+                      '--duration-ms', String(Math.ceil(durationMs) + 3000)];
+    if (opts.speaker) hostArgs.push('--speaker', opts.speaker);
+    const micFile = path.join(os.tmpdir(), `session_replay_mic_${process.pid}.wav`);
+    if (writeMicWav(micFile)) hostArgs.push('--mic', micFile, '--tail-ms', '3000');
+    const host = spawn(opts.device, hostArgs, { stdio: ['ignore', 'pipe', 'inherit'] });
+    let hostOutput = '';
+    host.stdout.on('data', (d) => { hostOutput += d; });
+    const hostExit = new Promise((resolve) => host.on('exit', resolve));
+
+    const reports = [];
+    let deviceAddress = null;
+    let firstDatagram;
+    const started = new Promise((resolve) => { firstDatagram = resolve; });
+    bridge.on('message', (msg, rinfo) => {
+        if (!deviceAddress) {
+            deviceAddress = rinfo;
+            firstDatagram();
+        }
+        // Clock sync and link probes need live answers
+        if (msg[0] === UDP_MSG_TIME_REQUEST) {
+            const response = buildTimeResponse(msg, bridgeClockUs());
+            if (response) bridge.send(response, rinfo.port, rinfo.address);
+        } else if (msg[0] === UDP_MSG_PROBE) {
+            const echo = buildProbeEcho(msg);
+            if (echo) bridge.send(echo, rinfo.port, rinfo.address);
+        } else {
+            reports.push(msg);
+        }
+    });
+
+    await Promise.race([started, sleep(10000)]);
+    if (!deviceAddress) {
+        host.kill();
+        console.error('❌ The device never contacted the replay bridge');
+        return false;
+    }
+    // The recorded timeline starts at the device's HELLO, like this one
+    const skip = new Set([UDP_MSG_TIME_RESPONSE, UDP_MSG_PROBE_ECHO, UDP_MSG_HELLO_REQUEST]);
+    await playTimeline([REC_UDP_OUT], (rec) => {
+        if (!skip.has(rec.data[0])) bridge.send(rec.data, deviceAddress.port, deviceAddress.address);
+    });
+    await Promise.race([hostExit, sleep(3000 / opts.speed + 5000)]);
+    host.kill('SIGINT');
+    await hostExit;
+    bridge.close();
+    fs.rmSync(micFile, { force: true });
+
+    const deviceCounts = (datagrams) => {
+        const counts = countBy(datagrams, typeName);
+        const compared = {};
+        for (const name of DEVICE_REPORT_TYPES) compared[name] = counts[name] || 0;
+        return compared;
+    };
+    const recordedReports = deviceCounts(records.filter((r) => r.kind === REC_UDP_IN).map((r) => r.data));
+    const replayedReports = deviceCounts(reports);
+    const ok = compare('device reports', recordedReports, replayedReports);
+
+    const summaryAt = hostOutput.indexOf('==== host run summary');
+    const summary = summaryAt >= 0 ? hostOutput.slice(summaryAt).trim() : '';
+    if (opts.json) {
+        console.log(JSON.stringify({
+            replay: 'device',
+            file: path.basename(opts.file),
+            speed: opts.speed,
+            reports: replayedReports,
+            deviceSummary: summary.split('\n').slice(1),
+            match: ok
+        }));
+    } else {
+        if (summary) console.log(summary);
+        console.log(ok ? '✅ Device replay matches the recording' : '❌ Device replay differs from the recording');
+    }
+    return ok;
+}
+
+// ==================== Main ====================
+
+if (opts.mode === 'info') {
+    info();
+} else {
+    (opts.mode === 'bridge' ? replayBridge() : replayDevice()).then((ok) => process.exit(ok ? 0 : 1));
+}
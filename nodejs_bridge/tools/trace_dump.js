@@ -0,0 +1,159 @@
+// Pulls the binary trace rings from a device and writes Chrome trace / Perfetto JSON.
+//
+//   node tools/trace_dump.js <device-ip> [out.json]
+//
+// Open the result in chrome://tracing or https://ui.perfetto.dev
+// Each core's cycle counter is independent, so cores are shown as separate tracks.
+
+const dgram = require('dgram');
+const fs = require('fs');
+const {
+    DEVICE_UDP_PORT,
+    UDP_MSG_TRACE_REQUEST,
+    UDP_MSG_TRACE_DATA
+} = require('../protocol');
+
+const HEADER_SIZE = 16;   // trace_packet_header_t
+const EVENT_SIZE = 12;    // trace_event_t
+const NUM_CORES = 2;       // ESP32-S3
+const TIMEOUT_MS = 3000;
+
+// Keep in sync with trace_event_id_t in main/trace.h
+const EVENT_NAMES = {
+    1: { name: 'i2s_read', phase: 'B', args: ['arg0', 'bytes'] },
+    2: { name: 'i2s_read', phase: 'E', args: ['err', 'bytes'] },
+    3: { name: 'i2s_write', phase: 'B', args: ['seq', 'bytes'] },
+    4: { name: 'i2s_write', phase: 'E', args: ['err', 'bytes'] },
+    5: { name: 'queue_push', phase: 'i', args: ['depth', 'seq'] },
+    6: { name: 'queue_pop', phase: 'i', args: ['depth', 'seq'] },
+    7: { name: 'state_change', phase: 'i', args: ['from', 'to'] },
+    8: { name: 'udp_send', phase: 'i', args: ['bytes', 'seq'] },
+    9: { name: 'udp_recv', phase: 'i', args: ['type', 'bytes'] },
+    10: { name: 'i2s_rx_dma', phase: 'i', args: ['arg0', 'bytes'] },
+    11: { name: 'i2s_rx_overflow', phase: 'i', args: ['arg0', 'bytes'] },
+    12: { name: 'i2s_tx_dma', phase: 'i', args: ['arg0', 'bytes'] },
+    13: { name: 'i2s_tx_overflow', phase: 'i', args: ['arg0', 'bytes'] }
+};
+
+const deviceIp = process.argv[2];
+const outFile = process.argv[3] || 'trace.json';
+
+if (!deviceIp) {
+    console.error('Usage: node tools/trace_dump.js <device-ip> [out.json]');
+    process.exit(1);
+}
+
+// core -> { partCount, cpuHz, dropped, parts: Map(part -> Buffer of events) }
+const cores = new Map();
+
+function isComplete() {
+    if (cores.size < NUM_CORES) return false;
+    for (const core of cores.values()) {
+        if (core.parts.size < core.partCount) return false;
+    }
+    return true;
+}
+
+function parsePacket(msg) {
+    if (msg.length < HEADER_SIZE || msg[0] !== UDP_MSG_TRACE_DATA) return;
+
+    const coreId = msg[1];
+    const part = msg.readUInt16LE(2);
+    const partCount = msg.readUInt16LE(4);
+    const eventCount = msg.readUInt16LE(6);
+    const cpuHz = msg.readUInt32LE(8);
+    const dropped = msg.readUInt32LE(12);
+
+    if (!cores.has(coreId)) {
+        cores.set(coreId, { partCount, cpuHz, dropped, parts: new Map() });
+    }
+    cores.get(coreId).parts.set(part, msg.subarray(HEADER_SIZE, HEADER_SIZE + eventCount * EVENT_SIZE));
+}
+
+function toChromeTrace() {
+    const traceEvents = [];
+
+    for (const [coreId, core] of [...cores.entries()].sort((a, b) => a[0] - b[0])) {
+        traceEvents.push({ name: 'thread_name', ph: 'M', pid: 0, tid: coreId, args: { name: `core ${coreId}` } });
+
+        const cyclesPerUs = core.cpuHz / 1e6;
+        let first = true;
+        let prev = 0;
+        let unwrapped = 0;
+
+        for (let part = 0; part < core.partCount; part++) {
+            const events = core.parts.get(part);
+            if (!events) continue;
+
+            for (let off = 0; off + EVENT_SIZE <= events.length; off += EVENT_SIZE) {
+                const cycles = events.readUInt32LE(off);
+                const id = events.readUInt16LE(off + 4);
+                const arg0 = events.readUInt16LE(off + 6);
+                const arg1 = events.readUInt32LE(off + 8);
+
+                // Unwrap the 32-bit counter; small backwards steps are preemption
+                // between slot reservation and timestamping, not wraps
+                if (first) {
+                    first = false;
+                } else {
+                    const delta = (cycles - prev) >>> 0;
+                    unwrapped += delta < 0x80000000 ? delta : delta - 0x100000000;
+                }
+                prev = cycles;
+
+                const desc = EVENT_NAMES[id] || { name: `event_${id}`, phase: 'i' };
+                const argNames = desc.args || ['arg0', 'arg1'];
+                const ev = {
+                    name: desc.name,
+                    ph: desc.phase,
+                    ts: unwrapped / cyclesPerUs,
+                    pid: 0,
+                    tid: coreId,
+                    args: { [argNames[0]]: arg0, [argNames[1]]: arg1 }
+                };
+                if (desc.phase === 'i') ev.s = 't';
+                traceEvents.push(ev);
+            }
+        }
+
+        console.log(`Core ${coreId}: ${core.parts.size}/${core.partCount} packets, ${core.dropped} events dropped on device`);
+    }
+
+    return { traceEvents, displayTimeUnit: 'ms' };
+}
+
+const socket = dgram.createSocket('udp4');
+
+function finish() {
+    clearTimeout(timer);
+    socket.close();
+
+    if (cores.size === 0) {
+        console.error('❌ No trace data received');
+        process.exit(1);
+    }
+    if (!isComplete()) {
+        console.warn('⚠️ Some trace packets were lost, writing partial trace');
+    }
+
+    const trace = toChromeTrace();
+    fs.writeFileSync(outFile, JSON.stringify(trace));
+    console.log(`✅ Wrote ${trace.traceEvents.length} events to ${outFile}`);
+}
+
+const timer = setTimeout(finish, TIMEOUT_MS);
+
+socket.on('message', (msg) => {
+    parsePacket(msg);
+    if (isComplete()) finish();
+});
+
+socket.bind(() => {
+    socket.send(Buffer.from([UDP_MSG_TRACE_REQUEST]), DEVICE_UDP_PORT, deviceIp, (err) => {
+        if (err) {
+            console.error(`❌ Failed to send trace request: ${err.message}`);
+            process.exit(1);
+        }
+        console.log(`📡 Requested trace from ${deviceIp}:${DEVICE_UDP_PORT}`);
+    });
+});
@@ -0,0 +1,176 @@
+// Event-loop lag of the bridge's uplink path against device count.
+//
+//   node tools/uplink_bench.js [--json] [--devices 1,10,50,100,200] [--seconds <n>]
+//                              [--batch-ms <n>] [--workers <n>]
+//
+// Each simulated device delivers a 40 ms PCM datagram every 40 ms (random
+// phase) into the same code the bridge runs (uplink.js), and every append
+// goes out over a real WebSocket to a sink in a child process. Three modes:
+//   per-packet   one append per datagram, encoded on the main thread (the old bridge)
+//   batched      --batch-ms batches, encoded on the main thread
+//   batched+pool --batch-ms batches, encoded on --workers worker threads
+// Reported: event-loop delay percentiles (monitorEventLoopDelay), event-loop
+// utilisation, and appends/s plus audio bytes as counted by the sink.
+
+const { fork } = require('child_process');
+const { monitorEventLoopDelay, performance } = require('perf_hooks');
+const WebSocket = require('ws');
+const { EncodePool, UplinkBatcher } = require('../uplink');
+
+const DATAGRAM_MS = 40;
+const DATAGRAM_BYTES = 48 * DATAGRAM_MS;   // PCM16 mono, 24 kHz
+
+// Sink: counts appends and decoded audio bytes, reports on request
+if (process.argv[2] === '--sink') {
+    const wss = new WebSocket.Server({ port: 0, host: '127.0.0.1' });
+    let appends = 0;
+    let audioBytes = 0;
+    wss.on('connection', (ws) => {
+        ws.on('message', (data) => {
+            const message = JSON.parse(data.toString());
+            appends++;
+            audioBytes += Buffer.byteLength(message.audio, 'base64');
+        });
+    });
+    wss.on('listening', () => process.send({ port: wss.address().port }));
+    process.on('message', (m) => {
+        if (m === 'count') {
+            process.send({ appends, audioBytes });
+            appends = 0;
+            audioBytes = 0;
+        }
+    });
+    return;
+}
+
+const args = process.argv.slice(2);
+const opts = { json: false, devices: [1, 10, 50, 100, 200], seconds: 5, batchMs: 100, workers: 2 };
+for (let i = 0; i < args.length; i++) {
+    switch (args[i]) {
+        case '--json': opts.json = true; break;
+        case '--devices': opts.devices = args[++i].split(',').map((n) => parseInt(n, 10)); break;
+        case '--seconds': opts.seconds = parseFloat(args[++i]); break;
+        case '--batch-ms': opts.batchMs = parseInt(args[++i], 10); break;
+        case '--workers': opts.workers = parseInt(args[++i], 10); break;
+        default:
+            console.error('Usage: node tools/uplink_bench.js [--json] [--devices 1,10,...] [--seconds <n>] [--batch-ms <n>] [--workers <n>]');
+            process.exit(1);
+    }
+}
+
+const MODES = [
+    { name: 'per-packet', batchMs: 0, workers: 0 },
+    { name: 'batched', batchMs: opts.batchMs, workers: 0 },
+    { name: 'batched+pool', batchMs: opts.batchMs, workers: opts.workers }
+];
+
+// Speech-like content: a tone burst with quiet gaps, so the level-change
+// flushes fire about as often as with a real talker
+function makeDatagram(index) {
+    const pcm = Buffer.allocUnsafe(DATAGRAM_BYTES);
+    const voiced = (index % 50) < 35;
+    for (let i = 0; i < DATAGRAM_BYTES / 2; i++) {
+        const noise = ((i * 7919 + index * 104729) % 201) - 100;
+        const tone = voiced ? Math.round(6000 * Math.sin(2 * Math.PI * 220 * (index * DATAGRAM_MS / 1000 + i / 24000))) : 0;
+        pcm.writeInt16LE(tone + noise, i * 2);
+    }
+    return pcm;
+}
+const TEMPLATES = Array.from({ length: 50 }, (_, i) => makeDatagram(i));
+
+const sleep = (ms) => new Promise((resolve) => setTimeout(resolve, ms));
+
+function request(sink, message) {
+    return new Promise((resolve) => {
+        sink.once('message', resolve);
+        sink.send(message);
+    });
+}
+
+async function runPoint(sink, port, mode, deviceCount) {
+    const pool = mode.workers > 0 ? new EncodePool(mode.workers) : null;
+    const sockets = await Promise.all(Array.from({ length: deviceCount }, () => new Promise((resolve, reject) => {
+        const ws = new WebSocket(`ws://127.0.0.1:${port}`);
+        ws.on('open', () => resolve(ws));
+        ws.on('error', reject);
+    })));
+    const batchers = sockets.map((ws, key) => new UplinkBatcher((frame) => ws.send(frame, { binary: false }),
+        { batchMs: mode.batchMs, pool, key }));
+
+    // Warm-up traffic is discarded by the count below
+    const timers = [];
+    let datagrams = 0;
+    batchers.forEach((batcher, d) => {
+        let index = d * 7;
+        timers.push(setTimeout(() => {
+            timers.push(setInterval(() => {
+                // A fresh buffer per datagram, like dgram delivers
+                batcher.push(Buffer.from(TEMPLATES[index++ % TEMPLATES.length]));
+                datagrams++;
+            }, DATAGRAM_MS));
+        }, Math.random() * DATAGRAM_MS));
+    });
+    await sleep(500);
+    await request(sink, 'count');
+
+    const histogram = monitorEventLoopDelay({ resolution: 1 });
+    histogram.enable();
+    const eluStart = performance.eventLoopUtilization();
+    const start = performance.now();
+    datagrams = 0;
+    await sleep(opts.seconds * 1000);
+    const elapsedS = (performance.now() - start) / 1000;
+    const elu = performance.eventLoopUtilization(eluStart);
+    histogram.disable();
+    const sent = datagrams;
+
+    for (const t of timers) clearInterval(t);
+    for (const b of batchers) b.flush();
+    await Promise.all(batchers.map((b) => b.tail));
+    await sleep(200);
+    const counted = await request(sink, 'count');
+
+    for (const ws of sockets) ws.close();
+    if (pool) await pool.close();
+
+    return {
+        bench: 'uplink',
+        mode: mode.name,
+        devices: deviceCount,
+        batchMs: mode.batchMs,
+        workers: mode.workers,
+        lagP50Ms: +(histogram.percentile(50) / 1e6).toFixed(2),
+        lagP99Ms: +(histogram.percentile(99) / 1e6).toFixed(2),
+        lagMaxMs: +(histogram.max / 1e6).toFixed(2),
+        eluPct: +(elu.utilization * 100).toFixed(1),
+        datagramsPerSec: Math.round(sent / elapsedS),
+        appendsPerSec: Math.round(counted.appends / elapsedS),
+        audioKBps: Math.round(counted.audioBytes / 1024 / elapsedS)
+    };
+}
+
+async function main() {
+    const sink = fork(__filename, ['--sink']);
+    const { port } = await new Promise((resolve) => sink.once('message', resolve));
+
+    const rows = [];
+    for (const devices of opts.devices) {
+        for (const mode of MODES) {
+            const row = await runPoint(sink, port, mode, devices);
+            rows.push(row);
+            if (opts.json) console.log(JSON.stringify(row));
+        }
+    }
+    sink.kill();
+
+    if (!opts.json) {
+        console.log('devices  mode           lag p50 ms  lag p99 ms  lag max ms   ELU %  datagrams/s  appends/s  audio KB/s');
+        for (const r of rows) {
+            console.log(`${String(r.devices).padStart(7)}  ${r.mode.padEnd(13)} ${r.lagP50Ms.toFixed(2).padStart(11)} ` +
+                `${r.lagP99Ms.toFixed(2).padStart(11)} ${r.lagMaxMs.toFixed(2).padStart(11)} ${r.eluPct.toFixed(1).padStart(7)} ` +
+                `${String(r.datagramsPerSec).padStart(12)} ${String(r.appendsPerSec).padStart(10)} ${String(r.audioKBps).padStart(11)}`);
+        }
+    }
+}
+
+main();
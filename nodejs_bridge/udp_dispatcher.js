@@ -0,0 +1,333 @@
+// UDP front end for running the bridge as several worker processes, on this
+// host or others.
+//
+//   node udp_dispatcher.js [--listen <port>] [--spawn <n>] [--base-port <port>] [--worker <host:port>]...
+//
+// Devices talk to --listen (default 8080) exactly as they would to a single
+// bridge. Each device is placed on a worker by rendezvous (highest random
+// weight) hashing of its id from the HELLO handshake over the healthy
+// workers, so every dispatcher with the same worker list agrees and adding
+// a worker only moves the devices that now hash to it. A placement is kept
+// until its worker fails; then only that worker's devices are re-hashed.
+//
+// Every device gets its own upstream socket, so a worker sees one stable
+// address per device and its session table (device_session.js) works as is;
+// replies from the worker go back to the device from the listen port.
+//
+// Workers are health-checked with UDP_MSG_TIME_REQUEST. When one stops
+// answering, its devices move to their next-ranked worker and the device's
+// last HELLO (and link profile report) is replayed there first, so the new
+// worker opens the session without a HELLO_REQUEST round trip. The
+// conversation state held by the OpenAI session that was lost with the
+// worker does not move.
+//
+// --spawn starts n local workers (realtime_bridge.js on --base-port, +1, ...)
+// and restarts any that exit. Worker i serves metrics on METRICS_PORT + i
+// and writes METRICS_TEXTFILE as name-i.prom, when those are set. --worker
+// adds a remote or separately run one (an IP address, as the health check
+// matches answers by source address).
+// Bridge timestamps are on a shared wall-clock timeline (latency.js), so a
+// device's clock sync stays valid when it moves between workers.
+
+const dgram = require('dgram');
+const crypto = require('crypto');
+const path = require('path');
+const { fork } = require('child_process');
+const {
+    UDP_MSG_HELLO,
+    UDP_MSG_HELLO_REQUEST,
+    UDP_MSG_PROBE_REPORT,
+    UDP_MSG_TIME_REQUEST,
+    UDP_MSG_TIME_RESPONSE
+} = require('./protocol');
+const { parseHello } = require('./device_session');
+
+const HEALTH_INTERVAL_MS = 500;
+const HEALTH_TIMEOUT_MS = 1500;     // no answer for this long: worker is down
+const RESPAWN_DELAY_MS = 1000;
+const DEVICE_IDLE_MS = 60000;
+const HELLO_REQUEST_INTERVAL_MS = 1000;
+
+const args = process.argv.slice(2);
+const opts = { listenPort: 8080, spawn: 0, basePort: 8100, workers: [] };
+
+function usage() {
+    console.error('Usage: node udp_dispatcher.js [--listen <port>] [--spawn <n>] [--base-port <port>] [--worker <host:port>]...');
+    process.exit(1);
+}
+
+for (let i = 0; i < args.length; i++) {
+    const next = () => {
+        if (i + 1 >= args.length) usage();
+        return args[++i];
+    };
+    switch (args[i]) {
+        case '--listen': opts.listenPort = parseInt(next(), 10); break;
+        case '--spawn': opts.spawn = parseInt(next(), 10); break;
+        case '--base-port': opts.basePort = parseInt(next(), 10); break;
+        case '--worker': {
+            const [host, port] = next().split(':');
+            opts.workers.push({ host, port: parseInt(port, 10) });
+            break;
+        }
+        default: usage();
+    }
+}
+
+// ==================== Workers ====================
+
+const workers = [];
+let shuttingDown = false;
+
+function addWorker(host, port, spawnIndex = null) {
+    const worker = {
+        name: `${host}:${port}`,
+        host,
+        port,
+        healthy: false,
+        lastAnswerMs: 0,
+        devices: 0,
+        spawnIndex,
+        child: null
+    };
+    workers.push(worker);
+    return worker;
+}
+
+function spawnWorker(worker) {
+    const env = { ...process.env, LISTEN_PORT: String(worker.port) };
+    if (process.env.METRICS_PORT) {
+        env.METRICS_PORT = String(parseInt(process.env.METRICS_PORT, 10) + worker.spawnIndex);
+    }
+    if (process.env.METRICS_TEXTFILE) {
+        env.METRICS_TEXTFILE = process.env.METRICS_TEXTFILE.replace(/(\.prom)?$/, `-${worker.spawnIndex}$1`);
+    }
+    // One cache file per worker: the log and its index have a single writer
+    if (process.env.RESPONSE_CACHE_FILE) {
+        env.RESPONSE_CACHE_FILE = `${process.env.RESPONSE_CACHE_FILE}-${worker.spawnIndex}`;
+    }
+    const child = fork(path.join(__dirname, 'realtime_bridge.js'), [], { env });
+    worker.child = child;
+    console.log(`🚀 Worker ${worker.name} started (pid ${child.pid})`);
+    child.on('exit', (code, signal) => {
+        worker.child = null;
+        if (shuttingDown) return;
+        console.warn(`⚠️ Worker ${worker.name} exited (${signal || code}), restarting in ${RESPAWN_DELAY_MS} ms`);
+        setTimeout(() => spawnWorker(worker), RESPAWN_DELAY_MS);
+    });
+}
+
+for (let i = 0; i < opts.spawn; i++) {
+    spawnWorker(addWorker('127.0.0.1', opts.basePort + i, i));
+}
+for (const w of opts.workers) {
+    addWorker(w.host, w.port);
+}
+if (workers.length === 0) usage();
+
+// Rendezvous hashing: the healthy worker with the highest weight for this device
+function weight(deviceId, worker) {
+    return crypto.createHash('sha1').update(`${deviceId}|${worker.name}`).digest().readUInt32BE(0);
+}
+
+function pickWorker(deviceId) {
+    let best = null;
+    let bestWeight = -1;
+    for (const worker of workers) {
+        if (!worker.healthy) continue;
+        const w = weight(deviceId, worker);
+        if (w > bestWeight) {
+            best = worker;
+            bestWeight = w;
+        }
+    }
+    return best;
+}
+
+// Health checks share one control socket; any TIME_RESPONSE counts as an answer
+const controlSocket = dgram.createSocket('udp4');
+controlSocket.on('message', (msg, rinfo) => {
+    if (msg[0] !== UDP_MSG_TIME_RESPONSE) return;
+    const worker = workers.find((w) => w.port === rinfo.port && w.host === rinfo.address);
+    if (!worker) return;
+    worker.lastAnswerMs = Date.now();
+    if (!worker.healthy) {
+        worker.healthy = true;
+        console.log(`✅ Worker ${worker.name} is up`);
+        // Devices that arrived while no worker was up
+        for (const device of devices.values()) {
+            if (!device.worker) assign(device);
+        }
+    }
+});
+
+setInterval(() => {
+    const now = Date.now();
+    const ping = Buffer.alloc(9);
+    ping[0] = UDP_MSG_TIME_REQUEST;
+    ping.writeBigInt64LE(1n, 1);
+    for (const worker of workers) {
+        controlSocket.send(ping, worker.port, worker.host);
+        if (worker.healthy && now - worker.lastAnswerMs > HEALTH_TIMEOUT_MS) {
+            worker.healthy = false;
+            console.warn(`❌ Worker ${worker.name} is down, moving its ${worker.devices} device(s)`);
+            for (const device of devices.values()) {
+                if (device.worker === worker) assign(device);
+            }
+        }
+    }
+}, HEALTH_INTERVAL_MS);
+
+// ==================== Devices ====================
+
+const deviceSocket = dgram.createSocket('udp4');
+const devices = new Map();          // device id -> device
+const devicesByAddress = new Map(); // "ip:port" -> device
+const helloRequests = new Map();    // unknown "ip:port" -> last HELLO_REQUEST time
+
+let forwardedUp = 0;
+let forwardedDown = 0;
+
+function assign(device) {
+    const previous = device.worker;
+    const worker = pickWorker(device.id);
+    if (previous) previous.devices--;
+    device.worker = worker;
+    if (!worker) {
+        if (previous) console.warn(`⚠️ [${device.id}] No healthy worker`);
+        return;
+    }
+    worker.devices++;
+    if (previous && previous !== worker) {
+        console.log(`🔀 [${device.id}] ${previous.name} → ${worker.name}`);
+    }
+    // Introduce the device before its traffic arrives
+    introduce(device, worker.port, worker.host);
+}
+
+// HELLO, then the link profile the device runs with (sets the downlink frame size)
+function introduce(device, port, host) {
+    device.upstream.send(device.hello, port, host);
+    if (device.probeReport) device.upstream.send(device.probeReport, port, host);
+}
+
+function createDevice(hello, raw, rinfo) {
+    const device = {
+        id: hello.id,
+        hello: Buffer.from(raw),
+        probeReport: null,
+        address: rinfo.address,
+        port: rinfo.port,
+        worker: null,
+        lastSeenMs: Date.now(),
+        upstream: dgram.createSocket('udp4')
+    };
+    // Worker → device, from the port the device talks to
+    device.upstream.on('message', (msg, rinfo) => {
+        // A restarted worker asking who this is: answer from the cached HELLO
+        if (msg[0] === UDP_MSG_HELLO_REQUEST) {
+            introduce(device, rinfo.port, rinfo.address);
+            return;
+        }
+        forwardedDown++;
+        deviceSocket.send(msg, device.port, device.address);
+    });
+    device.upstream.bind(0);
+    devices.set(device.id, device);
+    return device;
+}
+
+function handleHello(msg, rinfo, addressKey) {
+    const hello = parseHello(msg);
+    if (!hello) return null;
+    helloRequests.delete(addressKey);
+
+    let device = devices.get(hello.id);
+    if (device) {
+        device.hello = Buffer.from(msg);
+        const oldKey = `${device.address}:${device.port}`;
+        if (oldKey !== addressKey) {
+            devicesByAddress.delete(oldKey);
+            device.address = rinfo.address;
+            device.port = rinfo.port;
+        }
+    } else {
+        device = createDevice(hello, msg, rinfo);
+        assign(device);
+        console.log(`📱 [${device.id}] ${addressKey} → ${device.worker ? device.worker.name : 'no worker yet'}`);
+    }
+    devicesByAddress.set(addressKey, device);
+    return device;
+}
+
+deviceSocket.on('message', (msg, rinfo) => {
+    if (msg.length === 0) return;
+    const addressKey = `${rinfo.address}:${rinfo.port}`;
+
+    let device = devicesByAddress.get(addressKey);
+    if (msg[0] === UDP_MSG_HELLO) {
+        device = handleHello(msg, rinfo, addressKey);
+    }
+    if (!device) {
+        const now = Date.now();
+        const last = helloRequests.get(addressKey);
+        if (last === undefined || now - last >= HELLO_REQUEST_INTERVAL_MS) {
+            helloRequests.set(addressKey, now);
+            deviceSocket.send(Buffer.from([UDP_MSG_HELLO_REQUEST]), rinfo.port, rinfo.address);
+        }
+        return;
+    }
+
+    device.lastSeenMs = Date.now();
+    if (msg[0] === UDP_MSG_PROBE_REPORT) device.probeReport = Buffer.from(msg);
+    if (!device.worker) return;
+    forwardedUp++;
+    device.upstream.send(msg, device.worker.port, device.worker.host);
+});
+
+deviceSocket.on('listening', () => {
+    console.log(`✅ Dispatcher listening on :${opts.listenPort} for ${workers.length} worker(s): ` +
+                workers.map((w) => w.name).join(', '));
+    // A parent (e.g. tools/bridge_load_test.js) may want to watch the workers
+    if (process.send) {
+        process.send({ dispatcherPid: process.pid, workerPids: workers.filter((w) => w.child).map((w) => w.child.pid) });
+    }
+});
+
+deviceSocket.on('error', (err) => {
+    console.error('❌ Dispatcher socket error:', err);
+});
+
+deviceSocket.bind(opts.listenPort);
+
+// Forget devices that went away
+setInterval(() => {
+    const now = Date.now();
+    for (const device of devices.values()) {
+        if (now - device.lastSeenMs > DEVICE_IDLE_MS) {
+            if (device.worker) device.worker.devices--;
+            device.upstream.close();
+            devices.delete(device.id);
+            devicesByAddress.delete(`${device.address}:${device.port}`);
+        }
+    }
+    for (const [addressKey, last] of helloRequests) {
+        if (now - last > DEVICE_IDLE_MS) helloRequests.delete(addressKey);
+    }
+}, 5000);
+
+setInterval(() => {
+    if (forwardedUp === 0 && forwardedDown === 0) return;
+    console.log(`📊 Dispatcher: ${devices.size} device(s), ${forwardedUp} up, ${forwardedDown} down; ` +
+                workers.map((w) => `${w.name} ${w.healthy ? w.devices : 'down'}`).join(', '));
+}, 30000);
+
+process.on('SIGINT', () => {
+    shuttingDown = true;
+    console.log('\n🛑 Dispatcher shutting down...');
+    const children = workers.filter((w) => w.child).map((w) => w.child);
+    for (const child of children) child.kill('SIGINT');
+    Promise.all(children.map((child) => new Promise((resolve) => child.once('exit', resolve))))
+        .then(() => process.exit(0));
+    setTimeout(() => process.exit(0), 3000).unref();
+});
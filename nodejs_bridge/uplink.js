@@ -0,0 +1,202 @@
+// Uplink audio to OpenAI: input_audio_buffer.append batching and off-thread
+// encoding.
+//
+// The device sends a 40 ms datagram 25 times a second. Forwarding each one as
+// its own append means 25 base64 + JSON frames per second per device, all on
+// the main event loop. UplinkBatcher instead collects a device's PCM for
+// batchMs (80-200 ms is sensible) and sends one append per batch; it flushes
+// early when the signal level crosses the quiet threshold, so OpenAI's VAD
+// sees the start and the end of speech without waiting for the timer.
+//
+// Encoding (concat, base64, JSON, UTF-8) runs on an EncodePool of worker
+// threads. The worker hands back the finished text frame as a transferred
+// buffer, so the main thread only queues it on the WebSocket.
+const { Worker, isMainThread, parentPort, workerData } = require('worker_threads');
+
+const APPEND_PREFIX = '{"type":"input_audio_buffer.append","audio":"';
+const APPEND_SUFFIX = '"}';
+
+const QUIET_LEVEL = 300;            // mean |sample| below this is silence (~-40 dBFS)
+const LEVEL_STRIDE = 8;             // samples skipped between level reads
+const MAX_BATCH_BYTES = 48 * 500;   // never hold more than 500 ms, whatever batchMs says
+
+// One input_audio_buffer.append as a UTF-8 text frame. The output is not
+// pool-backed so its ArrayBuffer can be transferred.
+function encodeAppend(pcm) {
+    const audio = pcm.toString('base64');
+    const frame = Buffer.allocUnsafeSlow(APPEND_PREFIX.length + audio.length + APPEND_SUFFIX.length);
+    let at = frame.write(APPEND_PREFIX, 0, 'latin1');
+    at += frame.write(audio, at, 'latin1');
+    frame.write(APPEND_SUFFIX, at, 'latin1');
+    return frame;
+}
+
+// Copies a batch into one buffer that can be transferred to a worker
+function joinBatch(buffers, bytes) {
+    const pcm = Buffer.allocUnsafeSlow(bytes);
+    let at = 0;
+    for (const b of buffers) at += b.copy(pcm, at);
+    return pcm;
+}
+
+function isQuiet(pcm) {
+    const samples = pcm.length >> 1;
+    if (samples === 0) return true;
+    let sum = 0;
+    let n = 0;
+    for (let i = 0; i < samples; i += LEVEL_STRIDE, n++) {
+        sum += Math.abs(pcm.readInt16LE(i << 1));
+    }
+    return sum / n < QUIET_LEVEL;
+}
+
+class EncodePool {
+    constructor(size) {
+        this.workers = [];
+        this.pending = new Map();
+        this.nextId = 0;
+        for (let i = 0; i < size; i++) {
+            const worker = new Worker(__filename, { workerData: { uplinkEncoder: true } });
+            worker.on('message', ({ id, frame }) => {
+                const job = this.pending.get(id);
+                if (!job) return;
+                this.pending.delete(id);
+                job.resolve(Buffer.from(frame.buffer, frame.byteOffset, frame.byteLength));
+            });
+            worker.on('error', (err) => {
+                console.error(`❌ Uplink encoder worker failed: ${err.message}`);
+                // Its batches were transferred to it and are lost; later ones encode elsewhere
+                this.workers = this.workers.filter((w) => w !== worker);
+                for (const [id, job] of this.pending) {
+                    if (job.worker === worker) {
+                        this.pending.delete(id);
+                        job.resolve(null);
+                    }
+                }
+            });
+            worker.unref();
+            this.workers.push(worker);
+        }
+    }
+
+    get size() {
+        return this.workers.length;
+    }
+
+    // Resolves to the append frame, or null if its worker died. The batch's
+    // buffer is transferred. A device's batches all go to the same worker.
+    encode(pcm, key) {
+        if (this.workers.length === 0) return Promise.resolve(encodeAppend(pcm));
+        const worker = this.workers[key % this.workers.length];
+        const id = this.nextId++;
+        return new Promise((resolve) => {
+            this.pending.set(id, { resolve, worker });
+            worker.postMessage({ id, pcm }, [pcm.buffer]);
+        });
+    }
+
+    close() {
+        const workers = this.workers;
+        this.workers = [];
+        return Promise.all(workers.map((w) => w.terminate()));
+    }
+}
+
+class UplinkBatcher {
+    // send(frame, bytes) gets each finished append frame, in order, with the
+    // number of PCM bytes in it.
+    // batchMs 0 sends one append per datagram, like the bridge used to.
+    constructor(send, { batchMs = 100, pool = null, key = 0 } = {}) {
+        this.send = send;
+        this.batchMs = batchMs;
+        this.pool = pool;
+        this.key = key;
+        this.buffers = [];
+        this.bytes = 0;
+        this.timer = null;
+        this.quiet = true;
+        this.generation = 0;
+        this.tail = Promise.resolve();
+        this.appends = 0;
+        this.datagrams = 0;
+    }
+
+    push(pcm) {
+        if (pcm.length === 0) return;
+        this.buffers.push(pcm);
+        this.bytes += pcm.length;
+        this.datagrams++;
+
+        const quiet = isQuiet(pcm);
+        const levelChanged = quiet !== this.quiet;
+        this.quiet = quiet;
+
+        if (this.batchMs <= 0 || levelChanged || this.bytes >= MAX_BATCH_BYTES) {
+            this.flush();
+        } else if (!this.timer) {
+            this.timer = setTimeout(() => {
+                this.timer = null;
+                this.flush();
+            }, this.batchMs);
+        }
+    }
+
+    flush() {
+        if (this.timer) {
+            clearTimeout(this.timer);
+            this.timer = null;
+        }
+        if (this.bytes === 0) return;
+
+        const buffers = this.buffers;
+        const bytes = this.bytes;
+        this.buffers = [];
+        this.bytes = 0;
+        this.appends++;
+
+        if (!this.pool) {
+            this.send(encodeAppend(buffers.length === 1 ? buffers[0] : Buffer.concat(buffers, bytes)), bytes);
+            return;
+        }
+        // Sent strictly in flush order, whichever encode finishes first
+        const generation = this.generation;
+        const encoded = this.pool.encode(joinBatch(buffers, bytes), this.key);
+        this.tail = this.tail.then(() => encoded).then((frame) => {
+            if (frame && generation === this.generation) this.send(frame, bytes);
+        });
+    }
+
+    // Flush, then send a control message (input_audio_buffer.commit) after
+    // everything pushed so far, through the same ordered path
+    sendAfter(message) {
+        this.flush();
+        if (!this.pool) {
+            this.send(message, 0);
+            return;
+        }
+        const generation = this.generation;
+        this.tail = this.tail.then(() => {
+            if (generation === this.generation) this.send(message, 0);
+        });
+    }
+
+    // Drop everything not yet sent (input_audio_buffer.clear)
+    clear() {
+        if (this.timer) {
+            clearTimeout(this.timer);
+            this.timer = null;
+        }
+        this.buffers = [];
+        this.bytes = 0;
+        this.generation++;
+    }
+}
+
+if (!isMainThread && workerData && workerData.uplinkEncoder) {
+    parentPort.on('message', ({ id, pcm }) => {
+        const frame = encodeAppend(Buffer.from(pcm.buffer, pcm.byteOffset, pcm.byteLength));
+        parentPort.postMessage({ id, frame }, [frame.buffer]);
+    });
+}
+
+module.exports = { encodeAppend, isQuiet, EncodePool, UplinkBatcher };
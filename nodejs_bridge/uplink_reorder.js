@@ -0,0 +1,255 @@
+// Uplink reorder window and loss concealment, per device, ahead of the
+// batcher (uplink.js).
+//
+// The device numbers its audio datagrams from 0 at the start of every
+// stream (IDLE -> USER_SPEAKING, or an interrupt, which resets the window).
+// A sequence that goes back is a new stream only when it is far behind
+// (LATE_SPAN) or a stream start after STREAM_GAP_MS without audio; anything
+// else that goes back is a late datagram or a duplicate, even a 0 (a
+// duplicated or overtaken first datagram). In-order datagrams pass
+// straight through. A datagram ahead of the sequence is held while the
+// missing ones may still arrive, for at most windowMs; then the hole is
+// concealed and the held audio released. Audio that arrives after its hole
+// was concealed is dropped, so the input buffer never gets spliced or
+// duplicated audio.
+//
+// Concealment is a crossfade between the waveforms on either side of the
+// hole, each mirrored into it and faded out over FADE_MS from the real
+// audio, leaving comfort noise at the tracked background level in the
+// middle of a long hole. Holes longer
+// than MAX_CONCEAL_MS are only counted: inventing that much audio would do
+// VAD and transcription more harm than the gap itself.
+const FRAME_MS = 40;                // the device's chunk
+const MAX_HELD = 16;                // datagrams held behind a hole, whatever windowMs says
+const MAX_CONCEAL_MS = 200;
+const FADE_MS = 60;
+const LATE_SPAN = 64;               // further behind than this: a new stream whose 0 was lost
+const STREAM_GAP_MS = 500;          // the device streams continuously while the user speaks
+
+function frameRms(pcm) {
+    const samples = pcm.length >> 1;
+    if (samples === 0) return 0;
+    let sum = 0;
+    for (let i = 0; i < samples; i++) {
+        const s = pcm.readInt16LE(i << 1);
+        sum += s * s;
+    }
+    return Math.sqrt(sum / samples);
+}
+
+class UplinkReorder {
+    // deliver(pcm, captureUs, recvUs, concealed) gets the audio in sequence
+    // order. windowMs 0 conceals a hole as soon as it is seen. sampleRate is
+    // the device's uplink rate (HELLO).
+    constructor(deliver, { windowMs = 80, sampleRate = 24000 } = {}) {
+        this.deliver = deliver;
+        this.windowMs = windowMs;
+        this.samplesPerMs = sampleRate / 1000;
+        this.nextSeq = null;
+        this.held = new Map();      // sequence -> { pcm, captureUs, recvUs }
+        this.missing = new Set();   // sequences passed over by the last LATE_SPAN (late if they turn up)
+        this.lastRecvUs = null;
+        this.timer = null;
+        this.last = null;           // last frame delivered (real or concealed)
+        this.noiseRms = null;
+        this.seed = 0x2545F491;
+
+        // Stats
+        this.received = 0;
+        this.lost = 0;              // datagrams never received in time
+        this.concealed = 0;         // lost datagrams replaced with concealment
+        this.reordered = 0;         // arrived out of order, put back in place
+        this.late = 0;              // arrived after their hole was concealed, dropped
+        this.duplicates = 0;
+    }
+
+    push(sequence, pcm, captureUs, recvUs) {
+        this.received++;
+        const idle = this.lastRecvUs !== null && recvUs - this.lastRecvUs > STREAM_GAP_MS * 1000;
+        this.lastRecvUs = recvUs;
+
+        if (this.nextSeq === null ||
+            (sequence < this.nextSeq && (this.nextSeq - sequence > LATE_SPAN ||
+                                         (idle && sequence * FRAME_MS <= MAX_CONCEAL_MS)))) {
+            this.startStream(sequence, recvUs);
+        } else if (sequence < this.nextSeq) {
+            if (this.missing.delete(sequence)) {
+                this.late++;
+            } else {
+                this.duplicates++;
+            }
+            return;
+        }
+
+        if (sequence > this.nextSeq) {
+            if (this.held.has(sequence)) {
+                this.duplicates++;
+                return;
+            }
+            this.held.set(sequence, { pcm, captureUs, recvUs });
+            if (this.held.size > MAX_HELD || this.windowMs <= 0) {
+                this.fillHole(recvUs);
+            } else if (!this.timer) {
+                this.timer = setTimeout(() => {
+                    this.timer = null;
+                    this.fillHole(null);
+                }, this.windowMs);
+            }
+            return;
+        }
+
+        if (this.held.size > 0) this.reordered++;
+        this.emit(pcm, captureUs, recvUs, false);
+        this.nextSeq = sequence + 1;
+        this.releaseHeld();
+    }
+
+    // Sequence restarted: whatever is held belongs to the old stream
+    startStream(sequence, recvUs) {
+        if (this.held.size > 0) this.flushHeld(recvUs);
+        this.missing.clear();
+        this.last = null;
+        // A lost (or overtaken) start of stream is a hole like any other; the
+        // middle of a stream (bridge restarted, device moved) is not
+        this.nextSeq = sequence * FRAME_MS <= MAX_CONCEAL_MS ? 0 : sequence;
+    }
+
+    // Conceal the hole before the first held datagram, then release what follows it
+    fillHole(recvUs) {
+        if (this.held.size === 0) return;
+        const first = Math.min(...this.held.keys());
+        const next = this.held.get(first);
+        this.conceal(first - this.nextSeq, next.pcm, next.captureUs, recvUs || next.recvUs);
+        for (let seq = Math.max(this.nextSeq, first - LATE_SPAN); seq < first; seq++) this.missing.add(seq);
+        for (const seq of this.missing) {
+            if (seq < first - LATE_SPAN) this.missing.delete(seq);
+        }
+        this.nextSeq = first;
+        this.releaseHeld();
+    }
+
+    releaseHeld() {
+        while (this.held.has(this.nextSeq)) {
+            const frame = this.held.get(this.nextSeq);
+            this.held.delete(this.nextSeq);
+            this.emit(frame.pcm, frame.captureUs, frame.recvUs, false);
+            this.nextSeq++;
+        }
+        if (this.held.size === 0 && this.timer) {
+            clearTimeout(this.timer);
+            this.timer = null;
+        } else if (this.held.size > 0 && !this.timer && this.windowMs > 0) {
+            this.timer = setTimeout(() => {
+                this.timer = null;
+                this.fillHole(null);
+            }, this.windowMs);
+        }
+    }
+
+    // Everything held, holes concealed, in order
+    flushHeld(recvUs) {
+        while (this.held.size > 0) this.fillHole(recvUs);
+    }
+
+    emit(pcm, captureUs, recvUs, concealed) {
+        if (!concealed) {
+            const rms = frameRms(pcm);
+            this.noiseRms = this.noiseRms === null || rms < this.noiseRms ? rms :
+                this.noiseRms + (rms - this.noiseRms) * 0.01;
+        }
+        this.last = { pcm, captureUs };
+        this.deliver(pcm, captureUs, recvUs, concealed);
+    }
+
+    // count missing frames between the last delivered frame and `after`
+    conceal(count, after, afterCaptureUs, recvUs) {
+        if (count <= 0) return;
+        this.lost += count;
+        const frameBytes = this.last ? this.last.pcm.length : FRAME_MS * this.samplesPerMs * 2;
+        const frameMs = frameBytes / 2 / this.samplesPerMs;
+        if (count * frameMs > MAX_CONCEAL_MS) return;
+        this.concealed += count;
+
+        const before = this.last ? this.last.pcm : null;
+        const samples = count * (frameBytes >> 1);
+        const pcm = this.synthesize(before, after, samples);
+        // Capture times continue the timeline of the real audio on either side
+        const startUs = afterCaptureUs ? afterCaptureUs - count * frameMs * 1000 :
+            (this.last && this.last.captureUs ? this.last.captureUs + frameMs * 1000 : null);
+        for (let i = 0; i < count; i++) {
+            this.emit(pcm.subarray(i * frameBytes, (i + 1) * frameBytes),
+                      startUs ? startUs + i * frameMs * 1000 : null, recvUs, true);
+        }
+    }
+
+    synthesize(before, after, samples) {
+        const out = Buffer.alloc(samples * 2);
+        const fade = FADE_MS * this.samplesPerMs;
+        const beforeLen = before ? before.length >> 1 : 0;
+        const afterLen = after ? after.length >> 1 : 0;
+        const noise = this.noiseRms || 0;
+        for (let i = 0; i < samples; i++) {
+            // Distance to real audio on each side, in samples
+            const fromBefore = i + 1;
+            const toAfter = samples - i;
+            const gBefore = beforeLen ? Math.max(0, 1 - fromBefore / fade) : 0;
+            const gAfter = afterLen ? Math.max(0, 1 - toAfter / fade) : 0;
+            const mix = (i + 1) / (samples + 1);
+
+            let s = 0;
+            // Both waveforms mirrored at the hole's edges, so each joins its real audio without a step
+            if (gBefore > 0) {
+                s += (1 - mix) * gBefore * before.readInt16LE((beforeLen - 1 - i % beforeLen) << 1);
+            }
+            if (gAfter > 0) {
+                s += mix * gAfter * after.readInt16LE(((toAfter - 1) % afterLen) << 1);
+            }
+            s += (1 - Math.max(gBefore, gAfter)) * noise * 1.732 * (this.random() * 2 - 1);
+            out.writeInt16LE(Math.max(-32768, Math.min(32767, Math.round(s))), i << 1);
+        }
+        return out;
+    }
+
+    random() {
+        // xorshift32, deterministic so replays conceal identically
+        let x = this.seed;
+        x ^= x << 13;
+        x ^= x >>> 17;
+        x ^= x << 5;
+        this.seed = x >>> 0;
+        return this.seed / 4294967296;
+    }
+
+    // Interrupt: the device restarts at 0; nothing held is wanted
+    reset() {
+        if (this.timer) {
+            clearTimeout(this.timer);
+            this.timer = null;
+        }
+        this.held.clear();
+        this.missing.clear();
+        this.nextSeq = null;
+        this.lastRecvUs = null;
+        this.last = null;
+    }
+
+    stats() {
+        const expected = this.received - this.late - this.duplicates + this.lost;
+        return {
+            received: this.received,
+            lost: this.lost,
+            lossPct: expected > 0 ? +(100 * this.lost / expected).toFixed(2) : 0,
+            concealed: this.concealed,
+            reordered: this.reordered,
+            late: this.late,
+            duplicates: this.duplicates
+        };
+    }
+}
+
+function formatUplinkStats(s) {
+    return `uplink ${s.received} datagrams, ${s.lost} lost (${s.lossPct}%), ${s.concealed} concealed, ` +
+           `${s.reordered} reordered, ${s.late} late, ${s.duplicates} duplicates`;
+}
+
+module.exports = { UplinkReorder, formatUplinkStats };
@@ -0,0 +1,198 @@
+// Pool of warm upstream Realtime sessions.
+//
+// Opening a session costs a TLS + WebSocket handshake and a session.update
+// round trip. The pool keeps `size` sessions that are already connected,
+// authenticated and configured (session.updated received), so a device that
+// connects, or whose upstream just dropped, gets one immediately. Every
+// session handed out is replaced in the background. A session is used by one
+// device only and closed with it, never returned: it holds that device's
+// conversation.
+//
+// acquire() never fails: while the API is unreachable, waiters queue and
+// connection attempts back off. Acquisition latency is recorded per acquire
+// (warm hit or wait for a new session).
+const { performance } = require('perf_hooks');
+const WebSocket = require('ws');
+const { LatencyHistogram } = require('./latency');
+
+const RETRY_MIN_MS = 500;
+const RETRY_MAX_MS = 10000;
+const WARM_MAX_AGE_MS = 10 * 60 * 1000;     // recycle idle sessions well before the API's limit
+const HANDSHAKE_TIMEOUT_MS = 10000;         // connect + session.update round trip
+
+class UpstreamPool {
+    // opts: { url, apiKey, sessionUpdate, size }
+    constructor(opts) {
+        this.url = opts.url;
+        this.apiKey = opts.apiKey;
+        this.sessionUpdate = JSON.stringify(opts.sessionUpdate);
+        this.size = opts.size;
+
+        this.ready = [];            // { ws, readyAt }
+        this.connecting = 0;
+        this.waiters = [];          // { resolve, start }
+        this.retryMs = RETRY_MIN_MS;
+        this.retryTimer = null;
+        this.closed = false;
+
+        this.acquireLatency = new LatencyHistogram();
+        this.warmHits = 0;
+        this.waits = 0;
+        this.failures = 0;
+
+        this.ageTimer = setInterval(() => this.recycleOld(), 60000);
+        this.ageTimer.unref();
+    }
+
+    start() {
+        this.fill();
+    }
+
+    // Keep ready + connecting at size, plus one per waiting device
+    fill() {
+        if (this.closed || this.retryTimer) return;
+        while (this.ready.length + this.connecting < this.size + this.waiters.length) {
+            this.open();
+        }
+    }
+
+    open() {
+        this.connecting++;
+        const ws = new WebSocket(this.url, {
+            headers: {
+                'Authorization': `Bearer ${this.apiKey}`,
+                'OpenAI-Beta': 'realtime=v1'
+            }
+        });
+        let settled = false;
+        // A socket that never answers session.update would otherwise hold
+        // `connecting` up forever and stop fill() from replacing it
+        const timer = setTimeout(() => fail('handshake timeout'), HANDSHAKE_TIMEOUT_MS);
+
+        const fail = (reason) => {
+            if (settled) return;
+            settled = true;
+            clearTimeout(timer);
+            this.connecting--;
+            this.failures++;
+            ws.removeAllListeners();
+            ws.on('error', () => {});
+            ws.terminate();
+            // Sessions opened together fail together: one retry (and one
+            // backoff step) per round, not one per failed session
+            if (this.retryTimer) {
+                console.error(`❌ Upstream session failed (${reason}), retry already scheduled`);
+                return;
+            }
+            console.error(`❌ Upstream session failed (${reason}), retrying in ${this.retryMs} ms`);
+            this.retryTimer = setTimeout(() => {
+                this.retryTimer = null;
+                this.fill();
+            }, this.retryMs);
+            this.retryMs = Math.min(this.retryMs * 2, RETRY_MAX_MS);
+        };
+
+        ws.on('open', () => ws.send(this.sessionUpdate));
+        ws.on('message', (data) => {
+            let message;
+            try {
+                message = JSON.parse(data.toString());
+            } catch (e) {
+                return;
+            }
+            if (message.type === 'session.updated' && !settled) {
+                settled = true;
+                clearTimeout(timer);
+                this.connecting--;
+                this.retryMs = RETRY_MIN_MS;
+                this.onReady(ws);
+            } else if (message.type === 'error' && !settled) {
+                fail(message.error && message.error.message || 'error event');
+            }
+        });
+        ws.on('error', (error) => fail(error.message));
+        ws.on('close', (code) => fail(`closed ${code}`));
+    }
+
+    onReady(ws) {
+        // Idle in the pool: a close just means one fewer warm session
+        ws.removeAllListeners();
+        ws.on('error', () => {});
+        ws.on('close', () => {
+            this.ready = this.ready.filter((entry) => entry.ws !== ws);
+            this.fill();
+        });
+
+        const waiter = this.waiters.shift();
+        if (waiter) {
+            this.handOut(ws, waiter.start, false, waiter.resolve);
+        } else {
+            this.ready.push({ ws, readyAt: Date.now() });
+        }
+    }
+
+    handOut(ws, start, warm, resolve) {
+        ws.removeAllListeners();
+        const acquireMs = performance.now() - start;
+        this.acquireLatency.add(acquireMs);
+        if (warm) this.warmHits++;
+        else this.waits++;
+        resolve({ ws, acquireMs, warm });
+        this.fill();
+    }
+
+    // Resolves to { ws, acquireMs, warm }: an open, configured session with no listeners
+    acquire() {
+        const start = performance.now();
+        return new Promise((resolve) => {
+            while (this.ready.length > 0) {
+                const { ws } = this.ready.shift();
+                if (ws.readyState === WebSocket.OPEN) {
+                    this.handOut(ws, start, true, resolve);
+                    return;
+                }
+            }
+            this.waiters.push({ resolve, start });
+            this.fill();
+        });
+    }
+
+    recycleOld() {
+        const now = Date.now();
+        for (const entry of this.ready.filter((e) => now - e.readyAt > WARM_MAX_AGE_MS)) {
+            entry.ws.close();   // the close handler refills
+        }
+    }
+
+    stats() {
+        return {
+            warm: this.ready.length,
+            connecting: this.connecting,
+            waiting: this.waiters.length,
+            warmHits: this.warmHits,
+            waits: this.waits,
+            failures: this.failures,
+            acquire: this.acquireLatency.summary()
+        };
+    }
+
+    close() {
+        this.closed = true;
+        clearInterval(this.ageTimer);
+        if (this.retryTimer) clearTimeout(this.retryTimer);
+        for (const { ws } of this.ready) {
+            ws.removeAllListeners();
+            ws.on('error', () => {});
+            ws.close();
+        }
+        this.ready = [];
+    }
+}
+
+function formatPoolStats(s) {
+    return `upstream pool: ${s.warm} warm, ${s.connecting} connecting, ${s.waiting} waiting; ` +
+           `acquire p50 ${s.acquire.p50Ms} ms, p99 ${s.acquire.p99Ms} ms ` +
+           `(${s.warmHits} warm, ${s.waits} waited, ${s.failures} failed connects)`;
+}
+
+module.exports = { UpstreamPool, formatPoolStats };